@@ -0,0 +1,285 @@
+/**
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __STOUT_JSONIFY_HPP__
+#define __STOUT_JSONIFY_HPP__
+
+#include <stdio.h>
+#include <string.h>
+
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include <stout/json.hpp>
+#include <stout/stringify.hpp>
+
+// Provides a streaming alternative to building a JSON::Value and
+// then stringifying it: the writers below serialize JSON straight
+// into a string, without any intermediate JSON::Object or
+// JSON::Array, for example:
+//
+//   std::string json = jsonify([&](JSON::ObjectWriter* writer) {
+//     writer->field("name", framework.name());
+//     writer->field("tasks", [&](JSON::ArrayWriter* writer) {
+//       foreach (const Task& task, tasks) {
+//         writer->element(task.name());
+//       }
+//     });
+//   });
+//
+// A field (or element) can be a boolean, a number, a string, an
+// existing JSON::Value, or a function taking a JSON::ObjectWriter* or
+// a JSON::ArrayWriter* which writes a nested object or array.
+//
+// The output is identical to stringifying the equivalent JSON::Value
+// except that object fields appear in the order they were written
+// (rather than sorted), so callers are responsible for not writing
+// the same field twice.
+namespace JSON {
+
+class ObjectWriter;
+class ArrayWriter;
+
+namespace internal {
+
+inline void write(std::string* out, bool value)
+{
+  out->append(value ? "true" : "false");
+}
+
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value>::type
+write(std::string* out, T value)
+{
+  if (std::is_signed<T>::value) {
+    out->append(std::to_string(static_cast<long long>(value)));
+  } else {
+    out->append(std::to_string(static_cast<unsigned long long>(value)));
+  }
+}
+
+
+// Formats the value like a floating point JSON::Number, see
+// 'operator<<(std::ostream&, const Number&)', except that trailing
+// zeroes are only removed if there is no exponent.
+inline void write(std::string* out, double value)
+{
+  char buffer[50] {}; // More than long enough for the specified precision.
+  int size = snprintf(
+      buffer,
+      sizeof(buffer),
+      "%#.*g",
+      std::numeric_limits<double>::digits10,
+      value);
+
+  if (strchr(buffer, 'e') == NULL) {
+    while (size > 1 && buffer[size - 1] == '0') {
+      size--;
+    }
+  }
+
+  out->append(buffer, size);
+
+  // NOTE: valid JSON numbers cannot end with a '.'.
+  if (buffer[size - 1] == '.') {
+    out->push_back('0');
+  }
+}
+
+
+// Escapes the string the same way as 'operator<<(std::ostream&,
+// const String&)' does (i.e., like picojson).
+// TODO(benh): This escaping DOES NOT handle unicode, it encodes as ASCII.
+inline void write(std::string* out, const char* value, size_t size)
+{
+  out->push_back('"');
+
+  for (size_t i = 0; i < size; i++) {
+    const char c = value[i];
+    switch (c) {
+      case '"':  out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '/':  out->append("\\/"); break;
+      case '\b': out->append("\\b"); break;
+      case '\f': out->append("\\f"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+          char buffer[7];
+          snprintf(buffer, sizeof(buffer), "\\u%04x", c & 0xff);
+          out->append(buffer, 6);
+        } else {
+          out->push_back(c);
+        }
+        break;
+    }
+  }
+
+  out->push_back('"');
+}
+
+
+inline void write(std::string* out, const std::string& value)
+{
+  write(out, value.data(), value.size());
+}
+
+
+inline void write(std::string* out, const char* value)
+{
+  write(out, value, strlen(value));
+}
+
+
+inline void write(std::string* out, const Object& object)
+{
+  out->append(stringify(object));
+}
+
+
+inline void write(std::string* out, const Array& array)
+{
+  out->append(stringify(array));
+}
+
+
+inline void write(std::string* out, const Value& value)
+{
+  out->append(stringify(value));
+}
+
+
+template <typename F>
+auto write(std::string* out, const F& f)
+  -> decltype(f(static_cast<ObjectWriter*>(NULL)), void());
+
+
+template <typename F>
+auto write(std::string* out, const F& f)
+  -> decltype(f(static_cast<ArrayWriter*>(NULL)), void());
+
+} // namespace internal {
+
+
+// Writes a JSON object into the given string: the opening brace when
+// constructed and the closing brace when destructed.
+class ObjectWriter
+{
+public:
+  explicit ObjectWriter(std::string* _out) : out(_out), empty(true)
+  {
+    out->push_back('{');
+  }
+
+  ~ObjectWriter()
+  {
+    out->push_back('}');
+  }
+
+  template <typename T>
+  void field(const std::string& key, const T& value)
+  {
+    if (!empty) {
+      out->push_back(',');
+    }
+
+    empty = false;
+
+    internal::write(out, key);
+    out->push_back(':');
+    internal::write(out, value);
+  }
+
+private:
+  ObjectWriter(const ObjectWriter&) = delete;
+  ObjectWriter& operator=(const ObjectWriter&) = delete;
+
+  std::string* out;
+  bool empty;
+};
+
+
+// Writes a JSON array into the given string: the opening bracket
+// when constructed and the closing bracket when destructed.
+class ArrayWriter
+{
+public:
+  explicit ArrayWriter(std::string* _out) : out(_out), empty(true)
+  {
+    out->push_back('[');
+  }
+
+  ~ArrayWriter()
+  {
+    out->push_back(']');
+  }
+
+  template <typename T>
+  void element(const T& value)
+  {
+    if (!empty) {
+      out->push_back(',');
+    }
+
+    empty = false;
+
+    internal::write(out, value);
+  }
+
+private:
+  ArrayWriter(const ArrayWriter&) = delete;
+  ArrayWriter& operator=(const ArrayWriter&) = delete;
+
+  std::string* out;
+  bool empty;
+};
+
+
+namespace internal {
+
+template <typename F>
+auto write(std::string* out, const F& f)
+  -> decltype(f(static_cast<ObjectWriter*>(NULL)), void())
+{
+  ObjectWriter writer(out);
+  f(&writer);
+}
+
+
+template <typename F>
+auto write(std::string* out, const F& f)
+  -> decltype(f(static_cast<ArrayWriter*>(NULL)), void())
+{
+  ArrayWriter writer(out);
+  f(&writer);
+}
+
+} // namespace internal {
+} // namespace JSON {
+
+
+// Returns the JSON written by the given function, which takes either
+// a JSON::ObjectWriter* or a JSON::ArrayWriter*.
+template <typename F>
+std::string jsonify(const F& f)
+{
+  std::string out;
+  JSON::internal::write(&out, f);
+  return out;
+}
+
+#endif // __STOUT_JSONIFY_HPP__
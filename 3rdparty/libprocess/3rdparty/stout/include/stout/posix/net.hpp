@@ -90,6 +90,11 @@ inline Try<Bytes> contentLength(const std::string& url)
   curl_easy_setopt(curl, CURLOPT_HEADER, 1);
   curl_easy_setopt(curl, CURLOPT_NOBODY, 1);
 
+  // Keep libcurl from using signals (e.g., SIGALRM for name
+  // resolution timeouts), which is unsafe when transfers are
+  // performed by multiple threads.
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
   CURLcode curlErrorCode = curl_easy_perform(curl);
   if (curlErrorCode != 0) {
     curl_easy_cleanup(curl);
@@ -111,14 +116,29 @@ inline Try<Bytes> contentLength(const std::string& url)
 
 // Returns the HTTP response code resulting from attempting to
 // download the specified HTTP or FTP URL into a file at the specified
-// path.
-inline Try<int> download(const std::string& url, const std::string& path)
+// path. If 'resume' is true and the file already exists, only the
+// remainder of the resource beyond the size of the file is requested
+// and appended to the file (an HTTP server then responds with 206).
+inline Try<int> download(
+    const std::string& url,
+    const std::string& path,
+    bool resume = false)
 {
   initialize();
 
+  off_t offset = 0;
+  if (resume && os::exists(path)) {
+    Try<Bytes> size = os::stat::size(path);
+    if (size.isError()) {
+      return Error(size.error());
+    }
+
+    offset = size.get().bytes();
+  }
+
   Try<int> fd = os::open(
       path,
-      O_CREAT | O_WRONLY | O_CLOEXEC,
+      O_CREAT | O_WRONLY | O_CLOEXEC | (offset > 0 ? O_APPEND : O_TRUNC),
       S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 
   if (fd.isError()) {
@@ -137,7 +157,14 @@ inline Try<int> download(const std::string& url, const std::string& path)
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, NULL);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
 
-  FILE* file = fdopen(fd.get(), "w");
+  // See comment in 'contentLength' above.
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+  if (offset > 0) {
+    curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) offset);
+  }
+
+  FILE* file = fdopen(fd.get(), offset > 0 ? "a" : "w");
   if (file == NULL) {
     return ErrnoError("Failed to open file handle of '" + path + "'");
   }
@@ -36,7 +36,10 @@ inline Try<Bytes> contentLength(const std::string& url)
 // Returns the HTTP response code resulting from attempting to
 // download the specified HTTP or FTP URL into a file at the specified
 // path.
-inline Try<int> download(const std::string& url, const std::string& path)
+inline Try<int> download(
+    const std::string& url,
+    const std::string& path,
+    bool resume = false)
 {
   UNIMPLEMENTED;
 }
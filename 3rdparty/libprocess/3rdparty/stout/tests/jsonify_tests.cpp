@@ -0,0 +1,128 @@
+/**
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License
+*/
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <stout/foreach.hpp>
+#include <stout/gtest.hpp>
+#include <stout/json.hpp>
+#include <stout/jsonify.hpp>
+#include <stout/stringify.hpp>
+
+using std::string;
+using std::vector;
+
+
+TEST(JsonifyTest, Values)
+{
+  EXPECT_EQ("[true,false]", jsonify([](JSON::ArrayWriter* writer) {
+    writer->element(true);
+    writer->element(false);
+  }));
+
+  EXPECT_EQ("[0,-1,42,18446744073709551615]",
+            jsonify([](JSON::ArrayWriter* writer) {
+    writer->element(0);
+    writer->element(-1);
+    writer->element(42U);
+    writer->element(UINT64_MAX);
+  }));
+
+  // Floating point values are formatted like a JSON::Number.
+  const vector<double> values = {0.0, 1.0, -1.0, 1.5, 1.0 / 3, 1e-5};
+
+  foreach (double value, values) {
+    EXPECT_EQ("[" + stringify(JSON::Number(value)) + "]",
+              jsonify([=](JSON::ArrayWriter* writer) {
+      writer->element(value);
+    }));
+  }
+
+  EXPECT_EQ("[\"\",\"value\",\"literal\"]",
+            jsonify([](JSON::ArrayWriter* writer) {
+    writer->element(string());
+    writer->element(string("value"));
+    writer->element("literal");
+  }));
+
+  // Strings are escaped like a JSON::String.
+  const string binary("\"\\/\b\f\n\r\t\x00\x19 !#[]\x7F\xFF", 17);
+
+  EXPECT_EQ("[" + stringify(JSON::String(binary)) + "]",
+            jsonify([&](JSON::ArrayWriter* writer) {
+    writer->element(binary);
+  }));
+}
+
+
+TEST(JsonifyTest, Nested)
+{
+  EXPECT_EQ("{}", jsonify([](JSON::ObjectWriter*) {}));
+  EXPECT_EQ("[]", jsonify([](JSON::ArrayWriter*) {}));
+
+  JSON::Object labels;
+  labels.values["key"] = "value";
+
+  string json = jsonify([&](JSON::ObjectWriter* writer) {
+    writer->field("name", "framework");
+    writer->field("active", true);
+    writer->field("tasks", [](JSON::ArrayWriter* writer) {
+      for (int i = 0; i < 2; i++) {
+        writer->element([=](JSON::ObjectWriter* writer) {
+          writer->field("id", i);
+          writer->field("cpus", 0.5);
+          writer->field("statuses", [](JSON::ArrayWriter*) {});
+        });
+      }
+    });
+    writer->field("labels", labels);
+  });
+
+  EXPECT_EQ(
+      "{"
+        "\"name\":\"framework\","
+        "\"active\":true,"
+        "\"tasks\":["
+          "{\"id\":0,\"cpus\":0.5,\"statuses\":[]},"
+          "{\"id\":1,\"cpus\":0.5,\"statuses\":[]}"
+        "],"
+        "\"labels\":{\"key\":\"value\"}"
+      "}",
+      json);
+
+  // The output is the same as for the equivalent JSON::Value.
+  JSON::Object object;
+  object.values["name"] = "framework";
+  object.values["active"] = true;
+  object.values["labels"] = labels;
+
+  JSON::Array tasks;
+  for (int i = 0; i < 2; i++) {
+    JSON::Object task;
+    task.values["id"] = i;
+    task.values["cpus"] = 0.5;
+    task.values["statuses"] = JSON::Array();
+    tasks.values.push_back(task);
+  }
+  object.values["tasks"] = tasks;
+
+  Try<JSON::Object> parse = JSON::parse<JSON::Object>(json);
+  ASSERT_SOME(parse);
+  EXPECT_EQ(object, parse.get());
+}
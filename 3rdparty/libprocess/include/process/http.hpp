@@ -755,6 +755,7 @@ public:
 private:
   Connection(const network::Socket& s);
   friend Future<Connection> connect(const URL&);
+  friend Future<Connection> connect(const network::Socket&);
 
   // Forward declaration.
   struct Data;
@@ -766,6 +767,16 @@ private:
 Future<Connection> connect(const URL& url);
 
 
+/**
+ * Returns a connection over a socket that is already connected to
+ * the server, e.g., a unix domain socket that 'connect(const URL&)'
+ * can't connect to. The connection takes over closing the socket.
+ * Since requests are still encoded from their 'URL', the URL should
+ * include a domain (used for the 'Host' header).
+ */
+Future<Connection> connect(const network::Socket& socket);
+
+
 // TODO(bmahler): Consolidate these functions into a single
 // http::request function that takes a 'Request' object.
 
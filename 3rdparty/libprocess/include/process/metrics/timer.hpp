@@ -89,6 +89,19 @@ public:
     return t;
   }
 
+  // Record the duration of an event that was timed elsewhere, e.g.,
+  // by another program.
+  void record(const T& duration)
+  {
+    const double value = duration.value();
+
+    synchronized (data->lock) {
+      data->lastValue = value;
+    }
+
+    push(value);
+  }
+
   // Time an asynchronous event.
   template <typename U>
   Future<U> time(const Future<U>& future)
@@ -334,6 +334,10 @@ private:
   // Active references.
   std::atomic_long refs;
 
+  // Index of the worker thread that last ran this process (or -1),
+  // used as a hint for which run queue to put the process on.
+  std::atomic_long worker;
+
   // Process PID.
   UPID pid;
 };
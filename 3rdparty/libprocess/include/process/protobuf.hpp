@@ -20,7 +20,9 @@
 #include <google/protobuf/message.h>
 #include <google/protobuf/repeated_field.h>
 
+#include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <process/defer.hpp>
@@ -31,6 +33,33 @@
 #include <stout/lambda.hpp>
 
 
+namespace process {
+
+// A protocol buffer message that gets serialized once, so that it can
+// be sent to many processes (e.g., when broadcasting it) without
+// serializing it again for each of them. It is immutable, hence
+// copies share the serialized data rather than copying it.
+class Serialized
+{
+public:
+  explicit Serialized(const google::protobuf::Message& message)
+    : type(message.GetTypeName()),
+      bytes(new std::string(message.SerializeAsString())) {}
+
+  // Returns the name of the message type, i.e., the name that the
+  // message gets sent with.
+  const std::string& name() const { return type; }
+
+  const std::string& data() const { return *bytes; }
+
+private:
+  std::string type;
+  std::shared_ptr<const std::string> bytes;
+};
+
+} // namespace process {
+
+
 // Provides an implementation of process::post that for a protobuf.
 namespace process {
 
@@ -118,6 +147,15 @@ protected:
                               data.data(), data.size());
   }
 
+  // Sends a message that has already been serialized, see
+  // process::Serialized.
+  void send(const process::UPID& to,
+            const process::Serialized& message)
+  {
+    process::Process<T>::send(to, message.name(),
+                              message.data().data(), message.data().size());
+  }
+
   using process::Process<T>::send;
 
   void reply(const google::protobuf::Message& message)
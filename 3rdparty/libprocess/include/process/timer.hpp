@@ -25,6 +25,11 @@
 
 namespace process {
 
+// Forward declarations.
+namespace clock {
+class Timers;
+} // namespace clock {
+
 // Timer represents a delayed thunk, that can get created (scheduled)
 // and canceled using the Clock.
 
@@ -60,6 +65,7 @@ public:
 
 private:
   friend class Clock;
+  friend class clock::Timers;
 
   Timer(long _id,
         const Timeout& _t,
@@ -14,6 +14,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <list>
 #include <map>
 #include <mutex>
@@ -24,10 +25,13 @@
 #include <process/process.hpp>
 #include <process/time.hpp>
 #include <process/timeout.hpp>
+#include <process/timer.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/lambda.hpp>
+#include <stout/option.hpp>
 #include <stout/synchronized.hpp>
 #include <stout/try.hpp>
 #include <stout/unreachable.hpp>
@@ -41,19 +45,329 @@ using std::set;
 
 namespace process {
 
-// We store the timers in a map of lists indexed by the timeout of the
-// timer so that we can have two timers that have the same timeout. We
-// exploit that the map is SORTED!
-static map<Time, list<Timer>>* timers = new map<Time, list<Timer>>();
-static recursive_mutex* timers_mutex = new recursive_mutex();
-
-
 // We namespace the clock related variables to keep them well
 // named. In the future we'll probably want to associate a clock with
 // a specific ProcessManager/SocketManager instance pair, so this will
 // likely change.
 namespace clock {
 
+// Stores the pending timers in a hierarchical timing wheel, so that
+// adding and canceling a timer takes constant time no matter how
+// many timers are pending.
+//
+// Level 'k' of the wheel consists of SLOTS buckets which each cover
+// SLOTS^k ticks of RESOLUTION, relative to the tick of the 'cursor'.
+// Rather than walking the wheel tick by tick, the non-empty buckets
+// are kept sorted by the tick they expire at, which bounds the work
+// for expiring timers by the number of buckets rather than by the
+// time that has passed (e.g., when advancing a paused clock). When
+// a bucket above the lowest level expires its timers get moved to
+// lower levels, so each timer gets moved at most LEVELS times.
+class Timers
+{
+public:
+  Timers() : cursor(0)
+  {
+    for (int level = 0; level < LEVELS; level++) {
+      for (int slot = 0; slot < SLOTS; slot++) {
+        buckets[level][slot].level = level;
+        buckets[level][slot].expiration = 0;
+      }
+    }
+  }
+
+  bool empty() const
+  {
+    return index.empty();
+  }
+
+  void add(const Timer& timer)
+  {
+    Bucket* bucket = locate(timer.timeout().time());
+
+    Location location;
+    location.bucket = bucket;
+    location.iterator = bucket->timers.insert(bucket->timers.end(), timer);
+
+    index[timer.id] = location;
+
+    added(bucket, timer);
+  }
+
+  bool cancel(const Timer& timer)
+  {
+    Option<Location> location = index.get(timer.id);
+    if (location.isNone()) {
+      return false;
+    }
+
+    index.erase(timer.id);
+
+    Bucket* bucket = location.get().bucket;
+    bucket->timers.erase(location.get().iterator);
+
+    if (bucket->timers.empty()) {
+      queue.erase(bucket);
+    } else if (bucket->earliest == timer.timeout().time()) {
+      bucket->earliest = None();
+    }
+
+    return true;
+  }
+
+  // Removes and returns the timers that have expired by 'now', in the
+  // order of their timeouts (and creation, for equal timeouts).
+  list<Timer> expire(const Time& now)
+  {
+    const int64_t current = tick(now);
+
+    list<Timer> expired;
+
+    while (!queue.empty()) {
+      Bucket* bucket = *queue.begin();
+      if (bucket->expiration > current) {
+        break;
+      }
+
+      queue.erase(queue.begin());
+
+      cursor = std::max(cursor, bucket->expiration);
+      bucket->earliest = None();
+
+      if (bucket->level > 0) {
+        // Move the timers to the lower levels, which are relative
+        // to the new 'cursor'.
+        while (!bucket->timers.empty()) {
+          const Timer& timer = bucket->timers.front();
+
+          Bucket* lower = locate(timer.timeout().time());
+          CHECK_LT(lower->level, bucket->level);
+
+          index[timer.id].bucket = lower;
+
+          lower->timers.splice(
+              lower->timers.end(),
+              bucket->timers,
+              bucket->timers.begin());
+
+          added(lower, lower->timers.back());
+        }
+
+        continue;
+      }
+
+      remove(bucket, now, &expired);
+
+      if (!bucket->timers.empty()) {
+        // Only the bucket of the 'current' tick can contain timers
+        // which have not yet expired, so this is the last bucket
+        // to look at.
+        CHECK_EQ(current, bucket->expiration);
+        queue.insert(bucket);
+        break;
+      }
+    }
+
+    // If the clock was stepped backwards, i.e., 'now' is before the
+    // 'cursor', the bucket of the 'cursor' has not expired yet but it
+    // can still contain timers that are due, since all the timers up
+    // to the 'cursor' get placed into it (see 'locate'). All the
+    // other buckets only contain timers after the 'cursor'.
+    if (current < cursor) {
+      Bucket* bucket = &buckets[0][cursor % SLOTS];
+
+      if (bucket->expiration == cursor && !bucket->timers.empty()) {
+        bucket->earliest = None();
+
+        remove(bucket, now, &expired);
+
+        if (bucket->timers.empty()) {
+          queue.erase(bucket);
+        }
+      }
+    }
+
+    cursor = std::max(cursor, current);
+
+    expired.sort([](const Timer& left, const Timer& right) {
+      if (left.timeout().time() != right.timeout().time()) {
+        return left.timeout().time() < right.timeout().time();
+      }
+      return left.id < right.id;
+    });
+
+    return expired;
+  }
+
+  // Returns the time at which the next timer expires. When the next
+  // timer is not on the lowest level of the wheel this returns the
+  // earlier time at which it needs to be moved to a lower level.
+  Option<Time> next()
+  {
+    if (queue.empty()) {
+      return None();
+    }
+
+    Bucket* bucket = *queue.begin();
+
+    if (bucket->level > 0) {
+      return Time::epoch() + Nanoseconds(bucket->expiration * RESOLUTION);
+    }
+
+    if (bucket->earliest.isNone()) {
+      foreach (const Timer& timer, bucket->timers) {
+        if (bucket->earliest.isNone() ||
+            timer.timeout().time() < bucket->earliest.get()) {
+          bucket->earliest = timer.timeout().time();
+        }
+      }
+    }
+
+    return bucket->earliest;
+  }
+
+private:
+  // The resolution of the wheel in nanoseconds.
+  static const int64_t RESOLUTION = 1000000;
+
+  static const int BITS = 6;
+  static const int SLOTS = 1 << BITS;
+
+  // Enough levels to hold any timeout up to 'Time::max()'.
+  static const int LEVELS = 8;
+
+  struct Bucket
+  {
+    int level;
+
+    // The first tick covered by this bucket, at which its timers
+    // either expire or get moved to a lower level.
+    int64_t expiration;
+
+    list<Timer> timers;
+
+    // Cached timeout of the earliest timer, None if it is unknown.
+    Option<Time> earliest;
+  };
+
+  // Orders the buckets by their expiration. Buckets that expire at
+  // the same tick are ordered from the highest level to the lowest,
+  // so that a tick's timers are all on the lowest level by the time
+  // its bucket expires.
+  struct Order
+  {
+    bool operator()(const Bucket* left, const Bucket* right) const
+    {
+      if (left->expiration != right->expiration) {
+        return left->expiration < right->expiration;
+      } else if (left->level != right->level) {
+        return left->level > right->level;
+      }
+      return left < right;
+    }
+  };
+
+  struct Location
+  {
+    Bucket* bucket;
+    list<Timer>::iterator iterator;
+  };
+
+  static int64_t tick(const Time& time)
+  {
+    // Timeouts that overflowed into negative times expire right away.
+    return std::max<int64_t>(0, time.duration().ns()) / RESOLUTION;
+  }
+
+  // Returns the bucket that a timer with the specified timeout
+  // belongs to, relative to the 'cursor'.
+  Bucket* locate(const Time& time)
+  {
+    const int64_t timeout = tick(time);
+
+    // Timers that expire at or before the 'cursor' go in the bucket
+    // of the 'cursor' so they expire with the next batch. This also
+    // covers the timers that are due when the clock was stepped
+    // backwards, i.e., are placed relative to the earlier of the
+    // 'cursor' and the current time, see 'expire'.
+    if (timeout <= cursor) {
+      return locate(0, cursor);
+    }
+
+    for (int level = 0; level < LEVELS; level++) {
+      const int shift = BITS * level;
+      const int64_t start = (cursor >> shift) << shift;
+
+      if (timeout - start < (int64_t(SLOTS) << shift)) {
+        return locate(level, (timeout >> shift) << shift);
+      }
+    }
+
+    UNREACHABLE();
+  }
+
+  Bucket* locate(int level, int64_t expiration)
+  {
+    Bucket* bucket = &buckets[level][(expiration >> (BITS * level)) % SLOTS];
+
+    // Only empty buckets are reused for another range of ticks, since
+    // the expiration of a queued bucket must not change.
+    if (bucket->timers.empty()) {
+      bucket->expiration = expiration;
+    }
+
+    CHECK_EQ(expiration, bucket->expiration);
+    return bucket;
+  }
+
+  // Moves the timers of a (lowest level) bucket that are due by 'now'
+  // to 'expired'.
+  void remove(Bucket* bucket, const Time& now, list<Timer>* expired)
+  {
+    list<Timer>::iterator iterator = bucket->timers.begin();
+    while (iterator != bucket->timers.end()) {
+      if (iterator->timeout().time() <= now) {
+        index.erase(iterator->id);
+        expired->push_back(*iterator);
+        iterator = bucket->timers.erase(iterator);
+      } else {
+        ++iterator;
+      }
+    }
+  }
+
+  // Updates the bookkeeping of a bucket after adding a timer to it.
+  void added(Bucket* bucket, const Timer& timer)
+  {
+    if (bucket->timers.size() == 1) {
+      bucket->earliest = timer.timeout().time();
+      queue.insert(bucket);
+    } else if (bucket->earliest.isSome() &&
+               timer.timeout().time() < bucket->earliest.get()) {
+      bucket->earliest = timer.timeout().time();
+    }
+  }
+
+  // The tick up to which the timers have been expired.
+  int64_t cursor;
+
+  Bucket buckets[LEVELS][SLOTS];
+
+  // The non-empty buckets.
+  set<Bucket*, Order> queue;
+
+  hashmap<uint64_t, Location> index;
+};
+
+} // namespace clock {
+
+
+static clock::Timers* timers = new clock::Timers();
+static recursive_mutex* timers_mutex = new recursive_mutex();
+
+
+namespace clock {
+
 map<ProcessBase*, Time>* currents = new map<ProcessBase*, Time>();
 
 Time* initial = new Time(Time::epoch());
@@ -84,20 +398,17 @@ set<Time>* ticks = new set<Time>();
 // timers are expired. Note that we don't manipulate 'timers' directly
 // so that it's clear from the callsite that the use of 'timers' is
 // within a 'synchronized' block.
-//
-// TODO(benh): Create a generic 'Timers' abstraction which hides this
-// and more away (i.e., all manipulations of 'timers' below).
-Option<Time> next(const map<Time, list<Timer>>& timers)
+Option<Time> next(Timers* timers)
 {
-  if (!timers.empty()) {
-    Time first = timers.begin()->first;
+  const Option<Time> first = timers->next();
 
+  if (first.isSome()) {
     // If the clock is paused and no timers are expired, the
     // timers cannot fire until the clock is advanced, so we
     // return None() here. Note that we pass NULL to ensure
     // that this looks at the global clock, since this can be
     // called from a Process context through Clock::timer.
-    if (Clock::paused() && first > Clock::now(NULL)) {
+    if (Clock::paused() && first.get() > Clock::now(NULL)) {
       return None();
     }
 
@@ -118,7 +429,7 @@ void tick(const Time& time);
 // a 'synchronized' block.
 // TODO(bmahler): Consider taking an optional 'now' to avoid
 // excessive syscalls via Clock::now(NULL).
-void scheduleTick(const map<Time, list<Timer>>& timers, set<Time>* ticks)
+void scheduleTick(Timers* timers, set<Time>* ticks)
 {
   // Determine when the next 'tick' should fire.
   const Option<Time> next = clock::next(timers);
@@ -150,30 +461,22 @@ void tick(const Time& time)
 
     VLOG(3) << "Handling timers up to " << now;
 
-    foreachkey (const Time& timeout, *timers) {
-      if (timeout > now) {
-        break;
-      }
+    // Remove the timers that timed out.
+    timedout = timers->expire(now);
 
-      VLOG(3) << "Have timeout(s) at " << timeout;
+    // Need to toggle 'settling' so that we don't prematurely say
+    // we're settled until after the timers are executed below,
+    // outside of the critical section.
+    if (!timedout.empty()) {
+      VLOG(3) << "Have " << timedout.size() << " timeout(s) up to " << now;
 
-      // Need to toggle 'settling' so that we don't prematurely say
-      // we're settled until after the timers are executed below,
-      // outside of the critical section.
       if (clock::paused) {
         clock::settling = true;
       }
-
-      foreach (const Timer& timer, (*timers)[timeout]) {
-        timedout.push_back(timer);
-      }
     }
 
-    // Now erase the range of timers that timed out.
-    timers->erase(timers->begin(), timers->upper_bound(now));
-
     // Okay, so the timeout for the next timer should not have fired.
-    CHECK(timers->empty() || (timers->begin()->first > now));
+    CHECK(timers->empty() || (timers->next().get() > now));
 
     // Remove this tick from the scheduled 'ticks', it may have
     // been removed already if the clock was paused / manipulated
@@ -181,7 +484,7 @@ void tick(const Time& time)
     ticks->erase(time);
 
     // Schedule another "tick" if necessary.
-    scheduleTick(*timers, ticks);
+    scheduleTick(timers, ticks);
   }
 
   (*clock::callback)(timedout);
@@ -191,8 +494,7 @@ void tick(const Time& time)
   // executing expired timers.
   synchronized (timers_mutex) {
     if (clock::paused &&
-        (timers->size() == 0 ||
-         timers->begin()->first > *clock::current)) {
+        (timers->empty() || timers->next().get() > *clock::current)) {
       VLOG(3) << "Clock has settled";
       clock::settling = false;
     }
@@ -262,17 +564,13 @@ Timer Clock::timer(
 
   // Add the timer.
   synchronized (timers_mutex) {
-    if (timers->size() == 0 ||
-        timer.timeout().time() < timers->begin()->first) {
-      // Need to interrupt the loop to update/set timer repeat.
-      (*timers)[timer.timeout().time()].push_back(timer);
+    const Option<Time> next = timers->next();
 
-      // Schedule another "tick" if necessary.
-      clock::scheduleTick(*timers, clock::ticks);
-    } else {
-      // Timer repeat is adequate, just add the timeout.
-      CHECK(timers->size() >= 1);
-      (*timers)[timer.timeout().time()].push_back(timer);
+    timers->add(timer);
+
+    if (next.isNone() || timers->next().get() < next.get()) {
+      // Need to interrupt the loop to update/set timer repeat.
+      clock::scheduleTick(timers, clock::ticks);
     }
   }
 
@@ -282,22 +580,12 @@ Timer Clock::timer(
 
 bool Clock::cancel(const Timer& timer)
 {
-  bool canceled = false;
   synchronized (timers_mutex) {
-    // Check if the timeout is still pending, and if so, erase it. In
-    // addition, erase an empty list if we just removed the last
-    // timeout.
-    Time time = timer.timeout().time();
-    if (timers->count(time) > 0) {
-      canceled = true;
-      (*timers)[time].remove(timer);
-      if ((*timers)[time].empty()) {
-        timers->erase(time);
-      }
-    }
+    // Erases the timer if it is still pending.
+    return timers->cancel(timer);
   }
 
-  return canceled;
+  UNREACHABLE();
 }
 
 
@@ -346,7 +634,7 @@ void Clock::resume()
       clock::currents->clear();
 
       // Schedule another "tick" if necessary.
-      clock::scheduleTick(*timers, clock::ticks);
+      clock::scheduleTick(timers, clock::ticks);
     }
   }
 }
@@ -364,7 +652,7 @@ void Clock::advance(const Duration& duration)
       // Schedule another "tick" if necessary. Only "ticks" that
       // fire immediately will be scheduled here, since the clock
       // is paused.
-      clock::scheduleTick(*timers, clock::ticks);
+      clock::scheduleTick(timers, clock::ticks);
     }
   }
 }
@@ -401,7 +689,7 @@ void Clock::update(const Time& time)
         // Schedule another "tick" if necessary. Only "ticks" that
         // fire immediately will be scheduled here, since the clock
         // is paused.
-        clock::scheduleTick(*timers, clock::ticks);
+        clock::scheduleTick(timers, clock::ticks);
       }
     }
   }
@@ -441,8 +729,8 @@ bool Clock::settled()
     if (clock::settling) {
       VLOG(3) << "Clock still not settled";
       return false;
-    } else if (timers->size() == 0 ||
-               timers->begin()->first > *clock::current) {
+    } else if (timers->empty() ||
+               timers->next().get() > *clock::current) {
       VLOG(3) << "Clock is settled";
       return true;
     }
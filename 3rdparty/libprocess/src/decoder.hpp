@@ -16,21 +16,33 @@
 #define __DECODER_HPP__
 
 #include <http_parser.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <arpa/inet.h>
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <deque>
 #include <string>
 #include <vector>
 
 #include <process/http.hpp>
+#include <process/message.hpp>
+#include <process/pid.hpp>
 #include <process/socket.hpp>
 
 #include <stout/foreach.hpp>
 #include <stout/gzip.hpp>
+#include <stout/none.hpp>
 #include <stout/option.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
 #include <stout/try.hpp>
 
+#include "framing.hpp"
+
 
 // TODO(bmahler): Switch to joyent/http-parser now that it is no
 // longer being hosted under ry/http-parser.
@@ -43,7 +55,7 @@ class DataDecoder
 {
 public:
   explicit DataDecoder(const network::Socket& _s)
-    : s(_s), failure(false), request(NULL)
+    : s(_s), failure(false), mode(UNKNOWN), request(NULL)
   {
     settings.on_message_begin = &DataDecoder::on_message_begin;
 
@@ -67,6 +79,23 @@ public:
 
   std::deque<http::Request*> decode(const char* data, size_t length)
   {
+    // The first byte of a connection (or the first byte after a
+    // framing negotiation) tells us whether the peer is sending binary
+    // frames or HTTP requests (see 'framing.hpp').
+    if (mode == UNKNOWN && length > 0) {
+      mode = data[0] == framing::MARKER ? BINARY : HTTP;
+    }
+
+    if (mode == BINARY) {
+      // Once framing has been lost there's no way to find the start
+      // of the next frame.
+      if (!failure && !unframe(data, length)) {
+        failure = true;
+      }
+
+      return std::deque<http::Request*>();
+    }
+
     size_t parsed = http_parser_execute(&parser, &settings, data, length);
 
     if (parsed != length) {
@@ -83,6 +112,15 @@ public:
     return std::deque<http::Request*>();
   }
 
+  // Returns the messages that were received as binary frames since
+  // the last call.
+  std::deque<Message*> messages()
+  {
+    std::deque<Message*> result;
+    std::swap(result, framed);
+    return result;
+  }
+
   bool failed() const
   {
     return failure;
@@ -94,12 +132,128 @@ public:
   }
 
 private:
+  // Decodes as many binary frames as possible, buffering any
+  // incomplete frame until more data arrives. Returns false if the
+  // data is not validly framed.
+  bool unframe(const char* data, size_t length)
+  {
+    while (length > 0) {
+      // Every frame starts with the marker.
+      if ((frame.empty() ? data[0] : frame[0]) != framing::MARKER) {
+        return false;
+      }
+
+      // Avoid copying into the buffer when a complete frame is
+      // available in the data itself.
+      if (frame.empty()) {
+        Result<size_t> size = framed_size(data, length);
+        if (size.isError()) {
+          VLOG(1) << "Failed to decode frame: " << size.error();
+          return false;
+        } else if (size.isSome() && size.get() <= length) {
+          framed.push_back(parse(data));
+          data += size.get();
+          length -= size.get();
+          continue;
+        }
+      }
+
+      // Buffer the header first (to learn the size of the frame) and
+      // then the rest of the frame. Note that the size has already
+      // been validated when the header is complete.
+      Result<size_t> size = framed_size(frame.data(), frame.size());
+
+      size_t needed = size.isSome()
+        ? size.get() - frame.size()
+        : framing::HEADER_SIZE - frame.size();
+
+      size_t count = std::min(needed, length);
+      frame.append(data, count);
+      data += count;
+      length -= count;
+
+      size = framed_size(frame.data(), frame.size());
+
+      if (size.isError()) {
+        VLOG(1) << "Failed to decode frame: " << size.error();
+        return false;
+      } else if (size.isSome() && size.get() == frame.size()) {
+        framed.push_back(parse(frame.data()));
+        frame.clear();
+      }
+    }
+
+    return true;
+  }
+
+  // Returns the 'index'th length of a frame header.
+  static size_t field_length(const char* header, size_t index)
+  {
+    uint32_t value;
+    memcpy(&value, header + 1 + index * sizeof(value), sizeof(value));
+    return ntohl(value);
+  }
+
+  // Returns the total size of the frame that starts at 'data' if
+  // enough of it is available to know, or an error if the frame is
+  // larger than 'framing::MAX_FRAME_SIZE'. The lengths come from the
+  // peer so we check each of them before adding it to the total,
+  // which can therefore never wrap around (even with a 32-bit
+  // 'size_t').
+  static Result<size_t> framed_size(const char* data, size_t length)
+  {
+    if (length < framing::HEADER_SIZE) {
+      return None();
+    }
+
+    size_t size = framing::HEADER_SIZE;
+
+    for (size_t index = 0; index < 4; index++) {
+      const size_t field = field_length(data, index);
+
+      if (field > framing::MAX_FRAME_SIZE - size) {
+        return Error(
+            "Frame exceeds the maximum size of " +
+            stringify(framing::MAX_FRAME_SIZE) + " bytes");
+      }
+
+      size += field;
+    }
+
+    return size;
+  }
+
+  // Creates a message out of a complete frame. Note that only the id
+  // of the receiver is set since the address is implicit.
+  static Message* parse(const char* data)
+  {
+    const char* name = data + framing::HEADER_SIZE;
+    const char* from = name + field_length(data, 0);
+    const char* to = from + field_length(data, 1);
+    const char* body = to + field_length(data, 2);
+
+    Message* message = new Message();
+    message->name.assign(name, field_length(data, 0));
+    message->from = UPID(std::string(from, field_length(data, 1)));
+    message->to.id.assign(to, field_length(data, 2));
+    message->body.assign(body, field_length(data, 3));
+
+    return message;
+  }
+
   static int on_message_begin(http_parser* p)
   {
     DataDecoder* decoder = (DataDecoder*) p->data;
 
     CHECK(!decoder->failure);
 
+    // Any request that follows a framing negotiation means the peer
+    // has stayed with HTTP framing (e.g., because it gave up waiting
+    // for our response to the negotiation).
+    if (decoder->mode == UNKNOWN) {
+      decoder->mode = HTTP;
+    }
+
     decoder->header = HEADER_FIELD;
     decoder->field.clear();
     decoder->value.clear();
@@ -260,6 +414,15 @@ private:
         decoder->request->body.length();
     }
 
+    // A peer that has negotiated binary framing waits for our
+    // response before sending anything else. We can't switch to
+    // binary framing just yet though, since the peer might give up
+    // waiting and stay with HTTP framing, so instead we wait to see
+    // whether the next byte is a MARKER.
+    if (framing::negotiation(*decoder->request)) {
+      decoder->mode = UNKNOWN;
+    }
+
     decoder->requests.push_back(decoder->request);
     decoder->request = NULL;
     return 0;
@@ -269,6 +432,20 @@ private:
 
   bool failure;
 
+  // How the peer frames the data it sends on this connection.
+  enum
+  {
+    UNKNOWN,
+    HTTP,
+    BINARY
+  } mode;
+
+  // Partially received binary frame.
+  std::string frame;
+
+  // Messages received as binary frames.
+  std::deque<Message*> framed;
+
   http_parser parser;
   http_parser_settings settings;
 
@@ -18,6 +18,8 @@
 #include <stdint.h>
 #include <time.h>
 
+#include <arpa/inet.h>
+
 #include <map>
 #include <sstream>
 
@@ -29,7 +31,9 @@
 #include <stout/hashmap.hpp>
 #include <stout/numify.hpp>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
 
+#include "framing.hpp"
 
 namespace process {
 
@@ -109,8 +113,16 @@ private:
 class MessageEncoder : public DataEncoder
 {
 public:
-  MessageEncoder(const network::Socket& s, Message* _message)
-    : DataEncoder(s, encode(_message)), message(_message) {}
+  // Encodes the message as an HTTP request unless 'binary' is true,
+  // in which case it gets encoded as a binary frame (see
+  // 'framing.hpp').
+  MessageEncoder(
+      const network::Socket& s,
+      Message* _message,
+      bool _binary = false)
+    : DataEncoder(s, _binary ? frame(_message) : encode(_message)),
+      message(_message),
+      binary(_binary) {}
 
   virtual ~MessageEncoder()
   {
@@ -119,6 +131,58 @@ public:
     }
   }
 
+  // Returns whether the message has been encoded as a binary frame.
+  bool framed() const
+  {
+    return binary;
+  }
+
+  // Relinquishes ownership of the message, e.g., so that it can be
+  // encoded again using a different framing.
+  Message* release()
+  {
+    Message* result = message;
+    message = NULL;
+    return result;
+  }
+
+  static std::string frame(Message* message)
+  {
+    std::string out;
+
+    if (message != NULL) {
+      const std::string from = stringify(message->from);
+
+      out.reserve(
+          framing::HEADER_SIZE +
+          message->name.size() +
+          from.size() +
+          message->to.id.size() +
+          message->body.size());
+
+      out.push_back(framing::MARKER);
+
+      const size_t lengths[] = {
+        message->name.size(),
+        from.size(),
+        message->to.id.size(),
+        message->body.size()
+      };
+
+      foreach (size_t length, lengths) {
+        const uint32_t value = htonl(static_cast<uint32_t>(length));
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+      }
+
+      out.append(message->name);
+      out.append(from);
+      out.append(message->to.id);
+      out.append(message->body);
+    }
+
+    return out;
+  }
+
   static std::string encode(Message* message)
   {
     std::ostringstream out;
@@ -157,6 +221,7 @@ public:
 
 private:
   Message* message;
+  const bool binary;
 };
 
 
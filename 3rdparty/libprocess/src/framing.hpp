@@ -0,0 +1,98 @@
+/**
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License
+*/
+
+#ifndef __FRAMING_HPP__
+#define __FRAMING_HPP__
+
+#include <stdint.h>
+
+#include <string>
+
+#include <process/http.hpp>
+
+#include <stout/duration.hpp>
+
+namespace process {
+namespace framing {
+
+// Messages between libprocess instances are either sent as HTTP
+// requests (the original, and still the default, framing) or as
+// compact binary frames laid out as:
+//
+//   +--------+-------------+-------------+-------------+-------------+
+//   | MARKER | name length | from length |  to length  | body length |
+//   | 1 byte |   4 bytes   |   4 bytes   |   4 bytes   |   4 bytes   |
+//   +--------+-------------+-------------+-------------+-------------+
+//   | name | from | to | body |
+//   +------+------+----+------+
+//
+// where the lengths are in network byte order, 'from' is a stringified
+// UPID and 'to' is only the id of the receiving process.
+//
+// A sender only uses binary framing on a connection after the peer
+// agreed to it. For a connection to a peer whose support is unknown
+// the sender first sends a NEGOTIATION request (a plain HTTP request
+// that older peers simply answer with a '404 Not Found') and holds
+// any messages until the peer responds. A peer that understands
+// binary framing answers with a '200 OK' including the HEADER set to
+// BINARY and expects every subsequent byte on that connection to be
+// binary framed. Once a peer is known to support binary framing any
+// new connection to it starts with a binary frame, which receivers
+// detect by the leading MARKER (an HTTP request never starts with
+// a NUL byte). A receiver that accepted a negotiation likewise only
+// switches to binary framing once a MARKER arrives, since the sender
+// might have given up waiting for the response and stayed with HTTP.
+const char MARKER = '\0';
+
+const size_t HEADER_SIZE = 1 + 4 * sizeof(uint32_t);
+
+// The largest frame (including the header) a receiver accepts. A
+// larger frame fails the decoding, which closes the connection. This
+// is far larger than any message exchanged by libprocess users, it
+// just bounds what a peer can make us buffer.
+const size_t MAX_FRAME_SIZE = 256 * 1024 * 1024;
+
+const char NEGOTIATION[] = "/__framing__";
+const char HEADER[] = "Libprocess-Framing";
+const char BINARY[] = "binary";
+
+// How long a sender holds messages waiting for a peer to respond to
+// a negotiation request before falling back to HTTP framing.
+const Duration NEGOTIATION_TIMEOUT = Seconds(5);
+
+
+// Returns the request a sender uses to negotiate binary framing.
+inline std::string negotiation()
+{
+  return std::string("GET ") + NEGOTIATION + " HTTP/1.1\r\n" +
+         HEADER + ": " + BINARY + "\r\n" +
+         "Connection: Keep-Alive\r\n" +
+         "Host: \r\n" +
+         "\r\n";
+}
+
+
+// Returns true if the request is a negotiation request for binary
+// framing.
+inline bool negotiation(const http::Request& request)
+{
+  return request.method == "GET" &&
+         request.url.path == NEGOTIATION &&
+         request.headers.get(HEADER) == std::string(BINARY);
+}
+
+} // namespace framing {
+} // namespace process {
+
+#endif // __FRAMING_HPP__
@@ -1068,6 +1068,12 @@ Future<Connection> connect(const URL& url)
 }
 
 
+Future<Connection> connect(const Socket& socket)
+{
+  return Connection(socket);
+}
+
+
 namespace internal {
 
 Future<Response> request(const Request& request, bool streamedResponse)
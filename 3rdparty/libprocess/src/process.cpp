@@ -99,6 +99,7 @@
 #include "decoder.hpp"
 #include "encoder.hpp"
 #include "event_loop.hpp"
+#include "framing.hpp"
 #include "gate.hpp"
 #ifdef USE_SSL_SOCKET
 #include "openssl.hpp"
@@ -300,6 +301,17 @@ public:
 
   Encoder* next(int s);
 
+  // Invoked once the peer of 's' has responded to a framing
+  // negotiation (or failed to respond in time) with whether or not
+  // it accepted binary framing (see 'framing.hpp'). If 'negotiation'
+  // is given it must identify the pending negotiation of 's', which
+  // protects against acting on a different socket that has since
+  // been assigned the same file descriptor.
+  void negotiated(
+      int s,
+      bool binary,
+      const Option<uint64_t>& negotiation = None());
+
   void close(int s);
 
   void exited(const Address& address);
@@ -338,6 +350,12 @@ private:
       Socket* socket,
       Message* message);
 
+  // Determines the framing to use on a newly created socket to the
+  // given address. If the peer is not yet known to support binary
+  // framing and 'negotiate' is true the socket waits for a
+  // negotiation once it connects (see 'framing.hpp').
+  void frame(int s, const Address& address, bool negotiate);
+
   // Collection of all actice sockets.
   map<int, Socket*> sockets;
 
@@ -366,6 +384,29 @@ private:
   // HTTP proxies.
   map<int, HttpProxy*> proxies;
 
+  // Sockets on which messages are sent as binary frames.
+  set<int> framed;
+
+  // Sockets that will not send any messages until the peer has
+  // responded to a framing negotiation. Any messages queued on these
+  // sockets get re-encoded if the peer accepts binary framing. Each
+  // negotiation is identified by a unique number (see 'negotiations').
+  map<int, uint64_t> negotiating;
+
+  // Number of negotiations started so far.
+  uint64_t negotiations;
+
+  // Sockets in 'negotiating' whose sending stopped (i.e., the
+  // negotiation request has been sent) and needs to be restarted
+  // once the negotiation completes.
+  set<int> stalled;
+
+  // Whether or not the peer at a socket address is known to support
+  // binary framing. Forgotten whenever a socket to the peer gets
+  // closed since the peer might have been restarted with a different
+  // version of libprocess.
+  map<Address, bool> framings;
+
   // Protects instance variables.
   std::recursive_mutex mutex;
 };
@@ -426,9 +467,34 @@ private:
   // Gates for waiting threads (protected by processes_mutex).
   map<ProcessBase*, Gate*> gates;
 
-  // Queue of runnable processes (implemented using list).
-  list<ProcessBase*> runq;
-  std::recursive_mutex runq_mutex;
+  // A processing thread's queue of runnable processes. Each worker
+  // takes processes from the front of its own queue and, when that
+  // is empty, steals from the back of the queues of the other
+  // workers. This avoids having every processing thread contend on a
+  // single global run queue.
+  struct Worker
+  {
+    deque<ProcessBase*> runq;
+    std::mutex mutex;
+  };
+
+  // Returns the index of the worker whose run queue `process` should
+  // be put on. Prefers the worker that last ran the process (to keep
+  // its state warm in that CPU's cache), then the calling worker (if
+  // any), and otherwise picks a worker in a round-robin fashion.
+  size_t affinity(ProcessBase* process);
+
+  // Removes `process` from whichever run queue it is on (if any) and
+  // returns true if it was found.
+  bool extract(ProcessBase* process);
+
+  // Per-worker run queues, created by 'init_threads' and indexed by
+  // the worker's position.
+  vector<Worker*> workers;
+
+  // Used to distribute processes that have no affinity amongst the
+  // workers.
+  std::atomic_ulong next;
 
   // Number of running processes, to support Clock::settle operation.
   std::atomic_long running;
@@ -463,6 +529,10 @@ static SocketManager* socket_manager = NULL;
 // Active ProcessManager (eventually will probably be thread-local).
 static ProcessManager* process_manager = NULL;
 
+// Index of the worker that the current thread is running, or -1 if
+// the current thread is not a processing thread.
+static THREAD_LOCAL long _worker_ = -1;
+
 // Scheduling gate that threads wait at when there is nothing to run.
 static Gate* gate = new Gate();
 
@@ -615,10 +685,12 @@ void decode_recv(
     return;
   }
 
-  // Decode as much of the data as possible into HTTP requests.
+  // Decode as much of the data as possible into HTTP requests (or
+  // messages, if the peer is sending binary frames).
   const deque<Request*> requests = decoder->decode(data, length.get());
+  const deque<Message*> messages = decoder->messages();
 
-  if (requests.empty() && decoder->failed()) {
+  if (requests.empty() && messages.empty() && decoder->failed()) {
      VLOG(1) << "Decoder error while receiving";
      socket_manager->close(*socket);
      delete[] data;
@@ -647,6 +719,14 @@ void decode_recv(
     }
   }
 
+  foreach (Message* message, messages) {
+    message->to.address = __address__;
+
+    // TODO(benh): Use the sender PID when delivering in order to
+    // capture happens-before timing relationships for testing.
+    process_manager->deliver(message->to, new MessageEvent(message));
+  }
+
   socket->recv(data, size)
     .onAny(lambda::bind(&decode_recv, lambda::_1, data, size, socket, decoder));
 }
@@ -1224,7 +1304,7 @@ void HttpProxy::stream(
 }
 
 
-SocketManager::SocketManager() {}
+SocketManager::SocketManager() : negotiations(0) {}
 
 
 SocketManager::~SocketManager() {}
@@ -1265,6 +1345,55 @@ void ignore_recv_data(
 }
 
 
+// Receives the response to a framing negotiation request and then
+// ignores any further data, like 'ignore_recv_data'.
+void negotiate_recv(
+    const Future<size_t>& length,
+    Socket* socket,
+    char* data,
+    size_t size,
+    ResponseDecoder* decoder)
+{
+  if (length.isDiscarded() || length.isFailed() || length.get() == 0) {
+    socket_manager->close(*socket);
+    delete[] data;
+    delete decoder;
+    delete socket;
+    return;
+  }
+
+  deque<Response*> responses = decoder->decode(data, length.get());
+
+  if (!responses.empty() || decoder->failed()) {
+    bool binary = !responses.empty() &&
+      responses.front()->status == http::statuses[200] &&
+      responses.front()->headers.get(framing::HEADER) ==
+        string(framing::BINARY);
+
+    foreach (Response* response, responses) {
+      delete response;
+    }
+
+    delete decoder;
+
+    socket_manager->negotiated(*socket, binary);
+
+    socket->recv(data, size)
+      .onAny(lambda::bind(&ignore_recv_data, lambda::_1, socket, data, size));
+    return;
+  }
+
+  socket->recv(data, size)
+    .onAny(lambda::bind(
+        &negotiate_recv,
+        lambda::_1,
+        socket,
+        data,
+        size,
+        decoder));
+}
+
+
 // Forward declaration.
 void send(Encoder* encoder, Socket* socket);
 
@@ -1340,6 +1469,44 @@ void SocketManager::link_connect(
   size_t size = 80 * 1024;
   char* data = new char[size];
 
+  Option<uint64_t> negotiation = None();
+
+  synchronized (mutex) {
+    if (negotiating.count(*socket) > 0) {
+      negotiation = negotiating[*socket];
+    }
+  }
+
+  if (negotiation.isSome()) {
+    // Ask the peer whether it supports binary framing before sending
+    // anything else (see 'framing.hpp'). Anything that gets queued
+    // in the meantime is sent once the peer responds or we give up
+    // waiting for it.
+    socket->recv(data, size)
+      .onAny(lambda::bind(
+          &internal::negotiate_recv,
+          lambda::_1,
+          socket,
+          data,
+          size,
+          new ResponseDecoder()));
+
+    // NOTE: The socket might get closed (and its file descriptor
+    // reused) before the timer fires, hence we identify the
+    // negotiation rather than just the file descriptor.
+    const int s = *socket;
+    const uint64_t id = negotiation.get();
+    Clock::timer(framing::NEGOTIATION_TIMEOUT, [=]() {
+      socket_manager->negotiated(s, false, id);
+    });
+
+    internal::send(
+        new DataEncoder(*socket, framing::negotiation()),
+        new Socket(*socket));
+
+    return;
+  }
+
   socket->recv(data, size)
     .onAny(lambda::bind(
         &internal::ignore_recv_data,
@@ -1405,6 +1572,8 @@ void SocketManager::link(
 
       persists[to.address] = s;
 
+      frame(s, to.address, true);
+
       // Initialize 'outgoing' to prevent a race with
       // SocketManager::send() while the socket is not yet connected.
       // Initializing the 'outgoing' queue prevents
@@ -1662,7 +1831,13 @@ void SocketManager::send_connect(
     return;
   }
 
-  Encoder* encoder = new MessageEncoder(*socket, message);
+  bool binary = false;
+
+  synchronized (mutex) {
+    binary = framed.count(*socket) > 0;
+  }
+
+  Encoder* encoder = new MessageEncoder(*socket, message, binary);
 
   // Receive and ignore data from this socket. Note that we don't
   // expect to receive anything other than HTTP '202 Accepted'
@@ -1690,6 +1865,7 @@ void SocketManager::send(Message* message, const Socket::Kind& kind)
 
   Option<Socket> socket = None();
   bool connect = false;
+  bool binary = false;
 
   synchronized (mutex) {
     // Check if there is already a socket.
@@ -1706,8 +1882,11 @@ void SocketManager::send(Message* message, const Socket::Kind& kind)
         dispose.insert(socket.get());
       }
 
+      binary = framed.count(socket.get()) > 0;
+
       if (outgoing.count(socket.get()) > 0) {
-        outgoing[socket.get()].push(new MessageEncoder(socket.get(), message));
+        outgoing[socket.get()].push(
+            new MessageEncoder(socket.get(), message, binary));
         return;
       } else {
         // Initialize the outgoing queue.
@@ -1735,6 +1914,10 @@ void SocketManager::send(Message* message, const Socket::Kind& kind)
 
       dispose.insert(s);
 
+      // NOTE: We don't negotiate the framing for temporary sockets so
+      // that sending a message never has to wait for the peer.
+      frame(s, address, false);
+
       // Initialize the outgoing queue.
       outgoing[s];
 
@@ -1755,7 +1938,7 @@ void SocketManager::send(Message* message, const Socket::Kind& kind)
     // If we're not connecting and we haven't added the encoder to
     // the 'outgoing' queue then schedule it to be sent.
     internal::send(
-        new MessageEncoder(socket.get(), message),
+        new MessageEncoder(socket.get(), message, binary),
         new Socket(socket.get()));
   }
 }
@@ -1782,6 +1965,12 @@ Encoder* SocketManager::next(int s)
     if (sockets.count(s) > 0) {
       CHECK(outgoing.count(s) > 0);
 
+      // Hold off sending until the framing has been negotiated.
+      if (negotiating.count(s) > 0) {
+        stalled.insert(s);
+        return NULL;
+      }
+
       if (!outgoing[s].empty()) {
         // More messages!
         Encoder* encoder = outgoing[s].front();
@@ -1808,6 +1997,7 @@ Encoder* SocketManager::next(int s)
           }
 
           dispose.erase(s);
+          framed.erase(s);
 
           auto iterator = sockets.find(s);
 
@@ -1845,6 +2035,88 @@ Encoder* SocketManager::next(int s)
 }
 
 
+void SocketManager::negotiated(
+    int s,
+    bool binary,
+    const Option<uint64_t>& negotiation)
+{
+  Option<Socket> socket = None();
+
+  synchronized (mutex) {
+    // The negotiation might have already completed (e.g., the peer
+    // responded just before we gave up waiting) or the socket might
+    // have been closed in the meantime (and the file descriptor
+    // reused for a socket that is negotiating on its own).
+    if (negotiating.count(s) == 0 ||
+        (negotiation.isSome() && negotiating[s] != negotiation.get())) {
+      return;
+    }
+
+    negotiating.erase(s);
+
+    if (addresses.count(s) > 0) {
+      VLOG(2) << "Using " << (binary ? "binary" : "HTTP")
+              << " framing for messages to " << addresses[s];
+
+      framings[addresses[s]] = binary;
+    }
+
+    if (binary) {
+      framed.insert(s);
+
+      // Re-encode any messages that were queued during the
+      // negotiation.
+      if (outgoing.count(s) > 0) {
+        queue<Encoder*> encoders;
+        std::swap(encoders, outgoing[s]);
+
+        while (!encoders.empty()) {
+          Encoder* encoder = encoders.front();
+          encoders.pop();
+
+          MessageEncoder* message = dynamic_cast<MessageEncoder*>(encoder);
+          if (message != NULL && !message->framed()) {
+            encoder = new MessageEncoder(*sockets[s], message->release(), true);
+            delete message;
+          }
+
+          outgoing[s].push(encoder);
+        }
+      }
+    }
+
+    if (stalled.count(s) > 0) {
+      stalled.erase(s);
+      socket = *sockets[s];
+    }
+  }
+
+  // Restart sending if it stopped for the negotiation. We do this
+  // outside the synchronized block since 'next' might terminate an
+  // HttpProxy (see comment in SocketManager::proxy).
+  if (socket.isSome()) {
+    Encoder* encoder = next(s);
+    if (encoder != NULL) {
+      internal::send(encoder, new Socket(socket.get()));
+    }
+  }
+}
+
+
+void SocketManager::frame(int s, const Address& address, bool negotiate)
+{
+  synchronized (mutex) {
+    if (framings.count(address) > 0) {
+      if (framings[address]) {
+        framed.insert(s);
+      }
+    } else if (negotiate) {
+      negotiating[s] = ++negotiations;
+    }
+  }
+}
+
+
 void SocketManager::close(int s)
 {
   HttpProxy* proxy = NULL; // Non-null if needs to be terminated.
@@ -1871,6 +2143,8 @@ void SocketManager::close(int s)
       if (addresses.count(s) > 0) {
         const Address& address = addresses[s];
 
+        framings.erase(address);
+
         // Don't bother invoking exited unless socket was persistant.
         if (persists.count(address) > 0 && persists[address] == s) {
           persists.erase(address);
@@ -1889,6 +2163,9 @@ void SocketManager::close(int s)
       }
 
       dispose.erase(s);
+      framed.erase(s);
+      negotiating.erase(s);
+      stalled.erase(s);
       auto iterator = sockets.find(s);
 
       // We need to stop any 'ignore_data' receivers as they may have
@@ -2061,6 +2338,17 @@ void SocketManager::swap_implementing_socket(const Socket& from, Socket* to)
       dispose.erase(from_fd);
     }
 
+    // Update the framing of the link.
+    if (framed.count(from_fd) > 0) {
+      framed.insert(to_fd);
+      framed.erase(from_fd);
+    }
+
+    if (negotiating.count(from_fd) > 0) {
+      negotiating[to_fd] = negotiating[from_fd];
+      negotiating.erase(from_fd);
+    }
+
     // Update the fd that this address is associated with. Once we've
     // done this we can update the 'temps' and 'persists'
     // datastructures using this updated address.
@@ -2096,6 +2384,7 @@ ProcessManager::ProcessManager(const string& _delegate)
   : delegate(_delegate)
 {
   running.store(0);
+  next.store(0);
 }
 
 
@@ -2128,6 +2417,10 @@ ProcessManager::~ProcessManager()
     thread->join();
     delete thread;
   }
+
+  foreach (Worker* worker, workers) {
+    delete worker;
+  }
 }
 
 
@@ -2147,13 +2440,23 @@ long ProcessManager::init_threads()
   long cpus = std::max(8L, sysconf(_SC_NPROCESSORS_ONLN));
   threads.reserve(cpus+1);
 
+  // Create the run queues before any of the processing threads start
+  // so that 'workers' itself never changes once threads are running.
+  workers.reserve(cpus);
+  for (long i = 0; i < cpus; i++) {
+    workers.push_back(new Worker());
+  }
+
   // Create processing threads.
   for (long i = 0; i < cpus; i++) {
     // Retain the thread handles so that we can join when shutting down.
     threads.emplace_back(
         // We pass a constant reference to `joining` to make it clear that this
         // value is only being tested (read), and not manipulated.
-        new std::thread(std::bind([](const std::atomic_bool& joining) {
+        new std::thread(std::bind([](
+            long index,
+            const std::atomic_bool& joining) {
+          _worker_ = index;
           do {
             ProcessBase* process = process_manager->dequeue();
             if (process == NULL) {
@@ -2172,6 +2475,7 @@ long ProcessManager::init_threads()
             process_manager->resume(process);
           } while (true);
         },
+        i,
         std::cref(joining_threads))));
   }
 
@@ -2205,6 +2509,25 @@ bool ProcessManager::handle(
 {
   CHECK(request != NULL);
 
+  // Check if this is a peer negotiating to send messages as binary
+  // frames, which we always accept (the decoder for this socket
+  // switches to decoding binary frames once the first one arrives,
+  // see 'framing.hpp').
+  if (framing::negotiation(*request)) {
+    VLOG(2) << "Accepting binary framing from " << request->client;
+
+    Response response = OK();
+    response.headers[framing::HEADER] = framing::BINARY;
+
+    // Get the HttpProxy pid for this socket.
+    PID<HttpProxy> proxy = socket_manager->proxy(socket);
+
+    dispatch(proxy, &HttpProxy::enqueue, response, *request);
+
+    delete request;
+    return true;
+  }
+
   // Check if this is a libprocess request (i.e., 'User-Agent:
   // libprocess/id@ip:port') and if so, parse as a message.
   if (libprocess(request)) {
@@ -2434,6 +2757,12 @@ void ProcessManager::resume(ProcessBase* process)
 {
   __process__ = process;
 
+  // Remember which worker ran this process so that it gets enqueued
+  // on the same worker the next time it becomes runnable.
+  if (_worker_ >= 0) {
+    process->worker.store(_worker_);
+  }
+
   VLOG(2) << "Resuming " << process->pid << " at " << Clock::now();
 
   bool terminate = false;
@@ -2706,23 +3035,9 @@ bool ProcessManager::wait(const UPID& pid)
       // Check if it is runnable in order to donate this thread.
       if (process->state == ProcessBase::BOTTOM ||
           process->state == ProcessBase::READY) {
-        synchronized (runq_mutex) {
-          list<ProcessBase*>::iterator it =
-            find(runq.begin(), runq.end(), process);
-          if (it != runq.end()) {
-            // Found it! Remove it from the run queue since we'll be
-            // donating our thread and also increment 'running' before
-            // leaving this 'runq' protected critical section so that
-            // everyone that is waiting for the processes to settle
-            // continue to wait (otherwise they could see nothing in
-            // 'runq' and 'running' equal to 0 between when we exit
-            // this critical section and increment 'running').
-            runq.erase(it);
-            running.fetch_add(1);
-          } else {
-            // Another thread has resumed the process ...
-            process = NULL;
-          }
+        if (!extract(process)) {
+          // Another thread has resumed the process ...
+          process = NULL;
         }
       } else {
         // Process is not runnable, so no need to donate ...
@@ -2810,35 +3125,55 @@ void ProcessManager::enqueue(ProcessBase* process)
 
   // TODO(benh): Check and see if this process has it's own thread. If
   // it does, push it on that threads runq, and wake up that thread if
-  // it's not running. Otherwise, check and see which thread this
-  // process was last running on, and put it on that threads runq.
+  // it's not running.
 
-  synchronized (runq_mutex) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-    runq.push_back(process);
+  Worker* worker = workers[affinity(process)];
+
+  synchronized (worker->mutex) {
+    CHECK(find(worker->runq.begin(), worker->runq.end(), process) ==
+          worker->runq.end());
+    worker->runq.push_back(process);
   }
 
-  // Wake up the processing thread if necessary.
-  gate->open();
+  // Wake up a processing thread if necessary. Only one thread needs
+  // to be woken up since any idle thread can steal the process.
+  gate->open(false);
 }
 
 
 ProcessBase* ProcessManager::dequeue()
 {
-  // TODO(benh): Remove a process from this thread's runq. If there
-  // are no processes to run, and this is not a dedicated thread, then
-  // steal one from another threads runq.
+  // TODO(benh): If this is a dedicated thread, only run processes
+  // that have been assigned to it.
 
   ProcessBase* process = NULL;
 
-  synchronized (runq_mutex) {
-    if (!runq.empty()) {
-      process = runq.front();
-      runq.pop_front();
-      // Increment the running count of processes in order to support
-      // the Clock::settle() operation (this must be done atomically
-      // with removing the process from the runq).
-      running.fetch_add(1);
+  // Start with our own run queue (or the first one if this is not a
+  // processing thread) and then try to steal from everyone else.
+  const size_t size = workers.size();
+  const size_t start = _worker_ >= 0 ? _worker_ : 0;
+
+  for (size_t i = 0; i < size && process == NULL; i++) {
+    Worker* worker = workers[(start + i) % size];
+
+    synchronized (worker->mutex) {
+      if (!worker->runq.empty()) {
+        // Take from the front of our own run queue but steal from the
+        // back of someone else's so that we're less likely to contend
+        // with the worker that owns the queue.
+        if (i == 0) {
+          process = worker->runq.front();
+          worker->runq.pop_front();
+        } else {
+          process = worker->runq.back();
+          worker->runq.pop_back();
+        }
+
+        // Increment the running count of processes in order to
+        // support the Clock::settle() operation (this must be done
+        // atomically with removing the process from the runq).
+        running.fetch_add(1);
+      }
     }
   }
 
@@ -2846,6 +3181,48 @@ ProcessBase* ProcessManager::dequeue()
 }
 
 
+size_t ProcessManager::affinity(ProcessBase* process)
+{
+  CHECK(!workers.empty());
+
+  long index = process->worker.load();
+
+  if (index < 0) {
+    index = _worker_;
+  }
+
+  if (index < 0) {
+    index = next.fetch_add(1) % workers.size();
+  }
+
+  return index;
+}
+
+
+bool ProcessManager::extract(ProcessBase* process)
+{
+  foreach (Worker* worker, workers) {
+    synchronized (worker->mutex) {
+      deque<ProcessBase*>::iterator it =
+        find(worker->runq.begin(), worker->runq.end(), process);
+      if (it != worker->runq.end()) {
+        // Found it! Remove it from the run queue and also increment
+        // 'running' before leaving this 'runq' protected critical
+        // section so that everyone that is waiting for the processes
+        // to settle continue to wait (otherwise they could see
+        // nothing in any 'runq' and 'running' equal to 0 between when
+        // we exit this critical section and increment 'running').
+        worker->runq.erase(it);
+        running.fetch_add(1);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+
 void ProcessManager::settle()
 {
   bool done = true;
@@ -2864,23 +3241,19 @@ void ProcessManager::settle()
     // process on the run queue).
     os::sleep(Milliseconds(10));
 
-    done = true; // Assume to start that we are settled.
-
-    synchronized (runq_mutex) {
-      if (!runq.empty()) {
-        done = false;
-        continue;
-      }
+    // Lock every run queue (always in the same order) so that we get
+    // a consistent view of all of them together with 'running'.
+    foreach (Worker* worker, workers) {
+      worker->mutex.lock();
+    }
 
-      if (running.load() > 0) {
-        done = false;
-        continue;
-      }
+    done = running.load() == 0 && Clock::settled();
 
-      if (!Clock::settled()) {
+    foreach (Worker* worker, workers) {
+      if (!worker->runq.empty()) {
         done = false;
-        continue;
       }
+      worker->mutex.unlock();
     }
   } while (!done);
 }
@@ -2976,6 +3349,8 @@ ProcessBase::ProcessBase(const string& id)
 
   refs = 0;
 
+  worker = -1;
+
   pid.id = id != "" ? id : ID::generate();
   pid.address = __address__;
 
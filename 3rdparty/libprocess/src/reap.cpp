@@ -12,32 +12,77 @@
 * limitations under the License
 */
 
+#include <errno.h>
+#include <unistd.h>
+
 #include <glog/logging.h>
 
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif // __linux__
+
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/future.hpp>
 #include <process/id.hpp>
+#include <process/io.hpp>
 #include <process/once.hpp>
 #include <process/owned.hpp>
 #include <process/reap.hpp>
 
 #include <stout/check.hpp>
+#include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/multihashmap.hpp>
 #include <stout/none.hpp>
 #include <stout/os.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
 
+#ifdef __linux__
+// 'pidfd_open' was added in Linux 5.3, and has the same syscall
+// number on all architectures (but alpha) that we might not have
+// the headers for.
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#endif // __linux__
+
 namespace process {
 
 
-// TODO(bmahler): This can be optimized to use a thread per pid, where
-// each thread makes a blocking call to waitpid. This eliminates the
-// unfortunate poll delay.
+// Returns a file descriptor that becomes readable once the process
+// terminates, or an error if not supported (e.g., prior to Linux 5.3).
+static Try<int> pidfd(pid_t pid)
+{
+#ifdef __linux__
+  // NOTE: The file descriptor is close-on-exec.
+  int fd = ::syscall(SYS_pidfd_open, pid, 0);
+  if (fd < 0) {
+    return ErrnoError();
+  }
+
+  return fd;
+#else
+  return Error("Not supported");
+#endif // __linux__
+}
+
+
+// On Linux 5.3 and later the reaper watches a 'pidfd' for each pid
+// using the event loop and thus gets notified as soon as a process
+// terminates. Otherwise (or if opening the 'pidfd' fails) it polls
+// the pid periodically.
+//
+// NOTE: A SIGCHLD (or 'signalfd') based approach would require
+// SIGCHLD to be blocked in all threads of the process (interfering
+// with applications handling it themselves), and would still not
+// notify about the termination of processes that are not our
+// children.
 //
 // Simple bounded linear model for computing the poll interval.
 // Values were chosen such that at (50 pids, 100 ms) the CPU usage is
@@ -64,14 +109,23 @@ Duration MAX_REAP_INTERVAL() { return Seconds(1); }
 class ReaperProcess : public Process<ReaperProcess>
 {
 public:
-  ReaperProcess() : ProcessBase(ID::generate("reaper")) {}
+  ReaperProcess()
+    : ProcessBase(ID::generate("reaper")),
+      polling(false) {}
 
   Future<Option<int> > reap(pid_t pid)
   {
     // Check to see if this pid exists.
     if (os::exists(pid)) {
       Owned<Promise<Option<int> > > promise(new Promise<Option<int> >());
+
+      bool watched = promises.contains(pid);
       promises.put(pid, promise);
+
+      if (!watched) {
+        watch(pid);
+      }
+
       return promise->future();
     } else {
       return None();
@@ -79,10 +133,78 @@ public:
   }
 
 protected:
-  virtual void initialize() { wait(); }
+  virtual void finalize()
+  {
+    foreachvalue (int fd, fds) {
+      os::close(fd);
+    }
+    fds.clear();
+  }
+
+  void watch(pid_t pid)
+  {
+    Try<int> fd = pidfd(pid);
+
+    if (fd.isError()) {
+      VLOG(2) << "Polling pid " << pid << " as opening a pidfd failed: "
+              << fd.error();
+
+      schedule();
+      return;
+    }
+
+    fds[pid] = fd.get();
+
+    io::poll(fd.get(), io::READ)
+      .onAny(defer(self(), &Self::terminated, pid, lambda::_1));
+  }
+
+  void terminated(pid_t pid, const Future<short>& poll)
+  {
+    Option<int> fd = fds.get(pid);
+    CHECK_SOME(fd);
+
+    os::close(fd.get());
+    fds.erase(pid);
+
+    if (!poll.isReady()) {
+      LOG(WARNING) << "Polling pid " << pid << " as polling its pidfd failed: "
+                   << (poll.isFailed() ? poll.failure() : "discarded");
+
+      schedule();
+      return;
+    }
+
+    // The process has terminated. If it's our child we reap it and
+    // notify with the exit status.
+    int status;
+    if (waitpid(pid, &status, WNOHANG) > 0) {
+      notify(pid, status);
+    } else if (!os::exists(pid)) {
+      // The process has been reaped by someone else.
+      notify(pid, None());
+    } else {
+      // Either our child can not be reaped yet (e.g., other threads
+      // of it are still exiting), or the process is not our child
+      // and has not been reaped by its parent yet. Keep polling it,
+      // as we only notify with None() once it has been reaped.
+      schedule();
+    }
+  }
+
+  // Schedules polling the pids that are not watched using a pidfd.
+  void schedule()
+  {
+    if (!polling) {
+      polling = true;
+      delay(interval(), self(), &ReaperProcess::wait);
+    }
+  }
 
   void wait()
   {
+    polling = false;
+
     // There are two cases to consider for each pid when it terminates:
     //   1) The process is our child. In this case, we will reap the process and
     //      notify with the exit status.
@@ -94,6 +216,10 @@ protected:
     // between waitpid and the (!exists) conditional it will still exist as a
     // zombie; it will be reaped by us on the next loop.
     foreach (pid_t pid, promises.keys()) {
+      if (fds.contains(pid)) {
+        continue; // Watched using a pidfd.
+      }
+
       int status;
       if (waitpid(pid, &status, WNOHANG) > 0) {
         // We have reaped a child.
@@ -104,7 +230,10 @@ protected:
       }
     }
 
-    delay(interval(), self(), &ReaperProcess::wait); // Reap forever!
+    // Keep polling as long as there are pids that are not watched.
+    if (promises.keys().size() > fds.size()) {
+      schedule();
+    }
   }
 
   void notify(pid_t pid, Result<int> status)
@@ -124,7 +253,8 @@ protected:
 private:
   const Duration interval()
   {
-    size_t count = promises.size();
+    // Only the pids that are not watched using a pidfd get polled.
+    size_t count = promises.keys().size() - fds.size();
 
     if (count <= LOW_PID_COUNT) {
       return MIN_REAP_INTERVAL();
@@ -141,6 +271,12 @@ private:
   }
 
   multihashmap<pid_t, Owned<Promise<Option<int> > > > promises;
+
+  // The pidfds of the pids that are watched using the event loop.
+  hashmap<pid_t, int> fds;
+
+  // Whether polling the pids has been scheduled.
+  bool polling;
 };
 
 
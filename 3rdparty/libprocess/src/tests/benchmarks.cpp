@@ -20,26 +20,47 @@
 
 #include <gmock/gmock.h>
 
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <process/collect.hpp>
+#include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
+#include <process/http.hpp>
+#include <process/message.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
+#include <process/reap.hpp>
+#include <process/socket.hpp>
+#include <process/timer.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
 #include <stout/hashset.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/stopwatch.hpp>
 
+#include "decoder.hpp"
+#include "encoder.hpp"
+
 using namespace process;
 
 using std::cout;
+using std::deque;
 using std::endl;
 using std::list;
 using std::ostringstream;
@@ -287,6 +308,98 @@ TEST(ProcessTest, Process_BENCHMARK_ClientServer)
 }
 
 
+// A process that plays one side of a dispatch ping pong game with a
+// peer, completing `done` after it has been dispatched `total` times.
+class PingPongProcess : public Process<PingPongProcess>
+{
+public:
+  explicit PingPongProcess(size_t _total) : total(_total), count(0) {}
+
+  virtual ~PingPongProcess() {}
+
+  void setPeer(const PID<PingPongProcess>& _peer)
+  {
+    peer = _peer;
+  }
+
+  void ping()
+  {
+    if (++count == total) {
+      promise.set(Nothing());
+    } else {
+      dispatch(peer, &PingPongProcess::ping);
+    }
+  }
+
+  Future<Nothing> done()
+  {
+    return promise.future();
+  }
+
+private:
+  const size_t total;
+  size_t count;
+
+  PID<PingPongProcess> peer;
+
+  Promise<Nothing> promise;
+};
+
+
+// Measures the dispatch throughput of the processing threads as the
+// number of concurrently runnable processes grows. Every pair of
+// processes keeps exactly one process on the run queues at any time,
+// so the number of pairs determines how many worker threads are kept
+// busy (and contending on the run queues) at once.
+TEST(ProcessTest, Process_BENCHMARK_DispatchThroughput)
+{
+  const size_t dispatches = 100000;
+  const size_t maxPairs = 64;
+
+  for (size_t pairs = 1; pairs <= maxPairs; pairs *= 2) {
+    vector<Owned<PingPongProcess>> processes;
+
+    for (size_t i = 0; i < pairs; i++) {
+      Owned<PingPongProcess> pinger(new PingPongProcess(dispatches));
+      Owned<PingPongProcess> ponger(new PingPongProcess(dispatches));
+
+      pinger->setPeer(spawn(ponger.get()));
+      ponger->setPeer(spawn(pinger.get()));
+
+      processes.push_back(pinger);
+      processes.push_back(ponger);
+    }
+
+    list<Future<Nothing>> futures;
+
+    Stopwatch watch;
+    watch.start();
+
+    // Every pinger is dispatched first so it will be the first of
+    // each pair to reach the total.
+    for (size_t i = 0; i < processes.size(); i += 2) {
+      futures.push_back(processes[i]->done());
+      dispatch(processes[i]->self(), &PingPongProcess::ping);
+    }
+
+    AWAIT_READY_FOR(collect(futures), Minutes(5));
+
+    Duration elapsed = watch.elapsed();
+
+    // Each pair performed `2 * dispatches - 1` dispatches.
+    double throughput = (pairs * (2 * dispatches - 1)) / elapsed.secs();
+
+    cout << pairs << " concurrent pair(s): "
+         << throughput << " dispatches / sec" << endl;
+
+    foreach (const Owned<PingPongProcess>& process, processes) {
+      terminate(process.get());
+      wait(process.get());
+    }
+  }
+}
+
+
 class LinkerProcess : public Process<LinkerProcess>
 {
 public:
@@ -368,3 +481,197 @@ TEST(ProcessTest, Process_BENCHMARK_LargeNumberOfLinks)
     delete process;
   }
 }
+
+
+// Compares the cost of encoding and decoding messages as HTTP
+// requests versus binary frames (see 'framing.hpp'). The messages
+// are encoded into a single buffer which is then decoded in chunks
+// the size of a socket receive buffer.
+TEST(ProcessTest, Process_BENCHMARK_MessageFraming)
+{
+  const size_t messages = 10000;
+  const size_t chunk = 80 * 1024;
+
+  Try<network::Socket> socket = network::Socket::create();
+  ASSERT_SOME(socket);
+
+  foreach (size_t size, vector<size_t>({0, 100, 1024, 10240})) {
+    Message message;
+    message.name = "benchmark";
+    message.from = UPID("sender", process::address());
+    message.to = UPID("receiver", process::address());
+    message.body = string(size, 'x');
+
+    foreach (bool binary, vector<bool>({false, true})) {
+      Stopwatch watch;
+      watch.start();
+
+      string data;
+      for (size_t i = 0; i < messages; i++) {
+        data += binary
+          ? MessageEncoder::frame(&message)
+          : MessageEncoder::encode(&message);
+      }
+
+      Duration encoded = watch.elapsed();
+
+      DataDecoder decoder(socket.get());
+
+      size_t decoded = 0;
+      for (size_t offset = 0; offset < data.size(); offset += chunk) {
+        deque<http::Request*> requests = decoder.decode(
+            data.data() + offset,
+            std::min(chunk, data.size() - offset));
+
+        foreach (http::Request* request, requests) {
+          delete request;
+          decoded++;
+        }
+
+        foreach (Message* message, decoder.messages()) {
+          delete message;
+          decoded++;
+        }
+      }
+
+      ASSERT_FALSE(decoder.failed());
+      ASSERT_EQ(messages, decoded);
+
+      cout << (binary ? "Binary" : "HTTP") << " framing of " << messages
+           << " messages with " << Bytes(size) << " bodies took "
+           << encoded << " to encode and "
+           << (watch.elapsed() - encoded) << " to decode ("
+           << Bytes(data.size()) << " encoded)" << endl;
+    }
+  }
+}
+
+
+// Measures the cost of scheduling and canceling a large number of
+// timers, such as those for offer timeouts and filters in a master
+// of a large cluster, as well as of expiring them.
+TEST(ClockTest, Clock_BENCHMARK_Timers)
+{
+  const size_t count = 1000000;
+
+  // Spread the timeouts over an hour, with many of them sharing the
+  // same timeout.
+  vector<Duration> durations;
+  for (size_t i = 0; i < count; i++) {
+    durations.push_back(Milliseconds((i * 7919) % (60 * 60 * 1000)));
+  }
+
+  // NOTE: The clock is paused so that none of the timers expire
+  // while they are being scheduled.
+  Clock::pause();
+
+  vector<Timer> timers;
+  timers.reserve(count);
+
+  Stopwatch watch;
+  watch.start();
+
+  foreach (const Duration& duration, durations) {
+    timers.push_back(Clock::timer(duration, []() {}));
+  }
+
+  Duration scheduled = watch.elapsed();
+
+  foreach (const Timer& timer, timers) {
+    ASSERT_TRUE(Clock::cancel(timer));
+  }
+
+  cout << "Scheduled " << count << " timers in " << scheduled
+       << " and canceled them in " << (watch.elapsed() - scheduled) << endl;
+
+  std::atomic<size_t> expired(0);
+
+  timers.clear();
+  foreach (const Duration& duration, durations) {
+    timers.push_back(Clock::timer(duration, [&expired]() { expired++; }));
+  }
+
+  watch.start();
+
+  Clock::advance(Hours(1));
+  Clock::settle();
+
+  EXPECT_EQ(count, expired.load());
+
+  cout << "Expired " << count << " timers in " << watch.elapsed() << endl;
+
+  Clock::resume();
+}
+
+
+// Measures the latency between a watched process being killed and
+// the reaper notifying about its termination, while watching a large
+// number of processes.
+TEST(ReapTest, Reap_BENCHMARK_ExitNotificationLatency)
+{
+  const size_t count = 1000;
+
+  vector<pid_t> pids;
+  vector<Future<Option<int> > > futures;
+
+  Option<Error> error = None();
+
+  for (size_t i = 0; i < count; i++) {
+    pid_t pid = ::fork();
+
+    if (pid == -1) {
+      error = ErrnoError("Failed to fork");
+      break;
+    }
+
+    if (pid == 0) {
+      // Wait until getting killed.
+      while (true) {
+        ::pause();
+      }
+    }
+
+    pids.push_back(pid);
+    futures.push_back(reap(pid));
+  }
+
+  if (error.isSome()) {
+    // Kill (and reap) the children that were forked already, rather
+    // than leaking them.
+    foreach (pid_t pid, pids) {
+      ::kill(pid, SIGKILL);
+    }
+
+    foreach (const Future<Option<int> >& future, futures) {
+      AWAIT_READY_FOR(future, Minutes(1));
+    }
+
+    FAIL() << error.get().message;
+  }
+
+  // NOTE: The callbacks get invoked before 'AWAIT_READY' returns
+  // since they were added first.
+  vector<Stopwatch> watches(count);
+  vector<Duration> latencies(count);
+
+  for (size_t i = 0; i < count; i++) {
+    watches[i].start();
+    futures[i].onAny([&watches, &latencies, i]() {
+      latencies[i] = watches[i].elapsed();
+    });
+
+    EXPECT_EQ(0, ::kill(pids[i], SIGKILL));
+  }
+
+  foreach (const Future<Option<int> >& future, futures) {
+    AWAIT_READY_FOR(future, Minutes(1));
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+
+  cout << "Notified the termination of " << count << " processes with"
+       << " latencies p50 " << latencies[count / 2]
+       << ", p90 " << latencies[count * 9 / 10]
+       << ", p99 " << latencies[count * 99 / 100]
+       << ", max " << latencies.back() << endl;
+}
@@ -14,20 +14,30 @@
 
 #include <gmock/gmock.h>
 
+#include <arpa/inet.h>
+#include <stdint.h>
+
 #include <deque>
 #include <string>
+#include <vector>
 
+#include <process/message.hpp>
+#include <process/pid.hpp>
 #include <process/socket.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/gtest.hpp>
 
 #include "decoder.hpp"
+#include "encoder.hpp"
+#include "framing.hpp"
 
 using namespace process;
 using namespace process::http;
 
 using std::deque;
 using std::string;
+using std::vector;
 
 using process::network::Socket;
 
@@ -247,3 +257,209 @@ TEST(DecoderTest, StreamingResponseFailure)
   EXPECT_TRUE(read.isFailed());
   EXPECT_EQ("failed to decode body", read.failure());
 }
+
+
+TEST(DecoderTest, Frames)
+{
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+  DataDecoder decoder = DataDecoder(socket.get());
+
+  Message message1;
+  message1.name = "name1";
+  message1.from = UPID("from@127.0.0.1:5050");
+  message1.to = UPID("to@127.0.0.1:5051");
+  message1.body = "body1";
+
+  Message message2;
+  message2.name = "name2";
+  message2.from = UPID("from@127.0.0.1:5050");
+  message2.to = UPID("to@127.0.0.1:5051");
+  message2.body = string("body\0\r\n2", 8);
+
+  const string frame1 = MessageEncoder::frame(&message1);
+  const string frame2 = MessageEncoder::frame(&message2);
+
+  // The first frame is complete while the second frame arrives one
+  // byte at a time.
+  const string data = frame1 + frame2.substr(0, 1);
+
+  EXPECT_TRUE(decoder.decode(data.data(), data.length()).empty());
+  ASSERT_FALSE(decoder.failed());
+
+  deque<Message*> messages = decoder.messages();
+  ASSERT_EQ(1u, messages.size());
+
+  EXPECT_EQ("name1", messages[0]->name);
+  EXPECT_EQ(message1.from, messages[0]->from);
+  EXPECT_EQ("to", messages[0]->to.id);
+  EXPECT_EQ("body1", messages[0]->body);
+
+  delete messages[0];
+
+  for (size_t i = 1; i < frame2.length(); i++) {
+    EXPECT_TRUE(decoder.messages().empty());
+    EXPECT_TRUE(decoder.decode(frame2.data() + i, 1).empty());
+    ASSERT_FALSE(decoder.failed());
+  }
+
+  messages = decoder.messages();
+  ASSERT_EQ(1u, messages.size());
+
+  EXPECT_EQ("name2", messages[0]->name);
+  EXPECT_EQ(message2.from, messages[0]->from);
+  EXPECT_EQ("to", messages[0]->to.id);
+  EXPECT_EQ(message2.body, messages[0]->body);
+
+  delete messages[0];
+}
+
+
+TEST(DecoderTest, FramesFailure)
+{
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+  DataDecoder decoder = DataDecoder(socket.get());
+
+  Message message;
+  message.name = "name";
+  message.from = UPID("from@127.0.0.1:5050");
+  message.to = UPID("to@127.0.0.1:5051");
+
+  // Every frame must start with the marker, so an HTTP request can't
+  // follow a binary frame.
+  const string data =
+    MessageEncoder::frame(&message) +
+    "GET / HTTP/1.1\r\n"
+    "\r\n";
+
+  EXPECT_TRUE(decoder.decode(data.data(), data.length()).empty());
+  EXPECT_TRUE(decoder.failed());
+
+  deque<Message*> messages = decoder.messages();
+  ASSERT_EQ(1u, messages.size());
+  delete messages[0];
+}
+
+
+TEST(DecoderTest, FramingNegotiation)
+{
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+  DataDecoder decoder = DataDecoder(socket.get());
+
+  const string negotiation = framing::negotiation();
+
+  deque<Request*> requests =
+    decoder.decode(negotiation.data(), negotiation.length());
+  ASSERT_FALSE(decoder.failed());
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_TRUE(framing::negotiation(*requests[0]));
+
+  delete requests[0];
+
+  // A frame after the negotiation switches to binary framing.
+  Message message;
+  message.name = "name";
+  message.from = UPID("from@127.0.0.1:5050");
+  message.to = UPID("to@127.0.0.1:5051");
+
+  const string frame = MessageEncoder::frame(&message);
+
+  EXPECT_TRUE(decoder.decode(frame.data(), frame.length()).empty());
+  ASSERT_FALSE(decoder.failed());
+
+  deque<Message*> messages = decoder.messages();
+  ASSERT_EQ(1u, messages.size());
+  EXPECT_EQ("name", messages[0]->name);
+
+  delete messages[0];
+}
+
+
+// Tests that the framing stays HTTP when a peer sends a request after
+// a negotiation, e.g., because it gave up waiting for our response.
+TEST(DecoderTest, FramingNegotiationFallback)
+{
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+  DataDecoder decoder = DataDecoder(socket.get());
+
+  // The request arrives together with the negotiation and its body
+  // arrives separately, starting with a MARKER which must not be
+  // mistaken for the start of a binary frame.
+  const string data1 =
+    framing::negotiation() +
+    "POST /to/name HTTP/1.1\r\n"
+    "Content-Length: 2\r\n"
+    "\r\n";
+
+  const string data2 = string("\0\0", 2);
+
+  deque<Request*> requests = decoder.decode(data1.data(), data1.length());
+  ASSERT_FALSE(decoder.failed());
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_TRUE(framing::negotiation(*requests[0]));
+
+  delete requests[0];
+
+  requests = decoder.decode(data2.data(), data2.length());
+  ASSERT_FALSE(decoder.failed());
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_EQ("/to/name", requests[0]->url.path);
+  EXPECT_EQ(data2, requests[0]->body);
+
+  delete requests[0];
+
+  EXPECT_TRUE(decoder.messages().empty());
+}
+
+
+// Tests that frames larger than the maximum frame size are rejected
+// as soon as their header arrives, including frames whose lengths
+// would overflow when added up.
+TEST(DecoderTest, FramesTooLarge)
+{
+  // Returns a frame header with the given lengths.
+  auto header = [](uint32_t name, uint32_t from, uint32_t to, uint32_t body) {
+    string data(1, framing::MARKER);
+
+    const uint32_t lengths[] = {name, from, to, body};
+
+    foreach (uint32_t length, lengths) {
+      const uint32_t value = htonl(length);
+      data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    return data;
+  };
+
+  const vector<string> headers = {
+    header(0, 0, 0, framing::MAX_FRAME_SIZE),
+    header(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff),
+    header(0x80000000, 0x80000000, 0, 0)
+  };
+
+  foreach (const string& data, headers) {
+    Try<Socket> socket = Socket::create();
+    ASSERT_SOME(socket);
+    DataDecoder decoder = DataDecoder(socket.get());
+
+    EXPECT_TRUE(decoder.decode(data.data(), data.length()).empty());
+    EXPECT_TRUE(decoder.failed());
+    EXPECT_TRUE(decoder.messages().empty());
+  }
+
+  // The same holds if the header arrives one byte at a time.
+  Try<Socket> socket = Socket::create();
+  ASSERT_SOME(socket);
+  DataDecoder decoder = DataDecoder(socket.get());
+
+  const string data = headers[0];
+
+  for (size_t i = 0; i < data.length(); i++) {
+    EXPECT_TRUE(decoder.decode(data.data() + i, 1).empty());
+  }
+
+  EXPECT_TRUE(decoder.failed());
+}
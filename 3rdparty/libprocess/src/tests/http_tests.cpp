@@ -19,6 +19,8 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
+#include <sys/socket.h>
+
 #include <string>
 #include <vector>
 
@@ -37,6 +39,7 @@
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
 #include <stout/stringify.hpp>
+#include <stout/strings.hpp>
 
 #include "encoder.hpp"
 
@@ -977,6 +980,47 @@ TEST(HTTPConnectionTest, Equality)
 }
 
 
+// Tests that a connection can be made over a socket that is already
+// connected, in this case one end of a unix domain socket pair.
+TEST(HTTPConnectionTest, ConnectedSocket)
+{
+  int sockets[2];
+  ASSERT_EQ(0, ::socketpair(
+      AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sockets));
+
+  Try<Socket> socket = Socket::create(Socket::POLL, sockets[0]);
+  ASSERT_SOME(socket);
+
+  Future<http::Connection> connect = http::connect(socket.get());
+  AWAIT_READY(connect);
+
+  http::Connection connection = connect.get();
+
+  http::Request request;
+  request.method = "GET";
+  request.url = URL("http", "localhost", 80, "/get");
+  request.keepAlive = false;
+
+  Future<http::Response> response = connection.send(request);
+
+  // Act as the server on the other end of the socket pair.
+  char buffer[1024];
+  Future<size_t> read = io::read(sockets[1], buffer, sizeof(buffer));
+
+  AWAIT_READY(read);
+  EXPECT_TRUE(strings::startsWith(
+      string(buffer, read.get()), "GET /get HTTP/1.1\r\n"));
+
+  AWAIT_READY(io::write(
+      sockets[1],
+      "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nhi"));
+
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("hi", response);
+
+  ::close(sockets[1]);
+}
+
+
 TEST(HTTPTest, QueryEncodeDecode)
 {
   // If we use Type<a, b> directly inside a macro without surrounding
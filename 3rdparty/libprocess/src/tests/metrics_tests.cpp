@@ -424,6 +424,36 @@ TEST(MetricsTest, Timer)
 }
 
 
+TEST(MetricsTest, TimerRecord)
+{
+  metrics::Timer<Milliseconds> timer("test/timer", Seconds(60));
+  EXPECT_EQ("test/timer_ms", timer.name());
+
+  AWAIT_READY(metrics::add(timer));
+
+  // We have to pause the clock to ensure the time series
+  // entries are unique.
+  Clock::pause();
+
+  timer.record(Seconds(1));
+  Clock::advance(Seconds(1));
+  timer.record(Milliseconds(500));
+
+  Clock::resume();
+
+  Future<double> value = timer.value();
+  AWAIT_READY(value);
+  EXPECT_FLOAT_EQ(500.0, value.get());
+
+  Option<Statistics<double>> statistics = timer.statistics();
+  EXPECT_SOME(statistics);
+  EXPECT_EQ(2u, statistics.get().count);
+  EXPECT_FLOAT_EQ(1000.0, statistics.get().max);
+
+  AWAIT_READY(metrics::remove(timer));
+}
+
+
 static Future<int> advanceAndReturn()
 {
   Clock::advance(Seconds(1));
@@ -21,6 +21,7 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
+#include <mutex>
 #include <string>
 #include <sstream>
 #include <tuple>
@@ -43,6 +44,7 @@
 #include <process/run.hpp>
 #include <process/socket.hpp>
 #include <process/time.hpp>
+#include <process/timer.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/gtest.hpp>
@@ -53,9 +55,12 @@
 #include <stout/os.hpp>
 #include <stout/stringify.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/strings.hpp>
+#include <stout/synchronized.hpp>
 #include <stout/try.hpp>
 
 #include "encoder.hpp"
+#include "framing.hpp"
 
 using namespace process;
 
@@ -1060,6 +1065,112 @@ public:
 };
 
 
+// Verifies that timers expire in the order of their timeouts, no
+// matter how far apart they are, and that canceled timers do not
+// expire.
+TEST(ProcessTest, Timers)
+{
+  Clock::pause();
+
+  std::mutex mutex;
+  vector<int> expired;
+
+  const vector<Duration> durations = {
+    Days(400),
+    Milliseconds(1),
+    Hours(1),
+    Nanoseconds(1),
+    Seconds(1),
+    Milliseconds(1),
+    Weeks(3),
+    Seconds(70)
+  };
+
+  vector<Timer> timers;
+  for (size_t i = 0; i < durations.size(); i++) {
+    timers.push_back(Clock::timer(durations[i], [&mutex, &expired, i]() {
+      synchronized (mutex) {
+        expired.push_back(i);
+      }
+    }));
+  }
+
+  EXPECT_TRUE(Clock::cancel(timers[2]));
+  EXPECT_FALSE(Clock::cancel(timers[2]));
+
+  Clock::advance(Seconds(1));
+  Clock::settle();
+
+  synchronized (mutex) {
+    EXPECT_EQ(vector<int>({3, 1, 5, 4}), expired);
+  }
+
+  EXPECT_FALSE(Clock::cancel(timers[4]));
+
+  Clock::advance(Days(400));
+  Clock::settle();
+
+  synchronized (mutex) {
+    EXPECT_EQ(vector<int>({3, 1, 5, 4, 7, 6, 0}), expired);
+  }
+
+  Clock::resume();
+}
+
+
+// Checks that the timers which are due fire even after the clock was
+// stepped backwards (behind the timers that have already expired).
+TEST(ProcessTest, TimersClockBackwards)
+{
+  Clock::pause();
+
+  std::mutex mutex;
+  vector<int> expired;
+
+  auto expire = [&mutex, &expired](int i) {
+    return [&mutex, &expired, i]() {
+      synchronized (mutex) {
+        expired.push_back(i);
+      }
+    };
+  };
+
+  Clock::timer(Seconds(10), expire(0));
+
+  Clock::advance(Seconds(10));
+  Clock::settle();
+
+  // Step the clock backwards.
+  Clock::advance(Seconds(-5));
+
+  Clock::timer(Seconds(0), expire(1));
+  Clock::timer(Seconds(1), expire(2));
+  Clock::timer(Seconds(10), expire(3));
+
+  Clock::settle();
+
+  synchronized (mutex) {
+    EXPECT_EQ(vector<int>({0, 1}), expired);
+  }
+
+  Clock::advance(Seconds(1));
+  Clock::settle();
+
+  synchronized (mutex) {
+    EXPECT_EQ(vector<int>({0, 1, 2}), expired);
+  }
+
+  Clock::advance(Seconds(9));
+  Clock::settle();
+
+  synchronized (mutex) {
+    EXPECT_EQ(vector<int>({0, 1, 2, 3}), expired);
+  }
+
+  Clock::resume();
+}
+
+
 TEST(ProcessTest, Donate)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
@@ -1357,6 +1468,238 @@ TEST(ProcessTest, Remote)
 }
 
 
+// Like the 'remote' test but sends the message as a binary frame.
+TEST(ProcessTest, RemoteBinary)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  RemoteProcess process;
+  spawn(process);
+
+  Future<string> body;
+  EXPECT_CALL(process, handler(_, _))
+    .WillOnce(FutureArg<1>(&body));
+
+  Try<Socket> create = Socket::create();
+  ASSERT_SOME(create);
+
+  Socket socket = create.get();
+
+  AWAIT_READY(socket.connect(process.self().address));
+
+  Message message;
+  message.name = "handler";
+  message.from = UPID();
+  message.to = process.self();
+  message.body = "hello world";
+
+  const string data = MessageEncoder::frame(&message);
+
+  AWAIT_READY(socket.send(data));
+
+  AWAIT_EXPECT_EQ("hello world", body);
+
+  terminate(process);
+  wait(process);
+}
+
+
+// Like the 'remote' test but first negotiates binary framing and
+// then sends the message as a binary frame on the same connection.
+TEST(ProcessTest, RemoteNegotiation)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  RemoteProcess process;
+  spawn(process);
+
+  Future<string> body;
+  EXPECT_CALL(process, handler(_, _))
+    .WillOnce(FutureArg<1>(&body));
+
+  Try<Socket> create = Socket::create();
+  ASSERT_SOME(create);
+
+  Socket socket = create.get();
+
+  AWAIT_READY(socket.connect(process.self().address));
+
+  AWAIT_READY(socket.send(framing::negotiation()));
+
+  Future<string> response = socket.recv();
+  AWAIT_READY(response);
+  EXPECT_TRUE(strings::startsWith(response.get(), "HTTP/1.1 200 OK"));
+  EXPECT_TRUE(strings::contains(
+      response.get(),
+      string(framing::HEADER) + ": " + framing::BINARY));
+
+  Message message;
+  message.name = "handler";
+  message.from = UPID();
+  message.to = process.self();
+  message.body = "hello world";
+
+  AWAIT_READY(socket.send(MessageEncoder::frame(&message)));
+
+  AWAIT_EXPECT_EQ("hello world", body);
+
+  terminate(process);
+  wait(process);
+}
+
+
+// A process that links to a (remote) process and sends it messages,
+// used to test the framing negotiation on the sending side.
+class FramingProcess : public Process<FramingProcess>
+{
+public:
+  explicit FramingProcess(const UPID& _to) : to(_to) {}
+
+  void connect()
+  {
+    link(to);
+  }
+
+  void message(const string& body)
+  {
+    send(to, "handler", body.data(), body.size());
+  }
+
+private:
+  const UPID to;
+};
+
+
+// Tests that a link negotiates binary framing with its peer and then
+// re-encodes the messages that were queued during the negotiation.
+TEST(ProcessTest, LinkNegotiation)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Pause the clock so that the negotiation can't time out.
+  Clock::pause();
+
+  Try<Socket> create = Socket::create();
+  ASSERT_SOME(create);
+
+  Socket socket = create.get();
+
+  ASSERT_SOME(socket.bind(Address()));
+  ASSERT_SOME(socket.listen(1));
+
+  Try<Address> address = socket.address();
+  ASSERT_SOME(address);
+
+  const UPID to("receiver", address.get());
+
+  FramingProcess process(to);
+  spawn(process);
+
+  Future<Socket> accept = socket.accept();
+
+  dispatch(process, &FramingProcess::connect);
+
+  AWAIT_READY(accept);
+
+  Socket client = accept.get();
+
+  const string negotiation = framing::negotiation();
+
+  AWAIT_EXPECT_EQ(negotiation, client.recv(negotiation.size()));
+
+  // This message gets held until the negotiation completes.
+  dispatch(process, &FramingProcess::message, "hello world");
+
+  Clock::settle();
+
+  AWAIT_READY(client.send(
+      "HTTP/1.1 200 OK\r\n"
+      "Libprocess-Framing: binary\r\n"
+      "Content-Length: 0\r\n"
+      "\r\n"));
+
+  Message message;
+  message.name = "handler";
+  message.from = process.self();
+  message.to = to;
+  message.body = "hello world";
+
+  const string frame = MessageEncoder::frame(&message);
+
+  AWAIT_EXPECT_EQ(frame, client.recv(frame.size()));
+
+  // Subsequent messages get sent as binary frames right away.
+  dispatch(process, &FramingProcess::message, "hello world");
+
+  AWAIT_EXPECT_EQ(frame, client.recv(frame.size()));
+
+  terminate(process);
+  wait(process);
+
+  Clock::resume();
+}
+
+
+// Tests that a link falls back to HTTP framing when the peer doesn't
+// respond to the negotiation in time, sending the messages that were
+// queued during the negotiation as HTTP requests.
+TEST(ProcessTest, LinkNegotiationTimeout)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  Try<Socket> create = Socket::create();
+  ASSERT_SOME(create);
+
+  Socket socket = create.get();
+
+  ASSERT_SOME(socket.bind(Address()));
+  ASSERT_SOME(socket.listen(1));
+
+  Try<Address> address = socket.address();
+  ASSERT_SOME(address);
+
+  const UPID to("receiver", address.get());
+
+  FramingProcess process(to);
+  spawn(process);
+
+  Future<Socket> accept = socket.accept();
+
+  dispatch(process, &FramingProcess::connect);
+
+  AWAIT_READY(accept);
+
+  Socket client = accept.get();
+
+  const string negotiation = framing::negotiation();
+
+  AWAIT_EXPECT_EQ(negotiation, client.recv(negotiation.size()));
+
+  dispatch(process, &FramingProcess::message, "hello world");
+
+  Clock::settle();
+
+  // Nothing gets sent until the negotiation times out.
+  Future<string> recv = client.recv(1);
+  EXPECT_TRUE(recv.isPending());
+
+  Clock::advance(framing::NEGOTIATION_TIMEOUT);
+
+  AWAIT_EXPECT_EQ("P", recv);
+
+  const string data = "OST /receiver/handler HTTP/1.1";
+
+  AWAIT_EXPECT_EQ(data, client.recv(data.size()));
+
+  terminate(process);
+  wait(process);
+
+  Clock::resume();
+}
+
+
 // Like the 'remote' test but uses http::post.
 TEST(ProcessTest, Http1)
 {
@@ -322,6 +322,12 @@ private:
   // returns Resources.
   Option<Resources> find(const Resource& target) const;
 
+  // Similar to the public '+=' and '-=' but skip the validity check,
+  // i.e., the given Resource object must be valid and non-empty
+  // (e.g. it's inside a Resources).
+  void add(const Resource& that);
+  void subtract(const Resource& that);
+
   google::protobuf::RepeatedPtrField<Resource> resources;
 };
 
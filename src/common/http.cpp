@@ -354,5 +354,242 @@ JSON::Object model(
 }
 
 
+void json(JSON::ObjectWriter* writer, const Resources& resources)
+{
+  // To maintain backwards compatibility we exclude revocable
+  // resources in the reporting.
+  Resources nonRevocable = resources - resources.revocable();
+
+  map<string, Value_Type> types = nonRevocable.types();
+
+  // Like 'model' we always report cpus, mem and disk.
+  static const char* names[] = {"cpus", "mem", "disk"};
+
+  foreach (const char* name, names) {
+    if (types.count(name) == 0) {
+      writer->field(name, 0);
+    }
+  }
+
+  foreachpair (const string& name, const Value_Type& type, types) {
+    switch (type) {
+      case Value::SCALAR:
+        writer->field(
+            name,
+            nonRevocable.get<Value::Scalar>(name).get().value());
+        break;
+      case Value::RANGES:
+        writer->field(
+            name,
+            stringify(nonRevocable.get<Value::Ranges>(name).get()));
+        break;
+      case Value::SET:
+        writer->field(
+            name,
+            stringify(nonRevocable.get<Value::Set>(name).get()));
+        break;
+      default:
+        LOG(FATAL) << "Unexpected Value type: " << type;
+    }
+  }
+}
+
+
+void json(JSON::ObjectWriter* writer, const CommandInfo& command)
+{
+  if (command.has_shell()) {
+    writer->field("shell", command.shell());
+  }
+
+  if (command.has_value()) {
+    writer->field("value", command.value());
+  }
+
+  writer->field("argv", [&](JSON::ArrayWriter* writer) {
+    foreach (const string& arg, command.arguments()) {
+      writer->element(arg);
+    }
+  });
+
+  if (command.has_environment()) {
+    writer->field("environment", [&](JSON::ObjectWriter* writer) {
+      writer->field("variables", [&](JSON::ArrayWriter* writer) {
+        foreach (const Environment_Variable& variable,
+                 command.environment().variables()) {
+          writer->element([&](JSON::ObjectWriter* writer) {
+            writer->field("name", variable.name());
+            writer->field("value", variable.value());
+          });
+        }
+      });
+    });
+  }
+
+  writer->field("uris", [&](JSON::ArrayWriter* writer) {
+    foreach (const CommandInfo_URI& uri, command.uris()) {
+      writer->element([&](JSON::ObjectWriter* writer) {
+        writer->field("value", uri.value());
+        writer->field("executable", uri.executable());
+      });
+    }
+  });
+}
+
+
+void json(JSON::ObjectWriter* writer, const ExecutorInfo& executorInfo)
+{
+  writer->field("executor_id", executorInfo.executor_id().value());
+  writer->field("name", executorInfo.name());
+  writer->field("data", executorInfo.data());
+  writer->field("framework_id", executorInfo.framework_id().value());
+
+  writer->field("command", [&](JSON::ObjectWriter* writer) {
+    json(writer, executorInfo.command());
+  });
+
+  writer->field("resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, Resources(executorInfo.resources()));
+  });
+}
+
+
+void json(JSON::ArrayWriter* writer, const Labels& labels)
+{
+  foreach (const Label& label, labels.labels()) {
+    writer->element(JSON::Protobuf(label));
+  }
+}
+
+
+void json(JSON::ObjectWriter* writer, const NetworkInfo& info)
+{
+  if (info.has_ip_address()) {
+    writer->field("ip_address", info.ip_address());
+  }
+
+  if (info.groups().size() > 0) {
+    writer->field("groups", [&](JSON::ArrayWriter* writer) {
+      foreach (const string& group, info.groups()) {
+        writer->element(group);
+      }
+    });
+  }
+
+  if (info.has_labels()) {
+    writer->field("labels", [&](JSON::ArrayWriter* writer) {
+      json(writer, info.labels());
+    });
+  }
+}
+
+
+void json(JSON::ObjectWriter* writer, const ContainerStatus& status)
+{
+  if (status.network_infos().size() > 0) {
+    writer->field("network_infos", [&](JSON::ArrayWriter* writer) {
+      foreach (const NetworkInfo& info, status.network_infos()) {
+        writer->element([&](JSON::ObjectWriter* writer) {
+          json(writer, info);
+        });
+      }
+    });
+  }
+}
+
+
+static void json(JSON::ObjectWriter* writer, const TaskStatus& status)
+{
+  writer->field("state", TaskState_Name(status.state()));
+  writer->field("timestamp", status.timestamp());
+
+  if (status.has_labels()) {
+    writer->field("labels", [&](JSON::ArrayWriter* writer) {
+      json(writer, status.labels());
+    });
+  }
+
+  if (status.has_container_status()) {
+    writer->field("container_status", [&](JSON::ObjectWriter* writer) {
+      json(writer, status.container_status());
+    });
+  }
+}
+
+
+void json(JSON::ObjectWriter* writer, const Task& task)
+{
+  writer->field("id", task.task_id().value());
+  writer->field("name", task.name());
+  writer->field("framework_id", task.framework_id().value());
+  writer->field(
+      "executor_id",
+      task.has_executor_id() ? task.executor_id().value() : "");
+  writer->field("slave_id", task.slave_id().value());
+  writer->field("state", TaskState_Name(task.state()));
+
+  writer->field("resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, Resources(task.resources()));
+  });
+
+  writer->field("statuses", [&](JSON::ArrayWriter* writer) {
+    foreach (const TaskStatus& status, task.statuses()) {
+      writer->element([&](JSON::ObjectWriter* writer) {
+        json(writer, status);
+      });
+    }
+  });
+
+  if (task.has_labels()) {
+    writer->field("labels", [&](JSON::ArrayWriter* writer) {
+      json(writer, task.labels());
+    });
+  }
+
+  if (task.has_discovery()) {
+    writer->field("discovery", JSON::Protobuf(task.discovery()));
+  }
+}
+
+
+void json(
+    JSON::ObjectWriter* writer,
+    const TaskInfo& task,
+    const FrameworkID& frameworkId,
+    const TaskState& state,
+    const vector<TaskStatus>& statuses)
+{
+  writer->field("id", task.task_id().value());
+  writer->field("name", task.name());
+  writer->field("framework_id", frameworkId.value());
+  writer->field(
+      "executor_id",
+      task.has_executor() ? task.executor().executor_id().value() : "");
+  writer->field("slave_id", task.slave_id().value());
+  writer->field("state", TaskState_Name(state));
+
+  writer->field("resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, Resources(task.resources()));
+  });
+
+  writer->field("statuses", [&](JSON::ArrayWriter* writer) {
+    foreach (const TaskStatus& status, statuses) {
+      writer->element([&](JSON::ObjectWriter* writer) {
+        json(writer, status);
+      });
+    }
+  });
+
+  if (task.has_labels()) {
+    writer->field("labels", [&](JSON::ArrayWriter* writer) {
+      json(writer, task.labels());
+    });
+  }
+
+  if (task.has_discovery()) {
+    writer->field("discovery", JSON::Protobuf(task.discovery()));
+  }
+}
+
+
 }  // namespace internal {
 }  // namespace mesos {
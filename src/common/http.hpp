@@ -26,6 +26,7 @@
 
 #include <stout/hashmap.hpp>
 #include <stout/json.hpp>
+#include <stout/jsonify.hpp>
 #include <stout/protobuf.hpp>
 
 namespace mesos {
@@ -92,6 +93,23 @@ JSON::Object model(
     const TaskState& state,
     const std::vector<TaskStatus>& statuses);
 
+// These write the same JSON as the 'model' functions above straight
+// into a JSON::ObjectWriter (or JSON::ArrayWriter), for endpoints
+// that stream their (potentially large) responses.
+void json(JSON::ObjectWriter* writer, const Resources& resources);
+void json(JSON::ObjectWriter* writer, const CommandInfo& command);
+void json(JSON::ObjectWriter* writer, const ExecutorInfo& executorInfo);
+void json(JSON::ArrayWriter* writer, const Labels& labels);
+void json(JSON::ObjectWriter* writer, const NetworkInfo& info);
+void json(JSON::ObjectWriter* writer, const ContainerStatus& status);
+void json(JSON::ObjectWriter* writer, const Task& task);
+void json(
+    JSON::ObjectWriter* writer,
+    const TaskInfo& task,
+    const FrameworkID& frameworkId,
+    const TaskState& state,
+    const std::vector<TaskStatus>& statuses);
+
 } // namespace internal {
 } // namespace mesos {
 
@@ -578,17 +578,45 @@ Resources::Resources(
 
 bool Resources::contains(const Resources& that) const
 {
-  Resources remaining = *this;
-
-  foreach (const Resource& resource, that.resources) {
+  // No two Resource objects in a Resources can be added together, so
+  // each Resource object in 'that' is contained in a different
+  // Resource object in 'this' and we can check them one by one
+  // without subtracting them from a copy of 'this'. The exception
+  // are persistent volumes, which are never combined (i.e., 'that'
+  // may contain the same volume more than once).
+  bool volumes = false;
+
+  for (int i = 0; i < that.resources.size(); i++) {
+    const Resource& resource = that.resources.Get(i);
+
+    // Resources that were built the same way (e.g., copies) keep
+    // their Resource objects in the same order, so we first try the
+    // Resource object at the same position before searching.
+    //
     // NOTE: We use _contains because Resources only contain valid
     // Resource objects, and we don't want the performance hit of the
     // validity check.
+    if (!(i < resources.size() &&
+          internal::contains(resources.Get(i), resource)) &&
+        !_contains(resource)) {
+      return false;
+    }
+
+    volumes = volumes || isPersistentVolume(resource);
+  }
+
+  if (!volumes) {
+    return true;
+  }
+
+  Resources remaining = *this;
+
+  foreach (const Resource& resource, that.resources) {
     if (!remaining._contains(resource)) {
       return false;
     }
 
-    remaining -= resource;
+    remaining.subtract(resource);
   }
 
   return true;
@@ -1046,6 +1074,47 @@ bool Resources::_contains(const Resource& that) const
 }
 
 
+void Resources::add(const Resource& that)
+{
+  foreach (Resource& resource, resources) {
+    if (internal::addable(resource, that)) {
+      resource += that;
+      return;
+    }
+  }
+
+  // Cannot be combined with any existing Resource object.
+  resources.Add()->CopyFrom(that);
+}
+
+
+void Resources::subtract(const Resource& that)
+{
+  for (int i = 0; i < resources.size(); i++) {
+    Resource* resource = resources.Mutable(i);
+
+    if (internal::subtractable(*resource, that)) {
+      *resource -= that;
+
+      // Remove the resource if it becomes invalid or zero. We need
+      // to do the validation because we want to strip negative
+      // scalar Resource object. Subtraction can only make a scalar
+      // invalid by making it negative, so we skip the validation
+      // for scalars.
+      if (resource->type() == Value::SCALAR) {
+        if (resource->scalar().value() <= 0) {
+          resources.DeleteSubrange(i, 1);
+        }
+      } else if (validate(*resource).isSome() || isEmpty(*resource)) {
+        resources.DeleteSubrange(i, 1);
+      }
+
+      return;
+    }
+  }
+}
+
+
 /////////////////////////////////////////////////
 // Overloaded operators.
 /////////////////////////////////////////////////
@@ -1059,6 +1128,12 @@ Resources::operator const google::protobuf::RepeatedPtrField<Resource>&() const
 
 bool Resources::operator==(const Resources& that) const
 {
+  // Equal Resources have the same number of Resource objects since
+  // Resource objects that can be added together are always combined.
+  if (resources.size() != that.resources.size()) {
+    return false;
+  }
+
   return this->contains(that) && that.contains(*this);
 }
 
@@ -1088,19 +1163,7 @@ Resources Resources::operator+(const Resources& that) const
 Resources& Resources::operator+=(const Resource& that)
 {
   if (validate(that).isNone() && !isEmpty(that)) {
-    bool found = false;
-    foreach (Resource& resource, resources) {
-      if (internal::addable(resource, that)) {
-        resource += that;
-        found = true;
-        break;
-      }
-    }
-
-    // Cannot be combined with any existing Resource object.
-    if (!found) {
-      resources.Add()->CopyFrom(that);
-    }
+    add(that);
   }
 
   return *this;
@@ -1109,8 +1172,11 @@ Resources& Resources::operator+=(const Resource& that)
 
 Resources& Resources::operator+=(const Resources& that)
 {
+  // NOTE: We use add because Resources only contain valid and
+  // non-empty Resource objects, and we don't want the performance hit
+  // of the validity check.
   foreach (const Resource& resource, that.resources) {
-    *this += resource;
+    add(resource);
   }
 
   return *this;
@@ -1136,22 +1202,7 @@ Resources Resources::operator-(const Resources& that) const
 Resources& Resources::operator-=(const Resource& that)
 {
   if (validate(that).isNone() && !isEmpty(that)) {
-    for (int i = 0; i < resources.size(); i++) {
-      Resource* resource = resources.Mutable(i);
-
-      if (internal::subtractable(*resource, that)) {
-        *resource -= that;
-
-        // Remove the resource if it becomes invalid or zero. We need
-        // to do the validation because we want to strip negative
-        // scalar Resource object.
-        if (validate(*resource).isSome() || isEmpty(*resource)) {
-          resources.DeleteSubrange(i, 1);
-        }
-
-        break;
-      }
-    }
+    subtract(that);
   }
 
   return *this;
@@ -1160,8 +1211,11 @@ Resources& Resources::operator-=(const Resource& that)
 
 Resources& Resources::operator-=(const Resources& that)
 {
+  // NOTE: We use subtract because Resources only contain valid and
+  // non-empty Resource objects, and we don't want the performance hit
+  // of the validity check.
   foreach (const Resource& resource, that.resources) {
-    *this -= resource;
+    subtract(resource);
   }
 
   return *this;
@@ -33,6 +33,7 @@
 #include "common/status_utils.hpp"
 
 #include "docker/docker.hpp"
+#include "docker/engine.hpp"
 
 #ifdef __linux__
 #include "linux/cgroups.hpp"
@@ -98,13 +99,17 @@ static Future<Nothing> checkError(const string& cmd, const Subprocess& s)
 Try<Docker*> Docker::create(
     const string& path,
     const string& socket,
-    bool validate)
+    bool validate,
+    bool engine)
 {
   if (!strings::startsWith(socket, "/")) {
     return Error("Invalid Docker socket path: " + socket);
   }
 
-  Docker* docker = new Docker(path, socket);
+  Docker* docker = engine
+    ? new DockerEngine(path, socket)
+    : new Docker(path, socket);
+
   if (!validate) {
     return docker;
   }
@@ -41,11 +41,14 @@
 class Docker
 {
 public:
-  // Create Docker abstraction and optionally validate docker.
+  // Create Docker abstraction and optionally validate docker. If
+  // 'engine' is true the Docker daemon is talked to directly via its
+  // Engine API on the socket rather than via the CLI where possible.
   static Try<Docker*> create(
     const std::string& path,
     const std::string& socket,
-    bool validate = true);
+    bool validate = true,
+    bool engine = false);
 
   virtual ~Docker() {}
 
@@ -0,0 +1,549 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <list>
+#include <vector>
+
+#include <process/async.hpp>
+#include <process/clock.hpp>
+#include <process/collect.hpp>
+#include <process/http.hpp>
+#include <process/network.hpp>
+#include <process/owned.hpp>
+#include <process/socket.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/json.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "docker/engine.hpp"
+
+#include "slave/constants.hpp"
+
+using namespace mesos::internal::slave;
+
+using namespace process;
+
+using std::list;
+using std::string;
+using std::vector;
+
+
+// Returns whether the response has the specified status code.
+static bool is(const http::Response& response, int code)
+{
+  return strings::startsWith(response.status, stringify(code) + " ");
+}
+
+
+template <typename T>
+static Future<T> failure(
+    const string& operation,
+    const http::Response& response)
+{
+  return Failure(
+      "Failed to " + operation + ": status = " + response.status +
+      " body = " + strings::trim(response.body));
+}
+
+
+// Sends a request to the Docker daemon listening on the unix socket
+// and returns the response once it has been received completely. A
+// new connection is used for each request, which is cheap for a unix
+// socket and ensures that slow requests (e.g., stopping a container)
+// don't hold up others.
+static Future<http::Response> request(
+    const string& socket,
+    const string& method,
+    const string& path,
+    const hashmap<string, string>& query = hashmap<string, string>())
+{
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if (socket.size() >= sizeof(address.sun_path)) {
+    return Failure("Docker socket path '" + socket + "' is too long");
+  }
+
+  memcpy(address.sun_path, socket.data(), socket.size());
+
+  Try<int> fd = network::socket(
+      AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  if (fd.isError()) {
+    return Failure("Failed to create socket: " + fd.error());
+  }
+
+  // Connecting to a unix socket completes right away unless the
+  // daemon's backlog is full, in which case we fail rather than
+  // block.
+  if (::connect(fd.get(), (struct sockaddr*) &address, sizeof(address)) < 0) {
+    ErrnoError error("Failed to connect to '" + socket + "'");
+    os::close(fd.get());
+    return Failure(error);
+  }
+
+  Try<network::Socket> connected =
+    network::Socket::create(network::Socket::POLL, fd.get());
+
+  if (connected.isError()) {
+    os::close(fd.get());
+    return Failure("Failed to create socket: " + connected.error());
+  }
+
+  // NOTE: The Engine API expects the query values to be URL encoded
+  // while http::Request doesn't encode them.
+  hashmap<string, string> encoded;
+  foreachpair (const string& key, const string& value, query) {
+    encoded[key] = http::encode(value);
+  }
+
+  http::Request request;
+  request.method = method;
+  request.url = http::URL("http", "docker", 80, path, encoded);
+  request.keepAlive = false;
+
+  return http::connect(connected.get())
+    .then([request](http::Connection connection) {
+      Future<http::Response> response = connection.send(request);
+
+      // Keep a copy of the connection until the daemon closes it.
+      // Since the connection is destroyed when the last copy goes
+      // away, we delete the copy using 'async' so that it doesn't
+      // happen within the connection's own execution context.
+      http::Connection* copy = new http::Connection(std::move(connection));
+      auto deleter = [copy]() { delete copy; };
+
+      copy->disconnected()
+        .onAny([=]() { async(deleter); });
+
+      return response;
+    });
+}
+
+
+Future<Version> DockerEngine::version() const
+{
+  return request(socketPath, "GET", "/version")
+    .then([](const http::Response& response) -> Future<Version> {
+      if (!is(response, 200)) {
+        return failure<Version>("get docker version", response);
+      }
+
+      Try<JSON::Object> json = JSON::parse<JSON::Object>(response.body);
+      if (json.isError()) {
+        return Failure("Failed to parse JSON: " + json.error());
+      }
+
+      Result<JSON::String> value = json->find<JSON::String>("Version");
+      if (!value.isSome()) {
+        return Failure("Unable to find docker version in output");
+      }
+
+      // Like for the CLI (see Docker::__version), we remove the
+      // components of non-conforming versions such as "x.x.x.fc22"
+      // that don't match the Semantic Versioning specification.
+      vector<string> components = strings::split(value->value, ".");
+      if (components.size() > 3) {
+        components.erase(components.begin() + 3, components.end());
+      }
+
+      Try<Version> version = Version::parse(strings::join(".", components));
+      if (version.isError()) {
+        return Failure("Failed to parse docker version: " + version.error());
+      }
+
+      return version.get();
+    });
+}
+
+
+static Future<Nothing> remove(
+    const string& socket,
+    const string& containerName,
+    bool force)
+{
+  hashmap<string, string> query;
+  if (force) {
+    query["force"] = "1";
+  }
+
+  return request(socket, "DELETE", "/containers/" + containerName, query)
+    .then([=](const http::Response& response) -> Future<Nothing> {
+      if (!is(response, 204)) {
+        return failure<Nothing>(
+            "remove container '" + containerName + "'", response);
+      }
+
+      return Nothing();
+    });
+}
+
+
+Future<Nothing> DockerEngine::stop(
+    const string& containerName,
+    const Duration& timeout,
+    bool remove) const
+{
+  int timeoutSecs = (int) timeout.secs();
+  if (timeoutSecs < 0) {
+    return Failure("A negative timeout can not be applied to docker stop: " +
+                   stringify(timeoutSecs));
+  }
+
+  VLOG(1) << "Stopping docker container '" << containerName << "'";
+
+  const string socket = socketPath;
+
+  return request(
+      socket,
+      "POST",
+      "/containers/" + containerName + "/stop",
+      {{"t", stringify(timeoutSecs)}})
+    .then([=](const http::Response& response) -> Future<Nothing> {
+      // Like 'docker stop', stopping a container that is not running
+      // (i.e., '304 Not Modified') succeeds.
+      bool stopped = is(response, 204) || is(response, 304);
+
+      if (remove) {
+        return ::remove(socket, containerName, !stopped);
+      }
+
+      if (!stopped) {
+        return failure<Nothing>(
+            "stop container '" + containerName + "'", response);
+      }
+
+      return Nothing();
+    });
+}
+
+
+Future<Nothing> DockerEngine::rm(
+    const string& containerName,
+    bool force) const
+{
+  VLOG(1) << "Removing docker container '" << containerName << "'";
+
+  return remove(socketPath, containerName, force);
+}
+
+
+static void _inspect(
+    const string& socket,
+    const string& containerName,
+    const Owned<Promise<Docker::Container>>& promise,
+    const Option<Duration>& retryInterval)
+{
+  if (promise->future().hasDiscard()) {
+    promise->discard();
+    return;
+  }
+
+  auto retry = [=]() {
+    VLOG(1) << "Retrying inspect of docker container '" << containerName
+            << "', interval: " << stringify(retryInterval.get());
+
+    Clock::timer(retryInterval.get(), [=]() {
+      _inspect(socket, containerName, promise, retryInterval);
+    });
+  };
+
+  request(socket, "GET", "/containers/" + containerName + "/json")
+    .onAny([=](const Future<http::Response>& response) {
+      if (promise->future().hasDiscard()) {
+        promise->discard();
+        return;
+      }
+
+      // Like for the CLI, we retry if the container can't be found
+      // (yet) or the daemon can't be reached.
+      if (!response.isReady() || !is(response.get(), 200)) {
+        if (retryInterval.isSome()) {
+          retry();
+          return;
+        }
+
+        promise->fail(
+            "Failed to inspect container '" + containerName + "': " +
+            (response.isReady()
+             ? "status = " + response->status +
+               " body = " + strings::trim(response->body)
+             : (response.isFailed() ? response.failure() : "discarded")));
+        return;
+      }
+
+      // The output of 'docker inspect' is an array of the objects
+      // returned by the Engine API, which Docker::Container expects.
+      Try<Docker::Container> container =
+        Docker::Container::create("[" + response->body + "]");
+
+      if (container.isError()) {
+        promise->fail("Unable to create container: " + container.error());
+        return;
+      }
+
+      if (retryInterval.isSome() && !container->started) {
+        retry();
+        return;
+      }
+
+      promise->set(container.get());
+    });
+}
+
+
+static Future<Docker::Container> inspect(
+    const string& socket,
+    const string& containerName,
+    const Option<Duration>& retryInterval)
+{
+  Owned<Promise<Docker::Container>> promise(new Promise<Docker::Container>());
+
+  _inspect(socket, containerName, promise, retryInterval);
+
+  return promise->future();
+}
+
+
+Future<Docker::Container> DockerEngine::inspect(
+    const string& containerName,
+    const Option<Duration>& retryInterval) const
+{
+  VLOG(1) << "Inspecting docker container '" << containerName << "'";
+
+  return ::inspect(socketPath, containerName, retryInterval);
+}
+
+
+// Inspects the named containers, at most DOCKER_PS_MAX_INSPECT_CALLS
+// at a time to bound the number of open connections.
+static Future<list<Docker::Container>> inspect(
+    const string& socket,
+    const Owned<vector<string>>& names,
+    const Owned<list<Docker::Container>>& containers)
+{
+  list<Future<Docker::Container>> batch;
+
+  while (!names->empty() &&
+         batch.size() < (size_t) DOCKER_PS_MAX_INSPECT_CALLS) {
+    batch.push_back(::inspect(socket, names->back(), None()));
+    names->pop_back();
+  }
+
+  return collect(batch)
+    .then([=](const list<Docker::Container>& inspected)
+        -> Future<list<Docker::Container>> {
+      containers->insert(containers->end(), inspected.begin(), inspected.end());
+
+      if (names->empty()) {
+        return *containers;
+      }
+
+      return ::inspect(socket, names, containers);
+    });
+}
+
+
+Future<list<Docker::Container>> DockerEngine::ps(
+    bool all,
+    const Option<string>& prefix) const
+{
+  VLOG(1) << "Listing docker containers";
+
+  hashmap<string, string> query;
+  if (all) {
+    query["all"] = "1";
+  }
+
+  const string socket = socketPath;
+
+  return request(socket, "GET", "/containers/json", query)
+    .then([=](const http::Response& response)
+        -> Future<list<Docker::Container>> {
+      if (!is(response, 200)) {
+        return failure<list<Docker::Container>>(
+            "list containers", response);
+      }
+
+      Try<JSON::Array> array = JSON::parse<JSON::Array>(response.body);
+      if (array.isError()) {
+        return Failure("Failed to parse JSON: " + array.error());
+      }
+
+      Owned<vector<string>> names(new vector<string>());
+
+      foreach (const JSON::Value& value, array->values) {
+        if (!value.is<JSON::Object>()) {
+          return Failure("Unexpected container in JSON: " + stringify(value));
+        }
+
+        Result<JSON::Array> _names =
+          value.as<JSON::Object>().find<JSON::Array>("Names");
+
+        if (!_names.isSome()) {
+          return Failure("Unable to find Names in container");
+        }
+
+        // Besides its own name (e.g., '/mesos-1') a container is also
+        // listed with the names under which it is linked to other
+        // containers (e.g., '/other/mesos-1'), which we skip.
+        foreach (const JSON::Value& _name, _names->values) {
+          if (!_name.is<JSON::String>()) {
+            continue;
+          }
+
+          const string name = strings::remove(
+              _name.as<JSON::String>().value, "/", strings::PREFIX);
+
+          if (strings::contains(name, "/")) {
+            continue;
+          }
+
+          if (prefix.isNone() || strings::startsWith(name, prefix.get())) {
+            names->push_back(name);
+          }
+        }
+      }
+
+      return ::inspect(
+          socket, names, Owned<list<Docker::Container>>(
+              new list<Docker::Container>()));
+    });
+}
+
+
+static Future<Docker::Image> inspectImage(const http::Response& response)
+{
+  if (!is(response, 200)) {
+    return failure<Docker::Image>("inspect image", response);
+  }
+
+  Try<JSON::Object> json = JSON::parse<JSON::Object>(response.body);
+  if (json.isError()) {
+    return Failure("Failed to parse JSON: " + json.error());
+  }
+
+  Try<Docker::Image> image = Docker::Image::create(json.get());
+  if (image.isError()) {
+    return Failure("Unable to create image: " + image.error());
+  }
+
+  return image.get();
+}
+
+
+// Pulls the image and inspects it once the pull has completed.
+// NOTE: Discarding the returned future does not cancel the
+// pull, unlike for the CLI where the 'docker pull' gets killed.
+static Future<Docker::Image> pullImage(
+    const string& socket,
+    const string& image)
+{
+  // Split off the tag, which follows the last ':' unless that is part
+  // of a registry server (e.g., 'localhost:5000/image').
+  size_t colon = image.find_last_of(':');
+  size_t slash = image.find_last_of('/');
+
+  hashmap<string, string> query;
+  if (colon != string::npos && (slash == string::npos || colon > slash)) {
+    query["fromImage"] = image.substr(0, colon);
+    query["tag"] = image.substr(colon + 1);
+  } else {
+    query["fromImage"] = image;
+  }
+
+  VLOG(1) << "Pulling docker image '" << image << "'";
+
+  return request(socket, "POST", "/images/create", query)
+    .then([=](const http::Response& response) -> Future<Docker::Image> {
+      if (!is(response, 200)) {
+        return failure<Docker::Image>(
+            "pull image '" + image + "'", response);
+      }
+
+      // The daemon streams the progress of the pull as JSON objects,
+      // which is how it reports a failed pull as well.
+      foreach (const string& line, strings::tokenize(response.body, "\r\n")) {
+        Try<JSON::Object> message = JSON::parse<JSON::Object>(line);
+        if (message.isError()) {
+          continue;
+        }
+
+        Result<JSON::String> error = message->find<JSON::String>("error");
+        if (error.isSome()) {
+          return Failure(
+              "Failed to pull image '" + image + "': " + error->value);
+        }
+      }
+
+      return request(socket, "GET", "/images/" + image + "/json")
+        .then(&inspectImage);
+    });
+}
+
+
+Future<Docker::Image> DockerEngine::pull(
+    const string& directory,
+    const string& image,
+    bool force) const
+{
+  // Credentials in the sandbox are only picked up by the CLI (see
+  // Docker::pull), since the Engine API would need them in a
+  // 'X-Registry-Auth' header.
+  if (os::exists(path::join(directory, ".dockercfg")) ||
+      os::exists(path::join(directory, ".docker", "config.json"))) {
+    return Docker::pull(directory, image, force);
+  }
+
+  // Like for the CLI, we add a 'latest' tag if no tag was given to
+  // avoid pulling down the whole repository.
+  string dockerImage = image;
+
+  vector<string> parts = strings::split(image, "/");
+
+  if (!strings::contains(parts.back(), ":")) {
+    dockerImage += ":latest";
+  }
+
+  const string socket = socketPath;
+
+  if (force) {
+    return pullImage(socket, dockerImage);
+  }
+
+  return request(socket, "GET", "/images/" + dockerImage + "/json")
+    .then([=](const http::Response& response) -> Future<Docker::Image> {
+      if (is(response, 404)) {
+        return pullImage(socket, dockerImage);
+      }
+
+      return inspectImage(response);
+    });
+}
@@ -0,0 +1,94 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DOCKER_ENGINE_HPP__
+#define __DOCKER_ENGINE_HPP__
+
+#include <list>
+#include <string>
+
+#include <process/future.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/version.hpp>
+
+#include "docker/docker.hpp"
+
+
+// Abstraction for working with Docker that talks to the Docker daemon
+// using its Engine (remote) API over the daemon's unix socket, rather
+// than executing the Docker CLI for every operation. Use
+// Docker::create to create one.
+//
+// NOTE: 'run' still executes the Docker CLI since it attaches the
+// output of the container to the sandbox. Likewise 'pull' executes
+// the CLI when the sandbox contains Docker credentials, since these
+// are only picked up by the CLI.
+class DockerEngine : public Docker
+{
+public:
+  virtual ~DockerEngine() {}
+
+  // Performs 'GET /version'.
+  virtual process::Future<Version> version() const;
+
+  // Performs 'POST /containers/CONTAINER/stop?t=TIMEOUT' followed by a
+  // 'DELETE /containers/CONTAINER' if remove is true (see Docker::stop).
+  virtual process::Future<Nothing> stop(
+      const std::string& containerName,
+      const Duration& timeout = Seconds(0),
+      bool remove = false) const;
+
+  // Performs 'DELETE /containers/CONTAINER(?force=1)'.
+  virtual process::Future<Nothing> rm(
+      const std::string& containerName,
+      bool force = false) const;
+
+  // Performs 'GET /containers/CONTAINER/json' (see Docker::inspect).
+  virtual process::Future<Container> inspect(
+      const std::string& containerName,
+      const Option<Duration>& retryInterval = None()) const;
+
+  // Performs 'GET /containers/json(?all=1)' and inspects each of the
+  // containers.
+  virtual process::Future<std::list<Container>> ps(
+      bool all = false,
+      const Option<std::string>& prefix = None()) const;
+
+  // Performs 'GET /images/IMAGE/json' and, if the image is missing (or
+  // force is true), 'POST /images/create?fromImage=IMAGE' first.
+  virtual process::Future<Image> pull(
+      const std::string& directory,
+      const std::string& image,
+      bool force = false) const;
+
+protected:
+  // Uses the specified path to the Docker CLI tool for 'run' and the
+  // specified path to the unix socket of the Docker daemon.
+  DockerEngine(const std::string& _path, const std::string& _socket)
+    : Docker(_path, _socket), socketPath(_socket) {}
+
+private:
+  friend class Docker;
+
+  const std::string socketPath;
+};
+
+#endif // __DOCKER_ENGINE_HPP__
@@ -16,19 +16,28 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
 #include <mesos/fetcher/fetcher.hpp>
 
+#include <stout/bytes.hpp>
+#include <stout/foreach.hpp>
 #include <stout/json.hpp>
 #include <stout/net.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/protobuf.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
+#include <stout/synchronized.hpp>
 
 #include "hdfs/hdfs.hpp"
 
@@ -43,10 +52,13 @@ using namespace mesos;
 using namespace mesos::internal;
 
 using mesos::fetcher::FetcherInfo;
+using mesos::fetcher::FetcherReport;
 
 using mesos::internal::slave::Fetcher;
+using mesos::internal::slave::FETCHER_MAX_DOWNLOAD_ATTEMPTS;
 
 using std::string;
+using std::vector;
 
 
 // Try to extract sourcePath into directory. If sourcePath is
@@ -119,6 +131,31 @@ static Try<string> downloadWithHadoopClient(
 }
 
 
+// Checks that the HTTP or FTP status code reports a successful
+// transfer.
+static Try<Nothing> checkNetCode(
+    const string& sourceUri,
+    int code,
+    bool resumed)
+{
+  // The status code for successful HTTP requests is 200 (or 206 for
+  // a resumed download), the status code for successful FTP file
+  // transfers is 226.
+  if (strings::startsWith(sourceUri, "ftp://") ||
+      strings::startsWith(sourceUri, "ftps://")) {
+    if (code != 226) {
+      return Error("Error downloading resource, received FTP return code " +
+                   stringify(code));
+    }
+  } else if (code != 200 && !(resumed && code == 206)) {
+    return Error("Error downloading resource, received HTTP return code " +
+                 stringify(code));
+  }
+
+  return Nothing();
+}
+
+
 static Try<string> downloadWithNet(
     const string& sourceUri,
     const string& destinationPath)
@@ -132,27 +169,47 @@ static Try<string> downloadWithNet(
   LOG(INFO) << "Downloading resource from '" << sourceUri
             << "' to '" << destinationPath << "'";
 
-  Try<int> code = net::download(sourceUri, destinationPath);
-  if (code.isError()) {
-    return Error("Error downloading resource: " + code.error());
-  } else {
-    // The status code for successful HTTP requests is 200, the status code
-    // for successful FTP file transfers is 226.
-    if (strings::startsWith(sourceUri, "ftp://") ||
-        strings::startsWith(sourceUri, "ftps://")) {
-      if (code.get() != 226) {
-        return Error("Error downloading resource, received FTP return code " +
-                     stringify(code.get()));
+  // If the transfer gets interrupted, we try again, asking the server
+  // to only send the part of the resource that we do not have yet.
+  bool resume = false;
+  Bytes downloaded;
+
+  for (size_t attempt = 1; ; attempt++) {
+    Try<int> code = net::download(sourceUri, destinationPath, resume);
+
+    if (code.isSome()) {
+      // A server responds with 416 if a previous attempt did in fact
+      // get the whole resource, but we cannot tell that apart from a
+      // changed resource, so we start over.
+      if (resume && code.get() == 416 &&
+          attempt < FETCHER_MAX_DOWNLOAD_ATTEMPTS) {
+        resume = false;
+        downloaded = Bytes(0);
+        continue;
       }
-    } else {
-      if (code.get() != 200) {
-        return Error("Error downloading resource, received HTTP return code " +
-                     stringify(code.get()));
+
+      Try<Nothing> checked = checkNetCode(sourceUri, code.get(), resume);
+      if (checked.isError()) {
+        return Error(checked.error());
       }
+
+      return destinationPath;
     }
-  }
 
-  return destinationPath;
+    if (attempt >= FETCHER_MAX_DOWNLOAD_ATTEMPTS) {
+      return Error("Error downloading resource: " + code.error());
+    }
+
+    // Only resume if this attempt made progress. This makes us start
+    // over if the server does not support resuming.
+    Try<Bytes> size = os::stat::size(destinationPath);
+    resume = size.isSome() && size.get() > downloaded;
+    downloaded = resume ? size.get() : Bytes(0);
+
+    LOG(WARNING) << "Download attempt " << attempt << " of '" << sourceUri
+                 << "' failed: " << code.error() << "; retrying"
+                 << (resume ? " from " + stringify(downloaded) : "");
+  }
 }
 
 
@@ -238,12 +295,49 @@ static Try<string> chmodExecutable(const string& filePath)
 }
 
 
+// Returns the path that a resource bypassing the cache is downloaded
+// to before it gets moved into place in the sandbox directory (see
+// 'install'). The basename of the URI is kept as a suffix since it
+// determines how the resource gets extracted.
+static Try<string> stagingPath(
+    const CommandInfo::URI& uri,
+    const string& sandboxDirectory,
+    int index)
+{
+  Try<string> basename = Fetcher::basename(uri.value());
+  if (basename.isError()) {
+    return Error("Failed to determine the basename of the URI '" +
+                 uri.value() + "' with error: " + basename.error());
+  }
+
+  return path::join(
+      sandboxDirectory,
+      ".mesos-fetcher-" + stringify(index) + "-" + basename.get());
+}
+
+
+static Try<Nothing> downloadBypassingCache(
+    const CommandInfo::URI& uri,
+    const string& stagingPath,
+    const Option<string>& frameworksHome)
+{
+  LOG(INFO) << "Downloading into the sandbox directory";
+
+  Try<string> downloaded = download(uri.value(), stagingPath, frameworksHome);
+  if (downloaded.isError()) {
+    return Error(downloaded.error());
+  }
+
+  return Nothing();
+}
+
+
 // Returns the resulting file or in case of extraction the destination
 // directory (for logging).
 static Try<string> fetchBypassingCache(
     const CommandInfo::URI& uri,
-    const string& sandboxDirectory,
-    const Option<string>& frameworksHome)
+    const string& stagingPath,
+    const string& sandboxDirectory)
 {
   LOG(INFO) << "Fetching directly into the sandbox directory";
 
@@ -255,13 +349,14 @@ static Try<string> fetchBypassingCache(
 
   string path = path::join(sandboxDirectory, basename.get());
 
-  Try<string> downloaded = download(uri.value(), path, frameworksHome);
-  if (downloaded.isError()) {
-    return Error(downloaded.error());
+  Try<Nothing> rename = os::rename(stagingPath, path);
+  if (rename.isError()) {
+    return Error("Failed to move '" + stagingPath + "' to '" + path +
+                 "': " + rename.error());
   }
 
   if (uri.executable()) {
-    return chmodExecutable(downloaded.get());
+    return chmodExecutable(path);
   } else if (uri.extract()) {
     Try<bool> extracted = extract(path, sandboxDirectory);
     if (extracted.isError()) {
@@ -273,7 +368,7 @@ static Try<string> fetchBypassingCache(
     }
   }
 
-  return downloaded;
+  return path;
 }
 
 
@@ -319,12 +414,9 @@ static Try<string> fetchFromCache(
 }
 
 
-// Returns the resulting file or in case of extraction the destination
-// directory (for logging).
-static Try<string> fetchThroughCache(
+static Try<Nothing> downloadThroughCache(
     const FetcherInfo::Item& item,
     const Option<string>& cacheDirectory,
-    const string& sandboxDirectory,
     const Option<string>& frameworksHome)
 {
   if (cacheDirectory.isNone() || cacheDirectory.get().empty()) {
@@ -359,32 +451,72 @@ static Try<string> fetchThroughCache(
     }
   }
 
-  return fetchFromCache(item, cacheDirectory.get(), sandboxDirectory);
+  return Nothing();
 }
 
 
-// Returns the resulting file or in case of extraction the destination
-// directory (for logging).
-static Try<string> fetch(
+// Fetching an item is split in two steps so that downloads can
+// proceed concurrently while the sandbox directory gets populated
+// strictly in the order of the items: an item whose URI has the same
+// basename as, or is an archive overlapping with, an earlier item must
+// overwrite what the earlier item left in the sandbox directory.
+//
+// The first step downloads the item, either into the cache or, when
+// bypassing the cache, to its staging path in the sandbox directory
+// (see 'stagingPath'). The download duration is recorded in 'report'.
+static Try<Nothing> download(
     const FetcherInfo::Item& item,
     const Option<string>& cacheDirectory,
-    const string& sandboxDirectory,
-    const Option<string>& frameworksHome)
+    const string& stagingPath,
+    const Option<string>& frameworksHome,
+    FetcherReport::Item* report)
 {
   LOG(INFO) << "Fetching URI '" << item.uri().value() << "'";
 
-  if (item.action() == FetcherInfo::Item::BYPASS_CACHE) {
-    return fetchBypassingCache(
-        item.uri(),
-        sandboxDirectory,
-        frameworksHome);
+  report->mutable_uri()->CopyFrom(item.uri());
+  report->set_action(item.action());
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Try<Nothing> downloaded = item.action() == FetcherInfo::Item::BYPASS_CACHE
+    ? downloadBypassingCache(item.uri(), stagingPath, frameworksHome)
+    : downloadThroughCache(item, cacheDirectory, frameworksHome);
+
+  if (downloaded.isSome() &&
+      item.action() != FetcherInfo::Item::RETRIEVE_FROM_CACHE) {
+    report->mutable_download_duration()->set_nanoseconds(
+        stopwatch.elapsed().ns());
   }
 
-  return fetchThroughCache(
-      item,
-      cacheDirectory,
-      sandboxDirectory,
-      frameworksHome);
+  report->mutable_fetch_duration()->set_nanoseconds(stopwatch.elapsed().ns());
+
+  return downloaded;
+}
+
+
+// The second step copies, extracts and changes the permissions of a
+// downloaded item in the sandbox directory. The time this takes is
+// added to the fetch duration in 'report'. Returns the resulting file
+// or in case of extraction the destination directory (for logging).
+static Try<string> install(
+    const FetcherInfo::Item& item,
+    const Option<string>& cacheDirectory,
+    const string& stagingPath,
+    const string& sandboxDirectory,
+    FetcherReport::Item* report)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Try<string> fetched = item.action() == FetcherInfo::Item::BYPASS_CACHE
+    ? fetchBypassingCache(item.uri(), stagingPath, sandboxDirectory)
+    : fetchFromCache(item, cacheDirectory.get(), sandboxDirectory);
+
+  report->mutable_fetch_duration()->set_nanoseconds(
+      report->fetch_duration().nanoseconds() + stopwatch.elapsed().ns());
+
+  return fetched;
 }
 
 
@@ -440,17 +572,133 @@ int main(int argc, char* argv[])
       Option<string>::some(fetcherInfo.get().frameworks_home()) :
         Option<string>::none();
 
-  // Fetch each URI to a local file, chmod, then chown if a user is provided.
-  foreach (const FetcherInfo::Item& item, fetcherInfo.get().items()) {
-    Try<string> fetched =
-      fetch(item, cacheDirectory, sandboxDirectory, frameworksHome);
+  const int items = fetcherInfo.get().items_size();
+
+  // Fetch each URI to a local file, chmod, then chown if a user is
+  // provided. Up to 'concurrency' items are downloaded in parallel,
+  // by this thread and additional worker threads. Once a download
+  // fails no more downloads are started, but those already in
+  // progress are finished so that the report is complete.
+  const size_t concurrency = std::min(
+      (size_t) std::max(fetcherInfo.get().concurrency(), 1u),
+      (size_t) items);
+
+  vector<string> stagingPaths(items);
+  vector<FetcherReport::Item> reported(items);
+
+  std::atomic<int> next(0);
+  std::atomic<bool> failed(false);
+
+  std::mutex mutex;
+  Option<string> failure; // Protected by 'mutex'.
+
+  // NOTE: Each item (and hence each element of the vectors above) is
+  // only accessed by the thread that claimed it until all threads
+  // have been joined.
+  auto worker = [&]() {
+    while (!failed.load()) {
+      const int i = next++;
+      if (i >= items) {
+        return;
+      }
+
+      const FetcherInfo::Item& item = fetcherInfo.get().items(i);
+
+      Try<Nothing> downloaded = Nothing();
+
+      if (item.action() == FetcherInfo::Item::BYPASS_CACHE) {
+        Try<string> path = stagingPath(item.uri(), sandboxDirectory, i);
+        if (path.isError()) {
+          downloaded = Error(path.error());
+        } else {
+          stagingPaths[i] = path.get();
+        }
+      }
+
+      if (downloaded.isSome()) {
+        downloaded = download(
+            item,
+            cacheDirectory,
+            stagingPaths[i],
+            frameworksHome,
+            &reported[i]);
+      }
+
+      if (downloaded.isError()) {
+        synchronized (mutex) {
+          if (failure.isNone()) {
+            failure = "Failed to fetch '" + item.uri().value() +
+                      "': " + downloaded.error();
+          }
+        }
+
+        failed.store(true);
+        return;
+      }
+    }
+  };
+
+  vector<std::thread> threads;
+  for (size_t i = 1; i < concurrency; i++) {
+    threads.push_back(std::thread(worker));
+  }
+
+  worker();
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+
+  // Populate the sandbox directory in the order of the items, such
+  // that later items overwrite earlier ones as if they had been
+  // fetched one after another.
+  FetcherReport report;
+
+  for (int i = 0; i < items && failure.isNone(); i++) {
+    const FetcherInfo::Item& item = fetcherInfo.get().items(i);
+
+    Try<string> fetched = install(
+        item,
+        cacheDirectory,
+        stagingPaths[i],
+        sandboxDirectory,
+        &reported[i]);
+
     if (fetched.isError()) {
-      EXIT(1) << "Failed to fetch '" << item.uri().value()
-              << "': " + fetched.error();
-    } else {
-      LOG(INFO) << "Fetched '" << item.uri().value()
-                << "' to '" << fetched.get() << "'";
+      failure = "Failed to fetch '" + item.uri().value() +
+                "': " + fetched.error();
+      break;
     }
+
+    LOG(INFO) << "Fetched '" << item.uri().value()
+              << "' to '" << fetched.get() << "' in "
+              << Nanoseconds(reported[i].fetch_duration().nanoseconds());
+
+    report.add_items()->CopyFrom(reported[i]);
+  }
+
+  // Remove what is left of downloads that did not make it into place
+  // because of a failure.
+  if (failure.isSome()) {
+    foreach (const string& path, stagingPaths) {
+      if (!path.empty() && os::exists(path)) {
+        os::rm(path);
+      }
+    }
+  }
+
+  if (fetcherInfo.get().has_report_path()) {
+    Try<Nothing> write =
+      ::protobuf::write(fetcherInfo.get().report_path(), report);
+    if (write.isError()) {
+      LOG(WARNING) << "Failed to write the fetcher report to '"
+                   << fetcherInfo.get().report_path() << "': "
+                   << write.error();
+    }
+  }
+
+  if (failure.isSome()) {
+    EXIT(1) << failure.get();
   }
 
   // Recursively chown the sandbox directory if a user is provided.
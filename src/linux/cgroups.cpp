@@ -16,11 +16,14 @@
  * limitations under the License.
  */
 
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <fts.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/syscall.h>
@@ -28,6 +31,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <fstream>
 #include <list>
 #include <map>
@@ -57,6 +61,9 @@
 #include <stout/strings.hpp>
 #include <stout/unreachable.hpp>
 
+#include <stout/os/close.hpp>
+#include <stout/os/open.hpp>
+
 #include "linux/cgroups.hpp"
 #include "linux/fs.hpp"
 
@@ -1861,6 +1868,187 @@ Try<hashmap<string, uint64_t>> stat(
 }
 
 
+// Parses an unsigned decimal number without allocating, returning
+// false if [begin, end) is empty or contains anything else.
+static bool parse(const char* begin, const char* end, uint64_t* value)
+{
+  if (begin == end) {
+    return false;
+  }
+
+  *value = 0;
+  for (const char* c = begin; c != end; ++c) {
+    if (*c < '0' || *c > '9') {
+      return false;
+    }
+
+    *value = *value * 10 + (*c - '0');
+  }
+
+  return true;
+}
+
+
+StatisticsReader::~StatisticsReader()
+{
+  foreachvalue (const hashmap<string, int>& controls, fds) {
+    foreachvalue (int fd, controls) {
+      os::close(fd);
+    }
+  }
+}
+
+
+Try<uint64_t> StatisticsReader::value(
+    const string& hierarchy,
+    const string& cgroup,
+    const string& control)
+{
+  Try<size_t> length = read(hierarchy, cgroup, control);
+  if (length.isError()) {
+    return Error(length.error());
+  }
+
+  const char* begin = buffer.data();
+  const char* end = begin + length.get();
+
+  // Ignore the trailing newline.
+  while (end != begin && isspace(*(end - 1))) {
+    --end;
+  }
+
+  uint64_t value;
+  if (!parse(begin, end, &value)) {
+    return Error("Unexpected format in " + control + ": " +
+                 string(buffer.data(), length.get()));
+  }
+
+  return value;
+}
+
+
+Try<hashmap<string, uint64_t>> StatisticsReader::stat(
+    const string& hierarchy,
+    const string& cgroup,
+    const string& file,
+    const set<string>& keys)
+{
+  Try<size_t> length = read(hierarchy, cgroup, file);
+  if (length.isError()) {
+    return Error(length.error());
+  }
+
+  hashmap<string, uint64_t> result;
+
+  const char* end = buffer.data() + length.get();
+  const char* line = buffer.data();
+
+  while (line != end) {
+    const char* newline = std::find(line, end, '\n');
+
+    // Expected line format: "%s %llu", skipping empty lines.
+    if (newline != line) {
+      const char* space = std::find(line, newline, ' ');
+
+      uint64_t value;
+      if (space == newline || !parse(space + 1, newline, &value)) {
+        return Error("Unexpected line format in " + file + ": " +
+                     string(line, newline - line));
+      }
+
+      const size_t size = space - line;
+
+      foreach (const string& key, keys) {
+        if (key.size() == size && memcmp(key.data(), line, size) == 0) {
+          result[key] = value;
+          break;
+        }
+      }
+    }
+
+    line = newline == end ? end : newline + 1;
+  }
+
+  return result;
+}
+
+
+void StatisticsReader::remove(const string& hierarchy, const string& cgroup)
+{
+  const string directory = path::join(hierarchy, cgroup);
+
+  if (fds.contains(directory)) {
+    foreachvalue (int fd, fds[directory]) {
+      os::close(fd);
+    }
+
+    fds.erase(directory);
+  }
+}
+
+
+Try<size_t> StatisticsReader::read(
+    const string& hierarchy,
+    const string& cgroup,
+    const string& control)
+{
+  const string directory = path::join(hierarchy, cgroup);
+  const string path = path::join(directory, control);
+
+  if (!fds.contains(directory) || !fds[directory].contains(control)) {
+    Try<int> fd = os::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd.isError()) {
+      return Error("Failed to open file " + path + ": " + fd.error());
+    }
+
+    fds[directory][control] = fd.get();
+  }
+
+  const int fd = fds[directory][control];
+
+  if (buffer.empty()) {
+    buffer.resize(4096);
+  }
+
+  // The kernel generates the entire contents of a control file for
+  // the first read at offset zero, so a short read means we've read
+  // everything. Only if the buffer was filled do we grow it and keep
+  // reading.
+  size_t length = 0;
+  while (true) {
+    ssize_t n = ::pread(
+        fd,
+        buffer.data() + length,
+        buffer.size() - length,
+        length);
+
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      // Close the control file so that it gets reopened next time,
+      // e.g., in case the cgroup has been recreated.
+      ErrnoError error("Failed to read file " + path);
+
+      os::close(fd);
+      fds[directory].erase(control);
+
+      return error;
+    }
+
+    length += n;
+
+    if (length < buffer.size()) {
+      break;
+    }
+
+    buffer.resize(buffer.size() * 2);
+  }
+
+  return length;
+}
+
 namespace internal {
 
 // Helper for finding the cgroup of the specified pid for the
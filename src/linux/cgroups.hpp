@@ -388,6 +388,71 @@ Try<hashmap<std::string, uint64_t>> stat(
     const std::string& file);
 
 
+// Reads statistics from control files, keeping the control files
+// open across reads. This way collecting the statistics of a cgroup
+// repeatedly (e.g., for every /monitor/statistics request) costs a
+// single pread(2) per control file, rather than opening, reading and
+// closing it every time, and parsing doesn't allocate per line.
+// NOTE: Not thread safe, expected to be owned by a single process
+// (e.g., an isolator).
+class StatisticsReader
+{
+public:
+  StatisticsReader() {}
+  ~StatisticsReader();
+
+  StatisticsReader(const StatisticsReader&) = delete;
+  StatisticsReader& operator=(const StatisticsReader&) = delete;
+
+  // Returns the value of a single value control file, e.g.,
+  // 'memory.usage_in_bytes'.
+  // @param   hierarchy   Path to the hierarchy root.
+  // @param   cgroup      Path to the cgroup relative to the hierarchy root.
+  // @param   control     Name of the control file.
+  // @return  The value read from the control file.
+  //          Error if reading or parsing fails.
+  Try<uint64_t> value(
+      const std::string& hierarchy,
+      const std::string& cgroup,
+      const std::string& control);
+
+  // Returns the requested keys of a stat file, like cgroups::stat.
+  // Keys that are not found in the file are not included.
+  // @param   hierarchy   Path to the hierarchy root.
+  // @param   cgroup      Path to the cgroup relative to the hierarchy root.
+  // @param   file        The stat file to read from. (Ex: "memory.stat").
+  // @param   keys        The keys to return. (Ex: "total_rss").
+  // @return  The stat information parsed from the file.
+  //          Error if reading or parsing fails.
+  Try<hashmap<std::string, uint64_t>> stat(
+      const std::string& hierarchy,
+      const std::string& cgroup,
+      const std::string& file,
+      const std::set<std::string>& keys);
+
+  // Closes the control files of the cgroup, e.g., once the cgroup
+  // has been destroyed.
+  // @param   hierarchy   Path to the hierarchy root.
+  // @param   cgroup      Path to the cgroup relative to the hierarchy root.
+  void remove(const std::string& hierarchy, const std::string& cgroup);
+
+private:
+  // Reads the entire control file into 'buffer', returning the
+  // number of bytes read.
+  Try<size_t> read(
+      const std::string& hierarchy,
+      const std::string& cgroup,
+      const std::string& control);
+
+  // Open control files, keyed by the path of their cgroup and
+  // then by their name.
+  hashmap<std::string, hashmap<std::string, int>> fds;
+
+  // Reused across reads to avoid allocating.
+  std::vector<char> buffer;
+};
+
+
 // Cpu controls.
 namespace cpu {
 
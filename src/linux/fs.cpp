@@ -290,6 +290,28 @@ Try<FileSystemTable> FileSystemTable::read()
 }
 
 
+Try<bool> supported(const string& fsname)
+{
+  Try<string> lines = os::read("/proc/filesystems");
+  if (lines.isError()) {
+    return Error("Failed to read /proc/filesystems: " + lines.error());
+  }
+
+  // Each line lists a file system type, optionally preceded by
+  // 'nodev' if it doesn't require a block device, e.g.:
+  //   nodev   overlay
+  //           ext4
+  foreach (const string& line, strings::tokenize(lines.get(), "\n")) {
+    vector<string> tokens = strings::tokenize(line, " \t");
+    if (!tokens.empty() && tokens.back() == fsname) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
 Try<Nothing> mount(const Option<string>& source,
                    const string& target,
                    const Option<string>& type,
@@ -16,14 +16,22 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <linux/perf_event.h>
+
 #include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <limits>
 #include <list>
 #include <ostream>
 #include <tuple>
@@ -36,9 +44,16 @@
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
 
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
 #include <stout/strings.hpp>
 #include <stout/unreachable.hpp>
 
+#include <stout/os/close.hpp>
+#include <stout/os/read.hpp>
 #include <stout/os/signals.hpp>
 
 #include "common/status_utils.hpp"
@@ -58,6 +73,12 @@ using std::vector;
 
 namespace perf {
 
+// Requires Linux >= 3.14, older kernels will fail to open counters
+// and thus fall back to executing 'perf stat'.
+#ifndef PERF_FLAG_FD_CLOEXEC
+#define PERF_FLAG_FD_CLOEXEC (1UL << 3)
+#endif
+
 // Delimiter for fields in perf stat output.
 static const char PERF_DELIMITER[] = ",";
 
@@ -382,6 +403,388 @@ Future<hashmap<string, mesos::PerfStatistics>> sample(
 }
 
 
+// Returns the online CPUs, read from a list of ranges such as
+// '0-3,8-11'. Counting events for a cgroup requires a counter for
+// each CPU, just like 'perf stat --all-cpus --cgroup' opens.
+// TODO(bmahler): Handle CPUs being hotplugged after creation.
+static Try<vector<int>> online()
+{
+  Try<string> read = os::read("/sys/devices/system/cpu/online");
+  if (read.isError()) {
+    return Error("Failed to read online CPUs: " + read.error());
+  }
+
+  vector<int> cpus;
+
+  foreach (const string& range, strings::tokenize(read.get(), ",\n")) {
+    vector<string> bounds = strings::tokenize(range, "-");
+    if (bounds.empty() || bounds.size() > 2) {
+      return Error("Unexpected range of online CPUs '" + range + "'");
+    }
+
+    Try<int> first = numify<int>(bounds.front());
+    Try<int> last = numify<int>(bounds.back());
+    if (first.isError() || last.isError() || first.get() > last.get()) {
+      return Error("Unexpected range of online CPUs '" + range + "'");
+    }
+
+    for (int cpu = first.get(); cpu <= last.get(); cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  if (cpus.empty()) {
+    return Error("No online CPUs found");
+  }
+
+  return cpus;
+}
+
+
+Try<Owned<Counters>> Counters::create(
+    const set<string>& events,
+    const string& hierarchy)
+{
+  hashmap<string, Event> _events;
+
+  foreach (const string& event, events) {
+    const string name = internal::normalize(event);
+
+    Option<Event> _event = lookup(name);
+    if (_event.isNone()) {
+      return Error("Event '" + event + "' can not be counted natively");
+    }
+
+    _events[name] = _event.get();
+  }
+
+  Try<vector<int>> cpus = online();
+  if (cpus.isError()) {
+    return Error(cpus.error());
+  }
+
+  // Every counter uses a file descriptor, so only up to half of the
+  // file descriptors this process is allowed to open are used for
+  // counters that are kept open between samples, see 'stop'.
+  struct rlimit limit;
+  if (::getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+    return ErrnoError("Failed to get the file descriptor limit");
+  }
+
+  const size_t budget = limit.rlim_cur == RLIM_INFINITY
+    ? std::numeric_limits<size_t>::max()
+    : limit.rlim_cur / 2;
+
+  Owned<Counters> counters(
+      new Counters(_events, hierarchy, cpus.get(), budget));
+
+  // Make sure that all of the events can actually be counted (e.g.,
+  // the PMU supports them and we are permitted to count them) by
+  // opening counters for the root cgroup of the hierarchy.
+  Try<vector<Counter>> probe = counters->open("");
+  if (probe.isError()) {
+    return Error(probe.error());
+  }
+
+  foreach (const Counter& counter, probe.get()) {
+    os::close(counter.fd);
+  }
+
+  return counters;
+}
+
+
+Counters::~Counters()
+{
+  foreachvalue (const vector<Counter>& _counters, counters) {
+    foreach (const Counter& counter, _counters) {
+      os::close(counter.fd);
+    }
+  }
+}
+
+
+Try<Nothing> Counters::start(const set<string>& cgroups)
+{
+  foreach (const string& cgroup, counters.keys()) {
+    if (cgroups.count(cgroup) == 0) {
+      remove(cgroup);
+    }
+  }
+
+  foreach (const string& cgroup, cgroups) {
+    if (!counters.contains(cgroup)) {
+      Try<vector<Counter>> _counters = open(cgroup);
+      if (_counters.isError()) {
+        LOG(WARNING) << "Failed to open perf counters for cgroup '"
+                     << cgroup << "': " << _counters.error();
+        continue;
+      }
+
+      counters[cgroup] = _counters.get();
+    }
+  }
+
+  foreachvalue (vector<Counter>& _counters, counters) {
+    foreach (Counter& counter, _counters) {
+      Try<Count> count = read(counter.fd);
+      if (count.isError()) {
+        return Error("Failed to read perf counter: " + count.error());
+      }
+
+      counter.start = count.get();
+    }
+  }
+
+  started = Clock::now();
+
+  return Nothing();
+}
+
+
+Try<hashmap<string, mesos::PerfStatistics>> Counters::stop()
+{
+  if (started.isNone()) {
+    return Error("Sample has not been started");
+  }
+
+  const Time start = started.get();
+  const Duration duration = Clock::now() - start;
+
+  started = None();
+
+  hashmap<string, mesos::PerfStatistics> statistics;
+
+  foreachpair (const string& cgroup,
+               const vector<Counter>& _counters,
+               counters) {
+    // Sum the counts of each event across all of the CPUs.
+    hashmap<string, double> totals;
+
+    foreach (const Counter& counter, _counters) {
+      Try<Count> count = read(counter.fd);
+      if (count.isError()) {
+        return Error("Failed to read perf counter: " + count.error());
+      }
+
+      uint64_t value = count->value - counter.start.value;
+      uint64_t enabled = count->enabled - counter.start.enabled;
+      uint64_t running = count->running - counter.start.running;
+
+      // Scale the count if the counter was only running for part of
+      // the time it was enabled because the PMU was multiplexed. A
+      // counter that never ran counts as zero, like '<not counted>'.
+      totals[counter.event] += running == 0
+        ? 0
+        : (double) value * ((double) enabled / (double) running);
+    }
+
+    mesos::PerfStatistics& _statistics = statistics[cgroup];
+    _statistics.set_timestamp(start.secs());
+    _statistics.set_duration(duration.secs());
+
+    const google::protobuf::Reflection* reflection =
+      _statistics.GetReflection();
+
+    foreachpair (const string& event, double total, totals) {
+      const google::protobuf::FieldDescriptor* field =
+        _statistics.GetDescriptor()->FindFieldByName(event);
+
+      CHECK_NOTNULL(field);
+
+      switch (field->type()) {
+        case google::protobuf::FieldDescriptor::TYPE_DOUBLE:
+          // Clock events count nanoseconds but are reported in
+          // milliseconds, like 'perf stat' does.
+          reflection->SetDouble(&_statistics, field, total / 1000000.0);
+          break;
+        case google::protobuf::FieldDescriptor::TYPE_UINT64:
+          reflection->SetUInt64(&_statistics, field, (uint64_t) total);
+          break;
+        default:
+          return Error("Unsupported perf field type for event '" +
+                       event + "'");
+      }
+    }
+  }
+
+  // Keep the counters of as many cgroups open as the budget allows,
+  // the counters of the other cgroups get opened again when the next
+  // sample is started.
+  size_t open = 0;
+  foreach (const string& cgroup, counters.keys()) {
+    if (open + counters[cgroup].size() > budget) {
+      remove(cgroup);
+    } else {
+      open += counters[cgroup].size();
+    }
+  }
+
+  return statistics;
+}
+
+
+void Counters::remove(const string& cgroup)
+{
+  if (counters.contains(cgroup)) {
+    foreach (const Counter& counter, counters[cgroup]) {
+      os::close(counter.fd);
+    }
+
+    counters.erase(cgroup);
+  }
+}
+
+
+Option<Counters::Event> Counters::lookup(const string& event)
+{
+  // Events are named after their PerfStatistics field.
+  hashmap<string, Event> known = {
+    // Hardware events.
+    {"cycles", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES}},
+    {"stalled_cycles_frontend",
+     {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND}},
+    {"stalled_cycles_backend",
+     {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND}},
+    {"instructions", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS}},
+    {"cache_references",
+     {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES}},
+    {"cache_misses", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}},
+    {"branches", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS}},
+    {"branch_misses", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}},
+    {"bus_cycles", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES}},
+    {"ref_cycles", {PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES}},
+
+    // Software events.
+    {"cpu_clock", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK}},
+    {"task_clock", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}},
+    {"page_faults", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}},
+    {"minor_faults", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN}},
+    {"major_faults", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ}},
+    {"context_switches",
+     {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}},
+    {"cpu_migrations", {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS}},
+    {"alignment_faults",
+     {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_ALIGNMENT_FAULTS}},
+    {"emulation_faults",
+     {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_EMULATION_FAULTS}},
+  };
+
+  // Hardware cache events are named '<cache>_<operation>', e.g.,
+  // 'l1_dcache_load_misses'.
+  const hashmap<string, uint64_t> caches = {
+    {"l1_dcache", PERF_COUNT_HW_CACHE_L1D},
+    {"l1_icache", PERF_COUNT_HW_CACHE_L1I},
+    {"llc", PERF_COUNT_HW_CACHE_LL},
+    {"dtlb", PERF_COUNT_HW_CACHE_DTLB},
+    {"itlb", PERF_COUNT_HW_CACHE_ITLB},
+    {"branch", PERF_COUNT_HW_CACHE_BPU},
+    {"node", PERF_COUNT_HW_CACHE_NODE},
+  };
+
+  const hashmap<string, std::pair<uint64_t, uint64_t>> operations = {
+    {"loads",
+     {PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS}},
+    {"load_misses",
+     {PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS}},
+    {"stores",
+     {PERF_COUNT_HW_CACHE_OP_WRITE, PERF_COUNT_HW_CACHE_RESULT_ACCESS}},
+    {"store_misses",
+     {PERF_COUNT_HW_CACHE_OP_WRITE, PERF_COUNT_HW_CACHE_RESULT_MISS}},
+    {"prefetches",
+     {PERF_COUNT_HW_CACHE_OP_PREFETCH, PERF_COUNT_HW_CACHE_RESULT_ACCESS}},
+    {"prefetch_misses",
+     {PERF_COUNT_HW_CACHE_OP_PREFETCH, PERF_COUNT_HW_CACHE_RESULT_MISS}},
+  };
+
+  foreachpair (const string& cache, uint64_t id, caches) {
+    foreachpair (const string& operation,
+                 const std::pair<uint64_t, uint64_t>& op,
+                 operations) {
+      known[cache + "_" + operation] =
+        {PERF_TYPE_HW_CACHE, id | (op.first << 8) | (op.second << 16)};
+    }
+  }
+
+  return known.get(event);
+}
+
+
+Try<Counters::Count> Counters::read(int fd)
+{
+  // The value followed by the times enabled and running, as
+  // requested using 'read_format' when opening the counter.
+  uint64_t values[3];
+
+  ssize_t length;
+  while ((length = ::read(fd, values, sizeof(values))) == -1 &&
+         errno == EINTR);
+
+  if (length == -1) {
+    return ErrnoError();
+  } else if (length != sizeof(values)) {
+    return Error("Unexpected size " + stringify(length));
+  }
+
+  return Count({values[0], values[1], values[2]});
+}
+
+
+Try<vector<Counters::Counter>> Counters::open(const string& cgroup)
+{
+  const string directory = path::join(hierarchy, cgroup);
+
+  // The cgroup is specified to perf_event_open(2) using a file
+  // descriptor for its directory, which is only needed while opening.
+  int fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return ErrnoError("Failed to open '" + directory + "'");
+  }
+
+  vector<Counter> _counters;
+
+  foreachpair (const string& name, const Event& event, events) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    foreach (int cpu, cpus) {
+      int counter = ::syscall(
+          SYS_perf_event_open,
+          &attr,
+          fd,
+          cpu,
+          -1,
+          PERF_FLAG_PID_CGROUP | PERF_FLAG_FD_CLOEXEC);
+
+      if (counter == -1) {
+        Error error = ErrnoError(
+            "Failed to open perf counter for event '" + name +
+            "' on CPU " + stringify(cpu));
+
+        foreach (const Counter& _counter, _counters) {
+          os::close(_counter.fd);
+        }
+
+        os::close(fd);
+        return error;
+      }
+
+      _counters.push_back(Counter({name, counter, Count({0, 0, 0})}));
+    }
+  }
+
+  os::close(fd);
+
+  return _counters;
+}
+
+
 bool valid(const set<string>& events)
 {
   ostringstream command;
@@ -19,15 +19,22 @@
 #ifndef __PERF_HPP__
 #define __PERF_HPP__
 
+#include <stdint.h>
 #include <unistd.h>
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/future.hpp>
+#include <process/owned.hpp>
+#include <process/time.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
 
 // For PerfStatistics protobuf.
 #include "mesos/mesos.hpp"
@@ -53,6 +60,88 @@ bool valid(const std::set<std::string>& events);
 bool supported();
 
 
+// Counts perf events for cgroups natively using perf_event_open(2),
+// rather than executing 'perf stat' for every sample. A counter is
+// opened for each event on each online CPU when a cgroup is first
+// sampled and is kept open until the cgroup is removed, so taking a
+// sample only requires reading the counters.
+// NOTE: Every counter is a file descriptor, i.e., events x CPUs per
+// cgroup. At most half of the process' file descriptor limit is kept
+// open between samples, the counters of the cgroups beyond that are
+// opened for every sample and closed again once it stops.
+// NOTE: Counters are not thread safe and are expected to be used
+// from a single process (e.g., an isolator).
+class Counters
+{
+public:
+  // Returns an error if any of the events can't be counted natively
+  // or if perf_event_open(2) can't be used for cgroups in the
+  // specified perf_event hierarchy.
+  static Try<process::Owned<Counters>> create(
+      const std::set<std::string>& events,
+      const std::string& hierarchy);
+
+  ~Counters();
+
+  // Starts a sample for the cgroups (relative to the hierarchy).
+  // Counters are opened for cgroups not yet being counted and closed
+  // for cgroups no longer included. Cgroups whose counters can't be
+  // opened (e.g., because they were just destroyed) are skipped.
+  Try<Nothing> start(const std::set<std::string>& cgroups);
+
+  // Returns the counts for each cgroup since the sample was started,
+  // scaled (as 'perf stat' does) in case counters were multiplexed.
+  Try<hashmap<std::string, mesos::PerfStatistics>> stop();
+
+  // Closes the counters of the cgroup, e.g., before destroying it.
+  void remove(const std::string& cgroup);
+
+private:
+  struct Event
+  {
+    uint32_t type;
+    uint64_t config;
+  };
+
+  struct Count
+  {
+    uint64_t value;
+    uint64_t enabled;
+    uint64_t running;
+  };
+
+  struct Counter
+  {
+    std::string event;
+    int fd;
+    Count start;
+  };
+
+  Counters(
+      const hashmap<std::string, Event>& _events,
+      const std::string& _hierarchy,
+      const std::vector<int>& _cpus,
+      size_t _budget)
+    : events(_events), hierarchy(_hierarchy), cpus(_cpus), budget(_budget) {}
+
+  static Option<Event> lookup(const std::string& event);
+  static Try<Count> read(int fd);
+
+  Try<std::vector<Counter>> open(const std::string& cgroup);
+
+  // Events to count, keyed by their PerfStatistics field name.
+  const hashmap<std::string, Event> events;
+  const std::string hierarchy;
+  const std::vector<int> cpus;
+
+  // The maximum number of counters kept open between samples.
+  const size_t budget;
+
+  hashmap<std::string, std::vector<Counter>> counters;
+  Option<process::Time> started;
+};
+
+
 // Note: The parse function is exposed to allow testing of the
 // multiple supported perf stat output formats.
 Try<hashmap<std::string, mesos::PerfStatistics>> parse(
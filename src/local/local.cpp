@@ -198,7 +198,8 @@ PID<Master> launch(const Flags& flags, Allocator* _allocator)
           1,
           path::join(flags.work_dir.get(), "replicated_log"),
           set<UPID>(),
-          flags.log_auto_initialize);
+          flags.log_auto_initialize,
+          flags.log_group_commit_window);
       storage = new state::LogStorage(log);
     } else {
       EXIT(1) << "'" << flags.registry << "' is not a supported"
@@ -19,15 +19,19 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <deque>
 
 #include <mesos/type_utils.hpp>
 
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/none.hpp>
+#include <stout/nothing.hpp>
 
 #include "log/catchup.hpp"
 #include "log/consensus.hpp"
@@ -37,6 +41,7 @@
 
 using namespace process;
 
+using std::deque;
 using std::string;
 
 namespace mesos {
@@ -49,14 +54,21 @@ public:
   CoordinatorProcess(
       size_t _quorum,
       const Shared<Replica>& _replica,
-      const Shared<Network>& _network)
+      const Shared<Network>& _network,
+      size_t _window)
     : ProcessBase(ID::generate("log-coordinator")),
       quorum(_quorum),
       replica(_replica),
       network(_network),
+      window(_window),
       state(INITIAL),
       proposal(0),
-      index(0) {}
+      index(0),
+      started(0),
+      learning(Nothing())
+  {
+    CHECK_GT(window, 0u);
+  }
 
   virtual ~CoordinatorProcess() {}
 
@@ -70,7 +82,13 @@ protected:
   virtual void finalize()
   {
     electing.discard();
-    writing.discard();
+
+    foreach (const Owned<Write>& write, writes) {
+      if (write->future.isSome()) {
+        write->future.get().discard();
+      }
+      write->promise.discard();
+    }
   }
 
 private:
@@ -95,25 +113,32 @@ private:
   /////////////////////////////////
 
   Future<Option<uint64_t> > write(const Action& action);
+  void startWrites();
   Future<WriteResponse> runWritePhase(const Action& action);
   Future<Option<uint64_t> > checkWritePhase(
       const Action& action,
+      const Future<Nothing>& preceding,
       const WriteResponse& response);
   Future<Nothing> runLearnPhase(const Action& action);
   Future<bool> checkLearnPhase(const Action& action);
-  Future<Option<uint64_t> > updateIndexAfterWritten(bool missing);
-  void writingFinished();
-  void writingFailed();
-  void writingAborted();
+  Future<Option<uint64_t> > getWrittenPosition(
+      const Action& action,
+      bool missing);
+  void writingFinished(const Future<Option<uint64_t> >& future);
+  void writingDiscarded(uint64_t position);
+  void completeWrites();
 
   const size_t quorum;
   const Shared<Replica> replica;
   const Shared<Network> network;
 
+  // The maximum number of writes that are in progress at a time.
+  const size_t window;
+
   // The current state of the coordinator. A coordinator needs to be
   // elected first to perform append and truncate operations. If one
   // tries to do an append or a truncate while the coordinator is not
-  // elected, a failed future will be returned immediately. A
+  // elected, a none future will be returned immediately. A
   // coordinator does not declare itself as elected until it wins the
   // election and has filled all existing positions. A coordinator is
   // put in electing state after it decides to go for an election and
@@ -133,7 +158,37 @@ private:
   uint64_t index;
 
   Future<Option<uint64_t> > electing;
-  Future<Option<uint64_t> > writing;
+
+  // A write (append or truncate) that has been assigned a position.
+  struct Write
+  {
+    explicit Write(const Action& _action) : action(_action) {}
+
+    const Action action;
+
+    // The result of the write and learn phases, set once started.
+    Option<Future<Option<uint64_t> > > future;
+
+    // Completed in the order of the positions of the writes.
+    Promise<Option<uint64_t> > promise;
+  };
+
+  // The writes that have not been completed yet, ordered by their
+  // positions. The first 'started' of them are in progress (or have
+  // finished but wait for the preceding writes to finish).
+  deque<Owned<Write> > writes;
+  size_t started;
+
+  // Satisfied once the last started write is done (successfully or
+  // not). Writes only run their learn phases once the preceding
+  // writes are done, so that positions are learned in order.
+  Future<Nothing> learning;
+
+  // The result of the first write that was not successful, with which
+  // all the following writes get completed (the coordinator has been
+  // demoted by then, and those writes might or might not have been
+  // written, see MESOS-1038).
+  Option<Future<Option<uint64_t> > > aborted;
 };
 
 
@@ -150,6 +205,8 @@ Future<Option<uint64_t> > CoordinatorProcess::elect()
     return index - 1; // The last learned position!
   } else if (state == WRITING) {
     return Failure("Coordinator already elected, and is currently writing");
+  } else if (!writes.empty()) {
+    return Failure("Coordinator was demoted, and is still writing");
   }
 
   CHECK_EQ(state, INITIAL);
@@ -300,12 +357,10 @@ Future<Option<uint64_t> > CoordinatorProcess::append(const string& bytes)
 {
   if (state == INITIAL || state == ELECTING) {
     return None();
-  } else if (state == WRITING) {
-    return Failure("Coordinator is currently writing");
   }
 
   Action action;
-  action.set_position(index);
+  action.set_position(index++);
   action.set_promised(proposal);
   action.set_performed(proposal);
   action.set_type(Action::APPEND);
@@ -320,12 +375,10 @@ Future<Option<uint64_t> > CoordinatorProcess::truncate(uint64_t to)
 {
   if (state == INITIAL || state == ELECTING) {
     return None();
-  } else if (state == WRITING) {
-    return Failure("Coordinator is currently writing");
   }
 
   Action action;
-  action.set_position(index);
+  action.set_position(index++);
   action.set_promised(proposal);
   action.set_performed(proposal);
   action.set_type(Action::TRUNCATE);
@@ -338,45 +391,98 @@ Future<Option<uint64_t> > CoordinatorProcess::truncate(uint64_t to)
 
 Future<Option<uint64_t> > CoordinatorProcess::write(const Action& action)
 {
-  LOG(INFO) << "Coordinator attempting to write " << action.type()
-            << " action at position " << action.position();
-
-  CHECK_EQ(state, ELECTED);
+  CHECK(state == ELECTED || state == WRITING);
   CHECK(action.has_performed() && action.has_type());
 
   state = WRITING;
 
-  writing = runWritePhase(action)
-    .then(defer(self(), &Self::checkWritePhase, action, lambda::_1))
-    .onReady(defer(self(), &Self::writingFinished))
-    .onFailed(defer(self(), &Self::writingFailed))
-    .onDiscarded(defer(self(), &Self::writingAborted));
+  Owned<Write> write(new Write(action));
+  writes.push_back(write);
+
+  write->promise.future()
+    .onDiscard(defer(self(), &Self::writingDiscarded, action.position()));
+
+  startWrites();
 
-  return writing;
+  return write->promise.future();
+}
+
+
+void CoordinatorProcess::startWrites()
+{
+  // Writes are pipelined, i.e., up to 'window' of them run their
+  // write and learn phases concurrently. They are started in order
+  // and only as long as the coordinator has not been demoted.
+  while (state == WRITING && started < writes.size() && started < window) {
+    Owned<Write> write = writes[started++];
+
+    LOG(INFO) << "Coordinator attempting to write " << write->action.type()
+              << " action at position " << write->action.position();
+
+    // The write phases run concurrently, but the learn phases run in
+    // the order of the positions. Otherwise a replica could learn a
+    // position before a preceding one, and a Log::Reader reading up
+    // to the former from that replica would fail because the range
+    // includes a pending entry.
+    Future<Nothing> preceding = learning;
+
+    Owned<Promise<Nothing> > done(new Promise<Nothing>());
+    learning = done->future();
+
+    write->future = runWritePhase(write->action)
+      .then(defer(self(),
+                  &Self::checkWritePhase,
+                  write->action,
+                  preceding,
+                  lambda::_1))
+      .onAny([done]() { done->set(Nothing()); })
+      .onAny(defer(self(), &Self::writingFinished, lambda::_1));
+
+    if (write->promise.future().hasDiscard()) {
+      write->future.get().discard();
+    }
+  }
 }
 
 
 Future<WriteResponse> CoordinatorProcess::runWritePhase(const Action& action)
 {
-  return log::write(quorum, network, proposal, action);
+  // NOTE: We use the proposal number of the action rather than the
+  // current one since the latter might have been updated by a NACK
+  // for a preceding write that is still in progress.
+  return log::write(quorum, network, action.performed(), action);
 }
 
 
 Future<Option<uint64_t> > CoordinatorProcess::checkWritePhase(
     const Action& action,
+    const Future<Nothing>& preceding,
     const WriteResponse& response)
 {
   if (!response.okay()) {
-    // Received a NACK. Save the proposal number.
-    CHECK_LE(proposal, response.proposal());
-    proposal = response.proposal();
+    // Received a NACK. Demote the coordinator right away so that no
+    // more writes get started (or accepted) until it gets elected
+    // again, unless that already happened due to a NACK for another
+    // write (which might also have updated the proposal number).
+    CHECK_LE(action.performed(), response.proposal());
+
+    if (action.performed() == proposal) {
+      state = INITIAL;
+    }
+
+    // Save the proposal number.
+    proposal = std::max(proposal, response.proposal());
 
     return None();
   }
 
-  return runLearnPhase(action)
+  // NOTE: 'preceding' is always satisfied eventually (see
+  // 'startWrites'), even if a preceding write was not successful,
+  // in which case this write will not be used anyway.
+  return preceding
+    .then(defer(self(), &Self::runLearnPhase, action))
     .then(defer(self(), &Self::checkLearnPhase, action))
-    .then(defer(self(), &Self::updateIndexAfterWritten, lambda::_1));
+    .then(defer(self(), &Self::getWrittenPosition, action, lambda::_1));
 }
 
 
@@ -395,39 +501,99 @@ Future<bool> CoordinatorProcess::checkLearnPhase(const Action& action)
 }
 
 
-Future<Option<uint64_t> > CoordinatorProcess::updateIndexAfterWritten(
+Future<Option<uint64_t> > CoordinatorProcess::getWrittenPosition(
+    const Action& action,
     bool missing)
 {
   CHECK(!missing) << "Not expecting local replica to be missing position "
-                  << index << " after the writing is done";
+                  << action.position() << " after the writing is done";
 
-  return index++;
+  return action.position();
 }
 
 
-void CoordinatorProcess::writingFinished()
+void CoordinatorProcess::writingFinished(
+    const Future<Option<uint64_t> >& future)
 {
-  CHECK_EQ(state, WRITING);
-  state = ELECTED;
+  // Ignore the writes that were already completed because a
+  // preceding write was not successful.
+  bool found = false;
+  foreach (const Owned<Write>& write, writes) {
+    if (write->future.isSome() && write->future.get() == future) {
+      found = true;
+      break;
+    }
+  }
+
+  if (!found) {
+    return;
+  }
+
+  if (!future.isReady() || future.get().isNone()) {
+    // Demote the coordinator if a write operation fails or is
+    // discarded. In the latter case we don't actually know the write
+    // was successful or not and we really need to "catch-up" that
+    // position before we try and do another write (see MESOS-1038
+    // for more details).
+    state = INITIAL;
+  }
+
+  completeWrites();
 }
 
 
-void CoordinatorProcess::writingFailed()
+void CoordinatorProcess::writingDiscarded(uint64_t position)
 {
-  CHECK_EQ(state, WRITING);
-  state = INITIAL;
+  foreach (const Owned<Write>& write, writes) {
+    if (write->action.position() == position) {
+      // Writes that have not been started yet get discarded once
+      // they are started, see 'startWrites'.
+      if (write->future.isSome()) {
+        write->future.get().discard();
+      }
+      break;
+    }
+  }
 }
 
 
-void CoordinatorProcess::writingAborted()
+void CoordinatorProcess::completeWrites()
 {
-  CHECK_EQ(state, WRITING);
+  while (!writes.empty()) {
+    Owned<Write> write = writes.front();
+
+    if (aborted.isSome()) {
+      if (write->future.isSome()) {
+        write->future.get().discard();
+      }
+      write->promise.associate(aborted.get());
+    } else if (write->future.isNone() || write->future.get().isPending()) {
+      break;
+    } else {
+      const Future<Option<uint64_t> >& future = write->future.get();
+      if (!future.isReady() || future.get().isNone()) {
+        aborted = future;
+      }
+      write->promise.associate(future);
+    }
+
+    if (write->future.isSome()) {
+      started--;
+    }
+
+    writes.pop_front();
+  }
 
-  // Demote the coordinator if a write operation is discarded since we
-  // don't actually know the write was successful or not and we really
-  // need to "catch-up" that position before we try and do another
-  // write (see MESOS-1038 for more details).
-  state = INITIAL;
+  if (!writes.empty()) {
+    startWrites();
+    return;
+  }
+
+  aborted = None();
+
+  if (state == WRITING) {
+    state = ELECTED;
+  }
 }
 
 
@@ -439,9 +605,10 @@ void CoordinatorProcess::writingAborted()
 Coordinator::Coordinator(
     size_t quorum,
     const Shared<Replica>& replica,
-    const Shared<Network>& network)
+    const Shared<Network>& network,
+    size_t window)
 {
-  process = new CoordinatorProcess(quorum, replica, network);
+  process = new CoordinatorProcess(quorum, replica, network, window);
   spawn(process);
 }
 
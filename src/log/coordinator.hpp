@@ -42,10 +42,17 @@ class CoordinatorProcess;
 class Coordinator
 {
 public:
+  // Writes (appends and truncates) are pipelined: up to '_window' of
+  // them are in progress at a time (and more get queued), and they
+  // complete in the order of their positions. If a write does not
+  // succeed, the coordinator gets demoted and all of the following
+  // writes complete the same way as that write (whether or not they
+  // were written).
   Coordinator(
       size_t _quorum,
       const process::Shared<Replica>& _replica,
-      const process::Shared<Network>& _network);
+      const process::Shared<Network>& _network,
+      size_t _window = 1);
 
   ~Coordinator();
 
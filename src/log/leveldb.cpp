@@ -25,8 +25,11 @@
 
 #include <stdint.h>
 
+#include <list>
+
 #include <stout/check.hpp>
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
 #include <stout/numify.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
@@ -34,6 +37,7 @@
 
 #include "log/leveldb.hpp"
 
+using std::list;
 using std::string;
 
 namespace mesos {
@@ -311,24 +315,40 @@ Try<Nothing> LevelDBStorage::persist(const Metadata& metadata)
 
 
 Try<Nothing> LevelDBStorage::persist(const Action& action)
+{
+  return persist(list<Action>(1, action));
+}
+
+
+Try<Nothing> LevelDBStorage::persist(const list<Action>& actions)
 {
   Stopwatch stopwatch;
   stopwatch.start();
 
-  Record record;
-  record.set_type(Record::ACTION);
-  record.mutable_action()->MergeFrom(action);
+  // All of the actions get written using a single batch, and thus
+  // with a single sync.
+  leveldb::WriteBatch batch;
+  size_t size = 0;
 
-  string value;
+  foreach (const Action& action, actions) {
+    Record record;
+    record.set_type(Record::ACTION);
+    record.mutable_action()->MergeFrom(action);
 
-  if (!record.SerializeToString(&value)) {
-    return Error("Failed to serialize record");
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Error("Failed to serialize record");
+    }
+
+    batch.Put(encode(action.position()), value);
+    size += value.size();
   }
 
   leveldb::WriteOptions options;
   options.sync = true;
 
-  leveldb::Status status = db->Put(options, encode(action.position()), value);
+  leveldb::Status status = db->Write(options, &batch);
 
   if (!status.ok()) {
     return Error(status.ToString());
@@ -338,69 +358,21 @@ Try<Nothing> LevelDBStorage::persist(const Action& action)
   // of checking 'isNone()' because it's likely that log entries are
   // written out of order during catch-up (e.g. if a random bulk
   // catch-up policy is used).
-  first = min(first, action.position());
+  foreach (const Action& action, actions) {
+    first = min(first, action.position());
+  }
 
-  LOG(INFO) << "Persisting action (" << value.size()
+  LOG(INFO) << "Persisting " << actions.size() << " action(s) (" << size
             << " bytes) to leveldb took " << stopwatch.elapsed();
 
   // Delete positions if a truncate action has been *learned*. Note
   // that we do this in a best-effort fashion (i.e., we ignore any
   // failures to the database since we can always try again).
-  if (action.has_type() && action.type() == Action::TRUNCATE &&
-      action.has_learned() && action.learned()) {
-    CHECK(action.has_truncate());
-
-    stopwatch.start(); // Restart the stopwatch.
-
-    // To actually perform the truncation in leveldb we need to remove
-    // all the keys that represent positions no longer in the log. We
-    // do this by attempting to delete all keys that represent the
-    // first position we know is still in leveldb up to (but
-    // excluding) the truncate position. Note that this works because
-    // the semantics of WriteBatch are such that even if the position
-    // doesn't exist (which is possible because this replica has some
-    // holes), we can attempt to delete the key that represents it and
-    // it will just ignore that key. This is *much* cheaper than
-    // actually iterating through the entire database instead (which
-    // was, for posterity, the original implementation). In addition,
-    // caching the "first" position we know is in the database is
-    // cheaper than using an iterator to determine the first position
-    // (which was, for posterity, the second implementation).
-
-    leveldb::WriteBatch batch;
-
-    CHECK_SOME(first);
-
-    // Add positions up to (but excluding) the truncate position to
-    // the batch starting at the first position still in leveldb. It's
-    // likely that the first position is greater than the truncate
-    // position (e.g., during catch-up). In that case, we do nothing
-    // because there is nothing we can truncate.
-    // TODO(jieyu): We might miss a truncation if we do random (i.e.,
-    // out of order) bulk catch-up and the truncate operation is
-    // caught up first.
-    uint64_t index = 0;
-    while ((first.get() + index) < action.truncate().to()) {
-      batch.Delete(encode(first.get() + index));
-      index++;
-    }
-
-    // If we added any positions, attempt to delete them!
-    if (index > 0) {
-      // We do this write asynchronously (e.g., using default options).
-      leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
-
-      if (!status.ok()) {
-        LOG(WARNING) << "Ignoring leveldb batch delete failure: "
-                     << status.ToString();
-      } else {
-        // Save the new first position!
-        CHECK_LT(first.get(), action.truncate().to());
-        first = action.truncate().to();
-
-        LOG(INFO) << "Deleting ~" << index
-                  << " keys from leveldb took " << stopwatch.elapsed();
-      }
+  foreach (const Action& action, actions) {
+    if (action.has_type() && action.type() == Action::TRUNCATE &&
+        action.has_learned() && action.learned()) {
+      CHECK(action.has_truncate());
+      truncate(action.truncate().to());
     }
   }
 
@@ -408,6 +380,64 @@ Try<Nothing> LevelDBStorage::persist(const Action& action)
 }
 
 
+void LevelDBStorage::truncate(uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // To actually perform the truncation in leveldb we need to remove
+  // all the keys that represent positions no longer in the log. We
+  // do this by attempting to delete all keys that represent the
+  // first position we know is still in leveldb up to (but
+  // excluding) the truncate position. Note that this works because
+  // the semantics of WriteBatch are such that even if the position
+  // doesn't exist (which is possible because this replica has some
+  // holes), we can attempt to delete the key that represents it and
+  // it will just ignore that key. This is *much* cheaper than
+  // actually iterating through the entire database instead (which
+  // was, for posterity, the original implementation). In addition,
+  // caching the "first" position we know is in the database is
+  // cheaper than using an iterator to determine the first position
+  // (which was, for posterity, the second implementation).
+
+  leveldb::WriteBatch batch;
+
+  CHECK_SOME(first);
+
+  // Add positions up to (but excluding) the truncate position to
+  // the batch starting at the first position still in leveldb. It's
+  // likely that the first position is greater than the truncate
+  // position (e.g., during catch-up). In that case, we do nothing
+  // because there is nothing we can truncate.
+  // TODO(jieyu): We might miss a truncation if we do random (i.e.,
+  // out of order) bulk catch-up and the truncate operation is
+  // caught up first.
+  uint64_t index = 0;
+  while ((first.get() + index) < to) {
+    batch.Delete(encode(first.get() + index));
+    index++;
+  }
+
+  // If we added any positions, attempt to delete them!
+  if (index > 0) {
+    // We do this write asynchronously (e.g., using default options).
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+
+    if (!status.ok()) {
+      LOG(WARNING) << "Ignoring leveldb batch delete failure: "
+                   << status.ToString();
+    } else {
+      // Save the new first position!
+      CHECK_LT(first.get(), to);
+      first = to;
+
+      LOG(INFO) << "Deleting ~" << index
+                << " keys from leveldb took " << stopwatch.elapsed();
+    }
+  }
+}
+
+
 Try<Action> LevelDBStorage::read(uint64_t position)
 {
   Stopwatch stopwatch;
@@ -41,9 +41,14 @@ public:
   virtual Try<State> restore(const std::string& path);
   virtual Try<Nothing> persist(const Metadata& metadata);
   virtual Try<Nothing> persist(const Action& action);
+  virtual Try<Nothing> persist(const std::list<Action>& actions);
   virtual Try<Action> read(uint64_t position);
 
 private:
+  // Deletes the positions preceding the given position (in a
+  // best-effort fashion), used once a truncate action is learned.
+  void truncate(uint64_t to);
+
   leveldb::DB* db;
 
   // First position still in leveldb, used during truncation.
@@ -56,7 +56,8 @@ public:
       size_t _quorum,
       const string& path,
       const set<UPID>& pids,
-      bool _autoInitialize);
+      bool _autoInitialize,
+      const Option<Duration>& groupCommitWindow);
 
   LogProcess(
       size_t _quorum,
@@ -65,7 +66,8 @@ public:
       const Duration& timeout,
       const string& znode,
       const Option<zookeeper::Authentication>& auth,
-      bool _autoInitialize);
+      bool _autoInitialize,
+      const Option<Duration>& groupCommitWindow);
 
   // Recovers the log by catching up if needed. Returns a shared
   // pointer to the local replica if the recovery succeeds.
@@ -154,7 +156,7 @@ private:
 class LogWriterProcess : public Process<LogWriterProcess>
 {
 public:
-  explicit LogWriterProcess(Log* log);
+  LogWriterProcess(Log* log, size_t window);
 
   Future<Option<Log::Position> > start();
   Future<Option<Log::Position> > append(const string& bytes);
@@ -183,6 +185,7 @@ private:
 
   const size_t quorum;
   const Shared<Network> network;
+  const size_t window;
 
   Future<Shared<Replica> > recovering;
   list<process::Promise<Nothing>*> promises;
@@ -201,10 +204,11 @@ LogProcess::LogProcess(
     size_t _quorum,
     const string& path,
     const set<UPID>& pids,
-    bool _autoInitialize)
+    bool _autoInitialize,
+    const Option<Duration>& groupCommitWindow)
   : ProcessBase(ID::generate("log")),
     quorum(_quorum),
-    replica(new Replica(path)),
+    replica(new Replica(path, groupCommitWindow)),
     network(new Network(pids + (UPID) replica->pid())),
     autoInitialize(_autoInitialize),
     group(NULL) {}
@@ -217,10 +221,11 @@ LogProcess::LogProcess(
     const Duration& timeout,
     const string& znode,
     const Option<zookeeper::Authentication>& auth,
-    bool _autoInitialize)
+    bool _autoInitialize,
+    const Option<Duration>& groupCommitWindow)
   : ProcessBase(ID::generate("log")),
     quorum(_quorum),
-    replica(new Replica(path)),
+    replica(new Replica(path, groupCommitWindow)),
     network(new ZooKeeperNetwork(
         servers,
         timeout,
@@ -567,10 +572,11 @@ Log::Position LogReaderProcess::position(uint64_t value)
 /////////////////////////////////////////////////
 
 
-LogWriterProcess::LogWriterProcess(Log* log)
+LogWriterProcess::LogWriterProcess(Log* log, size_t _window)
   : ProcessBase(ID::generate("log-writer")),
     quorum(log->process->quorum),
     network(log->process->network),
+    window(_window),
     recovering(dispatch(log->process, &LogProcess::recover)),
     coordinator(NULL),
     error(None()) {}
@@ -656,7 +662,7 @@ Future<Option<Log::Position> > LogWriterProcess::_start()
 
   CHECK_READY(recovering);
 
-  coordinator = new Coordinator(quorum, recovering.get(), network);
+  coordinator = new Coordinator(quorum, recovering.get(), network, window);
 
   LOG(INFO) << "Attempting to start the writer";
 
@@ -743,7 +749,8 @@ Log::Log(
     int quorum,
     const string& path,
     const set<UPID>& pids,
-    bool autoInitialize)
+    bool autoInitialize,
+    const Option<Duration>& groupCommitWindow)
 {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
 
@@ -752,7 +759,8 @@ Log::Log(
         quorum,
         path,
         pids,
-        autoInitialize);
+        autoInitialize,
+        groupCommitWindow);
 
   spawn(process);
 }
@@ -764,7 +772,8 @@ Log::Log(
     const Duration& timeout,
     const string& znode,
     const Option<zookeeper::Authentication>& auth,
-    bool autoInitialize)
+    bool autoInitialize,
+    const Option<Duration>& groupCommitWindow)
 {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
 
@@ -776,7 +785,8 @@ Log::Log(
         timeout,
         znode,
         auth,
-        autoInitialize);
+        autoInitialize,
+        groupCommitWindow);
 
   spawn(process);
 }
@@ -835,9 +845,9 @@ Future<Log::Position> Log::Reader::ending()
 /////////////////////////////////////////////////
 
 
-Log::Writer::Writer(Log* log)
+Log::Writer::Writer(Log* log, size_t window)
 {
-  process = new LogWriterProcess(log);
+  process = new LogWriterProcess(log, window);
   spawn(process);
 }
 
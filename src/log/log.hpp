@@ -158,7 +158,16 @@ public:
     // time. A writer becomes invalid if either Writer::append or
     // Writer::truncate return None, in which case, the writer (or
     // another writer) must be restarted.
-    explicit Writer(Log* log);
+    //
+    // Up to 'window' appends and truncates are in progress at a time
+    // (more get queued), which complete in order. If one of them
+    // returns none (or fails), so do all of the following ones. The
+    // positions are also learned in order, so a Log::Reader can read
+    // up to the position returned by any completed append or
+    // truncate. Note however that (as with a window of 1) the ending
+    // position of the local replica may include positions that are
+    // still being written, which cannot be read yet.
+    explicit Writer(Log* log, size_t window = 1);
     ~Writer();
 
     // Attempts to get a promise (from the log's replicas) for
@@ -186,11 +195,14 @@ public:
 
   // Creates a new replicated log that assumes the specified quorum
   // size, is backed by a file at the specified path, and coordinates
-  // with other replicas via the set of process PIDs.
+  // with other replicas via the set of process PIDs. If a group
+  // commit window is specified, the local replica persists all of the
+  // actions written within that window at once (see Replica).
   Log(int quorum,
       const std::string& path,
       const std::set<process::UPID>& pids,
-      bool autoInitialize = false);
+      bool autoInitialize = false,
+      const Option<Duration>& groupCommitWindow = None());
 
   // Creates a new replicated log that assumes the specified quorum
   // size, is backed by a file at the specified path, and coordinates
@@ -202,7 +214,8 @@ public:
       const Duration& timeout,
       const std::string& znode,
       const Option<zookeeper::Authentication>& auth = None(),
-      bool autoInitialize = false);
+      bool autoInitialize = false,
+      const Option<Duration>& groupCommitWindow = None());
 
   ~Log();
 
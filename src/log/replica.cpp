@@ -19,11 +19,15 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <map>
 
 #include <mesos/type_utils.hpp>
 
+#include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
+#include <process/owned.hpp>
 
 #include <stout/check.hpp>
 #include <stout/error.hpp>
@@ -41,6 +45,7 @@
 using namespace process;
 
 using std::list;
+using std::map;
 using std::string;
 
 namespace mesos {
@@ -62,7 +67,10 @@ class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 public:
   // Constructs a new replica process using specified path to a
   // directory for storing the underlying log.
-  explicit ReplicaProcess(const string& path);
+  ReplicaProcess(
+      const string& path,
+      const Option<Duration>& window,
+      Storage* storage);
 
   virtual ~ReplicaProcess();
 
@@ -102,6 +110,9 @@ public:
   // the disk. Returns true on success and false otherwise.
   bool update(const Metadata::Status& status);
 
+protected:
+  virtual void finalize();
+
 private:
   // Handles a request from a proposer to promise not to accept writes
   // from any other proposer with lower proposal number.
@@ -118,8 +129,23 @@ private:
 
   // Helper routines that write a record corresponding to the
   // specified argument. Returns true on success and false otherwise.
+  // NOTE: When group committing the record only gets written (and
+  // becomes durable) once the group is committed, see 'commit'.
   bool persist(const Action& action);
 
+  // Sends the response to a request, but only once the actions that
+  // have been persisted so far are durable (i.e., once the current
+  // group is committed). This also keeps the responses in order.
+  void respond(const UPID& to, const google::protobuf::Message& response);
+
+  // Helpers for group committing, which write all of the pending
+  // actions at once and then send the pending responses. Returns
+  // true on success and false otherwise, in which case the responses
+  // are dropped (see 'commit').
+  void schedule();
+  void _commit();
+  bool commit();
+
   // Helper routines that update metadata corresponding to the
   // specified argument. The update will be persisted on the disk.
   // Returns true on success and false otherwise.
@@ -146,16 +172,47 @@ private:
 
   // Unlearned positions in the log.
   IntervalSet<uint64_t> unlearned;
+
+  // The group commit window, if group committing.
+  const Option<Duration> window;
+
+  // The actions that are not yet committed (i.e., written to the
+  // underlying storage), and the responses to send once they are.
+  struct Reply
+  {
+    UPID to;
+    string name;
+    string data;
+  };
+
+  map<uint64_t, Action> pending;
+  list<Reply> replies;
+
+  // Completed once the pending actions have been committed, which
+  // reads of pending positions wait for.
+  Owned<process::Promise<Nothing> > committed;
+
+  // Whether a commit has been scheduled.
+  bool committing;
 };
 
 
-ReplicaProcess::ReplicaProcess(const string& path)
+ReplicaProcess::ReplicaProcess(
+    const string& path,
+    const Option<Duration>& _window,
+    Storage* _storage)
   : ProcessBase(ID::generate("log-replica")),
+    storage(_storage),
     begin(0),
-    end(0)
+    end(0),
+    window(_window),
+    committed(new process::Promise<Nothing>()),
+    committing(false)
 {
   // TODO(benh): Factor out and expose storage.
-  storage = new LevelDBStorage();
+  if (storage == NULL) {
+    storage = new LevelDBStorage();
+  }
 
   restore(path);
 
@@ -181,6 +238,13 @@ ReplicaProcess::~ReplicaProcess()
 }
 
 
+void ReplicaProcess::finalize()
+{
+  // Commit any pending actions before terminating.
+  commit();
+}
+
+
 Result<Action> ReplicaProcess::read(uint64_t position)
 {
   if (position < begin) {
@@ -189,6 +253,8 @@ Result<Action> ReplicaProcess::read(uint64_t position)
     return None(); // These semantics are assumed above!
   } else if (holes.contains(position)) {
     return None();
+  } else if (pending.count(position) > 0) {
+    return pending[position]; // Not yet committed.
   }
 
   // Must exist in storage ...
@@ -222,6 +288,16 @@ Future<list<Action> > ReplicaProcess::read(uint64_t from, uint64_t to)
     return promise.future();
   }
 
+  // Only serve the actions once they are durable, see 'commit'.
+  map<uint64_t, Action>::const_iterator next = pending.lower_bound(from);
+  if (next != pending.end() && next->first <= to) {
+    VLOG(2) << "Delaying read from '" << stringify(from) << "' to '"
+            << stringify(to) << "' until pending actions are committed";
+
+    return committed->future()
+      .then(defer(self(), [=](const Nothing&) { return read(from, to); }));
+  }
+
   VLOG(2) << "Starting read from '" << stringify(from) << "' to '"
           << stringify(to) << "'";
 
@@ -309,6 +385,12 @@ uint64_t ReplicaProcess::promised()
 
 bool ReplicaProcess::update(const Metadata::Status& status)
 {
+  // Make sure the pending actions are durable before the metadata,
+  // which must not claim anything the actions do not back up.
+  if (!commit()) {
+    return false;
+  }
+
   Metadata metadata_;
   metadata_.set_status(status);
   metadata_.set_promised(promised());
@@ -331,6 +413,12 @@ bool ReplicaProcess::update(const Metadata::Status& status)
 
 bool ReplicaProcess::update(uint64_t promised)
 {
+  // Make sure the pending actions are durable before the metadata,
+  // which must not claim anything the actions do not back up.
+  if (!commit()) {
+    return false;
+  }
+
   Metadata metadata_;
   metadata_.set_status(status());
   metadata_.set_promised(promised);
@@ -405,7 +493,7 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
       response.set_okay(true);
       response.set_proposal(request.proposal());
       response.mutable_action()->MergeFrom(action);
-      reply(response);
+      respond(from, response);
       return;
     }
 
@@ -437,7 +525,7 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
         PromiseResponse response;
         response.set_okay(false);
         response.set_proposal(promised());
-        reply(response);
+        respond(from, response);
       } else {
         Action action;
         action.set_position(request.position());
@@ -448,7 +536,7 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
           response.set_okay(true);
           response.set_proposal(request.proposal());
           response.set_position(request.position());
-          reply(response);
+          respond(from, response);
         }
       }
     } else {
@@ -460,7 +548,7 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
         PromiseResponse response;
         response.set_okay(false);
         response.set_proposal(action.promised());
-        reply(response);
+        respond(from, response);
       } else {
         Action original = action;
         action.set_promised(request.proposal());
@@ -470,7 +558,7 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
           response.set_okay(true);
           response.set_proposal(request.proposal());
           response.mutable_action()->MergeFrom(original);
-          reply(response);
+          respond(from, response);
         }
       }
     }
@@ -485,7 +573,7 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
       PromiseResponse response;
       response.set_okay(false);
       response.set_proposal(promised());
-      reply(response);
+      respond(from, response);
     } else {
       if (update(request.proposal())) {
         // Return the last position written.
@@ -493,7 +581,7 @@ void ReplicaProcess::promise(const UPID& from, const PromiseRequest& request)
         response.set_okay(true);
         response.set_proposal(request.proposal());
         response.set_position(end);
-        reply(response);
+        respond(from, response);
       }
     }
   }
@@ -523,7 +611,7 @@ void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
       response.set_okay(false);
       response.set_proposal(promised());
       response.set_position(request.position());
-      reply(response);
+      respond(from, response);
     } else {
       Action action;
       action.set_position(request.position());
@@ -554,7 +642,7 @@ void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
         response.set_okay(true);
         response.set_proposal(request.proposal());
         response.set_position(request.position());
-        reply(response);
+        respond(from, response);
       }
     }
   } else if (result.isSome()) {
@@ -566,7 +654,7 @@ void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
       response.set_okay(false);
       response.set_proposal(action.promised());
       response.set_position(request.position());
-      reply(response);
+      respond(from, response);
     } else {
       if (action.has_learned() && action.learned()) {
         // We ignore the write request if this position has already
@@ -629,7 +717,7 @@ void ReplicaProcess::write(const UPID& from, const WriteRequest& request)
           response.set_okay(true);
           response.set_proposal(request.proposal());
           response.set_position(request.position());
-          reply(response);
+          respond(from, response);
         }
       }
     }
@@ -651,7 +739,8 @@ void ReplicaProcess::recover(const UPID& from, const RecoverRequest& request)
     response.set_end(end);
   }
 
-  reply(response);
+  // Only claim the positions once the actions are durable.
+  respond(from, response);
 }
 
 
@@ -671,14 +760,21 @@ void ReplicaProcess::learned(const UPID& from, const Action& action)
 
 bool ReplicaProcess::persist(const Action& action)
 {
-  Try<Nothing> persisted = storage->persist(action);
+  if (window.isSome()) {
+    pending[action.position()] = action;
+    schedule();
 
-  if (persisted.isError()) {
-    LOG(ERROR) << "Error writing to log: " << persisted.error();
-    return false;
-  }
+    VLOG(2) << "Pending action at " << action.position();
+  } else {
+    Try<Nothing> persisted = storage->persist(action);
+
+    if (persisted.isError()) {
+      LOG(ERROR) << "Error writing to log: " << persisted.error();
+      return false;
+    }
 
-  LOG(INFO) << "Persisted action at " << action.position();
+    LOG(INFO) << "Persisted action at " << action.position();
+  }
 
   // No longer a hole here (if there even was one).
   holes -= action.position();
@@ -719,6 +815,100 @@ bool ReplicaProcess::persist(const Action& action)
 }
 
 
+void ReplicaProcess::respond(
+    const UPID& to,
+    const google::protobuf::Message& response)
+{
+  if (pending.empty() && replies.empty()) {
+    send(to, response);
+    return;
+  }
+
+  Reply reply;
+  reply.to = to;
+  reply.name = response.GetTypeName();
+  response.SerializeToString(&reply.data);
+  replies.push_back(reply);
+
+  schedule();
+}
+
+
+void ReplicaProcess::schedule()
+{
+  CHECK_SOME(window);
+
+  if (committing) {
+    return;
+  }
+
+  committing = true;
+
+  // With a zero window this commits once the messages that are
+  // already queued for this process have been handled.
+  if (window.get() == Duration::zero()) {
+    dispatch(self(), &Self::_commit);
+  } else {
+    delay(window.get(), self(), &Self::_commit);
+  }
+}
+
+
+void ReplicaProcess::_commit()
+{
+  commit();
+}
+
+
+bool ReplicaProcess::commit()
+{
+  committing = false;
+
+  if (!pending.empty()) {
+    list<Action> actions;
+    foreachvalue (const Action& action, pending) {
+      actions.push_back(action);
+    }
+
+    Try<Nothing> persisted = storage->persist(actions);
+
+    if (persisted.isError()) {
+      // We keep the pending actions so that the next commit retries
+      // writing them, but drop the responses, which is equivalent to
+      // pretending like the requests never made it here (see the
+      // comment above ReplicaProcess::promise).
+      LOG(ERROR) << "Error writing to log: " << persisted.error()
+                 << "; dropping " << replies.size() << " responses";
+
+      replies.clear();
+
+      committed->fail("Failed to commit: " + persisted.error());
+      committed.reset(new process::Promise<Nothing>());
+      return false;
+    }
+
+    LOG(INFO) << "Committed " << actions.size() << " actions";
+
+    pending.clear();
+
+    committed->set(Nothing());
+    committed.reset(new process::Promise<Nothing>());
+  }
+
+  foreach (const Reply& reply, replies) {
+    ProcessBase::send(
+        reply.to,
+        reply.name,
+        reply.data.data(),
+        reply.data.size());
+  }
+
+  replies.clear();
+
+  return true;
+}
+
+
 void ReplicaProcess::restore(const string& path)
 {
   Try<Storage::State> state = storage->restore(path);
@@ -750,9 +940,12 @@ void ReplicaProcess::restore(const string& path)
 }
 
 
-Replica::Replica(const string& path)
+Replica::Replica(
+    const string& path,
+    const Option<Duration>& groupCommitWindow,
+    Storage* storage)
 {
-  process = new ReplicaProcess(path);
+  process = new ReplicaProcess(path, groupCommitWindow, storage);
   spawn(process);
 }
 
@@ -28,7 +28,10 @@
 #include <process/pid.hpp>
 #include <process/protobuf.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/interval.hpp>
+#include <stout/none.hpp>
+#include <stout/option.hpp>
 
 #include "messages/log.hpp"
 
@@ -46,8 +49,9 @@ extern Protocol<RecoverRequest, RecoverResponse> recover;
 } // namespace protocol {
 
 
-// Forward declaration.
+// Forward declarations.
 class ReplicaProcess;
+class Storage;
 
 
 class Replica
@@ -59,7 +63,20 @@ public:
   // reply to any request except the recover request). The recover
   // process will later decide if this replica can be re-allowed to
   // vote depending on the status of other replicas.
-  explicit Replica(const std::string& path);
+  //
+  // If a group commit window is specified, the actions written within
+  // that window get persisted at once (i.e., with a single sync), and
+  // the replica only replies to the requests (and serves reads of the
+  // actions) once that is done. With a zero window the actions of all
+  // of the requests that have been received so far (i.e., are queued)
+  // get persisted together.
+  //
+  // The log is stored using LevelDB unless a storage is specified, in
+  // which case the replica takes ownership of it (e.g., for testing).
+  explicit Replica(
+      const std::string& path,
+      const Option<Duration>& groupCommitWindow = None(),
+      Storage* storage = NULL);
   ~Replica();
 
   // Returns all the actions between the specified positions, unless
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 
+#include <list>
 #include <string>
 
 #include <stout/interval.hpp>
@@ -55,6 +56,11 @@ public:
   virtual Try<State> restore(const std::string& path) = 0;
   virtual Try<Nothing> persist(const Metadata& metadata) = 0;
   virtual Try<Nothing> persist(const Action& action) = 0;
+
+  // Persists all of the actions at once (i.e., with a single sync),
+  // which is used to "group commit" actions.
+  virtual Try<Nothing> persist(const std::list<Action>& actions) = 0;
+
   virtual Try<Action> read(uint64_t position) = 0;
 };
 
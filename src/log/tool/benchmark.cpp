@@ -19,6 +19,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <deque>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -31,6 +33,7 @@
 #include <stout/bytes.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/numify.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
 #include <stout/os/read.hpp>
@@ -44,6 +47,7 @@
 using namespace process;
 
 using std::cout;
+using std::deque;
 using std::endl;
 using std::ifstream;
 using std::ofstream;
@@ -55,6 +59,16 @@ namespace internal {
 namespace log {
 namespace tool {
 
+// Returns the given percentile of the sorted durations.
+static Duration percentile(const vector<Duration>& sorted, double p)
+{
+  CHECK(!sorted.empty());
+
+  size_t index = static_cast<size_t>(p / 100.0 * sorted.size());
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+
 Benchmark::Flags::Flags()
 {
   add(&Flags::quorum,
@@ -90,6 +104,13 @@ Benchmark::Flags::Flags()
       "  random: all bits are randomly chosen\n",
       "random");
 
+  add(&Flags::windows,
+      "windows",
+      "Comma separated list of the numbers of appends that are in\n"
+      "progress at a time. The trace is replayed once for each of them\n"
+      "(e.g., 1,4,16)",
+      "1");
+
   add(&Flags::initialize,
       "initialize",
       "Whether to initialize the log",
@@ -106,7 +127,8 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
       "replicated log. It takes a trace file of write sizes\n"
       "and replay that trace to measure the latency of each\n"
       "write. The data to be written for each write can be\n"
-      "specified using the --type flag.\n"
+      "specified using the --type flag, and the number of\n"
+      "writes in progress at a time using the --windows flag.\n"
       "\n");
 
   // Configure the tool by parsing command line arguments.
@@ -148,6 +170,20 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
     return Error(flags.usage("Missing required option --output"));
   }
 
+  vector<size_t> windows;
+  foreach (const string& token, strings::tokenize(flags.windows, ",")) {
+    Try<size_t> window = numify<size_t>(strings::trim(token));
+    if (window.isError() || window.get() == 0) {
+      return Error(flags.usage("Invalid window size '" + token + "'"));
+    }
+
+    windows.push_back(window.get());
+  }
+
+  if (windows.empty()) {
+    return Error(flags.usage("Missing window sizes in --windows"));
+  }
+
   // Initialize the log.
   if (flags.initialize) {
     Initialize initialize;
@@ -167,24 +203,8 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
       Seconds(10),
       flags.znode.get());
 
-  // Create the log writer.
-  Log::Writer writer(&log);
-
-  Future<Option<Log::Position> > position = writer.start();
-
-  if (!position.await(Seconds(15))) {
-    return Error("Failed to start a log writer: timed out");
-  } else if (!position.isReady()) {
-    return Error("Failed to start a log writer: " +
-                 (position.isFailed()
-                  ? position.failure()
-                  : "Discarded future"));
-  }
-
   // Statistics to output.
   vector<Bytes> sizes;
-  vector<Duration> durations;
-  vector<Time> timestamps;
 
   // Read sizes from the input trace file.
   ifstream input(flags.input.get().c_str());
@@ -204,8 +224,13 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
 
   input.close();
 
+  if (sizes.empty()) {
+    return Error("The trace file " + flags.input.get() + " is empty");
+  }
+
   // Generate the data to be written.
   vector<string> data;
+  Bytes total;
   for (size_t i = 0; i < sizes.size(); i++) {
     if (flags.type == "one") {
       data.push_back(string(sizes[i].bytes(), 255));
@@ -214,45 +239,98 @@ Try<Nothing> Benchmark::execute(int argc, char** argv)
     } else {
       data.push_back(string(sizes[i].bytes(), 0));
     }
+
+    total += sizes[i];
   }
 
-  Stopwatch stopwatch;
-  stopwatch.start();
+  ofstream output(flags.output.get().c_str());
+  if (!output.is_open()) {
+    return Error("Failed to open the output file " + flags.output.get());
+  }
 
-  for (size_t i = 0; i < sizes.size(); i++) {
-    Stopwatch stopwatch;
-    stopwatch.start();
+  foreach (size_t window, windows) {
+    // Create the log writer.
+    Log::Writer writer(&log, window);
 
-    position = writer.append(data[i]);
+    Future<Option<Log::Position> > position = writer.start();
 
-    if (!position.await(Seconds(10))) {
-      return Error("Failed to append: timed out");
+    if (!position.await(Seconds(15))) {
+      return Error("Failed to start a log writer: timed out");
     } else if (!position.isReady()) {
-      return Error("Failed to append: " +
+      return Error("Failed to start a log writer: " +
                    (position.isFailed()
                     ? position.failure()
                     : "Discarded future"));
     } else if (position.get().isNone()) {
-      return Error("Failed to append: exclusive write promise lost");
+      return Error("Failed to start a log writer: exclusive write promise"
+                   " could not be attained");
     }
 
-    durations.push_back(stopwatch.elapsed());
-    timestamps.push_back(Clock::now());
-  }
+    vector<Duration> durations;
+    vector<Time> timestamps;
 
-  cout << "Total number of appends: " << sizes.size() << endl;
-  cout << "Total time used: " << stopwatch.elapsed() << endl;
+    // The appends in progress, along with when they were started.
+    deque<Future<Option<Log::Position> > > appending;
+    deque<Stopwatch> stopwatches;
 
-  // Ouput statistics.
-  ofstream output(flags.output.get().c_str());
-  if (!output.is_open()) {
-    return Error("Failed to open the output file " + flags.output.get());
-  }
+    Stopwatch stopwatch;
+    stopwatch.start();
 
-  for (size_t i = 0; i < sizes.size(); i++) {
-    output << timestamps[i]
-           << " Appended " << sizes[i].bytes() << " bytes"
-           << " in " << durations[i].ms() << " ms" << endl;
+    size_t next = 0;
+    while (durations.size() < sizes.size()) {
+      // Keep up to 'window' appends in progress.
+      while (next < sizes.size() && appending.size() < window) {
+        stopwatches.push_back(Stopwatch());
+        stopwatches.back().start();
+
+        appending.push_back(writer.append(data[next++]));
+      }
+
+      // Appends complete in order, so wait for the oldest one.
+      position = appending.front();
+
+      if (!position.await(Seconds(10))) {
+        return Error("Failed to append: timed out");
+      } else if (!position.isReady()) {
+        return Error("Failed to append: " +
+                     (position.isFailed()
+                      ? position.failure()
+                      : "Discarded future"));
+      } else if (position.get().isNone()) {
+        return Error("Failed to append: exclusive write promise lost");
+      }
+
+      durations.push_back(stopwatches.front().elapsed());
+      timestamps.push_back(Clock::now());
+
+      appending.pop_front();
+      stopwatches.pop_front();
+    }
+
+    Duration elapsed = stopwatch.elapsed();
+
+    vector<Duration> sorted = durations;
+    std::sort(sorted.begin(), sorted.end());
+
+    cout << "Window size: " << window << endl;
+    cout << "Total number of appends: " << sizes.size() << endl;
+    cout << "Total time used: " << elapsed << endl;
+    cout << "Throughput: " << (sizes.size() / elapsed.secs())
+         << " appends/sec, "
+         << Bytes(static_cast<uint64_t>(total.bytes() / elapsed.secs()))
+         << "/sec" << endl;
+    cout << "Latency: p50 " << percentile(sorted, 50)
+         << ", p90 " << percentile(sorted, 90)
+         << ", p99 " << percentile(sorted, 99)
+         << ", max " << sorted.back() << endl;
+
+    // Ouput statistics.
+    for (size_t i = 0; i < sizes.size(); i++) {
+      output << timestamps[i]
+             << " Appended " << sizes[i].bytes() << " bytes"
+             << " in " << durations[i].ms() << " ms"
+             << " (window " << window << ")" << endl;
+    }
   }
 
   return Nothing();
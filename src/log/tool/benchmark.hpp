@@ -46,6 +46,7 @@ public:
     Option<std::string> input;
     Option<std::string> output;
     std::string type;
+    std::string windows;
     bool initialize;
     bool help;
   };
@@ -0,0 +1,242 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <deque>
+#include <iostream>
+
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "log/replica.hpp"
+#include "log/tool/initialize.hpp"
+#include "log/tool/persist.hpp"
+
+#include "logging/logging.hpp"
+
+using namespace process;
+
+using std::cout;
+using std::deque;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace log {
+namespace tool {
+
+// Writes 'count' appends to a new replica at the given path, keeping
+// up to 'concurrency' of them in progress, and returns the number of
+// writes per second.
+static Try<double> run(
+    const string& path,
+    const Option<Duration>& window,
+    size_t count,
+    size_t concurrency,
+    const string& data)
+{
+  Initialize initialize;
+  initialize.flags.path = path;
+
+  Try<Nothing> execution = initialize.execute();
+  if (execution.isError()) {
+    return Error(execution.error());
+  }
+
+  log::Replica replica(path, window);
+
+  const uint64_t proposal = 1;
+
+  PromiseRequest request;
+  request.set_proposal(proposal);
+
+  Future<PromiseResponse> promise = protocol::promise(replica.pid(), request);
+
+  if (!promise.await(Seconds(10))) {
+    return Error("Failed to get a promise: timed out");
+  } else if (!promise.isReady()) {
+    return Error("Failed to get a promise: " +
+                 (promise.isFailed() ? promise.failure() : "discarded"));
+  } else if (!promise.get().okay()) {
+    return Error("Failed to get a promise: rejected");
+  }
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  deque<Future<WriteResponse> > writes;
+  uint64_t position = 1;
+
+  for (size_t written = 0; written < count; written++) {
+    // Keep up to 'concurrency' writes in progress.
+    while (position <= count && writes.size() < concurrency) {
+      WriteRequest request;
+      request.set_proposal(proposal);
+      request.set_position(position++);
+      request.set_type(Action::APPEND);
+      request.mutable_append()->set_bytes(data);
+
+      writes.push_back(protocol::write(replica.pid(), request));
+    }
+
+    Future<WriteResponse> write = writes.front();
+    writes.pop_front();
+
+    if (!write.await(Seconds(10))) {
+      return Error("Failed to write: timed out");
+    } else if (!write.isReady()) {
+      return Error("Failed to write: " +
+                   (write.isFailed() ? write.failure() : "discarded"));
+    } else if (!write.get().okay()) {
+      return Error("Failed to write: rejected");
+    }
+  }
+
+  return count / stopwatch.elapsed().secs();
+}
+
+
+Persist::Flags::Flags()
+{
+  add(&Flags::path,
+      "path",
+      "Path to a directory in which the logs are created");
+
+  add(&Flags::count,
+      "count",
+      "Number of writes to do for each configuration",
+      1000);
+
+  add(&Flags::size,
+      "size",
+      "Size of each write (e.g., 100B, 2KB, etc.)",
+      Kilobytes(1));
+
+  add(&Flags::concurrency,
+      "concurrency",
+      "Number of writes in progress at a time",
+      64);
+
+  add(&Flags::windows,
+      "windows",
+      "Comma separated list of group commit windows to measure\n"
+      "in addition to writing without group commit (e.g., 0ms,1ms)",
+      "0ms,1ms");
+}
+
+
+Try<Nothing> Persist::execute(int argc, char** argv)
+{
+  flags.setUsageMessage(
+      "Usage: " + name() + " [options]\n"
+      "\n"
+      "This command is used to measure the number of synchronous\n"
+      "writes per second to a replica, without group commit and\n"
+      "with each of the group commit windows specified using the\n"
+      "--windows flag.\n"
+      "\n");
+
+  // Configure the tool by parsing command line arguments.
+  if (argc > 0 && argv != NULL) {
+    Try<Nothing> load = flags.load(None(), argc, argv);
+    if (load.isError()) {
+      return Error(flags.usage(load.error()));
+    }
+
+    if (flags.help) {
+      return Error(flags.usage());
+    }
+
+    process::initialize();
+    logging::initialize(argv[0], flags);
+  }
+
+  if (flags.path.isNone()) {
+    return Error(flags.usage("Missing required flag --path"));
+  }
+
+  if (flags.count == 0 || flags.concurrency == 0) {
+    return Error(flags.usage("Expecting positive --count and --concurrency"));
+  }
+
+  // Without group commit, followed by each of the windows.
+  vector<Option<Duration> > windows;
+  windows.push_back(None());
+
+  foreach (const string& token, strings::tokenize(flags.windows, ",")) {
+    Try<Duration> window = Duration::parse(strings::trim(token));
+    if (window.isError()) {
+      return Error(flags.usage("Invalid window '" + token + "'"));
+    }
+
+    windows.push_back(window.get());
+  }
+
+  Try<Nothing> mkdir = os::mkdir(flags.path.get());
+  if (mkdir.isError()) {
+    return Error("Failed to create directory " + flags.path.get() +
+                 ": " + mkdir.error());
+  }
+
+  const string data(flags.size.bytes(), 0);
+
+  for (size_t i = 0; i < windows.size(); i++) {
+    const string directory = path::join(flags.path.get(), stringify(i));
+
+    if (os::exists(directory)) {
+      return Error("Log " + directory + " already exists");
+    }
+
+    Try<double> rate = run(
+        directory,
+        windows[i],
+        flags.count,
+        flags.concurrency,
+        data);
+
+    if (rate.isError()) {
+      return Error(rate.error());
+    }
+
+    if (windows[i].isNone()) {
+      cout << "Without group commit: ";
+    } else {
+      cout << "With a group commit window of " << windows[i].get() << ": ";
+    }
+
+    cout << rate.get() << " writes/sec" << endl;
+  }
+
+  return Nothing();
+}
+
+} // namespace tool {
+} // namespace log {
+} // namespace internal {
+} // namespace mesos {
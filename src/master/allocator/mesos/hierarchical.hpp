@@ -20,23 +20,31 @@
 #define __MASTER_ALLOCATOR_MESOS_HIERARCHICAL_HPP__
 
 #include <algorithm>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <mesos/resources.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <process/clock.hpp>
 #include <process/event.hpp>
 #include <process/delay.hpp>
 #include <process/future.hpp>
 #include <process/id.hpp>
 #include <process/metrics/gauge.hpp>
 #include <process/metrics/metrics.hpp>
+#include <process/time.hpp>
 #include <process/timeout.hpp>
 
 #include <stout/check.hpp>
 #include <stout/duration.hpp>
+#include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
+#include <stout/option.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 
@@ -197,11 +205,8 @@ protected:
   // Send inverse offers from the specified slaves.
   void deallocate(const hashset<SlaveID>& slaveIds);
 
-  // Remove an offer filter for the specified framework.
-  void expire(
-      const FrameworkID& frameworkId,
-      const SlaveID& slaveId,
-      OfferFilter* offerFilter);
+  // Remove the refusals of the offer filters that have expired.
+  void expire();
 
   // Remove an inverse offer filter for the specified framework.
   void expire(
@@ -269,7 +274,7 @@ protected:
     bool revocable;
 
     // Active offer and inverse offer filters for the framework.
-    hashmap<SlaveID, hashset<OfferFilter*>> offerFilters;
+    hashmap<SlaveID, OfferFilter> offerFilters;
     hashmap<SlaveID, hashset<InverseOfferFilter*>> inverseOfferFilters;
   };
 
@@ -280,6 +285,12 @@ protected:
 
   hashmap<FrameworkID, Framework> frameworks;
 
+  // The offer filters of the frameworks indexed by when they are to
+  // be expired next, see HierarchicalAllocatorProcess::expire. This
+  // may contain entries for filters that no longer exist.
+  std::multimap<process::Time, std::pair<FrameworkID, SlaveID>>
+    offerFilterExpirations;
+
   struct Slave
   {
     // Total amount of regular *and* oversubscribed resources.
@@ -366,37 +377,123 @@ protected:
 };
 
 
-// Used to represent "filters" for resources unused in offers.
+// Used to represent "filters" for resources unused in offers. All
+// the refusals of a framework for the resources of a slave are kept
+// in a single filter.
 class OfferFilter
 {
 public:
-  virtual ~OfferFilter() {}
+  // Adds a refusal of the resources until the timeout. A refusal that
+  // is covered by another one, i.e., one that refused a superset of
+  // its resources for at least as long, is not kept since it cannot
+  // filter anything that the other one does not. This keeps a single
+  // refusal when a framework keeps declining the same resources.
+  void add(const Resources& resources, const process::Timeout& timeout)
+  {
+    foreach (const Refusal& refusal, refusals) {
+      if (refusal.timeout.time() >= timeout.time() &&
+          refusal.resources.contains(resources)) {
+        return;
+      }
+    }
 
-  virtual bool filter(const Resources& resources) = 0;
-};
+    std::vector<Refusal> uncovered;
+    foreach (const Refusal& refusal, refusals) {
+      if (refusal.timeout.time() > timeout.time() ||
+          !resources.contains(refusal.resources)) {
+        uncovered.push_back(refusal);
+      }
+    }
 
+    uncovered.push_back(Refusal(resources, timeout));
+    refusals.swap(uncovered);
 
-class RefusedOfferFilter: public OfferFilter
-{
-public:
-  RefusedOfferFilter(
-      const Resources& _resources,
-      const process::Timeout& _timeout)
-    : resources(_resources), timeout(_timeout) {}
+    update();
+  }
 
-  virtual bool filter(const Resources& _resources)
+  // Returns true if the resources are contained in the resources of
+  // a refusal that has not yet expired.
+  bool filter(const Resources& resources) const
   {
-    // TODO(jieyu): Consider separating the superset check for regular
-    // and revocable resources. For example, frameworks might want
-    // more revocable resources only or non-revocable resources only,
-    // but currently the filter only expires if there is more of both
-    // revocable and non-revocable resources.
-    return resources.contains(_resources) && // Refused resources are superset.
-           timeout.remaining() > Seconds(0);
+    // The resources of a refusal are always contained in the bound.
+    if (refusals.size() > 1 && !bound.contains(resources)) {
+      return false;
+    }
+
+    const process::Time now = process::Clock::now();
+
+    foreach (const Refusal& refusal, refusals) {
+      // TODO(jieyu): Consider separating the superset check for regular
+      // and revocable resources. For example, frameworks might want
+      // more revocable resources only or non-revocable resources only,
+      // but currently the filter only expires if there is more of both
+      // revocable and non-revocable resources.
+      if (refusal.timeout.time() > now &&
+          refusal.resources.contains(resources)) {
+        return true;
+      }
+    }
+
+    return false;
   }
 
-  const Resources resources;
-  const process::Timeout timeout;
+  // Removes the refusals that have expired by 'now'.
+  void expire(const process::Time& now)
+  {
+    std::vector<Refusal> unexpired;
+    foreach (const Refusal& refusal, refusals) {
+      if (refusal.timeout.time() > now) {
+        unexpired.push_back(refusal);
+      }
+    }
+
+    refusals.swap(unexpired);
+
+    update();
+  }
+
+  // Returns when the next refusal expires, or none if there are no
+  // refusals left.
+  Option<process::Time> next() const
+  {
+    Option<process::Time> next = None();
+
+    foreach (const Refusal& refusal, refusals) {
+      if (next.isNone() || refusal.timeout.time() < next.get()) {
+        next = refusal.timeout.time();
+      }
+    }
+
+    return next;
+  }
+
+  // When the allocator expires this filter next, which is no later
+  // than when its next refusal expires.
+  Option<process::Time> expiration;
+
+private:
+  struct Refusal
+  {
+    Refusal(const Resources& _resources, const process::Timeout& _timeout)
+      : resources(_resources), timeout(_timeout) {}
+
+    Resources resources;
+    process::Timeout timeout;
+  };
+
+  void update()
+  {
+    bound = Resources();
+    foreach (const Refusal& refusal, refusals) {
+      bound += refusal.resources;
+    }
+  }
+
+  std::vector<Refusal> refusals;
+
+  // The combined resources of all refusals, which contains the
+  // resources of each refusal.
+  Resources bound;
 };
 
 
@@ -544,7 +641,7 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::removeFramework(
   }
 
   // Do not delete the filters contained in this
-  // framework's `offerFilters` hashset yet, see comments in
+  // framework's `inverseOfferFilters` hashset yet, see comments in
   // HierarchicalAllocatorProcess::reviveOffers and
   // HierarchicalAllocatorProcess::expire.
   frameworks.erase(frameworkId);
@@ -590,7 +687,7 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::deactivateFramework(
   // the added/removed and activated/deactivated in the future.
 
   // Do not delete the filters contained in this
-  // framework's `offerFilters` hashset yet, see comments in
+  // framework's `inverseOfferFilters` hashset yet, see comments in
   // HierarchicalAllocatorProcess::reviveOffers and
   // HierarchicalAllocatorProcess::expire.
   frameworks[frameworkId].offerFilters.clear();
@@ -699,8 +796,7 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::removeSlave(
   slaves.erase(slaveId);
 
   // Note that we DO NOT actually delete any filters associated with
-  // this slave, that will occur when the delayed
-  // HierarchicalAllocatorProcess::expire gets invoked (or the framework
+  // this slave, that will occur when they expire (or the framework
   // that applied the filters gets removed).
 
   LOG(INFO) << "Removed slave " << slaveId;
@@ -1141,27 +1237,22 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::recoverResources(
             << " filtered slave " << slaveId
             << " for " << seconds.get();
 
-    // Create a new filter and delay its expiration.
-    OfferFilter* offerFilter = new RefusedOfferFilter(
-        resources,
-        process::Timeout::in(seconds.get()));
+    // Add the refusal to the framework's filter for the slave, and
+    // index the filter if it now needs to be expired earlier. The
+    // expiration is done in batches, see
+    // HierarchicalAllocatorProcess::batch.
+    const process::Timeout timeout = process::Timeout::in(seconds.get());
 
-    frameworks[frameworkId].offerFilters[slaveId].insert(offerFilter);
+    OfferFilter& offerFilter = frameworks[frameworkId].offerFilters[slaveId];
+    offerFilter.add(resources, timeout);
 
-    // We need to disambiguate the function call to pick the correct
-    // expire() overload.
-    void (Self::*expireOffer)(
-              const FrameworkID&,
-              const SlaveID&,
-              OfferFilter*) = &Self::expire;
+    if (offerFilter.expiration.isNone() ||
+        timeout.time() < offerFilter.expiration.get()) {
+      offerFilter.expiration = timeout.time();
 
-    delay(
-        seconds.get(),
-        self(),
-        expireOffer,
-        frameworkId,
-        slaveId,
-        offerFilter);
+      offerFilterExpirations.insert(
+          std::make_pair(timeout.time(), std::make_pair(frameworkId, slaveId)));
+    }
   }
 }
 
@@ -1189,12 +1280,13 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::reviveOffers(
   frameworks[frameworkId].inverseOfferFilters.clear();
   frameworks[frameworkId].suppressed = false;
 
-  // We delete each actual `OfferFilter` when
+  // We delete each actual `InverseOfferFilter` when
   // `HierarchicalAllocatorProcess::expire` gets invoked. If we delete the
-  // `OfferFilter` here it's possible that the same `OfferFilter` (i.e., same
-  // address) could get reused and `HierarchicalAllocatorProcess::expire`
-  // would expire that filter too soon. Note that this only works
-  // right now because ALL Filter types "expire".
+  // `InverseOfferFilter` here it's possible that the same
+  // `InverseOfferFilter` (i.e., same address) could get reused and
+  // `HierarchicalAllocatorProcess::expire` would expire that filter too
+  // soon. Note that this only works right now because ALL Filter types
+  // "expire".
 
   LOG(INFO) << "Removed offer filters for framework " << frameworkId;
 
@@ -1206,6 +1298,7 @@ template <class RoleSorter, class FrameworkSorter>
 void
 HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::batch()
 {
+  expire();
   allocate();
   delay(allocationInterval, self(), &Self::batch);
 }
@@ -1260,6 +1353,26 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::allocate(
   //       to a framework of any role.
   hashmap<FrameworkID, hashmap<SlaveID, Resources>> offerable;
 
+  // Rather than sorting every role and every framework again for
+  // each slave, we sort them once for this allocation and then only
+  // re-sort a sorter after it has allocated something, i.e., once
+  // its order might have changed.
+  //
+  // To keep re-sorting a framework sorter cheap we don't add the
+  // resources allocated to a role to its framework sorter's total
+  // until the end of this allocation, since changing the total
+  // requires recalculating the share of every framework in the role.
+  // Within an allocation the frameworks of a role are therefore
+  // ordered by their shares of the resources the role had been
+  // allocated when the allocation started.
+  std::vector<std::string> roleOrder;
+  bool resortRoles = true;
+
+  hashmap<std::string, std::list<std::string>> frameworkOrders;
+  hashset<std::string> resortFrameworks;
+
+  hashmap<std::string, hashmap<SlaveID, Resources>> allocated;
+
   // Randomize the order in which slaves' resources are allocated.
   // TODO(vinod): Implement a smarter sorting algorithm.
   std::vector<SlaveID> slaveIds(slaveIds_.begin(), slaveIds_.end());
@@ -1271,9 +1384,43 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::allocate(
       continue;
     }
 
-    foreach (const std::string& role, roleSorter->sort()) {
-      foreach (const std::string& frameworkId_,
-               frameworkSorters[role]->sort()) {
+    // Calculate the currently available resources on the slave.
+    Resources available = slaves[slaveId].total - slaves[slaveId].allocated;
+
+    // Skip slaves that have nothing left to allocate (e.g., all of
+    // their resources are already offered or in use) without
+    // consulting the sorters.
+    if (!allocatable(available)) {
+      continue;
+    }
+
+    if (resortRoles) {
+      const std::list<std::string> sorted = roleSorter->sort();
+      roleOrder.assign(sorted.begin(), sorted.end());
+      resortRoles = false;
+    }
+
+    foreach (const std::string& role, roleOrder) {
+      // NOTE: Currently, frameworks are allowed to have '*' role.
+      // Calling reserved('*') returns an empty Resources object.
+      Resources resources = available.unreserved() + available.reserved(role);
+
+      // If none of the frameworks in the role could be allocated
+      // these resources, don't bother sorting them.
+      if (!allocatable(resources)) {
+        continue;
+      }
+
+      if (!frameworkOrders.contains(role) || resortFrameworks.contains(role)) {
+        frameworkOrders[role] = frameworkSorters[role]->sort();
+        resortFrameworks.erase(role);
+      }
+
+      // Remove revocable resources for frameworks that have not opted
+      // for them.
+      Resources nonRevocable = resources - resources.revocable();
+
+      foreach (const std::string& frameworkId_, frameworkOrders[role]) {
         FrameworkID frameworkId;
         frameworkId.set_value(frameworkId_);
 
@@ -1282,48 +1429,60 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::allocate(
           continue;
         }
 
-        // Calculate the currently available resources on the slave.
-        Resources available = slaves[slaveId].total - slaves[slaveId].allocated;
-
-        // NOTE: Currently, frameworks are allowed to have '*' role.
-        // Calling reserved('*') returns an empty Resources object.
-        Resources resources = available.unreserved() + available.reserved(role);
-
-        // Remove revocable resources if the framework has not opted
-        // for them.
-        if (!frameworks[frameworkId].revocable) {
-          resources -= resources.revocable();
-        }
+        const Resources& offered =
+          frameworks[frameworkId].revocable ? resources : nonRevocable;
 
         // If the resources are not allocatable, ignore.
-        if (!allocatable(resources)) {
+        if (!allocatable(offered)) {
           continue;
         }
 
         // If the framework filters these resources, ignore.
-        if (isFiltered(frameworkId, slaveId, resources)) {
+        if (isFiltered(frameworkId, slaveId, offered)) {
           continue;
         }
 
-        VLOG(2) << "Allocating " << resources << " on slave " << slaveId
+        VLOG(2) << "Allocating " << offered << " on slave " << slaveId
                 << " to framework " << frameworkId;
 
         // Note that we perform "coarse-grained" allocation,
         // meaning that we always allocate the entire remaining
         // slave resources to a single framework.
-        offerable[frameworkId][slaveId] = resources;
-        slaves[slaveId].allocated += resources;
+        offerable[frameworkId][slaveId] = offered;
+        slaves[slaveId].allocated += offered;
 
         // Reserved resources are only accounted for in the framework
         // sorter, since the reserved resources are not shared across
         // roles.
-        frameworkSorters[role]->add(slaveId, resources);
-        frameworkSorters[role]->allocated(frameworkId_, slaveId, resources);
-        roleSorter->allocated(role, slaveId, resources.unreserved());
+        allocated[role][slaveId] += offered;
+        frameworkSorters[role]->allocated(frameworkId_, slaveId, offered);
+        roleSorter->allocated(role, slaveId, offered.unreserved());
+
+        resortRoles = true;
+        resortFrameworks.insert(role);
+
+        available = slaves[slaveId].total - slaves[slaveId].allocated;
+        resources = available.unreserved() + available.reserved(role);
+        nonRevocable = resources - resources.revocable();
+
+        // Stop once nothing is left on the slave for this role.
+        if (!allocatable(resources)) {
+          break;
+        }
       }
     }
   }
 
+  // Now that the allocation is done, add the resources allocated to
+  // each role to the total of its framework sorter (see above).
+  foreachkey (const std::string& role, allocated) {
+    foreachpair (const SlaveID& slaveId,
+                 const Resources& resources,
+                 allocated[role]) {
+      frameworkSorters[role]->add(slaveId, resources);
+    }
+  }
+
   if (offerable.empty()) {
     VLOG(1) << "No resources available to allocate!";
   } else {
@@ -1432,26 +1591,48 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::deallocate(
 
 template <class RoleSorter, class FrameworkSorter>
 void
-HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::expire(
-    const FrameworkID& frameworkId,
-    const SlaveID& slaveId,
-    OfferFilter* offerFilter)
+HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::expire()
 {
-  // The filter might have already been removed (e.g., if the
-  // framework no longer exists or in
-  // HierarchicalAllocatorProcess::reviveOffers) but not yet deleted (to
-  // keep the address from getting reused possibly causing premature
-  // expiration).
-  if (frameworks.contains(frameworkId) &&
-      frameworks[frameworkId].offerFilters.contains(slaveId) &&
-      frameworks[frameworkId].offerFilters[slaveId].contains(offerFilter)) {
-    frameworks[frameworkId].offerFilters[slaveId].erase(offerFilter);
-    if (frameworks[frameworkId].offerFilters[slaveId].empty()) {
+  // NOTE: An expired refusal does not filter any resources even
+  // before it gets removed here, so removing the refusals only once
+  // per batch allocation does not affect which resources get offered.
+  const process::Time now = process::Clock::now();
+
+  while (!offerFilterExpirations.empty() &&
+         offerFilterExpirations.begin()->first <= now) {
+    const process::Time time = offerFilterExpirations.begin()->first;
+    const FrameworkID frameworkId =
+      offerFilterExpirations.begin()->second.first;
+    const SlaveID slaveId = offerFilterExpirations.begin()->second.second;
+
+    offerFilterExpirations.erase(offerFilterExpirations.begin());
+
+    // The filter might have already been removed (e.g., if the
+    // framework no longer exists or in
+    // HierarchicalAllocatorProcess::reviveOffers), or it might have
+    // been indexed again for an earlier time.
+    if (!frameworks.contains(frameworkId) ||
+        !frameworks[frameworkId].offerFilters.contains(slaveId)) {
+      continue;
+    }
+
+    OfferFilter& offerFilter = frameworks[frameworkId].offerFilters[slaveId];
+
+    if (offerFilter.expiration != time) {
+      continue;
+    }
+
+    offerFilter.expire(now);
+    offerFilter.expiration = offerFilter.next();
+
+    if (offerFilter.expiration.isNone()) {
       frameworks[frameworkId].offerFilters.erase(slaveId);
+    } else {
+      offerFilterExpirations.insert(std::make_pair(
+          offerFilter.expiration.get(),
+          std::make_pair(frameworkId, slaveId)));
     }
   }
-
-  delete offerFilter;
 }
 
 
@@ -1516,17 +1697,13 @@ HierarchicalAllocatorProcess<RoleSorter, FrameworkSorter>::isFiltered(
     return true;
   }
 
-  if (frameworks[frameworkId].offerFilters.contains(slaveId)) {
-    foreach (
-      OfferFilter* offerFilter, frameworks[frameworkId].offerFilters[slaveId]) {
-      if (offerFilter->filter(resources)) {
-        VLOG(1) << "Filtered offer with " << resources
-                << " on slave " << slaveId
-                << " for framework " << frameworkId;
+  if (frameworks[frameworkId].offerFilters.contains(slaveId) &&
+      frameworks[frameworkId].offerFilters[slaveId].filter(resources)) {
+    VLOG(1) << "Filtered offer with " << resources
+            << " on slave " << slaveId
+            << " for framework " << frameworkId;
 
-        return true;
-      }
-    }
+    return true;
   }
 
   return false;
@@ -16,6 +16,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <vector>
+
 #include "logging/logging.hpp"
 
 #include "master/allocator/sorter/drf/sorter.hpp"
@@ -23,6 +26,7 @@
 using std::list;
 using std::set;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -44,7 +48,7 @@ bool DRFComparator::operator()(const Client& client1, const Client& client2)
 void DRFSorter::add(const string& name, double weight)
 {
   Client client(name, 0, 0);
-  clients.insert(client);
+  insert(client);
 
   allocations[name] = Allocation();
   weights[name] = weight;
@@ -57,6 +61,7 @@ void DRFSorter::remove(const string& name)
 
   if (it != clients.end()) {
     clients.erase(it);
+    index.erase(name);
   }
 
   allocations.erase(name);
@@ -68,8 +73,16 @@ void DRFSorter::activate(const string& name)
 {
   CHECK(allocations.contains(name));
 
+  // Don't end up with the client in 'clients' twice if it's
+  // already active.
+  set<Client, DRFComparator>::iterator it = find(name);
+
+  if (it != clients.end()) {
+    clients.erase(it);
+  }
+
   Client client(name, calculateShare(name), 0);
-  clients.insert(client);
+  insert(client);
 }
 
 
@@ -83,6 +96,7 @@ void DRFSorter::deactivate(const string& name)
     // for this client which means the fairness can be gamed by a
     // framework disconnecting and reconnecting.
     clients.erase(it);
+    index.erase(name);
   }
 }
 
@@ -92,28 +106,27 @@ void DRFSorter::allocated(
     const SlaveID& slaveId,
     const Resources& resources)
 {
+  allocations[name].resources[slaveId] += resources;
+  add(&allocations[name].scalars, resources);
+
   set<Client, DRFComparator>::iterator it = find(name);
 
   if (it != clients.end()) { // TODO(benh): This should really be a CHECK.
-    // TODO(benh): Refactor 'update' to be able to reuse it here.
     Client client(*it);
 
     // Update the 'allocations' to reflect the allocator decision.
     client.allocations++;
 
+    // If the total resources have changed, we're going to
+    // recalculate all the shares, so don't bother just
+    // updating this client.
+    if (!dirty) {
+      client.share = calculateShare(name);
+    }
+
     // Remove and reinsert it to update the ordering appropriately.
     clients.erase(it);
-    clients.insert(client);
-  }
-
-  allocations[name].resources[slaveId] += resources;
-  allocations[name].scalars += resources.scalars();
-
-  // If the total resources have changed, we're going to
-  // recalculate all the shares, so don't bother just
-  // updating this client.
-  if (!dirty) {
-    update(name);
+    insert(client);
   }
 }
 
@@ -132,22 +145,20 @@ void DRFSorter::update(
   // is being currently done, for safety.
 
   CHECK(total.resources[slaveId].contains(oldAllocation));
-  CHECK(total.scalars.contains(oldAllocation.scalars()));
 
   total.resources[slaveId] -= oldAllocation;
   total.resources[slaveId] += newAllocation;
 
-  total.scalars -= oldAllocation.scalars();
-  total.scalars += newAllocation.scalars();
+  subtract(&total.scalars, oldAllocation);
+  add(&total.scalars, newAllocation);
 
   CHECK(allocations[name].resources[slaveId].contains(oldAllocation));
-  CHECK(allocations[name].scalars.contains(oldAllocation.scalars()));
 
   allocations[name].resources[slaveId] -= oldAllocation;
   allocations[name].resources[slaveId] += newAllocation;
 
-  allocations[name].scalars -= oldAllocation.scalars();
-  allocations[name].scalars += newAllocation.scalars();
+  subtract(&allocations[name].scalars, oldAllocation);
+  add(&allocations[name].scalars, newAllocation);
 
   // Just assume the total has changed, per the TODO above.
   dirty = true;
@@ -200,7 +211,7 @@ void DRFSorter::unallocated(
     const Resources& resources)
 {
   allocations[name].resources[slaveId] -= resources;
-  allocations[name].scalars -= resources.scalars();
+  subtract(&allocations[name].scalars, resources);
 
   if (allocations[name].resources[slaveId].empty()) {
     allocations[name].resources.erase(slaveId);
@@ -216,7 +227,7 @@ void DRFSorter::add(const SlaveID& slaveId, const Resources& resources)
 {
   if (!resources.empty()) {
     total.resources[slaveId] += resources;
-    total.scalars += resources.scalars();
+    add(&total.scalars, resources);
 
     // We have to recalculate all shares when the total resources
     // change, but we put it off until sort is called so that if
@@ -233,7 +244,7 @@ void DRFSorter::remove(const SlaveID& slaveId, const Resources& resources)
     CHECK(total.resources.contains(slaveId));
 
     total.resources[slaveId] -= resources;
-    total.scalars -= resources.scalars();
+    subtract(&total.scalars, resources);
 
     if (total.resources[slaveId].empty()) {
       total.resources.erase(slaveId);
@@ -246,10 +257,8 @@ void DRFSorter::remove(const SlaveID& slaveId, const Resources& resources)
 
 void DRFSorter::update(const SlaveID& slaveId, const Resources& resources)
 {
-  CHECK(total.scalars.contains(total.resources[slaveId].scalars()));
-
-  total.scalars -= total.resources[slaveId].scalars();
-  total.scalars += resources.scalars();
+  subtract(&total.scalars, total.resources[slaveId]);
+  add(&total.scalars, resources);
 
   total.resources[slaveId] = resources;
 
@@ -264,19 +273,19 @@ void DRFSorter::update(const SlaveID& slaveId, const Resources& resources)
 list<string> DRFSorter::sort()
 {
   if (dirty) {
-    set<Client, DRFComparator> temp;
+    vector<Client> temp(clients.begin(), clients.end());
 
-    set<Client, DRFComparator>::iterator it;
-    for (it = clients.begin(); it != clients.end(); it++) {
-      Client client(*it);
+    clients.clear();
+    index.clear();
 
+    foreach (Client& client, temp) {
       // Update the 'share' to get proper sorting.
       client.share = calculateShare(client.name);
 
-      temp.insert(client);
+      insert(client);
     }
 
-    clients = temp;
+    dirty = false;
   }
 
   list<string> result;
@@ -302,6 +311,33 @@ int DRFSorter::count()
 }
 
 
+void DRFSorter::add(Quantities* quantities, const Resources& resources)
+{
+  foreach (const Resource& resource, resources) {
+    if (resource.type() == Value::SCALAR) {
+      (*quantities)[resource.name()] += resource.scalar().value();
+    }
+  }
+}
+
+
+void DRFSorter::subtract(Quantities* quantities, const Resources& resources)
+{
+  foreach (const Resource& resource, resources) {
+    if (resource.type() == Value::SCALAR &&
+        quantities->contains(resource.name())) {
+      double& quantity = (*quantities)[resource.name()];
+      quantity -= resource.scalar().value();
+
+      // Like 'Resources', never keep a zero or negative quantity.
+      if (quantity <= 0.0) {
+        quantities->erase(resource.name());
+      }
+    }
+  }
+}
+
+
 void DRFSorter::update(const string& name)
 {
   set<Client, DRFComparator>::iterator it = find(name);
@@ -314,7 +350,7 @@ void DRFSorter::update(const string& name)
 
     // Remove and reinsert it to update the ordering appropriately.
     clients.erase(it);
-    clients.insert(client);
+    insert(client);
   }
 }
 
@@ -327,28 +363,11 @@ double DRFSorter::calculateShare(const string& name)
   // currently does not take into account resources that are not
   // scalars.
 
-  foreach (const string& scalar, total.scalars.names()) {
-    double _total = 0.0;
+  const Quantities& allocation = allocations[name].scalars;
 
-    // NOTE: Scalar resources may be spread across multiple
-    // 'Resource' objects. E.g. persistent volumes.
-    foreach (const Resource& resource, total.scalars.get(scalar)) {
-      CHECK_EQ(resource.type(), Value::SCALAR);
-      _total += resource.scalar().value();
-    }
-
-    if (_total > 0.0) {
-      double allocation = 0.0;
-
-      // NOTE: Scalar resources may be spread across multiple
-      // 'Resource' objects. E.g. persistent volumes.
-      foreach (const Resource& resource,
-               allocations[name].scalars.get(scalar)) {
-        CHECK_EQ(resource.type(), Value::SCALAR);
-        allocation += resource.scalar().value();
-      }
-
-      share = std::max(share, allocation / _total);
+  foreachpair (const string& scalar, double _total, total.scalars) {
+    if (_total > 0.0 && allocation.contains(scalar)) {
+      share = std::max(share, allocation.at(scalar) / _total);
     }
   }
 
@@ -358,14 +377,17 @@ double DRFSorter::calculateShare(const string& name)
 
 set<Client, DRFComparator>::iterator DRFSorter::find(const string& name)
 {
-  set<Client, DRFComparator>::iterator it;
-  for (it = clients.begin(); it != clients.end(); it++) {
-    if (name == (*it).name) {
-      break;
-    }
+  if (index.contains(name)) {
+    return index.at(name);
   }
 
-  return it;
+  return clients.end();
+}
+
+
+void DRFSorter::insert(const Client& client)
+{
+  index[client.name] = clients.insert(client).first;
 }
 
 } // namespace allocator {
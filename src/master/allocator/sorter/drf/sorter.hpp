@@ -63,6 +63,8 @@ struct DRFComparator
 class DRFSorter : public Sorter
 {
 public:
+  DRFSorter() : dirty(false) {}
+
   virtual ~DRFSorter() {}
 
   virtual void add(const std::string& name, double weight = 1);
@@ -108,6 +110,16 @@ public:
   virtual int count();
 
 private:
+  // Sums of scalar resource quantities, keyed by resource name. This
+  // is all that is needed to calculate dominant shares, and unlike
+  // 'Resources' it can be updated and looked up without walking a
+  // collection of 'Resource' objects.
+  typedef hashmap<std::string, double> Quantities;
+
+  static void add(Quantities* quantities, const Resources& resources);
+
+  static void subtract(Quantities* quantities, const Resources& resources);
+
   // Recalculates the share for the client and moves
   // it in 'clients' accordingly.
   void update(const std::string& name);
@@ -119,12 +131,20 @@ private:
   // it exists in this Sorter.
   std::set<Client, DRFComparator>::iterator find(const std::string& name);
 
+  // Inserts the client into 'clients' and indexes it.
+  void insert(const Client& client);
+
   // If true, sort() will recalculate all shares.
   bool dirty;
 
   // A set of Clients (names and shares) sorted by share.
   std::set<Client, DRFComparator> clients;
 
+  // Maps the names of active clients to their position in 'clients'
+  // so that a client can be moved after a change to its allocation
+  // in O(log n) rather than by scanning 'clients'.
+  hashmap<std::string, std::set<Client, DRFComparator>::iterator> index;
+
   // Maps client names to the weights that should be applied to their shares.
   hashmap<std::string, double> weights;
 
@@ -135,7 +155,7 @@ private:
     // NOTE: Scalars can be safely aggregated across slaves. We keep
     // that to speed up the calculation of shares. See MESOS-2891 for
     // the reasons why we want to do that.
-    Resources scalars;
+    Quantities scalars;
   } total;
 
   // Allocation for a client.
@@ -143,7 +163,7 @@ private:
     hashmap<SlaveID, Resources> resources;
 
     // Similarly, we aggregated scalars across slaves. See note above.
-    Resources scalars;
+    Quantities scalars;
   };
 
   // Maps client names to the resources they have been allocated.
@@ -34,6 +34,7 @@ const Bytes MIN_MEM = Megabytes(32);
 const Duration DEFAULT_HEARTBEAT_INTERVAL = Seconds(15);
 const Duration DEFAULT_SLAVE_PING_TIMEOUT = Seconds(15);
 const size_t DEFAULT_MAX_SLAVE_PING_TIMEOUTS = 5;
+const size_t SLAVE_PING_SLOTS = 64;
 const Duration MIN_SLAVE_REREGISTER_TIMEOUT = Minutes(10);
 const double RECOVERY_SLAVE_REMOVAL_PERCENT_LIMIT = 1.0; // 100%.
 const size_t MAX_REMOVED_SLAVES = 100000;
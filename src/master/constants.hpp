@@ -70,6 +70,10 @@ extern const Duration DEFAULT_SLAVE_PING_TIMEOUT;
 // Maximum number of ping timeouts until slave is considered failed.
 extern const size_t DEFAULT_MAX_SLAVE_PING_TIMEOUTS;
 
+// Number of slots the slave ping timeout is divided into, over which
+// the pings of the slaves are spread.
+extern const size_t SLAVE_PING_SLOTS;
+
 // The minimum timeout that can be used by a newly elected leader to
 // allow re-registration of slaves. Any slaves that do not re-register
 // within this timeout will be shutdown.
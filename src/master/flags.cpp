@@ -103,6 +103,19 @@ mesos::internal::master::Flags::Flags()
       "after which the operation is considered a failure.",
       Seconds(5));
 
+  add(&Flags::registry_max_deltas,
+      "registry_max_deltas",
+      "Maximum number of deltas (i.e., the changes made by a batch of\n"
+      "operations) that are appended to the registry before the whole\n"
+      "registry is stored again. Appending deltas greatly reduces the\n"
+      "amount of data written for large registries. If set to 0, the\n"
+      "whole registry is stored after every batch of operations.\n"
+      "\n"
+      "NOTE: Masters that do not support deltas ignore those that have\n"
+      "not yet been compacted when recovering the registry, so this must\n"
+      "be set to 0 (and the registry updated) before downgrading.",
+      0);
+
   add(&Flags::log_auto_initialize,
       "log_auto_initialize",
       "Whether to automatically initialize the replicated log used for the\n"
@@ -110,6 +123,15 @@ mesos::internal::master::Flags::Flags()
       "initialized when used for the very first time.",
       true);
 
+  add(&Flags::log_group_commit_window,
+      "log_group_commit_window",
+      "If set, the replicated log used for the registry persists all of\n"
+      "the actions written within this window at once (i.e., with a\n"
+      "single sync), and only replies to the writes once that is done.\n"
+      "This increases the write throughput of the log at the cost of the\n"
+      "latency of every write. With a window of 0secs, the writes that are\n"
+      "already queued get persisted together without any added latency.");
+
   add(&Flags::slave_reregister_timeout,
       "slave_reregister_timeout",
       "The timeout within which all slaves are expected to re-register\n"
@@ -435,4 +457,16 @@ mesos::internal::master::Flags::Flags()
       "\n"
       "Currently there's no support for multiple authorizers.",
       DEFAULT_AUTHORIZER);
+
+  add(&Flags::state_snapshot_interval,
+      "state_snapshot_interval",
+      "Maximum age of the snapshot of the master's state that the\n"
+      "'/state', '/state-summary', '/slaves' and '/tasks' endpoints\n"
+      "are served from (e.g., 500ms, 1secs, etc). These endpoints are\n"
+      "rendered outside of the master, so a larger value reduces the\n"
+      "time the master spends taking snapshots for frequent requests,\n"
+      "at the cost of the responses being more stale. Tasks that have\n"
+      "not changed since the previous snapshot are shared with it\n"
+      "rather than copied again.",
+      Seconds(0));
 }
@@ -54,7 +54,9 @@ public:
   bool registry_strict;
   Duration registry_fetch_timeout;
   Duration registry_store_timeout;
+  size_t registry_max_deltas;
   bool log_auto_initialize;
+  Option<Duration> log_group_commit_window;
   Duration slave_reregister_timeout;
   std::string recovery_slave_removal_limit;
   Option<std::string> slave_removal_rate_limit;
@@ -80,6 +82,7 @@ public:
   Duration slave_ping_timeout;
   size_t max_slave_ping_timeouts;
   std::string authorizers;
+  Duration state_snapshot_interval;
 
 #ifdef WITH_NETWORK_ISOLATOR
   Option<size_t> max_executors_per_slave;
@@ -33,6 +33,7 @@
 
 #include <mesos/maintenance/maintenance.hpp>
 
+#include <process/async.hpp>
 #include <process/defer.hpp>
 #include <process/help.hpp>
 
@@ -43,6 +44,7 @@
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/json.hpp>
+#include <stout/jsonify.hpp>
 #include <stout/lambda.hpp>
 #include <stout/net.hpp>
 #include <stout/nothing.hpp>
@@ -106,7 +108,8 @@ namespace mesos {
 namespace internal {
 namespace master {
 
-// Pull in model overrides from common.
+// Pull in model and json overrides from common.
+using mesos::internal::json;
 using mesos::internal::model;
 
 // Pull in definitions from process.
@@ -133,7 +136,7 @@ JSON::Object model(const Offer& offer)
 
 // Returns a JSON object summarizing some important fields in a
 // Framework.
-JSON::Object summarize(const Framework& framework)
+JSON::Object summarize(const Snapshot::Framework& framework)
 {
   JSON::Object object;
   object.values["id"] = framework.id().value();
@@ -167,7 +170,7 @@ JSON::Object summarize(const Framework& framework)
 
 
 // Returns a JSON object modeled on a Framework.
-JSON::Object model(const Framework& framework)
+JSON::Object model(const Snapshot::Framework& framework)
 {
   JSON::Object object = summarize(framework);
 
@@ -202,7 +205,7 @@ JSON::Object model(const Framework& framework)
           model(task, framework.id(), TASK_STAGING, statuses));
     }
 
-    foreachvalue (Task* task, framework.tasks) {
+    foreach (const std::shared_ptr<const Task>& task, framework.tasks) {
       array.values.push_back(model(*task));
     }
 
@@ -214,7 +217,8 @@ JSON::Object model(const Framework& framework)
     JSON::Array array;
     array.values.reserve(framework.completedTasks.size()); // MESOS-2353.
 
-    foreach (const std::shared_ptr<Task>& task, framework.completedTasks) {
+    foreach (const std::shared_ptr<const Task>& task,
+             framework.completedTasks) {
       array.values.push_back(model(*task));
     }
 
@@ -226,8 +230,8 @@ JSON::Object model(const Framework& framework)
     JSON::Array array;
     array.values.reserve(framework.offers.size()); // MESOS-2353.
 
-    foreach (Offer* offer, framework.offers) {
-      array.values.push_back(model(*offer));
+    foreach (const Offer& offer, framework.offers) {
+      array.values.push_back(model(offer));
     }
 
     object.values["offers"] = std::move(array);
@@ -272,7 +276,7 @@ JSON::Object model(const Framework& framework)
 
 
 // Returns a JSON object summarizing some important fields in a Slave.
-JSON::Object summarize(const Slave& slave)
+JSON::Object summarize(const Snapshot::Slave& slave)
 {
   JSON::Object object;
   object.values["id"] = slave.id.value();
@@ -286,7 +290,7 @@ JSON::Object summarize(const Slave& slave)
 
   const Resources& totalResources = slave.totalResources;
   object.values["resources"] = model(totalResources);
-  object.values["used_resources"] = model(Resources::sum(slave.usedResources));
+  object.values["used_resources"] = model(slave.usedResources);
   object.values["offered_resources"] = model(slave.offeredResources);
   object.values["reserved_resources"] = model(totalResources.reserved());
   object.values["unreserved_resources"] = model(totalResources.unreserved());
@@ -300,12 +304,239 @@ JSON::Object summarize(const Slave& slave)
 // Returns a JSON object modeled after a Slave.
 // For now there are no additional fields being added to those
 // generated by 'summarize'.
-JSON::Object model(const Slave& slave)
+JSON::Object model(const Snapshot::Slave& slave)
 {
   return summarize(slave);
 }
 
 
+// Writes the JSON of an Offer, see 'model(const Offer&)'.
+void json(JSON::ObjectWriter* writer, const Offer& offer)
+{
+  writer->field("id", offer.id().value());
+  writer->field("framework_id", offer.framework_id().value());
+  writer->field("slave_id", offer.slave_id().value());
+  writer->field("resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, Resources(offer.resources()));
+  });
+}
+
+
+// Writes the JSON of a Framework, see 'model(const
+// Snapshot::Framework&)'. The 'flush' callback is invoked after each
+// task, since these make up the bulk of the output.
+void json(
+    JSON::ObjectWriter* writer,
+    const Snapshot::Framework& framework,
+    const lambda::function<void()>& flush)
+{
+  writer->field("id", framework.id().value());
+  writer->field("name", framework.info.name());
+
+  // Omit pid for http frameworks.
+  if (framework.pid.isSome()) {
+    writer->field("pid", string(framework.pid.get()));
+  }
+
+  writer->field("used_resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, framework.totalUsedResources);
+  });
+
+  writer->field("offered_resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, framework.totalOfferedResources);
+  });
+
+  writer->field("capabilities", [&](JSON::ArrayWriter* writer) {
+    foreach (const FrameworkInfo::Capability& capability,
+             framework.info.capabilities()) {
+      writer->element(
+          FrameworkInfo::Capability::Type_Name(capability.type()));
+    }
+  });
+
+  writer->field("hostname", framework.info.hostname());
+  writer->field("webui_url", framework.info.webui_url());
+  writer->field("user", framework.info.user());
+  writer->field("failover_timeout", framework.info.failover_timeout());
+  writer->field("checkpoint", framework.info.checkpoint());
+  writer->field("role", framework.info.role());
+  writer->field("registered_time", framework.registeredTime.secs());
+  writer->field("unregistered_time", framework.unregisteredTime.secs());
+  writer->field("active", framework.active);
+
+  writer->field("resources", [&](JSON::ObjectWriter* writer) {
+    json(
+        writer,
+        framework.totalUsedResources + framework.totalOfferedResources);
+  });
+
+  if (framework.registeredTime != framework.reregisteredTime) {
+    writer->field("reregistered_time", framework.reregisteredTime.secs());
+  }
+
+  writer->field("tasks", [&](JSON::ArrayWriter* writer) {
+    foreachvalue (const TaskInfo& task, framework.pendingTasks) {
+      vector<TaskStatus> statuses;
+      writer->element([&](JSON::ObjectWriter* writer) {
+        json(writer, task, framework.id(), TASK_STAGING, statuses);
+      });
+      flush();
+    }
+
+    foreach (const std::shared_ptr<const Task>& task, framework.tasks) {
+      writer->element([&](JSON::ObjectWriter* writer) {
+        json(writer, *task);
+      });
+      flush();
+    }
+  });
+
+  writer->field("completed_tasks", [&](JSON::ArrayWriter* writer) {
+    foreach (const std::shared_ptr<const Task>& task,
+             framework.completedTasks) {
+      writer->element([&](JSON::ObjectWriter* writer) {
+        json(writer, *task);
+      });
+      flush();
+    }
+  });
+
+  writer->field("offers", [&](JSON::ArrayWriter* writer) {
+    foreach (const Offer& offer, framework.offers) {
+      writer->element([&](JSON::ObjectWriter* writer) {
+        json(writer, offer);
+      });
+    }
+  });
+
+  writer->field("executors", [&](JSON::ArrayWriter* writer) {
+    foreachpair (const SlaveID& slaveId,
+                 const auto& executorsMap,
+                 framework.executors) {
+      foreachvalue (const ExecutorInfo& executor, executorsMap) {
+        writer->element([&](JSON::ObjectWriter* writer) {
+          json(writer, executor);
+          writer->field("slave_id", slaveId.value());
+        });
+      }
+    }
+  });
+
+  if (framework.info.has_labels()) {
+    writer->field("labels", [&](JSON::ArrayWriter* writer) {
+      json(writer, framework.info.labels());
+    });
+  }
+}
+
+
+// Writes the JSON of a Slave, see 'model(const Snapshot::Slave&)'.
+void json(JSON::ObjectWriter* writer, const Snapshot::Slave& slave)
+{
+  writer->field("id", slave.id.value());
+  writer->field("pid", string(slave.pid));
+  writer->field("hostname", slave.info.hostname());
+  writer->field("registered_time", slave.registeredTime.secs());
+
+  if (slave.reregisteredTime.isSome()) {
+    writer->field("reregistered_time", slave.reregisteredTime.get().secs());
+  }
+
+  const Resources& totalResources = slave.totalResources;
+
+  writer->field("resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, totalResources);
+  });
+
+  writer->field("used_resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, slave.usedResources);
+  });
+
+  writer->field("offered_resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, slave.offeredResources);
+  });
+
+  writer->field("reserved_resources", [&](JSON::ObjectWriter* writer) {
+    foreachpair (const string& role,
+                 const Resources& resources,
+                 totalResources.reserved()) {
+      writer->field(role, [&](JSON::ObjectWriter* writer) {
+        json(writer, resources);
+      });
+    }
+  });
+
+  writer->field("unreserved_resources", [&](JSON::ObjectWriter* writer) {
+    json(writer, totalResources.unreserved());
+  });
+
+  writer->field("attributes", model(slave.info.attributes()));
+  writer->field("active", slave.active);
+}
+
+
+// Streamed JSON responses are written to the pipe in chunks of at
+// least this size, so that the first chunks can be sent while the
+// rest of the response is still being serialized.
+static const size_t JSON_CHUNK_SIZE = 64 * 1024;
+
+
+// Returns an 'OK' response whose body is the JSON object written by
+// 'f' (as JSONP if requested). The object is written asynchronously,
+// i.e., outside of the master, so 'f' must only access immutable
+// state such as a 'Snapshot'. It is sent in chunks as it gets
+// serialized: 'f' is passed a function to call between the
+// (potentially many) parts of its output, which writes what has been
+// buffered so far once there is at least a chunk's worth of it.
+static OK streamed(
+    const Option<string>& jsonp,
+    const lambda::function<
+        void(JSON::ObjectWriter*, const lambda::function<void()>&)>& f)
+{
+  Pipe pipe;
+
+  process::async([=]() {
+    Pipe::Writer writer = pipe.writer();
+    string buffer;
+
+    lambda::function<void()> flush = [&]() {
+      if (buffer.size() >= JSON_CHUNK_SIZE) {
+        writer.write(buffer);
+        buffer.clear();
+      }
+    };
+
+    if (jsonp.isSome()) {
+      buffer.append(jsonp.get() + "(");
+    }
+
+    {
+      JSON::ObjectWriter object(&buffer);
+      f(&object, flush);
+    }
+
+    if (jsonp.isSome()) {
+      buffer.append(");");
+    }
+
+    writer.write(buffer);
+    writer.close();
+  });
+
+  OK ok;
+  ok.type = Response::PIPE;
+  ok.reader = pipe.reader();
+
+  if (jsonp.isSome()) {
+    ok.headers["Content-Type"] = "text/javascript";
+  } else {
+    ok.headers["Content-Type"] = "application/json";
+  }
+
+  return ok;
+}
+
+
 // Returns a JSON object modeled after a Role.
 JSON::Object model(const Role& role)
 {
@@ -766,21 +997,27 @@ const string Master::Http::SLAVES_HELP = HELP(
 
 Future<Response> Master::Http::slaves(const Request& request) const
 {
-  JSON::Object object;
+  const std::shared_ptr<const Snapshot> snapshot = master->snapshot();
+  const Option<string> jsonp = request.url.query.get("jsonp");
 
-  {
-    JSON::Array array;
-    array.values.reserve(master->slaves.registered.size()); // MESOS-2353.
+  // The response is rendered outside of the master, see 'Snapshot'.
+  return process::async([=]() -> Response {
+    JSON::Object object;
 
-    foreachvalue (const Slave* slave, master->slaves.registered) {
-      array.values.push_back(model(*slave));
-    }
+    {
+      JSON::Array array;
+      array.values.reserve(snapshot->slaves.size()); // MESOS-2353.
 
-    object.values["slaves"] = std::move(array);
-  }
+      foreach (const std::shared_ptr<const Snapshot::Slave>& slave,
+               snapshot->slaves) {
+        array.values.push_back(model(*slave));
+      }
 
+      object.values["slaves"] = std::move(array);
+    }
 
-  return OK(object, request.url.query.get("jsonp"));
+    return OK(object, jsonp);
+  });
 }
 
 
@@ -794,139 +1031,136 @@ const string Master::Http::STATE_HELP = HELP(
 
 Future<Response> Master::Http::state(const Request& request) const
 {
-  JSON::Object object;
-  object.values["version"] = MESOS_VERSION;
-
-  if (build::GIT_SHA.isSome()) {
-    object.values["git_sha"] = build::GIT_SHA.get();
-  }
+  const std::shared_ptr<const Snapshot> snapshot = master->snapshot();
 
-  if (build::GIT_BRANCH.isSome()) {
-    object.values["git_branch"] = build::GIT_BRANCH.get();
-  }
+  // The state is serialized straight into the response (rather than
+  // modeled as a JSON::Object first) since it can be very large.
+  auto serialize = [snapshot](
+      JSON::ObjectWriter* writer,
+      const lambda::function<void()>& flush) {
+    writer->field("version", MESOS_VERSION);
 
-  if (build::GIT_TAG.isSome()) {
-    object.values["git_tag"] = build::GIT_TAG.get();
-  }
-
-  object.values["build_date"] = build::DATE;
-  object.values["build_time"] = build::TIME;
-  object.values["build_user"] = build::USER;
-  object.values["start_time"] = master->startTime.secs();
-
-  if (master->electedTime.isSome()) {
-    object.values["elected_time"] = master->electedTime.get().secs();
-  }
+    if (build::GIT_SHA.isSome()) {
+      writer->field("git_sha", build::GIT_SHA.get());
+    }
 
-  object.values["id"] = master->info().id();
-  object.values["pid"] = string(master->self());
-  object.values["hostname"] = master->info().hostname();
-  object.values["activated_slaves"] = master->_slaves_active();
-  object.values["deactivated_slaves"] = master->_slaves_inactive();
+    if (build::GIT_BRANCH.isSome()) {
+      writer->field("git_branch", build::GIT_BRANCH.get());
+    }
 
-  if (master->flags.cluster.isSome()) {
-    object.values["cluster"] = master->flags.cluster.get();
-  }
+    if (build::GIT_TAG.isSome()) {
+      writer->field("git_tag", build::GIT_TAG.get());
+    }
 
-  if (master->leader.isSome()) {
-    object.values["leader"] = master->leader.get().pid();
-  }
+    writer->field("build_date", build::DATE);
+    writer->field("build_time", build::TIME);
+    writer->field("build_user", build::USER);
+    writer->field("start_time", snapshot->startTime.secs());
 
-  if (master->flags.log_dir.isSome()) {
-    object.values["log_dir"] = master->flags.log_dir.get();
-  }
+    if (snapshot->electedTime.isSome()) {
+      writer->field("elected_time", snapshot->electedTime.get().secs());
+    }
 
-  if (master->flags.external_log_file.isSome()) {
-    object.values["external_log_file"] = master->flags.external_log_file.get();
-  }
+    writer->field("id", snapshot->info.id());
+    writer->field("pid", string(snapshot->pid));
+    writer->field("hostname", snapshot->info.hostname());
 
-  {
-    JSON::Object flags;
-    foreachpair (const string& name, const flags::Flag& flag, master->flags) {
-      Option<string> value = flag.stringify(master->flags);
-      if (value.isSome()) {
-        flags.values[name] = value.get();
+    double activatedSlaves = 0.0;
+    foreach (const std::shared_ptr<const Snapshot::Slave>& slave,
+             snapshot->slaves) {
+      if (slave->active) {
+        activatedSlaves++;
       }
     }
-    object.values["flags"] = std::move(flags);
-  }
 
-  // Model all of the slaves.
-  {
-    JSON::Array array;
-    array.values.reserve(master->slaves.registered.size()); // MESOS-2353.
+    writer->field("activated_slaves", activatedSlaves);
+    writer->field(
+        "deactivated_slaves",
+        snapshot->slaves.size() - activatedSlaves);
 
-    foreachvalue (Slave* slave, master->slaves.registered) {
-      array.values.push_back(model(*slave));
+    if (snapshot->flags.cluster.isSome()) {
+      writer->field("cluster", snapshot->flags.cluster.get());
     }
 
-    object.values["slaves"] = std::move(array);
-  }
-
-  // Model all of the frameworks.
-  {
-    JSON::Array array;
-    array.values.reserve(master->frameworks.registered.size()); // MESOS-2353.
-
-    foreachvalue (Framework* framework, master->frameworks.registered) {
-      array.values.push_back(model(*framework));
+    if (snapshot->leader.isSome()) {
+      writer->field("leader", snapshot->leader.get().pid());
     }
 
-    object.values["frameworks"] = std::move(array);
-  }
-
-  // Model all of the completed frameworks.
-  {
-    JSON::Array array;
-    array.values.reserve(master->frameworks.completed.size()); // MESOS-2353.
-
-    foreach (const std::shared_ptr<Framework>& framework,
-             master->frameworks.completed) {
-      array.values.push_back(model(*framework));
+    if (snapshot->flags.log_dir.isSome()) {
+      writer->field("log_dir", snapshot->flags.log_dir.get());
     }
 
-    object.values["completed_frameworks"] = std::move(array);
-  }
-
-  // Model all of the orphan tasks.
-  {
-    JSON::Array array;
+    if (snapshot->flags.external_log_file.isSome()) {
+      writer->field(
+          "external_log_file",
+          snapshot->flags.external_log_file.get());
+    }
 
-    // Find those orphan tasks.
-    foreachvalue (const Slave* slave, master->slaves.registered) {
-      typedef hashmap<TaskID, Task*> TaskMap;
-      foreachvalue (const TaskMap& tasks, slave->tasks) {
-        foreachvalue (const Task* task, tasks) {
-          CHECK_NOTNULL(task);
-          if (!master->frameworks.registered.contains(task->framework_id())) {
-            array.values.push_back(model(*task));
-          }
+    writer->field("flags", [&](JSON::ObjectWriter* writer) {
+      foreachpair (const string& name,
+                   const flags::Flag& flag,
+                   snapshot->flags) {
+        Option<string> value = flag.stringify(snapshot->flags);
+        if (value.isSome()) {
+          writer->field(name, value.get());
         }
       }
-    }
+    });
 
-    object.values["orphan_tasks"] = std::move(array);
-  }
+    // Model all of the slaves.
+    writer->field("slaves", [&](JSON::ArrayWriter* writer) {
+      foreach (const std::shared_ptr<const Snapshot::Slave>& slave,
+               snapshot->slaves) {
+        writer->element([&](JSON::ObjectWriter* writer) {
+          json(writer, *slave);
+        });
+        flush();
+      }
+    });
 
-  // Model all currently unregistered frameworks.
-  // This could happen when the framework has yet to re-register
-  // after master failover.
-  {
-    JSON::Array array;
+    // Model all of the frameworks.
+    writer->field("frameworks", [&](JSON::ArrayWriter* writer) {
+      foreach (const std::shared_ptr<const Snapshot::Framework>& framework,
+               snapshot->frameworks) {
+        writer->element([&](JSON::ObjectWriter* writer) {
+          json(writer, *framework, flush);
+        });
+      }
+    });
 
-    // Find unregistered frameworks.
-    foreachvalue (const Slave* slave, master->slaves.registered) {
-      foreachkey (const FrameworkID& frameworkId, slave->tasks) {
-        if (!master->frameworks.registered.contains(frameworkId)) {
-          array.values.push_back(frameworkId.value());
-        }
+    // Model all of the completed frameworks.
+    writer->field("completed_frameworks", [&](JSON::ArrayWriter* writer) {
+      foreach (const std::shared_ptr<const Snapshot::Framework>& framework,
+               snapshot->completedFrameworks) {
+        writer->element([&](JSON::ObjectWriter* writer) {
+          json(writer, *framework, flush);
+        });
       }
-    }
+    });
 
-    object.values["unregistered_frameworks"] = std::move(array);
-  }
+    // Model all of the orphan tasks.
+    writer->field("orphan_tasks", [&](JSON::ArrayWriter* writer) {
+      foreach (const std::shared_ptr<const Task>& task,
+               snapshot->orphanTasks) {
+        writer->element([&](JSON::ObjectWriter* writer) {
+          json(writer, *task);
+        });
+        flush();
+      }
+    });
 
-  return OK(object, request.url.query.get("jsonp"));
+    // Model all currently unregistered frameworks.
+    // This could happen when the framework has yet to re-register
+    // after master failover.
+    writer->field("unregistered_frameworks", [&](JSON::ArrayWriter* writer) {
+      foreach (const FrameworkID& frameworkId,
+               snapshot->unregisteredFrameworks) {
+        writer->element(frameworkId.value());
+      }
+    });
+  };
+
+  return streamed(request.url.query.get("jsonp"), serialize);
 }
 
 
@@ -937,22 +1171,25 @@ Future<Response> Master::Http::state(const Request& request) const
 class SlaveFrameworkMapping
 {
 public:
-  SlaveFrameworkMapping(const hashmap<FrameworkID, Framework*>& frameworks)
+  SlaveFrameworkMapping(
+      const vector<std::shared_ptr<const Snapshot::Framework>>& frameworks)
   {
-    foreachpair (const FrameworkID& frameworkId,
-                 const Framework* framework,
-                 frameworks) {
+    foreach (const std::shared_ptr<const Snapshot::Framework>& framework,
+             frameworks) {
+      const FrameworkID frameworkId = framework->id();
+
       foreachvalue (const TaskInfo& taskInfo, framework->pendingTasks) {
         frameworksToSlaves[frameworkId].insert(taskInfo.slave_id());
         slavesToFrameworks[taskInfo.slave_id()].insert(frameworkId);
       }
 
-      foreachvalue (const Task* task, framework->tasks) {
+      foreach (const std::shared_ptr<const Task>& task, framework->tasks) {
         frameworksToSlaves[frameworkId].insert(task->slave_id());
         slavesToFrameworks[task->slave_id()].insert(frameworkId);
       }
 
-      foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
+      foreach (const std::shared_ptr<const Task>& task,
+               framework->completedTasks) {
         frameworksToSlaves[frameworkId].insert(task->slave_id());
         slavesToFrameworks[task->slave_id()].insert(frameworkId);
       }
@@ -1035,22 +1272,25 @@ const TaskStateSummary TaskStateSummary::EMPTY;
 class TaskStateSummaries
 {
 public:
-  TaskStateSummaries(const hashmap<FrameworkID, Framework*>& frameworks)
+  TaskStateSummaries(
+      const vector<std::shared_ptr<const Snapshot::Framework>>& frameworks)
   {
-    foreachpair (const FrameworkID& frameworkId,
-                 const Framework* framework,
-                 frameworks) {
+    foreach (const std::shared_ptr<const Snapshot::Framework>& framework,
+             frameworks) {
+      const FrameworkID frameworkId = framework->id();
+
       foreachvalue (const TaskInfo& taskInfo, framework->pendingTasks) {
         frameworkTaskSummaries[frameworkId].staging++;
         slaveTaskSummaries[taskInfo.slave_id()].staging++;
       }
 
-      foreachvalue (const Task* task, framework->tasks) {
+      foreach (const std::shared_ptr<const Task>& task, framework->tasks) {
         frameworkTaskSummaries[frameworkId].count(*task);
         slaveTaskSummaries[task->slave_id()].count(*task);
       }
 
-      foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
+      foreach (const std::shared_ptr<const Task>& task,
+               framework->completedTasks) {
         frameworkTaskSummaries[frameworkId].count(*task);
         slaveTaskSummaries[task->slave_id()].count(*task);
       }
@@ -1086,109 +1326,116 @@ const string Master::Http::STATESUMMARY_HELP = HELP(
 
 Future<Response> Master::Http::stateSummary(const Request& request) const
 {
-  JSON::Object object;
+  const std::shared_ptr<const Snapshot> snapshot = master->snapshot();
+  const Option<string> jsonp = request.url.query.get("jsonp");
 
-  object.values["hostname"] = master->info().hostname();
+  // The response is rendered outside of the master, see 'Snapshot'.
+  return process::async([=]() -> Response {
+    JSON::Object object;
 
-  if (master->flags.cluster.isSome()) {
-    object.values["cluster"] = master->flags.cluster.get();
-  }
+    object.values["hostname"] = snapshot->info.hostname();
 
-  // We use the tasks in the 'Frameworks' struct to compute summaries
-  // for this endpoint. This is done 1) for consistency between the
-  // 'slaves' and 'frameworks' subsections below 2) because we want to
-  // provide summary information for frameworks that are currently
-  // registered 3) the frameworks keep a circular buffer of completed
-  // tasks that we can use to keep a limited view on the history of
-  // recent completed / failed tasks.
+    if (snapshot->flags.cluster.isSome()) {
+      object.values["cluster"] = snapshot->flags.cluster.get();
+    }
 
-  // Generate mappings from 'slave' to 'framework' and reverse.
-  SlaveFrameworkMapping slaveFrameworkMapping(master->frameworks.registered);
+    // We use the tasks in the 'Frameworks' struct to compute summaries
+    // for this endpoint. This is done 1) for consistency between the
+    // 'slaves' and 'frameworks' subsections below 2) because we want to
+    // provide summary information for frameworks that are currently
+    // registered 3) the frameworks keep a circular buffer of completed
+    // tasks that we can use to keep a limited view on the history of
+    // recent completed / failed tasks.
 
-  // Generate 'TaskState' summaries for all framework and slave ids.
-  TaskStateSummaries taskStateSummaries(master->frameworks.registered);
+    // Generate mappings from 'slave' to 'framework' and reverse.
+    SlaveFrameworkMapping slaveFrameworkMapping(snapshot->frameworks);
 
-  // Model all of the slaves.
-  {
-    JSON::Array array;
-    array.values.reserve(master->slaves.registered.size()); // MESOS-2353.
+    // Generate 'TaskState' summaries for all framework and slave ids.
+    TaskStateSummaries taskStateSummaries(snapshot->frameworks);
 
-    foreachvalue (Slave* slave, master->slaves.registered) {
-      JSON::Object json = summarize(*slave);
+    // Model all of the slaves.
+    {
+      JSON::Array array;
+      array.values.reserve(snapshot->slaves.size()); // MESOS-2353.
 
-      // Add the 'TaskState' summary for this slave.
-      const TaskStateSummary& summary = taskStateSummaries.slave(slave->id);
+      foreach (const std::shared_ptr<const Snapshot::Slave>& slave,
+               snapshot->slaves) {
+        JSON::Object json = summarize(*slave);
 
-      json.values["TASK_STAGING"] = summary.staging;
-      json.values["TASK_STARTING"] = summary.starting;
-      json.values["TASK_RUNNING"] = summary.running;
-      json.values["TASK_FINISHED"] = summary.finished;
-      json.values["TASK_KILLED"] = summary.killed;
-      json.values["TASK_FAILED"] = summary.failed;
-      json.values["TASK_LOST"] = summary.lost;
-      json.values["TASK_ERROR"] = summary.error;
+        // Add the 'TaskState' summary for this slave.
+        const TaskStateSummary& summary = taskStateSummaries.slave(slave->id);
 
-      // Add the ids of all the frameworks running on this slave.
-      const hashset<FrameworkID>& frameworks =
-        slaveFrameworkMapping.frameworks(slave->id);
+        json.values["TASK_STAGING"] = summary.staging;
+        json.values["TASK_STARTING"] = summary.starting;
+        json.values["TASK_RUNNING"] = summary.running;
+        json.values["TASK_FINISHED"] = summary.finished;
+        json.values["TASK_KILLED"] = summary.killed;
+        json.values["TASK_FAILED"] = summary.failed;
+        json.values["TASK_LOST"] = summary.lost;
+        json.values["TASK_ERROR"] = summary.error;
 
-      JSON::Array frameworkIdArray;
-      frameworkIdArray.values.reserve(frameworks.size()); // MESOS-2353.
+        // Add the ids of all the frameworks running on this slave.
+        const hashset<FrameworkID>& frameworks =
+          slaveFrameworkMapping.frameworks(slave->id);
 
-      foreach (const FrameworkID& frameworkId, frameworks) {
-        frameworkIdArray.values.push_back(frameworkId.value());
-      }
+        JSON::Array frameworkIdArray;
+        frameworkIdArray.values.reserve(frameworks.size()); // MESOS-2353.
 
-      json.values["framework_ids"] = std::move(frameworkIdArray);
+        foreach (const FrameworkID& frameworkId, frameworks) {
+          frameworkIdArray.values.push_back(frameworkId.value());
+        }
+
+        json.values["framework_ids"] = std::move(frameworkIdArray);
 
-      array.values.push_back(std::move(json));
+        array.values.push_back(std::move(json));
+      }
+
+      object.values["slaves"] = std::move(array);
     }
 
-    object.values["slaves"] = std::move(array);
-  }
+    // Model all of the frameworks.
+    {
+      JSON::Array array;
+      array.values.reserve(snapshot->frameworks.size()); // MESOS-2353.
+
+      foreach (const std::shared_ptr<const Snapshot::Framework>& framework,
+               snapshot->frameworks) {
+        const FrameworkID frameworkId = framework->id();
+        JSON::Object json = summarize(*framework);
+
+        // Add the 'TaskState' summary for this framework.
+        const TaskStateSummary& summary =
+          taskStateSummaries.framework(frameworkId);
+        json.values["TASK_STAGING"] = summary.staging;
+        json.values["TASK_STARTING"] = summary.starting;
+        json.values["TASK_RUNNING"] = summary.running;
+        json.values["TASK_FINISHED"] = summary.finished;
+        json.values["TASK_KILLED"] = summary.killed;
+        json.values["TASK_FAILED"] = summary.failed;
+        json.values["TASK_LOST"] = summary.lost;
+        json.values["TASK_ERROR"] = summary.error;
+
+        // Add the ids of all the slaves running this framework.
+        const hashset<SlaveID>& slaves =
+          slaveFrameworkMapping.slaves(frameworkId);
+
+        JSON::Array slaveIdArray;
+        slaveIdArray.values.reserve(slaves.size()); // MESOS-2353.
+
+        foreach (const SlaveID& slaveId, slaves) {
+          slaveIdArray.values.push_back(slaveId.value());
+        }
 
-  // Model all of the frameworks.
-  {
-    JSON::Array array;
-    array.values.reserve(master->frameworks.registered.size()); // MESOS-2353.
-
-    foreachpair (const FrameworkID& frameworkId,
-                 Framework* framework,
-                 master->frameworks.registered) {
-      JSON::Object json = summarize(*framework);
-
-      // Add the 'TaskState' summary for this framework.
-      const TaskStateSummary& summary =
-        taskStateSummaries.framework(frameworkId);
-      json.values["TASK_STAGING"] = summary.staging;
-      json.values["TASK_STARTING"] = summary.starting;
-      json.values["TASK_RUNNING"] = summary.running;
-      json.values["TASK_FINISHED"] = summary.finished;
-      json.values["TASK_KILLED"] = summary.killed;
-      json.values["TASK_FAILED"] = summary.failed;
-      json.values["TASK_LOST"] = summary.lost;
-      json.values["TASK_ERROR"] = summary.error;
-
-      // Add the ids of all the slaves running this framework.
-      const hashset<SlaveID>& slaves =
-        slaveFrameworkMapping.slaves(frameworkId);
-
-      JSON::Array slaveIdArray;
-      slaveIdArray.values.reserve(slaves.size()); // MESOS-2353.
-
-      foreach (const SlaveID& slaveId, slaves) {
-        slaveIdArray.values.push_back(slaveId.value());
-      }
+        json.values["slave_ids"] = std::move(slaveIdArray);
 
-      json.values["slave_ids"] = std::move(slaveIdArray);
+        array.values.push_back(std::move(json));
+      }
 
-      array.values.push_back(std::move(json));
+      object.values["frameworks"] = std::move(array);
     }
 
-    object.values["frameworks"] = std::move(array);
-  }
-
-  return OK(object, request.url.query.get("jsonp"));
+    return OK(object, jsonp);
+  });
 }
 
 
@@ -1385,51 +1632,58 @@ Future<Response> Master::Http::tasks(const Request& request) const
   // TODO(nnielsen): Currently, formatting errors in offset and/or limit
   // will silently be ignored. This could be reported to the user instead.
 
-  // Construct framework list with both active and completed framwworks.
-  vector<const Framework*> frameworks;
-  foreachvalue (Framework* framework, master->frameworks.registered) {
-    frameworks.push_back(framework);
-  }
-  foreach (const std::shared_ptr<Framework>& framework,
-           master->frameworks.completed) {
-    frameworks.push_back(framework.get());
-  }
+  Option<string> order = request.url.query.get("order");
+
+  const std::shared_ptr<const Snapshot> snapshot = master->snapshot();
 
-  // Construct task list with both running and finished tasks.
-  vector<const Task*> tasks;
-  foreach (const Framework* framework, frameworks) {
-    foreachvalue (Task* task, framework->tasks) {
-      CHECK_NOTNULL(task);
-      tasks.push_back(task);
+  auto serialize = [=](
+      JSON::ObjectWriter* writer,
+      const lambda::function<void()>& flush) {
+    // Construct framework list with both active and completed framwworks.
+    vector<const Snapshot::Framework*> frameworks;
+    foreach (const std::shared_ptr<const Snapshot::Framework>& framework,
+             snapshot->frameworks) {
+      frameworks.push_back(framework.get());
     }
-    foreach (const std::shared_ptr<Task>& task, framework->completedTasks) {
-      tasks.push_back(task.get());
+    foreach (const std::shared_ptr<const Snapshot::Framework>& framework,
+             snapshot->completedFrameworks) {
+      frameworks.push_back(framework.get());
     }
-  }
 
-  // Sort tasks by task status timestamp. Default order is descending.
-  // The earliest timestamp is chosen for comparison when multiple are present.
-  Option<string> order = request.url.query.get("order");
-  if (order.isSome() && (order.get() == "asc")) {
-    sort(tasks.begin(), tasks.end(), TaskComparator::ascending);
-  } else {
-    sort(tasks.begin(), tasks.end(), TaskComparator::descending);
-  }
-
-  JSON::Object object;
+    // Construct task list with both running and finished tasks.
+    vector<const Task*> tasks;
+    foreach (const Snapshot::Framework* framework, frameworks) {
+      foreach (const std::shared_ptr<const Task>& task, framework->tasks) {
+        tasks.push_back(task.get());
+      }
+      foreach (const std::shared_ptr<const Task>& task,
+               framework->completedTasks) {
+        tasks.push_back(task.get());
+      }
+    }
 
-  {
-    JSON::Array array;
-    size_t end = std::min(offset + limit, tasks.size());
-    for (size_t i = offset; i < end; i++) {
-      const Task* task = tasks[i];
-      array.values.push_back(model(*task));
+    // Sort tasks by task status timestamp. Default order is descending.
+    // The earliest timestamp is chosen for comparison when multiple are
+    // present.
+    if (order.isSome() && (order.get() == "asc")) {
+      sort(tasks.begin(), tasks.end(), TaskComparator::ascending);
+    } else {
+      sort(tasks.begin(), tasks.end(), TaskComparator::descending);
     }
 
-    object.values["tasks"] = std::move(array);
-  }
+    writer->field("tasks", [&](JSON::ArrayWriter* writer) {
+      size_t end = std::min(offset + limit, tasks.size());
+      for (size_t i = offset; i < end; i++) {
+        const Task* task = tasks[i];
+        writer->element([&](JSON::ObjectWriter* writer) {
+          json(writer, *task);
+        });
+        flush();
+      }
+    });
+  };
 
-  return OK(object, request.url.query.get("jsonp"));
+  return streamed(request.url.query.get("jsonp"), serialize);
 }
 
 
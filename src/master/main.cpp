@@ -300,14 +300,16 @@ int main(int argc, char** argv)
           flags.zk_session_timeout,
           path::join(url.get().path, "log_replicas"),
           url.get().authentication,
-          flags.log_auto_initialize);
+          flags.log_auto_initialize,
+          flags.log_group_commit_window);
     } else {
       // Use replicated log without ZooKeeper.
       log = new Log(
           1,
           path::join(flags.work_dir.get(), "replicated_log"),
           set<UPID>(),
-          flags.log_auto_initialize);
+          flags.log_auto_initialize,
+          flags.log_group_commit_window);
     }
     storage = new state::LogStorage(log);
   } else {
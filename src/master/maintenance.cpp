@@ -47,7 +47,7 @@ UpdateSchedule::UpdateSchedule(
 
 Try<bool> UpdateSchedule::perform(
     Registry* registry,
-    hashset<SlaveID>* slaveIDs,
+    hashmap<SlaveID, int>* slaveIDs,
     bool strict)
 {
   // Put the machines in the existing schedule into a set.
@@ -126,7 +126,7 @@ StartMaintenance::StartMaintenance(
 
 Try<bool> StartMaintenance::perform(
     Registry* registry,
-    hashset<SlaveID>* slaveIDs,
+    hashmap<SlaveID, int>* slaveIDs,
     bool strict)
 {
   // Flip the mode of all targeted machines.
@@ -156,7 +156,7 @@ StopMaintenance::StopMaintenance(
 
 Try<bool> StopMaintenance::perform(
     Registry* registry,
-    hashset<SlaveID>* slaveIDs,
+    hashmap<SlaveID, int>* slaveIDs,
     bool strict)
 {
   // Delete the machine info entry of all targeted machines.
@@ -23,6 +23,7 @@
 
 #include <mesos/maintenance/maintenance.hpp>
 
+#include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/nothing.hpp>
 #include <stout/try.hpp>
@@ -58,7 +59,7 @@ public:
 protected:
   Try<bool> perform(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict);
 
 private:
@@ -82,7 +83,7 @@ public:
 protected:
   Try<bool> perform(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict);
 
 private:
@@ -105,7 +106,7 @@ public:
 protected:
   Try<bool> perform(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict);
 
 private:
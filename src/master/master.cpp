@@ -119,29 +119,33 @@ using mesos::master::RoleInfo;
 using mesos::master::allocator::Allocator;
 
 
+// Checks the health of all registered slaves by pinging each of them
+// every 'slavePingTimeout', and shuts down the slaves that have not
+// responded to the last 'maxSlavePingTimeouts' pings.
+//
+// Rather than using a timer per slave, the ping interval is divided
+// into SLAVE_PING_SLOTS slots which the observer goes through in turn.
+// When a slot is due, the timeouts of all of its slaves are evaluated
+// and they get pinged again. A new slave is pinged right away and put
+// in the least loaded slot, so that the pings (e.g., of the slaves
+// re-registering after a master failover) are spread evenly across
+// the interval.
 class SlaveObserver : public ProtobufProcess<SlaveObserver>
 {
 public:
-  SlaveObserver(const UPID& _slave,
-                const SlaveInfo& _slaveInfo,
-                const SlaveID& _slaveId,
-                const PID<Master>& _master,
+  SlaveObserver(const PID<Master>& _master,
                 const Option<shared_ptr<RateLimiter>>& _limiter,
                 const shared_ptr<Metrics> _metrics,
                 const Duration& _slavePingTimeout,
                 const size_t _maxSlavePingTimeouts)
     : ProcessBase(process::ID::generate("slave-observer")),
-      slave(_slave),
-      slaveInfo(_slaveInfo),
-      slaveId(_slaveId),
       master(_master),
       limiter(_limiter),
       metrics(_metrics),
-      slavePingTimeout(_slavePingTimeout),
       maxSlavePingTimeouts(_maxSlavePingTimeouts),
-      timeouts(0),
-      pinged(false),
-      connected(true)
+      interval(_slavePingTimeout / SLAVE_PING_SLOTS),
+      slots(SLAVE_PING_SLOTS),
+      cursor(0)
   {
     // TODO(Wang Yong Qiao): For backwards compatibility, this handler is kept.
     // Suggest to remove this handler in 0.26.0.
@@ -150,73 +154,217 @@ public:
     install<PongSlaveMessage>(&SlaveObserver::pong);
   }
 
-  void reconnect()
+  void add(const SlaveID& slaveId, const UPID& pid)
   {
-    connected = true;
+    CHECK(!slaves.contains(slaveId));
+
+    if (slaves.empty()) {
+      // Nothing is due, so line up the slots with the current time.
+      cursor = 0;
+      due = Clock::now() + interval;
+    } else {
+      advance();
+    }
+
+    // Prefer the slot that was due last, which is due again a full
+    // interval from now, so that the first ping of the slave does not
+    // get evaluated early.
+    size_t previous = (cursor + slots.size() - 1) % slots.size();
+
+    size_t slot = previous;
+    for (size_t i = 1; i < slots.size(); i++) {
+      size_t candidate = (previous + i) % slots.size();
+      if (slots[candidate].size() < slots[slot].size()) {
+        slot = candidate;
+      }
+    }
+
+    Health& health = slaves[slaveId];
+    health.pid = pid;
+    health.slot = slot;
+
+    // A slave in any other slot gets skipped the first time its slot
+    // is due, since that happens less than an interval from now.
+    health.fresh = slot != previous;
+
+    pids[pid] = slaveId;
+    slots[slot].insert(slaveId);
+
+    ping(health);
+
+    schedule();
+  }
+
+  void remove(const SlaveID& slaveId)
+  {
+    if (!slaves.contains(slaveId)) {
+      return;
+    }
+
+    const Health& health = slaves[slaveId];
+
+    slots[health.slot].erase(slaveId);
+
+    if (pids.get(health.pid) == slaveId) {
+      pids.erase(health.pid);
+    }
+
+    // NOTE: A pending shutdown is not canceled, same as for a slave
+    // that gets removed for any other reason while it is pending.
+    slaves.erase(slaveId);
+
+    schedule();
   }
 
-  void disconnect()
+  void reconnect(const SlaveID& slaveId)
   {
-    connected = false;
+    if (slaves.contains(slaveId)) {
+      slaves[slaveId].connected = true;
+    }
   }
 
-protected:
-  virtual void initialize()
+  void disconnect(const SlaveID& slaveId)
   {
-    ping();
+    if (slaves.contains(slaveId)) {
+      slaves[slaveId].connected = false;
+    }
   }
 
-  void ping()
+protected:
+  // The health of a slave, which lives in slot 'slot'.
+  struct Health
   {
-    PingSlaveMessage message;
-    message.set_connected(connected);
-    send(slave, message);
+    Health()
+      : slot(0),
+        timeouts(0),
+        pinged(false),
+        connected(true),
+        fresh(false) {}
+
+    UPID pid;
+    size_t slot;
+    uint32_t timeouts;
+    bool pinged;
+    bool connected;
+    bool fresh;
+    Option<Future<Nothing>> shuttingDown;
+  };
+
+  void tick()
+  {
+    timer = None();
 
-    pinged = true;
-    delay(slavePingTimeout, self(), &SlaveObserver::timeout);
+    advance();
+    schedule();
   }
 
-  void pongOld(const UPID& from, const string& body)
+  // Goes through the slots that are due.
+  void advance()
   {
-    pong();
+    const Time now = Clock::now();
+
+    while (due <= now) {
+      foreach (const SlaveID& slaveId, slots[cursor]) {
+        Health& health = slaves[slaveId];
+
+        if (health.fresh) {
+          health.fresh = false;
+          continue;
+        }
+
+        check(slaveId, &health);
+      }
+
+      cursor = (cursor + 1) % slots.size();
+      due += interval;
+    }
   }
 
-  void pong()
+  // Sets the timer for when the next non-empty slot is due.
+  void schedule()
   {
-    timeouts = 0;
-    pinged = false;
+    Option<Time> next = None();
 
-    // Cancel any pending shutdown.
-    if (shuttingDown.isSome()) {
-      // Need a copy for non-const access.
-      Future<Nothing> future = shuttingDown.get();
-      future.discard();
+    if (!slaves.empty()) {
+      for (size_t i = 0; i < slots.size(); i++) {
+        if (!slots[(cursor + i) % slots.size()].empty()) {
+          next = due + interval * i;
+          break;
+        }
+      }
+    }
+
+    if (timer.isSome()) {
+      if (next.isSome() && timer.get().timeout().time() == next.get()) {
+        return;
+      }
+
+      Clock::cancel(timer.get());
+      timer = None();
+    }
+
+    if (next.isSome()) {
+      timer = delay(next.get() - Clock::now(), self(), &SlaveObserver::tick);
     }
   }
 
-  void timeout()
+  void check(const SlaveID& slaveId, Health* health)
   {
-    if (pinged) {
-      timeouts++; // No pong has been received before the timeout.
-      if (timeouts >= maxSlavePingTimeouts) {
+    if (health->pinged) {
+      health->timeouts++; // No pong has been received before the timeout.
+      if (health->timeouts >= maxSlavePingTimeouts) {
         // No pong has been received for the last
         // 'maxSlavePingTimeouts' pings.
-        shutdown();
+        shutdown(slaveId, health);
       }
     }
 
     // NOTE: We keep pinging even if we schedule a shutdown. This is
     // because if the slave eventually responds to a ping, we can
     // cancel the shutdown.
-    ping();
+    ping(*health);
+  }
+
+  void ping(Health& health)
+  {
+    PingSlaveMessage message;
+    message.set_connected(health.connected);
+    send(health.pid, message);
+
+    health.pinged = true;
+  }
+
+  void pongOld(const UPID& from, const string& body)
+  {
+    pong(from);
+  }
+
+  void pong(const UPID& from)
+  {
+    Option<SlaveID> slaveId = pids.get(from);
+    if (slaveId.isNone()) {
+      return;
+    }
+
+    Health& health = slaves[slaveId.get()];
+
+    health.timeouts = 0;
+    health.pinged = false;
+
+    // Cancel any pending shutdown.
+    if (health.shuttingDown.isSome()) {
+      // Need a copy for non-const access.
+      Future<Nothing> future = health.shuttingDown.get();
+      future.discard();
+    }
   }
 
   // NOTE: The shutdown of the slave is rate limited and can be
   // canceled if a pong was received before the actual shutdown is
   // called.
-  void shutdown()
+  void shutdown(const SlaveID& slaveId, Health* health)
   {
-    if (shuttingDown.isSome()) {
+    if (health->shuttingDown.isSome()) {
       return;  // Shutdown is already in progress.
     }
 
@@ -229,15 +377,25 @@ protected:
       acquire = limiter.get()->acquire();
     }
 
-    shuttingDown = acquire.onAny(defer(self(), &Self::_shutdown));
+    health->shuttingDown = acquire.onAny(
+        defer(self(), &Self::_shutdown, slaveId, lambda::_1));
+
     ++metrics->slave_shutdowns_scheduled;
   }
 
-  void _shutdown()
+  void _shutdown(const SlaveID& slaveId, const Future<Nothing>& future)
   {
-    CHECK_SOME(shuttingDown);
+    if (!slaves.contains(slaveId)) {
+      return; // The slave has been removed in the meantime.
+    }
+
+    Health& health = slaves[slaveId];
 
-    const Future<Nothing>& future = shuttingDown.get();
+    // The slave might have been removed and added again in the
+    // meantime, in which case this shutdown is stale.
+    if (health.shuttingDown.isNone() || health.shuttingDown.get() != future) {
+      return;
+    }
 
     CHECK(!future.isFailed());
 
@@ -258,22 +416,30 @@ protected:
       ++metrics->slave_shutdowns_canceled;
     }
 
-    shuttingDown = None();
+    health.shuttingDown = None();
   }
 
 private:
-  const UPID slave;
-  const SlaveInfo slaveInfo;
-  const SlaveID slaveId;
   const PID<Master> master;
   const Option<shared_ptr<RateLimiter>> limiter;
   shared_ptr<Metrics> metrics;
-  Option<Future<Nothing>> shuttingDown;
-  const Duration slavePingTimeout;
   const size_t maxSlavePingTimeouts;
-  uint32_t timeouts;
-  bool pinged;
-  bool connected;
+
+  // The time between two consecutive slots being due.
+  const Duration interval;
+
+  hashmap<SlaveID, Health> slaves;
+
+  // Used to look up the slave that sent a pong.
+  hashmap<UPID, SlaveID> pids;
+
+  vector<hashset<SlaveID>> slots;
+
+  // The next slot to go through and when it is due.
+  size_t cursor;
+  Time due;
+
+  Option<Timer> timer;
 };
 
 
@@ -633,6 +799,14 @@ void Master::initialize()
       });
   spawn(whitelistWatcher);
 
+  slaveObserver = new SlaveObserver(
+      self(),
+      slaves.limiter,
+      metrics,
+      flags.slave_ping_timeout,
+      flags.max_slave_ping_timeouts);
+  spawn(slaveObserver);
+
   nextFrameworkId = 0;
   nextSlaveId = 0;
   nextOfferId = 0;
@@ -958,11 +1132,6 @@ void Master::finalize()
       removeInverseOffer(inverseOffer);
     }
 
-    // Terminate the slave observer.
-    terminate(slave->observer);
-    wait(slave->observer);
-
-    delete slave->observer;
     delete slave;
   }
   slaves.registered.clear();
@@ -1023,6 +1192,10 @@ void Master::finalize()
   wait(whitelistWatcher);
   delete whitelistWatcher;
 
+  terminate(slaveObserver);
+  wait(slaveObserver);
+  delete slaveObserver;
+
   if (authenticator.isSome()) {
     delete authenticator.get();
   }
@@ -2536,7 +2709,7 @@ void Master::disconnect(Slave* slave)
   slave->connected = false;
 
   // Inform the slave observer.
-  dispatch(slave->observer, &SlaveObserver::disconnect);
+  dispatch(slaveObserver, &SlaveObserver::disconnect, slave->id);
 
   // Remove the slave from authenticated. This is safe because
   // a slave will always reauthenticate before (re-)registering.
@@ -4062,7 +4235,7 @@ void Master::reregisterSlave(
     // slave.
     if (!slave->connected) {
       slave->connected = true;
-      dispatch(slave->observer, &SlaveObserver::reconnect);
+      dispatch(slaveObserver, &SlaveObserver::reconnect, slave->id);
       slave->active = true;
       allocator->activateSlave(slave->id);
     }
@@ -5763,18 +5936,8 @@ void Master::addSlave(
   CHECK(!machines[slave->machineId].slaves.contains(slave->id));
   machines[slave->machineId].slaves.insert(slave->id);
 
-  // Set up an observer for the slave.
-  slave->observer = new SlaveObserver(
-      slave->pid,
-      slave->info,
-      slave->id,
-      self(),
-      slaves.limiter,
-      metrics,
-      flags.slave_ping_timeout,
-      flags.max_slave_ping_timeouts);
-
-  spawn(slave->observer);
+  // Start observing the health of the slave.
+  dispatch(slaveObserver, &SlaveObserver::add, slave->id, slave->pid);
 
   // Add the slave's executors to the frameworks.
   foreachkey (const FrameworkID& frameworkId, slave->executors) {
@@ -5930,10 +6093,8 @@ void Master::removeSlave(
   CHECK(machines[slave->machineId].slaves.contains(slave->id));
   machines[slave->machineId].slaves.erase(slave->id);
 
-  // Kill the slave observer.
-  terminate(slave->observer);
-  wait(slave->observer);
-  delete slave->observer;
+  // Stop observing the health of the slave.
+  dispatch(slaveObserver, &SlaveObserver::remove, slave->id);
 
   // TODO(benh): unlink(slave->pid);
 
@@ -5995,14 +6156,18 @@ void Master::_removeSlave(
     }
   }
 
-  // Notify all frameworks of the lost slave.
+  // Notify all frameworks of the lost slave. The message is the same
+  // for all of them, hence it only gets encoded once.
+  LostSlaveMessage lostSlaveMessage;
+  lostSlaveMessage.mutable_slave_id()->MergeFrom(slaveInfo.id());
+
+  Broadcast<LostSlaveMessage> broadcast(lostSlaveMessage);
+
   foreachvalue (Framework* framework, frameworks.registered) {
     LOG(INFO) << "Notifying framework " << *framework << " of lost slave "
               << slaveInfo.id() << " (" << slaveInfo.hostname() << ") "
               << "after recovering";
-    LostSlaveMessage message;
-    message.mutable_slave_id()->MergeFrom(slaveInfo.id());
-    framework->send(message);
+    framework->send(broadcast);
   }
 
   // Finally, notify the `SlaveLost` hooks.
@@ -6037,6 +6202,10 @@ void Master::updateTask(Task* task, const StatusUpdate& update)
     latestState = update.latest_state();
   }
 
+  // The task is about to change, so the copy of it that is shared
+  // between snapshots (if any) is stale.
+  taskCopies.erase(task);
+
   // Set 'terminated' to true if this is the first time the task
   // transitioned to terminal state. Also set the latest state.
   bool terminated;
@@ -6161,6 +6330,8 @@ void Master::removeTask(Task* task)
   // Remove from slave.
   slave->removeTask(task);
 
+  taskCopies.erase(task);
+
   delete task;
 }
 
@@ -6393,6 +6564,102 @@ SlaveID Master::newSlaveId()
 }
 
 
+shared_ptr<const Snapshot> Master::snapshot()
+{
+  if (lastSnapshot.get() != NULL &&
+      Clock::now() - lastSnapshot->time < flags.state_snapshot_interval) {
+    return lastSnapshot;
+  }
+
+  shared_ptr<Snapshot> snapshot(new Snapshot());
+  snapshot->version =
+    lastSnapshot.get() != NULL ? lastSnapshot->version + 1 : 0;
+  snapshot->time = Clock::now();
+  snapshot->flags = flags;
+  snapshot->info = info_;
+  snapshot->pid = self();
+  snapshot->leader = leader;
+  snapshot->startTime = startTime;
+  snapshot->electedTime = electedTime;
+
+  // Only tasks that changed since they were last copied are copied
+  // again, the rest are shared with the previous snapshots.
+  auto copy = [this](const Task* task) -> shared_ptr<const Task> {
+    CHECK_NOTNULL(task);
+
+    if (!taskCopies.contains(task)) {
+      taskCopies[task] = shared_ptr<const Task>(new Task(*task));
+    }
+
+    return taskCopies[task];
+  };
+
+  snapshot->slaves.reserve(slaves.registered.size());
+  foreachvalue (const Slave* slave, slaves.registered) {
+    snapshot->slaves.push_back(
+        shared_ptr<const Snapshot::Slave>(new Snapshot::Slave(*slave)));
+
+    foreachpair (const FrameworkID& frameworkId,
+                 const auto& tasks,
+                 slave->tasks) {
+      if (frameworks.registered.contains(frameworkId)) {
+        continue;
+      }
+
+      foreachvalue (const Task* task, tasks) {
+        snapshot->orphanTasks.push_back(copy(task));
+      }
+
+      snapshot->unregisteredFrameworks.push_back(frameworkId);
+    }
+  }
+
+  snapshot->frameworks.reserve(frameworks.registered.size());
+  foreachvalue (const Framework* framework, frameworks.registered) {
+    vector<shared_ptr<const Task>> tasks;
+    tasks.reserve(framework->tasks.size());
+    foreachvalue (const Task* task, framework->tasks) {
+      tasks.push_back(copy(task));
+    }
+
+    snapshot->frameworks.push_back(
+        shared_ptr<const Snapshot::Framework>(
+            new Snapshot::Framework(*framework, tasks)));
+  }
+
+  // Completed frameworks never change, so reuse those that were
+  // already in the last snapshot.
+  hashmap<FrameworkID, shared_ptr<const Snapshot::Framework>> completed;
+  if (lastSnapshot.get() != NULL) {
+    foreach (const shared_ptr<const Snapshot::Framework>& framework,
+             lastSnapshot->completedFrameworks) {
+      completed[framework->id()] = framework;
+    }
+  }
+
+  snapshot->completedFrameworks.reserve(frameworks.completed.size());
+  foreach (const shared_ptr<Framework>& framework, frameworks.completed) {
+    Option<shared_ptr<const Snapshot::Framework>> completedFramework =
+      completed.get(framework->id());
+
+    if (completedFramework.isNone()) {
+      // A completed framework has no tasks left, see
+      // 'removeFramework()'.
+      completedFramework = shared_ptr<const Snapshot::Framework>(
+          new Snapshot::Framework(
+              *framework,
+              vector<shared_ptr<const Task>>()));
+    }
+
+    snapshot->completedFrameworks.push_back(completedFramework.get());
+  }
+
+  lastSnapshot = snapshot;
+
+  return lastSnapshot;
+}
+
+
 double Master::_slaves_active()
 {
   double count = 0.0;
@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include <list>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -104,6 +105,7 @@ struct BoundedRateLimiter;
 struct Framework;
 struct HttpConnection;
 struct Role;
+struct Snapshot;
 
 
 struct Slave
@@ -126,8 +128,7 @@ struct Slave
       registeredTime(_registeredTime),
       connected(true),
       active(true),
-      checkpointedResources(_checkpointedResources),
-      observer(NULL)
+      checkpointedResources(_checkpointedResources)
   {
     CHECK(_info.has_id());
 
@@ -353,8 +354,6 @@ struct Slave
   // includes revocable resources as well.
   Resources totalResources;
 
-  SlaveObserver* observer;
-
 private:
   Slave(const Slave&);              // No copying.
   Slave& operator=(const Slave&); // No assigning.
@@ -748,6 +747,11 @@ protected:
   OfferID newOfferId();
   SlaveID newSlaveId();
 
+  // Returns a snapshot of the state of the master that is at most
+  // 'flags.state_snapshot_interval' old, taking (and publishing) a
+  // new one if the last one is older than that.
+  std::shared_ptr<const Snapshot> snapshot();
+
   Option<Credentials> credentials;
 
 private:
@@ -986,6 +990,7 @@ private:
 
   mesos::master::allocator::Allocator* allocator;
   WhitelistWatcher* whitelistWatcher;
+  SlaveObserver* slaveObserver;
   Registrar* registrar;
   Repairer* repairer;
   Files* files;
@@ -1164,6 +1169,15 @@ private:
   hashmap<OfferID, Offer*> offers;
   hashmap<OfferID, process::Timer> offerTimers;
 
+  // The last published snapshot, see 'snapshot()'.
+  std::shared_ptr<const Snapshot> lastSnapshot;
+
+  // Copies of live tasks taken for a snapshot. A copy is shared by
+  // every subsequent snapshot until the task is updated or removed
+  // (see 'updateTask()' and 'removeTask()'), so that unchanged tasks
+  // are not copied again for every snapshot.
+  hashmap<const Task*, std::shared_ptr<const Task>> taskCopies;
+
   hashmap<OfferID, InverseOffer*> inverseOffers;
   hashmap<OfferID, process::Timer> inverseOfferTimers;
 
@@ -1272,7 +1286,7 @@ public:
 protected:
   virtual Try<bool> perform(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict)
   {
     // Check and see if this slave already exists.
@@ -1284,9 +1298,9 @@ protected:
       }
     }
 
+    (*slaveIDs)[info.id()] = registry->slaves().slaves().size();
     Registry::Slave* slave = registry->mutable_slaves()->add_slaves();
     slave->mutable_info()->CopyFrom(info);
-    slaveIDs->insert(info.id());
     return true; // Mutation.
   }
 
@@ -1307,7 +1321,7 @@ public:
 protected:
   virtual Try<bool> perform(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict)
   {
     if (slaveIDs->contains(info.id())) {
@@ -1317,9 +1331,9 @@ protected:
     if (strict) {
       return Error("Slave not yet admitted");
     } else {
+      (*slaveIDs)[info.id()] = registry->slaves().slaves().size();
       Registry::Slave* slave = registry->mutable_slaves()->add_slaves();
       slave->mutable_info()->CopyFrom(info);
-      slaveIDs->insert(info.id());
       return true; // Mutation.
     }
   }
@@ -1341,16 +1355,18 @@ public:
 protected:
   virtual Try<bool> perform(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict)
   {
-    for (int i = 0; i < registry->slaves().slaves().size(); i++) {
-      const Registry::Slave& slave = registry->slaves().slaves(i);
-      if (slave.info().id() == info.id()) {
-        registry->mutable_slaves()->mutable_slaves()->DeleteSubrange(i, 1);
-        slaveIDs->erase(info.id());
-        return true; // Mutation.
-      }
+    Option<int> index = slaveIDs->get(info.id());
+
+    if (index.isSome()) {
+      // The slave is only cleared here, the registrar drops it (along
+      // with all the other slaves removed in the same batch) once the
+      // batch has been applied, see Operation.
+      registry->mutable_slaves()->mutable_slaves(index.get())->Clear();
+      slaveIDs->erase(info.id());
+      return true; // Mutation.
     }
 
     if (strict) {
@@ -1370,6 +1386,54 @@ inline std::ostream& operator<<(
     const Framework& framework);
 
 
+// A message that gets broadcast to many frameworks. Rather than being
+// encoded for each framework, the message gets encoded at most once
+// for each way the frameworks receive it: serialized for the
+// frameworks with a pid, and evolved into an event record for each
+// content type of the HTTP frameworks.
+// NOTE: The encodings are cached, hence a broadcast must only be used
+// by a single process (i.e., the master).
+template <typename Message>
+class Broadcast
+{
+public:
+  explicit Broadcast(const Message& _message) : message(_message) {}
+
+  // Returns the serialized message, for the frameworks with a pid.
+  const process::Serialized& serialized()
+  {
+    if (serialized_.isNone()) {
+      serialized_ = process::Serialized(message);
+    }
+
+    return serialized_.get();
+  }
+
+  // Returns the message evolved into a 'v1::scheduler::Event' and
+  // encoded as a record for the given content type.
+  const std::string& record(ContentType contentType)
+  {
+    std::map<ContentType, std::string>::iterator it =
+      records.find(contentType);
+
+    if (it == records.end()) {
+      ::recordio::Encoder<v1::scheduler::Event> encoder(
+          lambda::bind(serialize, contentType, lambda::_1));
+
+      it = records.insert(
+          std::make_pair(contentType, encoder.encode(evolve(message)))).first;
+    }
+
+    return it->second;
+  }
+
+private:
+  const Message message;
+  Option<process::Serialized> serialized_;
+  std::map<ContentType, std::string> records;
+};
+
+
 // Represents the streaming HTTP connection to a framework.
 struct HttpConnection
 {
@@ -1388,6 +1452,14 @@ struct HttpConnection
     return writer.write(encoder.encode(evolve(message)));
   }
 
+  // Sends a message that gets broadcast to many frameworks, using its
+  // record that is encoded for the content type of this connection.
+  template <typename Message>
+  bool send(Broadcast<Message>& broadcast)
+  {
+    return writer.write(broadcast.record(contentType));
+  }
+
   bool close()
   {
     return writer.close();
@@ -1430,15 +1502,32 @@ private:
     if (http.closed().isPending()) {
       VLOG(1) << "Sending heartbeat to " << frameworkId;
 
-      scheduler::Event event;
-      event.set_type(scheduler::Event::HEARTBEAT);
-
-      http.send(event);
+      http.writer.write(record(http.contentType));
     }
 
     process::delay(interval, self(), &Self::heartbeat);
   }
 
+  // Returns the heartbeat event encoded for the content type. All the
+  // heartbeats are the same, hence they only get encoded once (for
+  // each content type) rather than on every heartbeat to every
+  // framework.
+  static const std::string& record(ContentType contentType)
+  {
+    static const std::string json = encode(ContentType::JSON);
+    static const std::string protobuf = encode(ContentType::PROTOBUF);
+
+    return contentType == ContentType::JSON ? json : protobuf;
+  }
+
+  static std::string encode(ContentType contentType)
+  {
+    scheduler::Event event;
+    event.set_type(scheduler::Event::HEARTBEAT);
+
+    return Broadcast<scheduler::Event>(event).record(contentType);
+  }
+
   const FrameworkID frameworkId;
   HttpConnection http;
   const Duration interval;
@@ -1544,6 +1633,27 @@ struct Framework
     }
   }
 
+  // Sends a message that gets broadcast to many frameworks, without
+  // encoding it again for each framework, see Broadcast.
+  template <typename Message>
+  void send(Broadcast<Message>& broadcast)
+  {
+    if (!connected) {
+      LOG(WARNING) << "Master attempted to send message to disconnected"
+                   << " framework " << *this;
+    }
+
+    if (http.isSome()) {
+      if (!http.get().send(broadcast)) {
+        LOG(WARNING) << "Unable to send event to framework " << *this << ":"
+                     << " connection closed";
+      }
+    } else {
+      CHECK_SOME(pid);
+      master->send(pid.get(), broadcast.serialized());
+    }
+  }
+
   void addCompletedTask(const Task& task)
   {
     // TODO(adam-mesos): Check if completed task already exists.
@@ -1906,6 +2016,117 @@ struct Role
   hashmap<FrameworkID, Framework*> frameworks;
 };
 
+// An immutable copy of the parts of the state of the master that are
+// exposed by the '/state', '/state-summary', '/slaves' and '/tasks'
+// endpoints. Since a snapshot is never modified once published (see
+// 'Master::snapshot'), these endpoints render it outside of the
+// master, so that frequent requests do not block it.
+struct Snapshot
+{
+  struct Framework
+  {
+    // NOTE: The master passes in the copies of the framework's tasks
+    // so that copies of unchanged tasks can be shared between
+    // snapshots, see 'Master::snapshot'.
+    Framework(
+        const master::Framework& framework,
+        const std::vector<std::shared_ptr<const Task>>& _tasks)
+      : info(framework.info),
+        pid(framework.pid),
+        active(framework.active),
+        registeredTime(framework.registeredTime),
+        reregisteredTime(framework.reregisteredTime),
+        unregisteredTime(framework.unregisteredTime),
+        pendingTasks(framework.pendingTasks),
+        tasks(_tasks),
+        executors(framework.executors),
+        totalUsedResources(framework.totalUsedResources),
+        totalOfferedResources(framework.totalOfferedResources)
+    {
+      // NOTE: Completed tasks are never modified by the master, so
+      // we share them rather than copy them.
+      completedTasks.assign(
+          framework.completedTasks.begin(),
+          framework.completedTasks.end());
+
+      offers.reserve(framework.offers.size());
+      foreach (Offer* offer, framework.offers) {
+        offers.push_back(*offer);
+      }
+    }
+
+    const FrameworkID id() const { return info.id(); }
+
+    FrameworkInfo info;
+    Option<process::UPID> pid;
+    bool active;
+
+    process::Time registeredTime;
+    process::Time reregisteredTime;
+    process::Time unregisteredTime;
+
+    hashmap<TaskID, TaskInfo> pendingTasks;
+    std::vector<std::shared_ptr<const Task>> tasks;
+    std::vector<std::shared_ptr<const Task>> completedTasks;
+    std::vector<Offer> offers;
+    hashmap<SlaveID, hashmap<ExecutorID, ExecutorInfo>> executors;
+
+    Resources totalUsedResources;
+    Resources totalOfferedResources;
+  };
+
+  struct Slave
+  {
+    explicit Slave(const master::Slave& slave)
+      : id(slave.id),
+        info(slave.info),
+        pid(slave.pid),
+        active(slave.active),
+        registeredTime(slave.registeredTime),
+        reregisteredTime(slave.reregisteredTime),
+        totalResources(slave.totalResources),
+        usedResources(Resources::sum(slave.usedResources)),
+        offeredResources(slave.offeredResources) {}
+
+    SlaveID id;
+    SlaveInfo info;
+    process::UPID pid;
+    bool active;
+
+    process::Time registeredTime;
+    Option<process::Time> reregisteredTime;
+
+    Resources totalResources;
+    Resources usedResources;
+    Resources offeredResources;
+  };
+
+  // Incremented every time the master publishes a new snapshot.
+  uint64_t version;
+
+  // When this snapshot was taken.
+  process::Time time;
+
+  Flags flags;
+  MasterInfo info;
+  process::UPID pid;
+  Option<MasterInfo> leader;
+  process::Time startTime;
+  Option<process::Time> electedTime;
+
+  std::vector<std::shared_ptr<const Slave>> slaves;
+  std::vector<std::shared_ptr<const Framework>> frameworks;
+
+  // NOTE: Completed frameworks are never modified by the master, so
+  // these are shared with the previous snapshot whenever possible.
+  std::vector<std::shared_ptr<const Framework>> completedFrameworks;
+
+  // Tasks on registered slaves whose frameworks are not registered,
+  // and the IDs of those frameworks (once per slave).
+  std::vector<std::shared_ptr<const Task>> orphanTasks;
+  std::vector<FrameworkID> unregisteredFrameworks;
+};
+
 } // namespace master {
 } // namespace internal {
 } // namespace mesos {
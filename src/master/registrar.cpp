@@ -17,10 +17,14 @@
  */
 
 #include <deque>
+#include <list>
+#include <map>
+#include <set>
 #include <string>
 
 #include <mesos/type_utils.hpp>
 
+#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
@@ -30,22 +34,28 @@
 #include <process/owned.hpp>
 #include <process/process.hpp>
 
+#include <process/metrics/counter.hpp>
 #include <process/metrics/gauge.hpp>
 #include <process/metrics/metrics.hpp>
 #include <process/metrics/timer.hpp>
 
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/lambda.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/protobuf.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/strings.hpp>
 
 #include "master/registrar.hpp"
 #include "master/registry.hpp"
 
 #include "state/protobuf.hpp"
 
+using google::protobuf::RepeatedPtrField;
+
 using mesos::internal::state::protobuf::State;
 using mesos::internal::state::protobuf::Variable;
 
@@ -66,10 +76,14 @@ using process::USAGE;
 
 using process::http::OK;
 
+using process::metrics::Counter;
 using process::metrics::Gauge;
 using process::metrics::Timer;
 
 using std::deque;
+using std::list;
+using std::map;
+using std::set;
 using std::string;
 
 namespace mesos {
@@ -86,6 +100,7 @@ public:
     : ProcessBase(process::ID::generate("registrar")),
       metrics(*this),
       updating(false),
+      nextDelta(0),
       flags(_flags),
       state(_state) {}
 
@@ -116,7 +131,7 @@ private:
   protected:
     virtual Try<bool> perform(
         Registry* registry,
-        hashset<SlaveID>* slaveIDs,
+        hashmap<SlaveID, int>* slaveIDs,
         bool strict)
     {
       registry->mutable_master()->mutable_info()->CopyFrom(info);
@@ -138,13 +153,15 @@ private:
             "registrar/registry_size_bytes",
             defer(process, &RegistrarProcess::_registry_size_bytes)),
         state_fetch("registrar/state_fetch"),
-        state_store("registrar/state_store", Days(1))
+        state_store("registrar/state_store", Days(1)),
+        state_store_bytes("registrar/state_store_bytes")
     {
       process::metrics::add(queued_operations);
       process::metrics::add(registry_size_bytes);
 
       process::metrics::add(state_fetch);
       process::metrics::add(state_store);
+      process::metrics::add(state_store_bytes);
     }
 
     ~Metrics()
@@ -154,6 +171,7 @@ private:
 
       process::metrics::remove(state_fetch);
       process::metrics::remove(state_store);
+      process::metrics::remove(state_store_bytes);
     }
 
     Gauge queued_operations;
@@ -161,6 +179,9 @@ private:
 
     Timer<Milliseconds> state_fetch;
     Timer<Milliseconds> state_store;
+
+    // Total size of the registries and deltas that were stored.
+    Counter state_store_bytes;
   } metrics;
 
   // Gauge handlers.
@@ -185,22 +206,47 @@ private:
   void __recover(const Future<bool>& recover);
   Future<bool> _apply(Owned<Operation> operation);
 
+  // Helpers for fetching the registry, i.e., the last stored
+  // registry with the deltas appended since then applied on top.
+  Future<Variable<Registry> > fetch();
+  Future<list<Variable<RegistryDelta> > > fetchDeltas(
+      const set<string>& names);
+  Future<Variable<Registry> > replay(
+      const Variable<Registry>& variable,
+      const list<Variable<RegistryDelta> >& deltas);
+
   // Helper for updating state (performing store).
   void update();
   void _update(
       const Future<Option<Variable<Registry> > >& store,
       deque<Owned<Operation> > operations);
 
+  // Helper for appending a delta to the state (performing store),
+  // rather than storing the whole registry in 'update'.
+  void append(const Registry& registry, const RegistryDelta& delta);
+  void _append(
+      const Registry& registry,
+      const Future<Option<Variable<RegistryDelta> > >& store,
+      deque<Owned<Operation> > operations);
+
   // Fails all pending operations and transitions the Registrar
   // into an error state in which all subsequent operations will fail.
   // This ensures we don't attempt to re-acquire log leadership by
   // performing more State storage operations.
   void abort(const string& message);
 
+  // NOTE: When deltas have been appended since the registry was last
+  // stored, this holds the current registry rather than the stored
+  // one (so that it can still be used to store the registry).
   Option<Variable<Registry> > variable;
   deque<Owned<Operation> > operations;
   bool updating; // Used to signify fetching (recovering) or storing.
 
+  // The deltas that were appended since the registry was last stored
+  // (or were recovered), which get expunged once it is stored again.
+  list<Variable<RegistryDelta> > deltas;
+  uint64_t nextDelta;
+
   const Flags flags;
   State* state;
 
@@ -237,6 +283,107 @@ void fail(deque<Owned<Operation>>* operations, const string& message)
 }
 
 
+// Names of the state variables the deltas are stored in.
+static const string DELTA_PREFIX = "registry_delta_";
+
+
+// Adds the changes that were made to the master, the machines and
+// the maintenance schedules of the 'previous' registry in order to
+// get the 'current' one to the delta. NOTE: The changes to the slaves
+// are collected while applying a batch of operations (see 'update')
+// so that the cost of a delta does not depend on the number of slaves.
+static void diff(
+    const Registry& previous,
+    const Registry& current,
+    RegistryDelta* delta)
+{
+  if (current.has_master() &&
+      (!previous.has_master() ||
+       !(previous.master().info() == current.master().info()))) {
+    delta->mutable_master()->CopyFrom(current.master());
+  }
+
+  // NOTE: We compare the serialized machines and schedules since
+  // these are expected to be small.
+  if (previous.machines().SerializeAsString() !=
+      current.machines().SerializeAsString()) {
+    delta->mutable_machines()->CopyFrom(current.machines());
+  }
+
+  RegistryDelta::Schedules previousSchedules;
+  previousSchedules.mutable_schedules()->CopyFrom(previous.schedules());
+
+  RegistryDelta::Schedules currentSchedules;
+  currentSchedules.mutable_schedules()->CopyFrom(current.schedules());
+
+  if (previousSchedules.SerializeAsString() !=
+      currentSchedules.SerializeAsString()) {
+    delta->mutable_schedules()->CopyFrom(currentSchedules);
+  }
+}
+
+
+// Applies the changes of the delta to the registry. Like 'update',
+// this keeps the order of the slaves: removed slaves are dropped,
+// changed slaves are updated in place, and new slaves are appended.
+static void patch(const RegistryDelta& delta, Registry* registry)
+{
+  if (delta.has_master()) {
+    registry->mutable_master()->CopyFrom(delta.master());
+  }
+
+  if (delta.added_slaves_size() > 0 || delta.removed_slaves_size() > 0) {
+    hashset<SlaveID> removed;
+    foreach (const SlaveID& slaveId, delta.removed_slaves()) {
+      removed.insert(slaveId);
+    }
+
+    hashmap<SlaveID, const Registry::Slave*> added;
+    foreach (const Registry::Slave& slave, delta.added_slaves()) {
+      added[slave.info().id()] = &slave;
+    }
+
+    RepeatedPtrField<Registry::Slave>* slaves =
+      registry->mutable_slaves()->mutable_slaves();
+
+    int kept = 0;
+    for (int i = 0; i < slaves->size(); i++) {
+      const SlaveID slaveId = slaves->Get(i).info().id();
+
+      // NOTE: A slave that was removed and then added again within
+      // the same batch of operations was appended by 'update'.
+      if (removed.contains(slaveId)) {
+        continue;
+      }
+
+      Option<const Registry::Slave*> slave = added.get(slaveId);
+      if (slave.isSome()) {
+        slaves->Mutable(i)->CopyFrom(*slave.get());
+        added.erase(slaveId);
+      }
+
+      slaves->SwapElements(i, kept++);
+    }
+
+    slaves->DeleteSubrange(kept, slaves->size() - kept);
+
+    foreach (const Registry::Slave& slave, delta.added_slaves()) {
+      if (added.contains(slave.info().id())) {
+        slaves->Add()->CopyFrom(slave);
+      }
+    }
+  }
+
+  if (delta.has_machines()) {
+    registry->mutable_machines()->CopyFrom(delta.machines());
+  }
+
+  if (delta.has_schedules()) {
+    registry->mutable_schedules()->CopyFrom(delta.schedules().schedules());
+  }
+}
+
+
 Future<Response> RegistrarProcess::registry(const Request& request)
 {
   JSON::Object result;
@@ -309,7 +456,7 @@ Future<Registry> RegistrarProcess::recover(const MasterInfo& info)
     LOG(INFO) << "Recovering registrar";
 
     metrics.state_fetch.start();
-    state->fetch<Registry>("registry")
+    fetch()
       .after(flags.registry_fetch_timeout,
              lambda::bind(
                  &timeout<Variable<Registry> >,
@@ -380,6 +527,87 @@ void RegistrarProcess::__recover(const Future<bool>& recover)
 }
 
 
+Future<Variable<Registry> > RegistrarProcess::fetch()
+{
+  // NOTE: The deltas are listed after fetching the registry so that
+  // no delta can be missed (the registry and the deltas are only
+  // written by the leading master, i.e., not while recovering).
+  return state->fetch<Registry>("registry")
+    .then(defer(self(), [this](const Variable<Registry>& variable) {
+      return state->names()
+        .then(defer(self(), &Self::fetchDeltas, lambda::_1))
+        .then(defer(self(), &Self::replay, variable, lambda::_1));
+    }));
+}
+
+
+Future<list<Variable<RegistryDelta> > > RegistrarProcess::fetchDeltas(
+    const set<string>& names)
+{
+  list<Future<Variable<RegistryDelta> > > futures;
+
+  foreach (const string& name, names) {
+    if (strings::startsWith(name, DELTA_PREFIX)) {
+      futures.push_back(state->fetch<RegistryDelta>(name));
+    }
+  }
+
+  return collect(futures);
+}
+
+
+Future<Variable<Registry> > RegistrarProcess::replay(
+    const Variable<Registry>& variable,
+    const list<Variable<RegistryDelta> >& fetched)
+{
+  Registry registry = variable.get();
+
+  // Order the deltas by their sequence numbers.
+  map<uint64_t, Variable<RegistryDelta> > ordered;
+  foreach (const Variable<RegistryDelta>& delta, fetched) {
+    if (!delta.get().has_sequence()) {
+      return Failure("Found a delta of the registry without a sequence");
+    }
+
+    ordered.insert(std::make_pair(delta.get().sequence(), delta));
+  }
+
+  nextDelta = registry.next_delta();
+
+  size_t replayed = 0;
+  foreachpair (uint64_t sequence,
+               const Variable<RegistryDelta>& delta,
+               ordered) {
+    // All of the recovered deltas get expunged once the registry is
+    // stored again, including those that were already compacted into
+    // the registry (i.e., that failed to be expunged before).
+    deltas.push_back(delta);
+
+    if (sequence < registry.next_delta()) {
+      continue;
+    }
+
+    // A missing delta fails the recovery (rather than aborting) so
+    // that the operator learns about it from the failed recovery.
+    if (sequence != nextDelta) {
+      return Failure(
+          "Missing delta " + stringify(nextDelta) + " of the registry"
+          " (found delta " + stringify(sequence) + " instead)");
+    }
+
+    patch(delta.get(), &registry);
+    nextDelta = sequence + 1;
+    replayed++;
+  }
+
+  LOG(INFO) << "Replayed " << replayed << " deltas of the registry";
+
+  registry.set_next_delta(nextDelta);
+
+  return variable.mutate(registry);
+}
+
+
 Future<bool> RegistrarProcess::apply(Owned<Operation> operation)
 {
   if (recovered.isNone()) {
@@ -425,24 +653,84 @@ void RegistrarProcess::update()
   updating = true;
 
   // Create a snapshot of the current registry.
-  Registry registry = variable.get().get();
+  const Registry& previous = variable.get().get();
+  Registry registry = previous;
 
   // Create the 'slaveIDs' accumulator.
-  hashset<SlaveID> slaveIDs;
-  foreach (const Registry::Slave& slave, registry.slaves().slaves()) {
-    slaveIDs.insert(slave.info().id());
+  hashmap<SlaveID, int> slaveIDs;
+  for (int i = 0; i < registry.slaves().slaves().size(); i++) {
+    slaveIDs[registry.slaves().slaves(i).info().id()] = i;
   }
 
+  const int previousSlaves = registry.slaves().slaves().size();
+
   foreach (Owned<Operation> operation, operations) {
     // No need to process the result of the operation.
     (*operation)(&registry, &slaveIDs, flags.registry_strict);
   }
 
+  // Append a delta rather than storing the whole registry, unless
+  // deltas are disabled or there are too many of them already. We
+  // always store the whole registry when recovering, which compacts
+  // the recovered deltas.
+  const bool appending =
+    flags.registry_max_deltas > 0 &&
+    deltas.size() < flags.registry_max_deltas &&
+    !recovered.get()->future().isPending();
+
+  RegistryDelta delta;
+
+  // Operations only ever append slaves or clear them in place (see
+  // Operation), so the added slaves are the ones past the previous
+  // slaves that have not been cleared again.
+  RepeatedPtrField<Registry::Slave>* slaves =
+    registry.mutable_slaves()->mutable_slaves();
+
+  if (appending) {
+    for (int i = previousSlaves; i < slaves->size(); i++) {
+      if (slaves->Get(i).has_info()) {
+        delta.add_added_slaves()->CopyFrom(slaves->Get(i));
+      }
+    }
+  }
+
+  // Drop the slaves that were removed (i.e., cleared) by the
+  // operations all at once, keeping the order of the remaining slaves
+  // so that the stored registry does not depend on how it was built.
+  if ((size_t) slaves->size() != slaveIDs.size()) {
+    int kept = 0;
+    for (int i = 0; i < slaves->size(); i++) {
+      if (slaves->Get(i).has_info()) {
+        slaves->SwapElements(i, kept++);
+      } else if (appending && i < previousSlaves) {
+        delta.add_removed_slaves()->CopyFrom(
+            previous.slaves().slaves(i).info().id());
+      }
+    }
+
+    slaves->DeleteSubrange(kept, slaves->size() - kept);
+  }
+
+  if (appending) {
+    diff(previous, registry, &delta);
+    delta.set_sequence(nextDelta);
+
+    LOG(INFO) << "Applied " << operations.size() << " operations in "
+              << stopwatch.elapsed() << "; attempting to append delta "
+              << delta.sequence() << " to the 'registry'";
+
+    append(registry, delta);
+    return;
+  }
+
+  registry.set_next_delta(nextDelta);
+
   LOG(INFO) << "Applied " << operations.size() << " operations in "
             << stopwatch.elapsed() << "; attempting to update the 'registry'";
 
   // Perform the store, and time the operation.
   metrics.state_store.start();
+  metrics.state_store_bytes += registry.ByteSize();
   state->store(variable.get().mutate(registry))
     .after(flags.registry_store_timeout,
            lambda::bind(
@@ -487,6 +775,86 @@ void RegistrarProcess::_update(
 
   variable = store.get().get();
 
+  // The deltas are now compacted into the registry, see 'replay' for
+  // why it is safe if expunging them fails.
+  foreach (const Variable<RegistryDelta>& delta, deltas) {
+    state->expunge(delta);
+  }
+
+  deltas.clear();
+
+  // Remove the operations.
+  while (!applied.empty()) {
+    Owned<Operation> operation = applied.front();
+    applied.pop_front();
+
+    operation->set();
+  }
+
+  if (!operations.empty()) {
+    update();
+  }
+}
+
+
+void RegistrarProcess::append(
+    const Registry& registry,
+    const RegistryDelta& delta)
+{
+  nextDelta++;
+
+  // Perform the store, and time the operation.
+  metrics.state_store.start();
+  metrics.state_store_bytes += delta.ByteSize();
+  state->fetch<RegistryDelta>(DELTA_PREFIX + stringify(delta.sequence()))
+    .then(defer(self(), [this, delta](const Variable<RegistryDelta>& variable) {
+      return state->store(variable.mutate(delta));
+    }))
+    .after(flags.registry_store_timeout,
+           lambda::bind(
+               &timeout<Option<Variable<RegistryDelta> > >,
+               "store",
+               flags.registry_store_timeout,
+               lambda::_1))
+    .onAny(defer(self(), &Self::_append, registry, lambda::_1, operations));
+
+  // Clear the operations, _append will transition the Promises!
+  operations.clear();
+}
+
+
+void RegistrarProcess::_append(
+    const Registry& registry,
+    const Future<Option<Variable<RegistryDelta> > >& store,
+    deque<Owned<Operation> > applied)
+{
+  updating = false;
+
+  // Abort if the storage operation did not succeed.
+  if (!store.isReady() || store.get().isNone()) {
+    string message = "Failed to append to 'registry': ";
+
+    if (store.isFailed()) {
+      message += store.failure();
+    } else if (store.isDiscarded()) {
+      message += "discarded";
+    } else {
+      message += "version mismatch";
+    }
+
+    fail(&applied, message);
+    abort(message);
+
+    return;
+  }
+
+  Duration elapsed = metrics.state_store.stop();
+
+  LOG(INFO) << "Successfully appended to the 'registry' in " << elapsed;
+
+  variable = variable.get().mutate(registry);
+  deltas.push_back(store.get().get());
+
   // Remove the operations.
   while (!applied.empty()) {
     Owned<Operation> operation = applied.front();
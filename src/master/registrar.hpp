@@ -21,7 +21,7 @@
 
 #include <mesos/mesos.hpp>
 
-#include <stout/hashset.hpp>
+#include <stout/hashmap.hpp>
 
 #include <process/future.hpp>
 #include <process/owned.hpp>
@@ -51,7 +51,16 @@ public:
 
   // Attempts to invoke the operation on the registry object.
   // Aided by accumulator(s):
-  //   slaveIDs - is the set of registered slaves.
+  //   slaveIDs - maps the registered slaves to their index in the
+  //              slaves of 'registry'.
+  //
+  // NOTE: Removed slaves are only cleared in place (so that removing
+  // a slave does not have to shift the remaining ones), and get
+  // dropped once all the operations of a batch have been applied.
+  // Hence operations must use 'slaveIDs' rather than scanning the
+  // slaves of 'registry'. New slaves must be appended, and slaves
+  // must not be changed in place, since the registrar relies on this
+  // to find the changes of a batch of operations for the deltas.
   //
   // NOTE: the "strict" parameter only applies to operations that
   // affect slaves (i.e. registration).  See Flags::registry_strict
@@ -61,7 +70,7 @@ public:
   // the operation cannot be applied successfully.
   Try<bool> operator()(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict)
   {
     const Try<bool> result = perform(registry, slaveIDs, strict);
@@ -77,7 +86,7 @@ public:
 protected:
   virtual Try<bool> perform(
       Registry* registry,
-      hashset<SlaveID>* slaveIDs,
+      hashmap<SlaveID, int>* slaveIDs,
       bool strict) = 0;
 
 private:
@@ -111,10 +111,26 @@ extern const std::string DEFAULT_AUTHENTICATEE;
 // Default maximum storage space to be used by the fetcher cache.
 const Bytes DEFAULT_FETCHER_CACHE_SIZE = Gigabytes(2);
 
+// Default maximum number of URIs the fetcher downloads (and extracts)
+// in parallel for a single container.
+const size_t DEFAULT_FETCHER_CONCURRENCY = 4;
+
+// Number of times the fetcher attempts to download an HTTP or FTP
+// URI. Interrupted downloads are resumed where the server allows it.
+const size_t FETCHER_MAX_DOWNLOAD_ATTEMPTS = 3;
+
+// Maximum number of threads that recover the checkpointed state of
+// the executors (of all frameworks) in parallel.
+const size_t RECOVERY_CONCURRENCY = 8;
+
 // Default maximum number of docker inspect calls docker ps will invoke
 // in parallel to prevent hitting system's open file descriptor limit.
 const int DOCKER_PS_MAX_INSPECT_CALLS = 100;
 
+// Maximum number of image layers the docker registry puller will
+// download (and extract) in parallel.
+const size_t DOCKER_REGISTRY_PULLER_MAX_DOWNLOADS = 4;
+
 // If no pings received within this timeout, then the slave will
 // trigger a re-detection of the master to cause a re-registration.
 Duration DEFAULT_MASTER_PING_TIMEOUT();
@@ -123,7 +123,11 @@ Try<DockerContainerizer*> DockerContainerizer::create(
     const Flags& flags,
     Fetcher* fetcher)
 {
-  Try<Docker*> create = Docker::create(flags.docker, flags.docker_socket, true);
+  Try<Docker*> create = Docker::create(
+      flags.docker,
+      flags.docker_socket,
+      true,
+      flags.docker_engine_api);
   if (create.isError()) {
     return Error("Failed to create docker: " + create.error());
   }
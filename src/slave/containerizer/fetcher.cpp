@@ -16,19 +16,29 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <unordered_map>
 
 #include <process/async.hpp>
 #include <process/check.hpp>
+#include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/dispatch.hpp>
 
+#include <process/metrics/metrics.hpp>
+
+#include <stout/hashset.hpp>
 #include <stout/net.hpp>
+#include <stout/numify.hpp>
 #include <stout/path.hpp>
+#include <stout/protobuf.hpp>
 
 #include "hdfs/hdfs.hpp"
 
+#include "messages/messages.hpp"
+
 #include "slave/slave.hpp"
+#include "slave/state.hpp"
 
 #include "slave/containerizer/fetcher.hpp"
 
@@ -39,7 +49,12 @@ using std::string;
 using std::transform;
 using std::vector;
 
+using mesos::fetcher::FetcherReport;
+
+using process::Clock;
 using process::Future;
+using process::PID;
+using process::Time;
 
 namespace mesos {
 namespace internal {
@@ -50,6 +65,25 @@ static const string FILE_URI_LOCALHOST = "file://localhost";
 
 static const string CACHE_FILE_NAME_PREFIX = "c";
 
+// NOTE: This must not contain CACHE_FILE_NAME_PREFIX, see cacheFiles().
+static const string CACHE_INDEX_FILE_NAME = ".index";
+
+
+static string getIndexPath(const string& cacheDirectory)
+{
+  return path::join(cacheDirectory, CACHE_INDEX_FILE_NAME);
+}
+
+
+static string getCacheFilePath(
+    const string& cacheDirectory,
+    const FetcherCacheIndex::Entry& entry)
+{
+  return entry.has_user()
+    ? path::join(cacheDirectory, entry.user(), entry.filename())
+    : path::join(cacheDirectory, entry.filename());
+}
+
 
 Fetcher::Fetcher() : process(new FetcherProcess())
 {
@@ -73,8 +107,7 @@ Fetcher::~Fetcher()
 
 Try<Nothing> Fetcher::recover(const SlaveID& slaveId, const Flags& flags)
 {
-  // Good enough for now, simple, least-effort recovery.
-  VLOG(1) << "Clearing fetcher cache";
+  VLOG(1) << "Recovering fetcher cache";
 
   string cacheDirectory = paths::getSlavePath(flags.fetcher_cache_dir, slaveId);
   Result<string> path = os::realpath(cacheDirectory);
@@ -85,16 +118,80 @@ Try<Nothing> Fetcher::recover(const SlaveID& slaveId, const Flags& flags)
     return Error(path.error());
   }
 
-  if (path.isSome() && os::exists(path.get())) {
-    Try<Nothing> rmdir = os::rmdir(path.get(), true);
-    if (rmdir.isError()) {
-      LOG(ERROR) << "Could not delete fetcher cache directory '"
-                 << cacheDirectory << "', error: " + rmdir.error();
+  if (path.isNone() || !os::exists(path.get())) {
+    return Nothing();
+  }
+
+  // We keep the checkpointed entries whose cache files are unchanged
+  // and delete everything else, e.g., partial downloads of a slave
+  // that did not shut down cleanly. We only compare the size and
+  // modification time of the files, since reading all of them to
+  // verify their contents would delay the slave's recovery.
+  const string indexPath = getIndexPath(path.get());
+
+  Result<FetcherCacheIndex> checkpointed =
+    ::protobuf::read<FetcherCacheIndex>(indexPath);
+
+  if (checkpointed.isError()) {
+    LOG(WARNING) << "Clearing fetcher cache, failed to read its index '"
+                 << indexPath << "': " << checkpointed.error();
+  }
 
-      return rmdir;
+  FetcherCacheIndex index;
+  hashset<string> files;
+
+  if (checkpointed.isSome()) {
+    foreach (const FetcherCacheIndex::Entry& entry,
+             checkpointed.get().entries()) {
+      const string file = getCacheFilePath(path.get(), entry);
+
+      Try<Bytes> size = os::stat::size(file, os::stat::DO_NOT_FOLLOW_SYMLINK);
+      Try<long> mtime = os::stat::mtime(file);
+
+      if (size.isError() || size.get().bytes() != entry.size() ||
+          mtime.isError() || mtime.get() != entry.mtime()) {
+        LOG(WARNING) << "Discarding fetcher cache file '" << file
+                     << "' for URI '" << entry.uri()
+                     << "', it is missing or has changed";
+        continue;
+      }
+
+      index.add_entries()->CopyFrom(entry);
+      files.insert(file);
+    }
+  }
+
+  Try<list<string>> find = os::find(path.get(), "");
+  if (find.isError()) {
+    LOG(ERROR) << "Could not access fetcher cache directory '"
+               << cacheDirectory << "', error: " + find.error();
+
+    return Error(find.error());
+  }
+
+  foreach (const string& file, find.get()) {
+    if (file != indexPath && !files.contains(file)) {
+      Try<Nothing> rm = os::rm(file);
+      if (rm.isError()) {
+        LOG(ERROR) << "Could not delete fetcher cache file '"
+                   << file << "', error: " + rm.error();
+
+        return rm;
+      }
     }
   }
 
+  Try<Nothing> checkpoint = state::checkpoint(indexPath, index);
+  if (checkpoint.isError()) {
+    LOG(ERROR) << "Could not checkpoint fetcher cache index '"
+               << indexPath << "', error: " + checkpoint.error();
+
+    return checkpoint;
+  }
+
+  VLOG(1) << "Recovered " << index.entries_size()
+          << " fetcher cache entries";
+
   return Nothing();
 }
 
@@ -304,6 +401,15 @@ Future<Nothing> FetcherProcess::fetch(
   // always the exact same value.
   cache.setSpace(flags.fetcher_cache_size);
 
+  // Likewise, the cache directory is only known here, so this is where
+  // the cache entries that were kept by Fetcher::recover() are loaded.
+  Try<Nothing> recovered = cache.recover(
+      paths::getSlavePath(flags.fetcher_cache_dir, slaveId));
+
+  if (recovered.isError()) {
+    LOG(WARNING) << "Failed to recover fetcher cache: " << recovered.error();
+  }
+
   Try<Nothing> validated = validateUris(commandInfo);
   if (validated.isError()) {
     return Failure("Could not fetch: " + validated.error());
@@ -365,12 +471,18 @@ Future<Nothing> FetcherProcess::fetch(
     if (entry.isSome()) {
       entry.get()->reference();
 
+      ++metrics.cache_hits;
+
       // Wait for the URI to be downloaded into the cache (or fail)
       entries[uri] = entry.get()->completion()
         .then(defer(self(), [=]() {
+          metrics.cache_bytes_saved += entry.get()->size.bytes();
+
           return Future<shared_ptr<Cache::Entry>>(entry.get());
         }));
     } else {
+      ++metrics.cache_misses;
+
       shared_ptr<Cache::Entry> newEntry =
         cache.create(cacheDirectory, commandUser, uri);
 
@@ -510,7 +622,27 @@ Future<Nothing> FetcherProcess::__fetch(
     info.set_frameworks_home(flags.frameworks_home);
   }
 
+  info.set_concurrency(flags.fetcher_concurrency);
+
+  // The report is kept in the sandbox directory so that it is subject
+  // to the same permissions and garbage collection as the sandbox
+  // (and its stdout and stderr), should it not get removed.
+  Try<string> reportPath = os::mktemp(
+      path::join(sandboxDirectory, ".mesos-fetcher-report.XXXXXX"));
+
+  if (reportPath.isError()) {
+    LOG(WARNING) << "Failed to create a file for the fetcher report: "
+                 << reportPath.error();
+  } else {
+    info.set_report_path(reportPath.get());
+  }
+
   return run(containerId, sandboxDirectory, user, info, flags)
+    .onAny(defer(self(), [=](const Future<Nothing>&) {
+      if (info.has_report_path()) {
+        readReport(info.report_path());
+      }
+    }))
     .repair(defer(self(), [=](const Future<Nothing>& future) {
       LOG(ERROR) << "Failed to run mesos-fetcher: " << future.failure();
 
@@ -526,6 +658,12 @@ Future<Nothing> FetcherProcess::__fetch(
         }
       }
 
+      Try<Nothing> checkpoint = cache.checkpoint();
+      if (checkpoint.isError()) {
+        LOG(WARNING) << "Failed to checkpoint fetcher cache index: "
+                     << checkpoint.error();
+      }
+
       return future; // Always propagate the failure!
     }))
     .then(defer(self(), [=]() {
@@ -553,6 +691,14 @@ Future<Nothing> FetcherProcess::__fetch(
         }
       }
 
+      // Checkpoint the completed entries as well as the order in which
+      // entries have been used, for LRU eviction after a restart.
+      Try<Nothing> checkpoint = cache.checkpoint();
+      if (checkpoint.isError()) {
+        LOG(WARNING) << "Failed to checkpoint fetcher cache index: "
+                     << checkpoint.error();
+      }
+
       return Nothing();
     }));
 }
@@ -866,7 +1012,9 @@ shared_ptr<FetcherProcess::Cache::Entry> FetcherProcess::Cache::create(
   const string filename = nextFilename(uri);
 
   auto entry = shared_ptr<Cache::Entry>(
-      new Cache::Entry(key, cacheDirectory, filename));
+      new Cache::Entry(key, user, uri.value(), cacheDirectory, filename));
+
+  entry->lastUsed = Clock::now();
 
   table.put(key, entry);
   lruSortedEntries.push_back(entry);
@@ -889,6 +1037,8 @@ FetcherProcess::Cache::get(
     // Refresh the cache entry by moving it to the back of lruSortedEntries.
     lruSortedEntries.remove(entry.get());
     lruSortedEntries.push_back(entry.get());
+
+    entry.get()->lastUsed = Clock::now();
   }
 
   return entry;
@@ -1044,7 +1194,14 @@ Try<Nothing> FetcherProcess::Cache::adjust(
   if (size.isSome()) {
     off_t d = delta(size.get(), entry);
     if (d <= 0) {
+      Try<long> mtime = os::stat::mtime(entry->path().value);
+      if (mtime.isError()) {
+        return Error("Could not determine modification time of fetcher "
+                     "cache file for '" + entry->key + "': " + mtime.error());
+      }
+
       entry->size = size.get();
+      entry->mtime = mtime.get();
 
       releaseSpace(Bytes(d));
     } else {
@@ -1067,6 +1224,125 @@ size_t FetcherProcess::Cache::size()
 }
 
 
+Try<Nothing> FetcherProcess::Cache::recover(const string& directory)
+{
+  if (root.isSome()) {
+    return Nothing();
+  }
+
+  root = directory;
+
+  const string indexPath = getIndexPath(directory);
+  if (!os::exists(indexPath)) {
+    return Nothing();
+  }
+
+  Result<FetcherCacheIndex> index =
+    ::protobuf::read<FetcherCacheIndex>(indexPath);
+
+  if (index.isError()) {
+    return Error("Failed to read index '" + indexPath + "': " + index.error());
+  } else if (index.isNone()) {
+    return Nothing();
+  }
+
+  foreach (const FetcherCacheIndex::Entry& checkpointed,
+           index.get().entries()) {
+    Option<string> user = None();
+    if (checkpointed.has_user()) {
+      user = checkpointed.user();
+    }
+
+    const string key = cacheKey(user, checkpointed.uri());
+
+    auto entry = shared_ptr<Cache::Entry>(new Cache::Entry(
+        key,
+        user,
+        checkpointed.uri(),
+        user.isSome() ? path::join(directory, user.get()) : directory,
+        checkpointed.filename()));
+
+    Try<Time> lastUsed = Time::create(checkpointed.last_used());
+
+    entry->size = checkpointed.size();
+    entry->mtime = checkpointed.mtime();
+    entry->lastUsed = lastUsed.isSome() ? lastUsed.get() : Clock::now();
+    entry->complete();
+
+    table.put(key, entry);
+    lruSortedEntries.push_back(entry);
+
+    claimSpace(entry->size);
+
+    // Make sure that new cache files get names distinct from the
+    // recovered ones (see nextFilename()).
+    const string& filename = checkpointed.filename();
+    const size_t length = filename.find('-') - CACHE_FILE_NAME_PREFIX.size();
+
+    Try<unsigned long> serial = numify<unsigned long>(
+        filename.substr(CACHE_FILE_NAME_PREFIX.size(), length));
+
+    if (serial.isSome()) {
+      filenameSerial = std::max(filenameSerial, serial.get());
+    }
+  }
+
+  VLOG(1) << "Recovered " << table.size() << " fetcher cache entries"
+          << " using " << tally;
+
+  // The cache space might have been decreased since the entries were
+  // checkpointed, e.g., when upgrading the slave.
+  if (tally > space) {
+    const Try<list<shared_ptr<Cache::Entry>>> victims =
+      selectVictims(tally - space);
+
+    if (victims.isError()) {
+      return Error(victims.error());
+    }
+
+    foreach (const shared_ptr<Cache::Entry>& entry, victims.get()) {
+      Try<Nothing> removal = remove(entry);
+      if (removal.isError()) {
+        return Error(removal.error());
+      }
+    }
+
+    return checkpoint();
+  }
+
+  return Nothing();
+}
+
+
+Try<Nothing> FetcherProcess::Cache::checkpoint()
+{
+  if (root.isNone()) {
+    return Nothing();
+  }
+
+  FetcherCacheIndex index;
+
+  foreach (const shared_ptr<Cache::Entry>& entry, lruSortedEntries) {
+    // Entries still being downloaded (or failed) are not reusable.
+    if (!entry->completion().isReady()) {
+      continue;
+    }
+
+    FetcherCacheIndex::Entry* checkpointed = index.add_entries();
+    checkpointed->set_uri(entry->uri);
+    if (entry->user.isSome()) {
+      checkpointed->set_user(entry->user.get());
+    }
+    checkpointed->set_filename(entry->filename);
+    checkpointed->set_size(entry->size.bytes());
+    checkpointed->set_mtime(entry->mtime);
+    checkpointed->set_last_used(entry->lastUsed.secs());
+  }
+
+  return state::checkpoint(getIndexPath(root.get()), index);
+}
+
+
 void FetcherProcess::Cache::setSpace(const Bytes& bytes)
 {
   if (space > 0) {
@@ -1160,6 +1436,83 @@ bool FetcherProcess::Cache::Entry::isReferenced()
   return referenceCount > 0;
 }
 
+
+FetcherProcess::Metrics::Metrics(const PID<FetcherProcess>& fetcher)
+  : cache_hits(
+        "containerizer/fetcher/cache_hits"),
+    cache_misses(
+        "containerizer/fetcher/cache_misses"),
+    cache_hit_rate(
+        "containerizer/fetcher/cache_hit_rate",
+        defer(fetcher, &FetcherProcess::_cache_hit_rate)),
+    cache_bytes_saved(
+        "containerizer/fetcher/cache_bytes_saved"),
+    download_time(
+        "containerizer/fetcher/download_time",
+        Days(1)),
+    fetch_time(
+        "containerizer/fetcher/fetch_time",
+        Days(1))
+{
+  process::metrics::add(cache_hits);
+  process::metrics::add(cache_misses);
+  process::metrics::add(cache_hit_rate);
+  process::metrics::add(cache_bytes_saved);
+  process::metrics::add(download_time);
+  process::metrics::add(fetch_time);
+}
+
+
+FetcherProcess::Metrics::~Metrics()
+{
+  process::metrics::remove(cache_hits);
+  process::metrics::remove(cache_misses);
+  process::metrics::remove(cache_hit_rate);
+  process::metrics::remove(cache_bytes_saved);
+  process::metrics::remove(download_time);
+  process::metrics::remove(fetch_time);
+}
+
+
+void FetcherProcess::readReport(const string& path)
+{
+  Result<FetcherReport> report = ::protobuf::read<FetcherReport>(path);
+
+  if (report.isError()) {
+    LOG(WARNING) << "Failed to read the fetcher report '" << path
+                 << "': " << report.error();
+  } else if (report.isSome()) {
+    foreach (const FetcherReport::Item& item, report.get().items()) {
+      if (item.has_download_duration()) {
+        metrics.download_time.record(
+            Nanoseconds(item.download_duration().nanoseconds()));
+      }
+
+      metrics.fetch_time.record(
+          Nanoseconds(item.fetch_duration().nanoseconds()));
+    }
+  }
+
+  Try<Nothing> rm = os::rm(path);
+  if (rm.isError()) {
+    LOG(WARNING) << "Failed to remove the fetcher report '" << path
+                 << "': " << rm.error();
+  }
+}
+
+
+double FetcherProcess::_cache_hit_rate()
+{
+  const double hits = metrics.cache_hits.value().get();
+  const double misses = metrics.cache_misses.value().get();
+
+  if (hits + misses == 0) {
+    return 0;
+  }
+
+  return hits / (hits + misses);
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
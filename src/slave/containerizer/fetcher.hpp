@@ -31,6 +31,11 @@
 #include <process/future.hpp>
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
+#include <process/time.hpp>
+
+#include <process/metrics/counter.hpp>
+#include <process/metrics/gauge.hpp>
+#include <process/metrics/timer.hpp>
 
 #include <stout/hashmap.hpp>
 
@@ -87,6 +92,10 @@ public:
 
   virtual ~Fetcher();
 
+  // Validates the cache files of the given slave against the cache's
+  // checkpointed index, keeping those that are intact (so they can be
+  // reused without downloading them again) and deleting all others.
+  // The fetcher process loads the remaining index on its first fetch.
   // TODO(bernd-mesos): Inject these parameters at Fetcher creation time.
   // Then also inject the fetcher into the slave at creation time. Then
   // it will be possible to make this an instance method instead of a
@@ -118,7 +127,9 @@ private:
 class FetcherProcess : public process::Process<FetcherProcess>
 {
 public:
-  FetcherProcess() : ProcessBase(process::ID::generate("fetcher")) {}
+  FetcherProcess()
+    : ProcessBase(process::ID::generate("fetcher")),
+      metrics(process::PID<FetcherProcess>(this)) {}
 
   virtual ~FetcherProcess();
 
@@ -155,12 +166,17 @@ public:
     public:
       Entry(
           const std::string& key,
+          const Option<std::string>& user,
+          const std::string& uri,
           const std::string& directory,
           const std::string& filename)
         : key(key),
+          user(user),
+          uri(uri),
           directory(directory),
           filename(filename),
           size(0),
+          mtime(0),
           referenceCount(0) {}
 
       ~Entry() {}
@@ -191,6 +207,10 @@ public:
       // Uniquely identifies a user/URI combination.
       const std::string key;
 
+      // The user and URI of this entry, for checkpointing.
+      const Option<std::string> user;
+      const std::string uri;
+
       // Cache directory where this entry is stored.
       // TODO(bernd-mesos): Remove this construct after refactoring so
       // that the slave flags get injected into the fetcher.
@@ -205,6 +225,13 @@ public:
       // different a warning is logged and the field's value adjusted.
       Bytes size;
 
+      // The modification time of the cache file once downloaded, which
+      // is checkpointed to validate the file when recovering.
+      long mtime;
+
+      // When this entry was last created or retrieved from the cache.
+      process::Time lastUsed;
+
     private:
       // Concurrent fetch attempts can reference the same entry multiple
       // times.
@@ -271,6 +298,16 @@ public:
     // Number of entries.
     size_t size();
 
+    // Loads the entries checkpointed in the index of the given cache
+    // directory (see Fetcher::recover()) into the cache, unless this
+    // has already been done, and evicts entries if they exceed the
+    // cache space. Later checkpoints are written to this directory.
+    Try<Nothing> recover(const std::string& directory);
+
+    // Checkpoints the index of all successfully downloaded entries,
+    // ordered from LRU to MRU, unless the cache was not recovered.
+    Try<Nothing> checkpoint();
+
   private:
     // Maximum storable number of bytes in the cache directory.
     Bytes space;
@@ -287,6 +324,10 @@ public:
 
     // Stores cache file entries sorted from LRU to MRU.
     std::list<std::shared_ptr<Entry>> lruSortedEntries;
+
+    // The cache directory the index is checkpointed to, which is set
+    // once the cache has been recovered.
+    Option<std::string> root;
   };
 
   // Public and virtual for mock testing.
@@ -332,9 +373,36 @@ private:
       const Try<Bytes>& requestedSpace,
       const std::shared_ptr<Cache::Entry>& entry);
 
+  // Records the durations in the FetcherReport that the mesos-fetcher
+  // wrote to the given path (if any) and removes the file.
+  void readReport(const std::string& path);
+
   Cache cache;
 
   hashmap<ContainerID, pid_t> subprocessPids;
+
+  struct Metrics
+  {
+    explicit Metrics(const process::PID<FetcherProcess>& fetcher);
+    ~Metrics();
+
+    // Number of URIs served from an existing cache entry, respectively
+    // for which a new cache entry had to be downloaded.
+    process::metrics::Counter cache_hits;
+    process::metrics::Counter cache_misses;
+
+    process::metrics::Gauge cache_hit_rate;
+
+    // Number of bytes served from the cache instead of downloading.
+    process::metrics::Counter cache_bytes_saved;
+
+    // Time the mesos-fetcher spent downloading each URI, respectively
+    // fetching it into the sandbox (including the download).
+    process::metrics::Timer<Milliseconds> download_time;
+    process::metrics::Timer<Milliseconds> fetch_time;
+  } metrics;
+
+  double _cache_hit_rate();
 };
 
 } // namespace slave {
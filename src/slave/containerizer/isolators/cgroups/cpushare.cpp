@@ -468,10 +468,11 @@ Future<ResourceStatistics> CgroupsCpushareIsolatorProcess::usage(
   PCHECK(ticks > 0) << "Failed to get sysconf(_SC_CLK_TCK)";
 
   // Add the cpuacct.stat information.
-  Try<hashmap<string, uint64_t>> stat = cgroups::stat(
+  Try<hashmap<string, uint64_t>> stat = reader.stat(
       hierarchies["cpuacct"],
       info->cgroup,
-      "cpuacct.stat");
+      "cpuacct.stat",
+      {"user", "system"});
 
   if (stat.isError()) {
     return Failure("Failed to read cpuacct.stat: " + stat.error());
@@ -489,7 +490,12 @@ Future<ResourceStatistics> CgroupsCpushareIsolatorProcess::usage(
 
   // Add the cpu.stat information only if CFS is enabled.
   if (flags.cgroups_enable_cfs) {
-    stat = cgroups::stat(hierarchies["cpu"], info->cgroup, "cpu.stat");
+    stat = reader.stat(
+        hierarchies["cpu"],
+        info->cgroup,
+        "cpu.stat",
+        {"nr_periods", "nr_throttled", "throttled_time"});
+
     if (stat.isError()) {
       return Failure("Failed to read cpu.stat: " + stat.error());
     }
@@ -561,6 +567,10 @@ Future<list<Nothing>> CgroupsCpushareIsolatorProcess::_cleanup(
         " : " + (future.isFailed() ? future.failure() : "discarded"));
   }
 
+  foreach (const string& subsystem, subsystems) {
+    reader.remove(hierarchies[subsystem], infos[containerId]->cgroup);
+  }
+
   delete infos[containerId];
   infos.erase(containerId);
 
@@ -29,6 +29,8 @@
 #include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 
+#include "linux/cgroups.hpp"
+
 #include "slave/flags.hpp"
 
 #include "slave/containerizer/isolator.hpp"
@@ -111,6 +113,9 @@ private:
   // will be only one element in the vector which is 'cpu,cpuacct'.
   std::vector<std::string> subsystems;
 
+  // Keeps the control files read by usage() open.
+  cgroups::StatisticsReader reader;
+
   // TODO(bmahler): Use Owned<Info>.
   hashmap<ContainerID, Info*> infos;
 };
@@ -422,28 +422,37 @@ Future<ResourceStatistics> CgroupsMemIsolatorProcess::usage(
   // The rss from memory.stat is wrong in two dimensions:
   //   1. It does not include child cgroups.
   //   2. It does not include any file backed pages.
-  Try<Bytes> usage = cgroups::memory::usage_in_bytes(hierarchy, info->cgroup);
+  Try<uint64_t> usage =
+    reader.value(hierarchy, info->cgroup, "memory.usage_in_bytes");
   if (usage.isError()) {
     return Failure("Failed to parse memory.usage_in_bytes: " + usage.error());
   }
 
-  result.set_mem_total_bytes(usage.get().bytes());
+  result.set_mem_total_bytes(usage.get());
 
   if (limitSwap) {
-    Try<Bytes> usage =
-      cgroups::memory::memsw_usage_in_bytes(hierarchy, info->cgroup);
+    Try<uint64_t> usage =
+      reader.value(hierarchy, info->cgroup, "memory.memsw.usage_in_bytes");
     if (usage.isError()) {
       return Failure(
         "Failed to parse memory.memsw.usage_in_bytes: " + usage.error());
     }
 
-    result.set_mem_total_memsw_bytes(usage.get().bytes());
+    result.set_mem_total_memsw_bytes(usage.get());
   }
 
   // TODO(bmahler): Add namespacing to cgroups to enforce the expected
   // structure, e.g, cgroups::memory::stat.
-  Try<hashmap<string, uint64_t>> stat =
-    cgroups::stat(hierarchy, info->cgroup, "memory.stat");
+  Try<hashmap<string, uint64_t>> stat = reader.stat(
+      hierarchy,
+      info->cgroup,
+      "memory.stat",
+      {"total_cache",
+       "total_rss",
+       "total_mapped_file",
+       "total_swap",
+       "total_unevictable"});
+
   if (stat.isError()) {
     return Failure("Failed to read memory.stat: " + stat.error());
   }
@@ -578,6 +587,8 @@ Future<Nothing> CgroupsMemIsolatorProcess::_cleanup(
                                               : "discarded"));
   }
 
+  reader.remove(hierarchy, infos[containerId]->cgroup);
+
   delete infos[containerId];
   infos.erase(containerId);
 
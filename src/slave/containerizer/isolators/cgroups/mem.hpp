@@ -130,6 +130,9 @@ private:
 
   const bool limitSwap;
 
+  // Keeps the control files read by usage() open.
+  cgroups::StatisticsReader reader;
+
   // TODO(bmahler): Use Owned<Info>.
   hashmap<ContainerID, Info*> infos;
 };
@@ -60,6 +60,7 @@ using std::vector;
 using process::Clock;
 using process::Failure;
 using process::Future;
+using process::Owned;
 using process::PID;
 using process::Time;
 
@@ -71,10 +72,6 @@ Try<Isolator*> CgroupsPerfEventIsolatorProcess::create(const Flags& flags)
 {
   LOG(INFO) << "Creating PerfEvent isolator";
 
-  if (!perf::supported()) {
-    return Error("Perf is not supported");
-  }
-
   if (flags.perf_duration > flags.perf_interval) {
     return Error("Sampling perf for duration (" +
                  stringify(flags.perf_duration) +
@@ -93,11 +90,6 @@ Try<Isolator*> CgroupsPerfEventIsolatorProcess::create(const Flags& flags)
     events.insert(event);
   }
 
-  if (!perf::valid(events)) {
-    return Error("Failed to create PerfEvent isolator, invalid events: " +
-                 stringify(events));
-  }
-
   Try<string> hierarchy = cgroups::prepare(
       flags.cgroups_hierarchy,
       "perf_event",
@@ -107,12 +99,37 @@ Try<Isolator*> CgroupsPerfEventIsolatorProcess::create(const Flags& flags)
     return Error("Failed to create perf_event cgroup: " + hierarchy.error());
   }
 
+  // Prefer counting the events natively, which avoids executing
+  // 'perf stat' for every sample.
+  Try<Owned<perf::Counters>> counters =
+    perf::Counters::create(events, hierarchy.get());
+
+  if (counters.isSome()) {
+    LOG(INFO) << "PerfEvent isolator will count events natively";
+  } else {
+    LOG(INFO) << "PerfEvent isolator will execute 'perf stat' since the"
+              << " events can't be counted natively: " << counters.error();
+
+    if (!perf::supported()) {
+      return Error("Perf is not supported");
+    }
+
+    if (!perf::valid(events)) {
+      return Error("Failed to create PerfEvent isolator, invalid events: " +
+                   stringify(events));
+    }
+  }
+
   LOG(INFO) << "PerfEvent isolator will profile for " << flags.perf_duration
             << " every " << flags.perf_interval
             << " for events: " << stringify(events);
 
-  process::Owned<MesosIsolatorProcess> process(
-      new CgroupsPerfEventIsolatorProcess(flags, hierarchy.get(), events));
+  Owned<MesosIsolatorProcess> process(
+      new CgroupsPerfEventIsolatorProcess(
+          flags,
+          hierarchy.get(),
+          events,
+          counters.isSome() ? counters.get() : Owned<perf::Counters>()));
 
   return new MesosIsolator(process);
 }
@@ -332,6 +349,11 @@ Future<Nothing> CgroupsPerfEventIsolatorProcess::cleanup(
 
   info->destroying = true;
 
+  // Close any native counters so they don't keep the cgroup around.
+  if (counters.get() != NULL) {
+    counters->remove(info->cgroup);
+  }
+
   return cgroups::destroy(hierarchy, info->cgroup)
     .then(defer(PID<CgroupsPerfEventIsolatorProcess>(this),
                 &CgroupsPerfEventIsolatorProcess::_cleanup,
@@ -383,6 +405,20 @@ void CgroupsPerfEventIsolatorProcess::sample()
     }
   }
 
+  if (counters.get() != NULL) {
+    Try<Nothing> start = counters->start(cgroups);
+    if (start.isError()) {
+      _sample(Clock::now() + flags.perf_interval, Failure(start.error()));
+      return;
+    }
+
+    delay(flags.perf_duration,
+          PID<CgroupsPerfEventIsolatorProcess>(this),
+          &CgroupsPerfEventIsolatorProcess::__sample,
+          Clock::now() + flags.perf_interval);
+    return;
+  }
+
   // The discard timeout includes an allowance of twice the
   // reaper interval to ensure we see the perf process exit.
   Duration timeout = flags.perf_duration + process::MAX_REAP_INTERVAL() * 2;
@@ -430,6 +466,19 @@ void CgroupsPerfEventIsolatorProcess::_sample(
         &CgroupsPerfEventIsolatorProcess::sample);
 }
 
+void CgroupsPerfEventIsolatorProcess::__sample(const Time& next)
+{
+  CHECK_NOTNULL(counters.get());
+
+  Try<hashmap<string, PerfStatistics>> statistics = counters->stop();
+  if (statistics.isError()) {
+    _sample(next, Failure(statistics.error()));
+    return;
+  }
+
+  _sample(next, statistics.get());
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
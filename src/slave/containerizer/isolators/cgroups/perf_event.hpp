@@ -21,11 +21,14 @@
 
 #include <set>
 
+#include <process/owned.hpp>
 #include <process/time.hpp>
 
 #include <stout/hashmap.hpp>
 #include <stout/nothing.hpp>
 
+#include "linux/perf.hpp"
+
 #include "slave/flags.hpp"
 
 #include "slave/containerizer/isolator.hpp"
@@ -75,10 +78,12 @@ private:
   CgroupsPerfEventIsolatorProcess(
       const Flags& _flags,
       const std::string& _hierarchy,
-      const std::set<std::string>& _events)
+      const std::set<std::string>& _events,
+      const process::Owned<perf::Counters>& _counters)
     : flags(_flags),
       hierarchy(_hierarchy),
-      events(_events) {}
+      events(_events),
+      counters(_counters) {}
 
   void sample();
 
@@ -86,6 +91,8 @@ private:
       const process::Time& next,
       const process::Future<hashmap<std::string, PerfStatistics>>& statistics);
 
+  void __sample(const process::Time& next);
+
   virtual process::Future<Nothing> _cleanup(const ContainerID& containerId);
 
   struct Info
@@ -116,6 +123,10 @@ private:
   // Set of events to sample.
   std::set<std::string> events;
 
+  // Native counters for sampling the events, or NULL if the events
+  // can't be counted natively and 'perf stat' is executed instead.
+  process::Owned<perf::Counters> counters;
+
   // TODO(jieyu): Use Owned<Info>.
   hashmap<ContainerID, Info*> infos;
 };
@@ -0,0 +1,233 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <process/dispatch.hpp>
+#include <process/process.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "linux/fs.hpp"
+
+#include "slave/containerizer/provisioner/backends/overlay.hpp"
+
+using namespace process;
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+class OverlayBackendProcess : public Process<OverlayBackendProcess>
+{
+public:
+  Future<Nothing> provision(const vector<string>& layers, const string& rootfs);
+
+  Future<bool> destroy(const string& rootfs);
+};
+
+
+// Returns the directory holding the upper and work directories for
+// the specified rootfs, i.e., '<backend>/scratch/<rootfs_id>' for
+// the rootfs '<backend>/rootfses/<rootfs_id>'.
+static string getScratchDir(const string& rootfs)
+{
+  const Path path(rootfs);
+
+  return path::join(
+      Path(path.dirname()).dirname(),
+      "scratch",
+      path.basename());
+}
+
+
+Try<Owned<Backend>> OverlayBackend::create(const Flags&)
+{
+  Result<string> user = os::user();
+  if (!user.isSome()) {
+    return Error("Failed to determine user: " +
+                 (user.isError() ? user.error() : "username not found"));
+  }
+
+  if (user.get() != "root") {
+    return Error("OverlayBackend requires root privileges");
+  }
+
+  Try<bool> supported = fs::supported("overlay");
+  if (supported.isError()) {
+    return Error(
+        "Failed to check overlay filesystem support: " + supported.error());
+  }
+
+  if (!supported.get()) {
+    return Error("The overlay filesystem is not supported by the kernel");
+  }
+
+  return Owned<Backend>(new OverlayBackend(
+      Owned<OverlayBackendProcess>(new OverlayBackendProcess())));
+}
+
+
+OverlayBackend::~OverlayBackend()
+{
+  terminate(process.get());
+  wait(process.get());
+}
+
+
+OverlayBackend::OverlayBackend(Owned<OverlayBackendProcess> _process)
+  : process(_process)
+{
+  spawn(CHECK_NOTNULL(process.get()));
+}
+
+
+Future<Nothing> OverlayBackend::provision(
+    const vector<string>& layers,
+    const string& rootfs)
+{
+  return dispatch(
+      process.get(), &OverlayBackendProcess::provision, layers, rootfs);
+}
+
+
+Future<bool> OverlayBackend::destroy(const string& rootfs)
+{
+  return dispatch(process.get(), &OverlayBackendProcess::destroy, rootfs);
+}
+
+
+Future<Nothing> OverlayBackendProcess::provision(
+    const vector<string>& layers,
+    const string& rootfs)
+{
+  if (layers.size() == 0) {
+    return Failure("No filesystem layers provided");
+  }
+
+  if (os::exists(rootfs)) {
+    return Failure("Rootfs is already provisioned");
+  }
+
+  const string scratchDir = getScratchDir(rootfs);
+  const string upperDir = path::join(scratchDir, "upperdir");
+  const string workDir = path::join(scratchDir, "workdir");
+
+  const vector<string> directories = {rootfs, upperDir, workDir};
+
+  foreach (const string& directory, directories) {
+    Try<Nothing> mkdir = os::mkdir(directory);
+    if (mkdir.isError()) {
+      return Failure(
+          "Failed to create directory '" + directory + "': " + mkdir.error());
+    }
+  }
+
+  // Overlayfs stacks the lower directories starting from the rightmost
+  // one, whereas files in a layer shadow those from the layers earlier
+  // in 'layers'.
+  vector<string> lowerDirs(layers.rbegin(), layers.rend());
+
+  const string options =
+    "lowerdir=" + strings::join(":", lowerDirs) +
+    ",upperdir=" + upperDir +
+    ",workdir=" + workDir;
+
+  // The kernel copies at most a page of mount options.
+  if (options.size() >= (size_t) sysconf(_SC_PAGESIZE)) {
+    return Failure(
+        "Too many layers (" + stringify(layers.size()) + ") to mount "
+        "with the overlay backend");
+  }
+
+  VLOG(1) << "Provisioning rootfs '" << rootfs << "' with overlay options '"
+          << options << "'";
+
+  Try<Nothing> mount = fs::mount(
+      "overlay",
+      rootfs,
+      "overlay",
+      0,
+      options);
+
+  if (mount.isError()) {
+    return Failure(
+        "Failed to mount rootfs '" + rootfs + "' with overlayfs: " +
+        mount.error());
+  }
+
+  return Nothing();
+}
+
+
+Future<bool> OverlayBackendProcess::destroy(const string& rootfs)
+{
+  Try<fs::MountInfoTable> mountTable = fs::MountInfoTable::read();
+
+  if (mountTable.isError()) {
+    return Failure("Failed to read mount table: " + mountTable.error());
+  }
+
+  foreach (const fs::MountInfoTable::Entry& entry, mountTable.get().entries) {
+    if (entry.target == rootfs) {
+      // NOTE: This would fail if the rootfs is still in use.
+      Try<Nothing> unmount = fs::unmount(entry.target);
+      if (unmount.isError()) {
+        return Failure(
+            "Failed to destroy overlay-mounted rootfs '" + rootfs + "': " +
+            unmount.error());
+      }
+
+      // Like for the bind backend, it is OK to ignore EBUSY here as
+      // the provisioner retries removing the container directory
+      // during slave recovery.
+      if (::rmdir(rootfs.c_str()) != 0 && errno != EBUSY) {
+        return Failure(
+            "Failed to remove rootfs mount point '" + rootfs + "': " +
+            strerror(errno));
+      }
+
+      const string scratchDir = getScratchDir(rootfs);
+
+      Try<Nothing> rmdir = os::rmdir(scratchDir);
+      if (rmdir.isError()) {
+        return Failure(
+            "Failed to remove scratch directory '" + scratchDir + "': " +
+            rmdir.error());
+      }
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,71 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PROVISIONER_BACKENDS_OVERLAY_HPP__
+#define __PROVISIONER_BACKENDS_OVERLAY_HPP__
+
+#include "slave/containerizer/provisioner/backend.hpp"
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Forward declaration.
+class OverlayBackendProcess;
+
+
+// This backend stacks the layers read-only using overlayfs and puts a
+// per-container writable directory on top, so provisioning a rootfs
+// takes a single mount regardless of the size of the image. NOTE:
+// 1) It requires a kernel supporting the 'overlay' filesystem (3.18+)
+//    and multiple layers require support for multiple lower
+//    directories (4.0+).
+// 2) The writable directory, as well as the overlayfs work directory,
+//    is kept in a 'scratch' directory next to the 'rootfses' directory
+//    of the backend and removed when the rootfs is destroyed. Like for
+//    the copy backend, writes into the rootfs are not accounted for in
+//    terms of disk usage.
+// 3) The layers must not be modified while they are in use.
+class OverlayBackend : public Backend
+{
+public:
+  virtual ~OverlayBackend();
+
+  // OverlayBackend doesn't use any flag.
+  static Try<process::Owned<Backend>> create(const Flags&);
+
+  virtual process::Future<Nothing> provision(
+      const std::vector<std::string>& layers,
+      const std::string& rootfs);
+
+  virtual process::Future<bool> destroy(const std::string& rootfs);
+
+private:
+  explicit OverlayBackend(process::Owned<OverlayBackendProcess> process);
+
+  OverlayBackend(const OverlayBackend&); // Not copyable.
+  OverlayBackend& operator=(const OverlayBackend&); // Not assignable.
+
+  process::Owned<OverlayBackendProcess> process;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROVISIONER_BACKENDS_OVERLAY_HPP__
@@ -19,6 +19,7 @@
 #include "slave/containerizer/provisioner/docker/puller.hpp"
 
 #include "slave/containerizer/provisioner/docker/local_puller.hpp"
+#include "slave/containerizer/provisioner/docker/registry_puller.hpp"
 
 using std::string;
 
@@ -37,6 +38,10 @@ Try<Owned<Puller>> Puller::create(const Flags& flags)
     return Owned<Puller>(new LocalPuller(flags));
   }
 
+  if (puller == "registry") {
+    return RegistryPuller::create(flags);
+  }
+
   return Error("Unknown or unsupported docker puller: " + puller);
 }
 
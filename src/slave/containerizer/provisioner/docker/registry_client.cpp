@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 
+#include <memory>
 #include <vector>
 
 #include <process/defer.hpp>
@@ -34,6 +35,7 @@ using process::Future;
 using process::Owned;
 using process::Process;
 
+using process::http::Pipe;
 using process::http::Request;
 using process::http::Response;
 using process::http::URL;
@@ -74,6 +76,12 @@ public:
       const Duration& timeout,
       size_t maxSize);
 
+  Future<size_t> streamBlob(
+      const string& path,
+      const Option<string>& digest,
+      int fd,
+      const Duration& timeout);
+
 private:
   RegistryClientProcess(
     const Owned<TokenManager>& tokenMgr,
@@ -174,6 +182,100 @@ Future<size_t> RegistryClient::getBlob(
 }
 
 
+Future<size_t> RegistryClient::getBlob(
+    const string& _path,
+    const Option<string>& _digest,
+    int fd,
+    const Option<Duration>& _timeout)
+{
+  Duration timeout = _timeout.getOrElse(DEFAULT_MANIFEST_TIMEOUT_SECS);
+
+  return dispatch(
+        process_.get(),
+        &RegistryClientProcess::streamBlob,
+        _path,
+        _digest,
+        fd,
+        timeout);
+}
+
+
+// Reads the next chunk of the body of a streamed response. Fails if
+// no data arrives within the timeout, in which case the reader gets
+// closed so that the connection is torn down rather than left to
+// hang on a stalled registry.
+static Future<string> read(Pipe::Reader reader, const Duration& timeout)
+{
+  return reader.read()
+    .after(timeout, [=](const Future<string>&) mutable -> Future<string> {
+      reader.close();
+      return Failure(
+          "No data received for " + stringify(timeout) +
+          " while reading the response body");
+    });
+}
+
+
+// Reads the remaining body of a streamed response until EOF.
+static Future<string> read(
+    Pipe::Reader reader,
+    const std::shared_ptr<string>& buffer,
+    const Duration& timeout)
+{
+  return read(reader, timeout)
+    .then([=](const string& data) -> Future<string> {
+      if (data.empty()) { // EOF.
+        return *buffer;
+      }
+
+      buffer->append(data);
+
+      return read(reader, buffer, timeout);
+    });
+}
+
+
+// Returns the specified streamed response once its body has been
+// read completely, failing if the body stalls for 'timeout'.
+static Future<Response> read(const Response& response, const Duration& timeout)
+{
+  CHECK_EQ(Response::PIPE, response.type);
+  CHECK_SOME(response.reader);
+
+  return read(response.reader.get(), std::make_shared<string>(), timeout)
+    .then([response](const string& body) {
+      Response bodyResponse = response;
+      bodyResponse.type = Response::BODY;
+      bodyResponse.body = body;
+      bodyResponse.reader = None();
+      return bodyResponse;
+    });
+}
+
+
+// Writes the body of a streamed response to the file descriptor as it
+// is received and returns its size. Fails if the body stalls for
+// 'timeout'.
+static Future<size_t> write(
+    Pipe::Reader reader,
+    int fd,
+    size_t size,
+    const Duration& timeout)
+{
+  return read(reader, timeout)
+    .then([=](const string& data) -> Future<size_t> {
+      if (data.empty()) { // EOF.
+        return size;
+      }
+
+      return process::io::write(fd, data)
+        .then([=]() {
+          return write(reader, fd, size + data.size(), timeout);
+        });
+    });
+}
+
+
 Try<Owned<RegistryClientProcess>> RegistryClientProcess::create(
     const URL& authServer,
     const URL& registryServer,
@@ -252,11 +354,21 @@ Future<Response> RegistryClientProcess::doHttpGet(
     bool resend,
     const Option<string>& lastResponseStatus) const
 {
-  return process::http::get(url, headers)
+  // Only the body of a successful response is streamed (e.g., for
+  // blobs to not be buffered in memory), while the body of any other
+  // response is read completely before it gets handled below.
+  return process::http::streaming::get(url, headers)
     .after(timeout, [](
         const Future<Response>& httpResponseFuture) -> Future<Response> {
       return Failure("Response timeout");
     })
+    .then([timeout](const Response& httpResponse) -> Future<Response> {
+      if (httpResponse.status == "200 OK") {
+        return httpResponse;
+      }
+
+      return read(httpResponse, timeout);
+    })
     .then(defer(self(), [=](
         const Response& httpResponse) -> Future<Response> {
       VLOG(1) << "Response status: " + httpResponse.status;
@@ -493,6 +605,12 @@ Future<ManifestResponse> RegistryClientProcess::getManifest(
   };
 
   return doHttpGet(manifestURL, None(), timeout, true, None())
+    .then([timeout](const Response& response) {
+      return read(response, timeout)
+        .after(timeout, [](const Future<Response>&) -> Future<Response> {
+          return Failure("Response timeout");
+        });
+    })
     .then([getManifestResponse] (
         const Response& response) -> Future<ManifestResponse> {
       Try<ManifestResponse> manifestResponse = getManifestResponse(response);
@@ -534,6 +652,28 @@ Future<size_t> RegistryClientProcess::getBlob(
      return Failure(prepare.error());
   }
 
+  // TODO(jojy): Add check for max size.
+  Try<int> fd = os::open(
+      filePath.value,
+      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (fd.isError()) {
+    return Failure("Failed to open file '" + filePath.value + "': " +
+                   fd.error());
+  }
+
+  return streamBlob(path, digest, fd.get(), timeout)
+    .onAny([fd]() { os::close(fd.get()); });
+}
+
+
+Future<size_t> RegistryClientProcess::streamBlob(
+    const string& path,
+    const Option<string>& digest,
+    int fd,
+    const Duration& timeout)
+{
   if (strings::contains(path, " ")) {
     return Failure("Invalid repository path: " + path);
   }
@@ -542,28 +682,15 @@ Future<size_t> RegistryClientProcess::getBlob(
   blobURL.path =
     "v2/" + path + "/blobs/" + digest.getOrElse("");
 
-  auto saveBlob = [filePath](
-      const Response& httpResponse) -> Future<size_t> {
-    // TODO(jojy): Add verification step.
-    // TODO(jojy): Add check for max size.
-    size_t size = httpResponse.body.length();
-    Try<int> fd = os::open(
-        filePath.value,
-        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
-        S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-
-    if (fd.isError()) {
-      return Failure("Failed to open file '" + filePath.value + "': " +
-                     fd.error());
-    }
-
-    return process::io::write(fd.get(), httpResponse.body)
-      .then([size](const Future<Nothing>&) { return size; })
-      .onAny([fd]() { os::close(fd.get()); } );
-  };
-
+  // NOTE: The timeout of 'doHttpGet' only covers the response headers,
+  // the body is subject to the same timeout between any two chunks
+  // (see 'write' above) so that a stalled registry fails the pull
+  // rather than holding on to a download slot forever.
+  // TODO(jojy): Add verification step.
   return doHttpGet(blobURL, None(), timeout, true, None())
-    .then([saveBlob](const Response& response) { return saveBlob(response); });
+    .then([fd, timeout](const Response& response) {
+      return write(response.reader.get(), fd, 0, timeout);
+    });
 }
 
 } // namespace registry {
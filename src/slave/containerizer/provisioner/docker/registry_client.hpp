@@ -133,6 +133,26 @@ public:
       const Option<Duration>& timeout,
       const Option<size_t>& maxSize);
 
+  /**
+   * Fetches blob for a repository from the client's remote registry server
+   * and writes it to the file descriptor as it is being received, e.g., to
+   * extract a layer while it is still being downloaded.
+   *
+   * @param path path of the repository on the registry.
+   * @param digest digest of the blob (from manifest).
+   * @param fd file descriptor to write the blob to, which is not closed.
+   * @param timeout Maximum time ater which the request will timeout and return
+   *    a failure if no response was received. Will default to
+   *    RESPONSE_TIMEOUT.
+   * @return size of downloaded blob on success.
+   *         Failure in case of any errors.
+   */
+  process::Future<size_t> getBlob(
+      const std::string& path,
+      const Option<std::string>& digest,
+      int fd,
+      const Option<Duration>& timeout);
+
   ~RegistryClient();
 
 private:
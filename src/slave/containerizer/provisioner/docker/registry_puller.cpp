@@ -0,0 +1,477 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <list>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+
+#include <process/collect.hpp>
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/http.hpp>
+#include <process/subprocess.hpp>
+
+#include "common/status_utils.hpp"
+
+#include "slave/constants.hpp"
+
+#include "slave/containerizer/provisioner/docker/paths.hpp"
+#include "slave/containerizer/provisioner/docker/registry_client.hpp"
+#include "slave/containerizer/provisioner/docker/registry_puller.hpp"
+
+using namespace process;
+
+using std::list;
+using std::pair;
+using std::queue;
+using std::string;
+using std::tuple;
+using std::vector;
+
+using mesos::internal::slave::docker::registry::RegistryClient;
+
+using ManifestResponse = RegistryClient::ManifestResponse;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace docker {
+
+class RegistryPullerProcess : public process::Process<RegistryPullerProcess>
+{
+public:
+  RegistryPullerProcess(
+      const Flags& _flags,
+      const Owned<RegistryClient>& _client)
+    : flags(_flags), client(_client), downloads(0) {}
+
+  ~RegistryPullerProcess() {}
+
+  Future<list<pair<string, string>>> pull(const Image::Name& name);
+
+private:
+  Future<list<pair<string, string>>> _pull(
+      const string& path,
+      const ManifestResponse& manifest);
+
+  Future<pair<string, string>> fetchLayer(
+      const string& path,
+      const string& digest);
+
+  Future<Nothing> download(
+      const string& repository,
+      const string& digest,
+      const string& layerId);
+
+  Future<Nothing> _download(
+      const string& digest,
+      const string& layerId,
+      const string& staging,
+      const tuple<Future<size_t>, Future<Option<int>>>& results);
+
+  // Limits the number of parallel downloads: 'acquire' is satisfied
+  // once a download slot is available, which has to be given back
+  // with 'release'.
+  Future<Nothing> acquire();
+  void release();
+
+  const Flags flags;
+  Owned<RegistryClient> client;
+
+  // Layers currently being fetched, keyed by their layer id, so that
+  // concurrent pulls of images sharing a layer fetch it only once.
+  hashmap<string, Future<Nothing>> fetching;
+
+  size_t downloads;
+  queue<Owned<Promise<Nothing>>> waiters;
+};
+
+
+// Parses a URL of the form 'scheme://host[:port]', e.g., as given by
+// the '--docker_registry' flag.
+static Try<process::http::URL> parseURL(const string& value)
+{
+  size_t index = value.find("://");
+  if (index == string::npos) {
+    return Error("Missing scheme in '" + value + "'");
+  }
+
+  const string scheme = value.substr(0, index);
+  if (scheme != "http" && scheme != "https") {
+    return Error("Unsupported scheme '" + scheme + "'");
+  }
+
+  string host = strings::remove(
+      value.substr(index + 3), "/", strings::SUFFIX);
+
+  uint16_t port = scheme == "https" ? 443 : 80;
+
+  index = host.find(':');
+  if (index != string::npos) {
+    Try<uint16_t> _port = numify<uint16_t>(host.substr(index + 1));
+    if (_port.isError()) {
+      return Error("Invalid port in '" + value + "': " + _port.error());
+    }
+
+    port = _port.get();
+    host = host.substr(0, index);
+  }
+
+  if (host.empty() || strings::contains(host, "/")) {
+    return Error("Invalid host in '" + value + "'");
+  }
+
+  return process::http::URL(scheme, host, port);
+}
+
+
+// Returns the path of the image's repository on the registry, e.g.,
+// 'library/busybox' for both 'busybox' and 'host:5000/library/busybox'.
+// NOTE: The host of the image's registry is not used, images are
+// always pulled from the registry given by '--docker_registry'.
+static string getRepositoryPath(const Image::Name& name)
+{
+  string namespace_ = "library";
+
+  if (name.has_registry()) {
+    size_t index = name.registry().find('/');
+    if (index != string::npos) {
+      namespace_ = name.registry().substr(index + 1);
+    }
+  }
+
+  return namespace_ + "/" + name.repository();
+}
+
+
+// Returns the id of the layer with the specified digest in the store.
+// The ':' of the digest (e.g., 'sha256:<hex>') is replaced as it is
+// the separator of the layer directories of the overlay backend.
+static string getLayerId(const string& digest)
+{
+  return strings::replace(digest, ":", "-");
+}
+
+
+Try<Owned<Puller>> RegistryPuller::create(const Flags& flags)
+{
+  Try<process::http::URL> registry = parseURL(flags.docker_registry);
+  if (registry.isError()) {
+    return Error("Failed to parse '--docker_registry': " + registry.error());
+  }
+
+  Try<process::http::URL> authServer = parseURL(flags.docker_auth_server);
+  if (authServer.isError()) {
+    return Error(
+        "Failed to parse '--docker_auth_server': " + authServer.error());
+  }
+
+  Try<Owned<RegistryClient>> client =
+    RegistryClient::create(authServer.get(), registry.get(), None());
+
+  if (client.isError()) {
+    return Error("Failed to create registry client: " + client.error());
+  }
+
+  Owned<RegistryPullerProcess> process(
+      new RegistryPullerProcess(flags, client.get()));
+
+  return Owned<Puller>(new RegistryPuller(process));
+}
+
+
+RegistryPuller::RegistryPuller(const Owned<RegistryPullerProcess>& _process)
+  : process(_process)
+{
+  process::spawn(process.get());
+}
+
+
+RegistryPuller::~RegistryPuller()
+{
+  process::terminate(process.get());
+  process::wait(process.get());
+}
+
+
+Future<list<pair<string, string>>> RegistryPuller::pull(
+    const Image::Name& name,
+    const string& directory)
+{
+  return dispatch(process.get(), &RegistryPullerProcess::pull, name);
+}
+
+
+Future<list<pair<string, string>>> RegistryPullerProcess::pull(
+    const Image::Name& name)
+{
+  const string path = getRepositoryPath(name);
+
+  VLOG(1) << "Pulling image '" << stringify(name) << "' from repository '"
+          << path << "' of registry '" << flags.docker_registry << "'";
+
+  return client->getManifest(path, name.tag(), None())
+    .then(defer(self(), &Self::_pull, path, lambda::_1));
+}
+
+
+Future<list<pair<string, string>>> RegistryPullerProcess::_pull(
+    const string& path,
+    const ManifestResponse& manifest)
+{
+  // The layers in the manifest are ordered with the top layer first
+  // and a layer (e.g., an empty one) can be listed more than once, in
+  // which case only its topmost occurrence needs to be applied.
+  vector<string> digests;
+  foreach (const auto& layer, manifest.fsLayerInfoList) {
+    const string& digest = layer.checksumInfo;
+    if (std::find(digests.begin(), digests.end(), digest) == digests.end()) {
+      digests.insert(digests.begin(), digest);
+    }
+  }
+
+  list<Future<pair<string, string>>> futures;
+  foreach (const string& digest, digests) {
+    futures.push_back(fetchLayer(path, digest));
+  }
+
+  return collect(futures);
+}
+
+
+Future<pair<string, string>> RegistryPullerProcess::fetchLayer(
+    const string& path,
+    const string& digest)
+{
+  const string layerId = getLayerId(digest);
+  const pair<string, string> layer(
+      layerId,
+      paths::getImageLayerRootfsPath(flags.docker_store_dir, layerId));
+
+  if (os::exists(layer.second)) {
+    VLOG(1) << "Layer '" << digest << "' is already in the store";
+    return layer;
+  }
+
+  if (!fetching.contains(layerId)) {
+    Future<Nothing> fetch = acquire()
+      .then(defer(self(), &Self::download, path, digest, layerId))
+      .onAny(defer(self(), &Self::release));
+
+    fetching[layerId] = fetch;
+
+    fetch.onAny(defer(self(), [=](const Future<Nothing>&) {
+      fetching.erase(layerId);
+    }));
+  }
+
+  return fetching[layerId]
+    .then([layer]() { return layer; });
+}
+
+
+Future<Nothing> RegistryPullerProcess::download(
+    const string& repository,
+    const string& digest,
+    const string& layerId)
+{
+  // We extract the layer into a staging directory of its own and then
+  // move it into the store, so that neither a failed pull leaves a
+  // partially extracted layer in the store nor the failure of another
+  // image's pull (removing its staging directory) affects this layer.
+  Try<string> staging =
+    os::mkdtemp(paths::getStagingTempDir(flags.docker_store_dir));
+
+  if (staging.isError()) {
+    return Failure("Failed to create a staging directory: " + staging.error());
+  }
+
+  const string rootfs = path::join(staging.get(), "rootfs");
+
+  Try<Nothing> mkdir = os::mkdir(rootfs);
+  if (mkdir.isError()) {
+    os::rmdir(staging.get());
+    return Failure("Failed to create rootfs path '" + rootfs + "': " +
+                   mkdir.error());
+  }
+
+  VLOG(1) << "Downloading layer '" << digest << "' to '" << rootfs << "'";
+
+  // The layer is written to 'tar' as it is being downloaded. We use
+  // our own pipe (rather than Subprocess::PIPE) so that we can close
+  // its write end once the download completes, which signals EOF.
+  int pipes[2];
+  if (::pipe(pipes) < 0) {
+    os::rmdir(staging.get());
+    return Failure(ErrnoError("Failed to create pipe").message);
+  }
+
+  Try<Nothing> cloexec = os::cloexec(pipes[0]);
+  if (cloexec.isSome()) {
+    cloexec = os::cloexec(pipes[1]);
+  }
+
+  if (cloexec.isError()) {
+    os::close(pipes[0]);
+    os::close(pipes[1]);
+    os::rmdir(staging.get());
+    return Failure("Failed to cloexec pipe: " + cloexec.error());
+  }
+
+  // TODO(jojy): Verify the layer against its digest.
+  const vector<string> argv = {
+    "tar",
+    "-C",
+    rootfs,
+    "-x",
+    "-z"
+  };
+
+  Try<Subprocess> s = subprocess(
+      "tar",
+      argv,
+      Subprocess::FD(pipes[0]),
+      Subprocess::PATH("/dev/null"),
+      Subprocess::PATH("/dev/null"));
+
+  os::close(pipes[0]);
+
+  if (s.isError()) {
+    os::close(pipes[1]);
+    os::rmdir(staging.get());
+    return Failure("Failed to create tar subprocess: " + s.error());
+  }
+
+  const int fd = pipes[1];
+
+  Future<size_t> blob = client->getBlob(repository, digest, fd, None())
+    .onAny([fd]() { os::close(fd); });
+
+  const string _staging = staging.get();
+
+  // NOTE: We wait for 'tar' even if the download failed, since it
+  // might still be writing into the staging directory until it sees
+  // EOF.
+  return await(blob, s.get().status())
+    .then(defer(self(),
+                &Self::_download,
+                digest,
+                layerId,
+                _staging,
+                lambda::_1))
+    .onAny([_staging]() {
+      Try<Nothing> rmdir = os::rmdir(_staging);
+      if (rmdir.isError()) {
+        LOG(WARNING) << "Failed to remove staging directory: " << rmdir.error();
+      }
+    });
+}
+
+
+Future<Nothing> RegistryPullerProcess::_download(
+    const string& digest,
+    const string& layerId,
+    const string& staging,
+    const tuple<Future<size_t>, Future<Option<int>>>& results)
+{
+  const Future<size_t>& blob = std::get<0>(results);
+  const Future<Option<int>>& status = std::get<1>(results);
+
+  if (!blob.isReady()) {
+    return Failure("Failed to download layer '" + digest + "': " +
+                   (blob.isFailed() ? blob.failure() : "discarded"));
+  }
+
+  if (!status.isReady() || status.get().isNone()) {
+    return Failure("Failed to reap status for tar subprocess");
+  } else if (!WIFEXITED(status.get().get()) ||
+             WEXITSTATUS(status.get().get()) != 0) {
+    return Failure("Untar of layer '" + digest + "' failed with exit code: " +
+                   WSTRINGIFY(status.get().get()));
+  }
+
+  VLOG(1) << "Downloaded " << blob.get() << " bytes of layer '" << digest
+          << "'";
+
+  const string imageLayerPath =
+    paths::getImageLayerPath(flags.docker_store_dir, layerId);
+
+  if (!os::exists(imageLayerPath)) {
+    Try<Nothing> mkdir = os::mkdir(imageLayerPath);
+    if (mkdir.isError()) {
+      return Failure("Failed to create layer path in store for id '" +
+                     layerId + "': " + mkdir.error());
+    }
+  }
+
+  Try<Nothing> rename = os::rename(
+      path::join(staging, "rootfs"),
+      paths::getImageLayerRootfsPath(flags.docker_store_dir, layerId));
+
+  if (rename.isError()) {
+    return Failure("Failed to move layer '" + layerId +
+                   "' to store directory: " + rename.error());
+  }
+
+  return Nothing();
+}
+
+
+Future<Nothing> RegistryPullerProcess::acquire()
+{
+  if (downloads < DOCKER_REGISTRY_PULLER_MAX_DOWNLOADS) {
+    downloads++;
+    return Nothing();
+  }
+
+  Owned<Promise<Nothing>> waiter(new Promise<Nothing>());
+  waiters.push(waiter);
+
+  return waiter->future();
+}
+
+
+void RegistryPullerProcess::release()
+{
+  // Hand the slot over to the next waiting download, if any.
+  if (!waiters.empty()) {
+    Owned<Promise<Nothing>> waiter = waiters.front();
+    waiters.pop();
+    waiter->set(Nothing());
+    return;
+  }
+
+  CHECK_GT(downloads, 0u);
+  downloads--;
+}
+
+} // namespace docker {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
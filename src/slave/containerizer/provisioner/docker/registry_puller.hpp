@@ -0,0 +1,84 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PROVISIONER_DOCKER_REGISTRY_PULLER_HPP__
+#define __PROVISIONER_DOCKER_REGISTRY_PULLER_HPP__
+
+#include <list>
+#include <string>
+#include <utility>
+
+#include <process/future.hpp>
+#include <process/owned.hpp>
+
+#include <stout/try.hpp>
+
+#include "slave/containerizer/provisioner/docker/message.hpp"
+#include "slave/containerizer/provisioner/docker/puller.hpp"
+
+#include "slave/flags.hpp"
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace docker {
+
+// Forward declaration.
+class RegistryPullerProcess;
+
+
+/**
+ * RegistryPuller pulls Docker images from a Docker registry
+ * (configured with flags.docker_registry) using the registry's v2
+ * API. Layers are identified by their digest and are put directly
+ * into the store (flags.docker_store_dir) once extracted, so a layer
+ * shared by several images is only downloaded once. Layers are
+ * streamed into 'tar' while they are downloaded and up to
+ * DOCKER_REGISTRY_PULLER_MAX_DOWNLOADS of them are downloaded in
+ * parallel.
+ */
+class RegistryPuller : public Puller
+{
+public:
+  static Try<process::Owned<Puller>> create(const Flags& flags);
+
+  ~RegistryPuller();
+
+  /**
+   * Pulls the layers of the image into the store. The returned layer
+   * directories are already in the store rather than in 'directory'.
+   */
+  process::Future<std::list<std::pair<std::string, std::string>>> pull(
+      const Image::Name& name,
+      const std::string& directory);
+
+private:
+  explicit RegistryPuller(const process::Owned<RegistryPullerProcess>& process);
+
+  RegistryPuller& operator=(const RegistryPuller&) = delete; // Not assignable.
+  RegistryPuller(const RegistryPuller&) = delete; // Not copyable.
+
+  process::Owned<RegistryPullerProcess> process;
+};
+
+} // namespace docker {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROVISIONER_DOCKER_REGISTRY_PULLER_HPP__
@@ -23,6 +23,7 @@
 
 #include <glog/logging.h>
 
+#include <stout/hashmap.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 #include <stout/result.hpp>
@@ -87,6 +88,10 @@ private:
   const Flags flags;
   Owned<MetadataManager> metadataManager;
   Owned<Puller> puller;
+
+  // Images currently being pulled, keyed by their name, so that
+  // concurrent gets of the same image pull it only once.
+  hashmap<string, Future<Image>> pulling;
 };
 
 
@@ -176,6 +181,12 @@ Future<Image> StoreProcess::_get(
     return image.get();
   }
 
+  const string key = stringify(name);
+
+  if (pulling.contains(key)) {
+    return pulling[key];
+  }
+
   Try<string> staging =
     os::mkdtemp(paths::getStagingTempDir(flags.docker_store_dir));
 
@@ -183,7 +194,7 @@ Future<Image> StoreProcess::_get(
     return Failure("Failed to create a staging directory");
   }
 
-  return puller->pull(name, staging.get())
+  Future<Image> pull = puller->pull(name, staging.get())
     .then(defer(self(), &Self::moveLayers, staging.get(), lambda::_1))
     .then(defer(self(), &Self::storeImage, name, lambda::_1))
     .onAny([staging]() {
@@ -192,6 +203,14 @@ Future<Image> StoreProcess::_get(
         LOG(WARNING) << "Failed to remove staging directory: " << rmdir.error();
       }
     });
+
+  pulling[key] = pull;
+
+  pull.onAny(defer(self(), [=](const Future<Image>&) {
+    pulling.erase(key);
+  }));
+
+  return pull;
 }
 
 
@@ -250,6 +269,15 @@ Future<Nothing> StoreProcess::moveLayer(const pair<string, string>& layerPath)
                    layerPath.second + "'");
   }
 
+  const string rootfsPath =
+    paths::getImageLayerRootfsPath(flags.docker_store_dir, layerPath.first);
+
+  // The layer might already be in the store, e.g., if the puller put
+  // it there directly or it is shared with another image.
+  if (os::exists(rootfsPath)) {
+    return Nothing();
+  }
+
   const string imageLayerPath =
     paths::getImageLayerPath(flags.docker_store_dir, layerPath.first);
 
@@ -261,10 +289,7 @@ Future<Nothing> StoreProcess::moveLayer(const pair<string, string>& layerPath)
     }
   }
 
-  Try<Nothing> status = os::rename(
-      layerPath.second,
-      paths::getImageLayerRootfsPath(
-          flags.docker_store_dir, layerPath.first));
+  Try<Nothing> status = os::rename(layerPath.second, rootfsPath);
 
   if (status.isError()) {
     return Failure("Failed to move layer '" + layerPath.first +
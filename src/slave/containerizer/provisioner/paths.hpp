@@ -41,7 +41,9 @@ namespace paths {
 //             |-- backends
 //                 |-- <backend> (copy, bind, etc.)
 //                     |-- rootfses
-//                         |-- <rootfs_id> (the rootfs)
+//                     |   |-- <rootfs_id> (the rootfs)
+//                     |-- scratch (overlay only)
+//                         |-- <rootfs_id> (upper and work directories)
 //
 // There can be multiple backends due to the change of backend flags.
 // Under each backend a rootfs is identified by the 'rootfs_id' which
@@ -85,7 +85,7 @@ mesos::internal::slave::Flags::Flags()
   add(&Flags::image_provisioner_backend,
       "image_provisioner_backend",
       "Strategy for provisioning container rootfs from images,\n"
-      "e.g., 'bind', 'copy'.",
+      "e.g., 'bind', 'copy', 'overlay'.",
       "copy");
 
   add(&Flags::appc_store_dir,
@@ -100,9 +100,22 @@ mesos::internal::slave::Flags::Flags()
 
   add(&Flags::docker_puller,
       "docker_puller",
-      "Strategy for docker puller to fetch images",
+      "Strategy for docker puller to fetch images.\n"
+      "Currently supported are 'local' and 'registry'.",
       "local");
 
+  add(&Flags::docker_registry,
+      "docker_registry",
+      "URL of the Docker registry the 'registry' docker puller\n"
+      "pulls images from",
+      "https://registry-1.docker.io");
+
+  add(&Flags::docker_auth_server,
+      "docker_auth_server",
+      "URL of the authorization server the 'registry' docker puller\n"
+      "gets tokens for the registry from",
+      "https://auth.docker.io");
+
   add(&Flags::docker_store_dir,
       "docker_store_dir",
       "Directory the docker provisioner will store images in",
@@ -141,6 +154,19 @@ mesos::internal::slave::Flags::Flags()
       "(one subdirectory per slave).",
       "/tmp/mesos/fetch");
 
+  add(&Flags::fetcher_concurrency,
+      "fetcher_concurrency",
+      "Maximum number of URIs that are downloaded in parallel when\n"
+      "fetching the URIs of a single container. The downloaded URIs are\n"
+      "still extracted into the sandbox in the order they were given.",
+      DEFAULT_FETCHER_CONCURRENCY,
+      [](size_t value) -> Option<Error> {
+        if (value < 1) {
+          return Error("Expected --fetcher_concurrency to be at least 1");
+        }
+        return None();
+      });
+
   add(&Flags::work_dir,
       "work_dir",
       "Directory path to place framework work directories\n", "/tmp/mesos");
@@ -265,6 +291,17 @@ mesos::internal::slave::Flags::Flags()
       "waiting to reconnect to the slave will self-terminate.\n",
       RECOVERY_TIMEOUT);
 
+  add(&Flags::status_update_group_commit_window,
+      "status_update_group_commit_window",
+      "Amount of time during which checkpointed status updates and\n"
+      "acknowledgements are collected and then synced to disk together\n"
+      "(e.g., 5ms, 50ms, etc). Executors are only acknowledged once their\n"
+      "updates have been synced, so a larger value reduces the number of\n"
+      "disk syncs when many tasks change state at once, at the cost of\n"
+      "delaying acknowledgements. If set to 0, every update and\n"
+      "acknowledgement is synced individually.",
+      Seconds(0));
+
   add(&Flags::strict,
       "strict",
       "If strict=true, any and all recovery errors are considered fatal.\n"
@@ -318,7 +355,12 @@ mesos::internal::slave::Flags::Flags()
       "Run command 'perf list' to see all events. Event names are\n"
       "sanitized by downcasing and replacing hyphens with underscores\n"
       "when reported in the PerfStatistics protobuf, e.g., cpu-cycles\n"
-      "becomes cpu_cycles; see the PerfStatistics protobuf for all names.");
+      "becomes cpu_cycles; see the PerfStatistics protobuf for all names.\n"
+      "If all of the events can be counted using perf_event_open(2) they\n"
+      "are counted natively, otherwise 'perf stat' is executed for every\n"
+      "sample. Counting natively uses a file descriptor for every event\n"
+      "on every CPU for each container, which are kept open between\n"
+      "samples for up to half of the slave's file descriptor limit.");
 
   add(&Flags::perf_interval,
       "perf_interval",
@@ -441,6 +483,15 @@ mesos::internal::slave::Flags::Flags()
       "path used by the slave's docker image.\n",
       "/var/run/docker.sock");
 
+  add(&Flags::docker_engine_api,
+      "docker_engine_api",
+      "Whether the docker containerizer should talk to the docker daemon\n"
+      "directly via its Engine API on the --docker_socket rather than\n"
+      "by running the docker CLI, which avoids forking a process for\n"
+      "each inspect, stop and the like. Containers are still launched\n"
+      "using the docker CLI.",
+      false);
+
   add(&Flags::sandbox_directory,
       "sandbox_directory",
       "The absolute path for the directory in the container where the\n"
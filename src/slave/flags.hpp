@@ -55,12 +55,15 @@ public:
 
   std::string docker_local_archives_dir;
   std::string docker_puller;
+  std::string docker_registry;
+  std::string docker_auth_server;
   std::string docker_store_dir;
 
   std::string default_role;
   Option<std::string> attributes;
   Bytes fetcher_cache_size;
   std::string fetcher_cache_dir;
+  size_t fetcher_concurrency;
   std::string work_dir;
   std::string launcher_dir;
   std::string hadoop_home; // TODO(benh): Make an Option.
@@ -80,6 +83,7 @@ public:
 
   std::string recover;
   Duration recovery_timeout;
+  Duration status_update_group_commit_window;
   bool strict;
   Duration register_retry_interval_min;
 #ifdef __linux__
@@ -108,6 +112,7 @@ public:
   Duration docker_stop_timeout;
   bool docker_kill_orphans;
   std::string docker_socket;
+  bool docker_engine_api;
 #ifdef WITH_NETWORK_ISOLATOR
   uint16_t ephemeral_ports_per_container;
   Option<std::string> eth0_name;
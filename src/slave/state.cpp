@@ -20,14 +20,21 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <process/pid.hpp>
 
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
 #include <stout/format.hpp>
+#include <stout/lambda.hpp>
 #include <stout/none.hpp>
+#include <stout/nothing.hpp>
 #include <stout/numify.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
@@ -36,6 +43,7 @@
 
 #include "messages/messages.hpp"
 
+#include "slave/constants.hpp"
 #include "slave/paths.hpp"
 #include "slave/state.hpp"
 
@@ -47,6 +55,110 @@ namespace state {
 using std::list;
 using std::string;
 using std::max;
+using std::vector;
+
+
+// Calls 'f' for each index in [0, 'count') from up to
+// RECOVERY_CONCURRENCY threads (including the calling thread), until
+// 'f' returns false for any of them.
+static void parallel(size_t count, const lambda::function<bool(size_t)>& f)
+{
+  std::atomic<size_t> next(0);
+  std::atomic<bool> stopped(false);
+
+  auto worker = [&]() {
+    while (!stopped.load()) {
+      const size_t index = next++;
+      if (index >= count) {
+        return;
+      }
+
+      if (!f(index)) {
+        stopped.store(true);
+      }
+    }
+  };
+
+  vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(count, RECOVERY_CONCURRENCY); i++) {
+    threads.push_back(std::thread(worker));
+  }
+
+  worker();
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+}
+
+
+// Recovers the state of a framework except for its executors, and
+// returns the IDs of the executors that are left to be recovered.
+static Try<FrameworkState> recoverFramework(
+    const string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    bool strict,
+    vector<ExecutorID>* executorIds);
+
+
+// Recovers the executors of all of the frameworks in parallel, using
+// a single pool of threads, and adds them to the frameworks' states.
+// We stop early if one fails to be recovered.
+static Try<Nothing> recoverExecutors(
+    const string& rootDir,
+    const SlaveID& slaveId,
+    const vector<FrameworkState*>& frameworks,
+    const vector<vector<ExecutorID>>& executorIds,
+    bool strict)
+{
+  CHECK_EQ(frameworks.size(), executorIds.size());
+
+  // The (framework, executor) index pairs of all of the executors.
+  vector<std::pair<size_t, size_t>> executors;
+  for (size_t i = 0; i < frameworks.size(); i++) {
+    for (size_t j = 0; j < executorIds[i].size(); j++) {
+      executors.push_back(std::make_pair(i, j));
+    }
+  }
+
+  // The results of those not attempted remain none.
+  vector<Option<Try<ExecutorState>>> recovered(executors.size());
+
+  parallel(executors.size(), [&](size_t i) {
+    const FrameworkState* framework = frameworks[executors[i].first];
+    const ExecutorID& executorId =
+      executorIds[executors[i].first][executors[i].second];
+
+    recovered[i] = ExecutorState::recover(
+        rootDir, slaveId, framework->id, executorId, strict);
+
+    return recovered[i].get().isSome();
+  });
+
+  for (size_t i = 0; i < executors.size(); i++) {
+    if (recovered[i].isNone()) {
+      continue;
+    }
+
+    FrameworkState* framework = frameworks[executors[i].first];
+    const ExecutorID& executorId =
+      executorIds[executors[i].first][executors[i].second];
+
+    const Try<ExecutorState>& executor = recovered[i].get();
+
+    if (executor.isError()) {
+      return Error("Failed to recover framework " + framework->id.value() +
+                   ": Failed to recover executor " + executorId.value() +
+                   ": " + executor.error());
+    }
+
+    framework->executors[executorId] = executor.get();
+    framework->errors += executor.get().errors;
+  }
+
+  return Nothing();
+}
 
 
 Result<State> recover(const string& rootDir, bool strict)
@@ -169,21 +281,45 @@ Try<SlaveState> SlaveState::recover(
                  ": " + frameworks.error());
   }
 
-  // Recover each of the frameworks.
+  // Recover each of the frameworks, and then all of their executors
+  // at once, since most of the checkpointed state is held by the
+  // executors.
+  vector<FrameworkState> _frameworks;
+  vector<vector<ExecutorID>> executorIds;
+
   foreach (const string& path, frameworks.get()) {
     FrameworkID frameworkId;
     frameworkId.set_value(Path(path).basename());
 
-    Try<FrameworkState> framework =
-      FrameworkState::recover(rootDir, slaveId, frameworkId, strict);
+    vector<ExecutorID> _executorIds;
+
+    Try<FrameworkState> framework = recoverFramework(
+        rootDir, slaveId, frameworkId, strict, &_executorIds);
 
     if (framework.isError()) {
       return Error("Failed to recover framework " + frameworkId.value() +
                    ": " + framework.error());
     }
 
-    state.frameworks[frameworkId] = framework.get();
-    state.errors += framework.get().errors;
+    _frameworks.push_back(framework.get());
+    executorIds.push_back(_executorIds);
+  }
+
+  vector<FrameworkState*> pointers;
+  foreach (FrameworkState& framework, _frameworks) {
+    pointers.push_back(&framework);
+  }
+
+  Try<Nothing> executors =
+    recoverExecutors(rootDir, slaveId, pointers, executorIds, strict);
+
+  if (executors.isError()) {
+    return Error(executors.error());
+  }
+
+  foreach (const FrameworkState& framework, _frameworks) {
+    state.frameworks[framework.id] = framework;
+    state.errors += framework.errors;
   }
 
   return state;
@@ -196,6 +332,41 @@ Try<FrameworkState> FrameworkState::recover(
     const FrameworkID& frameworkId,
     bool strict)
 {
+  vector<ExecutorID> executorIds;
+
+  Try<FrameworkState> state =
+    recoverFramework(rootDir, slaveId, frameworkId, strict, &executorIds);
+
+  if (state.isError()) {
+    return Error(state.error());
+  }
+
+  FrameworkState framework = state.get();
+
+  Try<Nothing> executors = recoverExecutors(
+      rootDir,
+      slaveId,
+      vector<FrameworkState*>(1, &framework),
+      vector<vector<ExecutorID>>(1, executorIds),
+      strict);
+
+  if (executors.isError()) {
+    return Error(executors.error());
+  }
+
+  return framework;
+}
+
+
+static Try<FrameworkState> recoverFramework(
+    const string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    bool strict,
+    vector<ExecutorID>* executorIds)
+{
+  CHECK_NOTNULL(executorIds);
+
   FrameworkState state;
   state.id = frameworkId;
   string message;
@@ -278,21 +449,12 @@ Try<FrameworkState> FrameworkState::recover(
         ": " + executors.error());
   }
 
-  // Recover the executors.
+  // The executors are recovered by the caller, see
+  // 'recoverExecutors'.
   foreach (const string& path, executors.get()) {
     ExecutorID executorId;
     executorId.set_value(Path(path).basename());
-
-    Try<ExecutorState> executor =
-      ExecutorState::recover(rootDir, slaveId, frameworkId, executorId, strict);
-
-    if (executor.isError()) {
-      return Error("Failed to recover executor " + executorId.value() +
-                   ": " + executor.error());
-    }
-
-    state.executors[executorId] = executor.get();
-    state.errors += executor.get().errors;
+    executorIds->push_back(executorId);
   }
 
   return state;
@@ -322,7 +484,7 @@ Try<ExecutorState> ExecutorState::recover(
                  "': " + runs.error());
   }
 
-  // Recover the runs.
+  // Find the latest run first, so that we can skip the others below.
   foreach (const string& path, runs.get()) {
     if (Path(path).basename() == paths::LATEST_SYMLINK) {
       const Result<string>& latest = os::realpath(path);
@@ -339,10 +501,29 @@ Try<ExecutorState> ExecutorState::recover(
       ContainerID containerId;
       containerId.set_value(Path(latest.get()).basename());
       state.latest = containerId;
-    } else {
+    }
+  }
+
+  // Recover the runs.
+  foreach (const string& path, runs.get()) {
+    if (Path(path).basename() != paths::LATEST_SYMLINK) {
       ContainerID containerId;
       containerId.set_value(Path(path).basename());
 
+      // The slave only garbage collects the runs other than the latest
+      // one, so we do not read their tasks and pids. On slaves with
+      // long-lived frameworks these make up most of the checkpointed
+      // state.
+      if (state.latest.isNone() || state.latest.get() != containerId) {
+        RunState run;
+        run.id = containerId;
+        run.completed = os::exists(paths::getExecutorSentinelPath(
+            rootDir, slaveId, frameworkId, executorId, containerId));
+
+        state.runs[containerId] = run;
+        continue;
+      }
+
       Try<RunState> run = RunState::recover(
           rootDir, slaveId, frameworkId, executorId, containerId, strict);
 
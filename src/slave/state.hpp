@@ -230,6 +230,9 @@ struct ExecutorState
   ExecutorID id;
   Option<ExecutorInfo> info;
   Option<ContainerID> latest;
+
+  // NOTE: Only the 'latest' run is recovered entirely, of all other
+  // runs only the 'id' and whether they are 'completed' is known.
   hashmap<ContainerID, RunState> runs;
   unsigned int errors;
 };
@@ -17,6 +17,7 @@
  */
 
 #include <process/delay.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/timer.hpp>
 
@@ -50,7 +51,9 @@ using std::string;
 using process::wait; // Necessary on some OS's to disambiguate.
 using process::Failure;
 using process::Future;
+using process::Owned;
 using process::PID;
+using process::Promise;
 using process::Timeout;
 using process::UPID;
 
@@ -140,12 +143,29 @@ private:
       const TaskID& taskId,
       const FrameworkID& frameworkId);
 
+  // Returns a future that is satisfied once the records written to
+  // the stream so far are on disk. With group commit, streams that
+  // have been written to are synced together at the end of the
+  // 'status_update_group_commit_window'.
+  Future<Nothing> committed(StatusUpdateStream* stream);
+
+  // Syncs all streams that have been written to since the last
+  // commit and deletes those that have been cleaned up meanwhile.
+  void commit();
+
   const Flags flags;
   bool paused;
 
   function<void(StatusUpdate)> forward_;
 
   hashmap<FrameworkID, hashmap<TaskID, StatusUpdateStream*> > streams;
+
+  // Streams with records that are not yet on disk, see 'committed()'.
+  hashmap<StatusUpdateStream*, Owned<Promise<Nothing>>> uncommitted;
+
+  // Streams that have been cleaned up while still in 'uncommitted',
+  // they get deleted once they are committed.
+  hashset<StatusUpdateStream*> detached;
 };
 
 
@@ -155,6 +175,10 @@ StatusUpdateManagerProcess::StatusUpdateManagerProcess(const Flags& _flags)
 
 StatusUpdateManagerProcess::~StatusUpdateManagerProcess()
 {
+  // Make sure that the futures of all updates and acknowledgements
+  // get satisfied.
+  commit();
+
   foreachkey (const FrameworkID& frameworkId, streams) {
     foreachvalue (StatusUpdateStream* stream, streams[frameworkId]) {
       delete stream;
@@ -363,7 +387,7 @@ Future<Nothing> StatusUpdateManagerProcess::_update(
     stream->timeout = forward(next.get(), STATUS_UPDATE_RETRY_INTERVAL_MIN);
   }
 
-  return Nothing();
+  return committed(stream);
 }
 
 
@@ -432,6 +456,9 @@ Future<bool> StatusUpdateManagerProcess::acknowledgement(
     return Failure("Duplicate acknowledgement");
   }
 
+  // NOTE: This must be called before the stream might get cleaned up.
+  Future<Nothing> committed_ = committed(stream);
+
   // Reset the timeout.
   stream->timeout = None();
 
@@ -455,7 +482,8 @@ Future<bool> StatusUpdateManagerProcess::acknowledgement(
     stream->timeout = forward(next.get(), STATUS_UPDATE_RETRY_INTERVAL_MIN);
   }
 
-  return !terminated;
+  return committed_
+    .then([terminated]() { return !terminated; });
 }
 
 
@@ -544,7 +572,61 @@ void StatusUpdateManagerProcess::cleanupStatusUpdateStream(
     streams.erase(frameworkId);
   }
 
-  delete stream;
+  if (uncommitted.contains(stream)) {
+    detached.insert(stream);
+  } else {
+    delete stream;
+  }
+}
+
+
+Future<Nothing> StatusUpdateManagerProcess::committed(
+    StatusUpdateStream* stream)
+{
+  if (!stream->checkpoint ||
+      flags.status_update_group_commit_window == Duration::zero()) {
+    return Nothing();
+  }
+
+  if (uncommitted.empty()) {
+    delay(flags.status_update_group_commit_window,
+          self(),
+          &StatusUpdateManagerProcess::commit);
+  }
+
+  if (!uncommitted.contains(stream)) {
+    uncommitted[stream].reset(new Promise<Nothing>());
+  }
+
+  return uncommitted[stream]->future();
+}
+
+
+void StatusUpdateManagerProcess::commit()
+{
+  if (uncommitted.empty()) {
+    return;
+  }
+
+  VLOG(1) << "Committing " << uncommitted.size() << " status update streams";
+
+  foreachpair (StatusUpdateStream* stream,
+               const Owned<Promise<Nothing>>& promise,
+               uncommitted) {
+    Try<Nothing> sync = stream->sync();
+    if (sync.isError()) {
+      promise->fail(sync.error());
+    } else {
+      promise->set(Nothing());
+    }
+
+    if (detached.contains(stream)) {
+      delete stream;
+    }
+  }
+
+  uncommitted.clear();
+  detached.clear();
 }
 
 
@@ -674,10 +756,16 @@ StatusUpdateStream::StatusUpdateStream(
       return;
     }
 
-    // Open the updates file.
+    // Open the updates file. With group commit the status update
+    // manager syncs the file instead, see 'sync()'.
+    int oflag = O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC;
+    if (flags.status_update_group_commit_window == Duration::zero()) {
+      oflag |= O_SYNC;
+    }
+
     Try<int> result = os::open(
         path.get(),
-        O_CREAT | O_WRONLY | O_APPEND | O_SYNC | O_CLOEXEC,
+        oflag,
         S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 
     if (result.isError()) {
@@ -815,6 +903,24 @@ Try<Nothing> StatusUpdateStream::replay(
 }
 
 
+Try<Nothing> StatusUpdateStream::sync()
+{
+  if (error.isSome()) {
+    return Error(error.get());
+  }
+
+  CHECK_SOME(fd);
+
+  if (::fsync(fd.get()) != 0) {
+    ErrnoError error_("Failed to sync '" + path.get() + "'");
+    error = error_.message;
+    return error_;
+  }
+
+  return Nothing();
+}
+
+
 Try<Nothing> StatusUpdateStream::handle(
     const StatusUpdate& update,
     const StatusUpdateRecord::Type& type)
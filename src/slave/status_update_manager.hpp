@@ -168,6 +168,10 @@ struct StatusUpdateStream
       const std::vector<StatusUpdate>& updates,
       const hashset<UUID>& acks);
 
+  // Syncs the records written so far to disk. This is only necessary
+  // with group commit, otherwise the records are written with O_SYNC.
+  Try<Nothing> sync();
+
   // TODO(vinod): Explore semantics to make these private.
   const bool checkpoint;
   bool terminated;
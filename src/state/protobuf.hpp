@@ -47,7 +47,7 @@ template <typename T>
 class Variable
 {
 public:
-  T get() const
+  const T& get() const
   {
     return t;
   }
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <iostream>
 #include <set>
 #include <string>
 #include <thread>
@@ -47,6 +48,7 @@
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/proc.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 
@@ -63,6 +65,8 @@ using namespace process;
 using cgroups::memory::pressure::Level;
 using cgroups::memory::pressure::Counter;
 
+using std::cout;
+using std::endl;
 using std::set;
 using std::string;
 
@@ -544,6 +548,103 @@ TEST_F(CgroupsAnyHierarchyWithCpuAcctMemoryTest, ROOT_CGROUPS_Stat)
 }
 
 
+TEST_F(CgroupsAnyHierarchyWithCpuAcctMemoryTest, ROOT_CGROUPS_StatisticsReader)
+{
+  const string hierarchy = path::join(baseHierarchy, "memory");
+
+  cgroups::StatisticsReader reader;
+
+  EXPECT_ERROR(reader.value(hierarchy, TEST_CGROUPS_ROOT, "invalid"));
+  EXPECT_ERROR(reader.stat(hierarchy, TEST_CGROUPS_ROOT, "invalid", {}));
+
+  Try<uint64_t> usage = reader.value(hierarchy, "/", "memory.usage_in_bytes");
+  ASSERT_SOME(usage);
+  EXPECT_GT(usage.get(), 0llu);
+
+  // Reading again uses the open control file.
+  usage = reader.value(hierarchy, "/", "memory.usage_in_bytes");
+  ASSERT_SOME(usage);
+  EXPECT_GT(usage.get(), 0llu);
+
+  // Only the requested keys are returned.
+  Try<hashmap<string, uint64_t>> stat =
+    reader.stat(hierarchy, "/", "memory.stat", {"rss", "unknown"});
+  ASSERT_SOME(stat);
+  EXPECT_EQ(1u, stat->size());
+  EXPECT_TRUE(stat->contains("rss"));
+  EXPECT_GT(stat->get("rss").get(), 0llu);
+
+  stat = reader.stat(
+      path::join(baseHierarchy, "cpuacct"),
+      "/",
+      "cpuacct.stat",
+      {"user", "system"});
+  ASSERT_SOME(stat);
+  EXPECT_GT(stat->get("user").get(), 0llu);
+  EXPECT_GT(stat->get("system").get(), 0llu);
+
+  reader.remove(hierarchy, "/");
+}
+
+
+// Compares collecting the memory statistics of many cgroups by
+// reopening the control files (like the memory isolator used to do)
+// against keeping them open using a cgroups::StatisticsReader.
+TEST_F(CgroupsAnyHierarchyWithCpuAcctMemoryTest,
+       ROOT_CGROUPS_BENCHMARK_StatisticsReader)
+{
+  const string hierarchy = path::join(baseHierarchy, "memory");
+  const size_t count = 300;
+  const size_t rounds = 10;
+
+  ASSERT_SOME(cgroups::create(hierarchy, TEST_CGROUPS_ROOT));
+
+  std::vector<string> cgroups;
+  for (size_t i = 0; i < count; i++) {
+    const string cgroup = path::join(TEST_CGROUPS_ROOT, stringify(i));
+    ASSERT_SOME(cgroups::create(hierarchy, cgroup));
+    cgroups.push_back(cgroup);
+  }
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t round = 0; round < rounds; round++) {
+    foreach (const string& cgroup, cgroups) {
+      ASSERT_SOME(cgroups::memory::usage_in_bytes(hierarchy, cgroup));
+      ASSERT_SOME(cgroups::stat(hierarchy, cgroup, "memory.stat"));
+    }
+  }
+
+  cout << "Reopening control files took " << watch.elapsed() / rounds
+       << " per round for " << count << " cgroups" << endl;
+
+  cgroups::StatisticsReader reader;
+
+  watch.start();
+
+  for (size_t round = 0; round < rounds; round++) {
+    foreach (const string& cgroup, cgroups) {
+      ASSERT_SOME(reader.value(hierarchy, cgroup, "memory.usage_in_bytes"));
+      ASSERT_SOME(reader.stat(
+          hierarchy,
+          cgroup,
+          "memory.stat",
+          {"total_cache", "total_rss", "total_mapped_file"}));
+    }
+  }
+
+  cout << "Keeping control files open took " << watch.elapsed() / rounds
+       << " per round for " << count << " cgroups" << endl;
+
+  foreach (const string& cgroup, cgroups) {
+    reader.remove(hierarchy, cgroup);
+  }
+
+  AWAIT_READY(cgroups::destroy(hierarchy, TEST_CGROUPS_ROOT));
+}
+
+
 TEST_F(CgroupsAnyHierarchyWithCpuMemoryTest, ROOT_CGROUPS_Listen)
 {
   string hierarchy = path::join(baseHierarchy, "memory");
@@ -1032,6 +1133,68 @@ TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_Perf)
 }
 
 
+TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_PerfCounters)
+{
+  string hierarchy = path::join(baseHierarchy, "perf_event");
+  ASSERT_SOME(cgroups::create(hierarchy, TEST_CGROUPS_ROOT));
+
+  Try<Owned<perf::Counters>> counters =
+    perf::Counters::create({"cycles", "task-clock"}, hierarchy);
+
+  ASSERT_SOME(counters);
+
+  pid_t pid = ::fork();
+  ASSERT_NE(-1, pid);
+
+  if (pid == 0) {
+    // In child process, wait to be killed. Don't sleep so the
+    // counters can actually count something, but have a side effect
+    // so the loop is not undefined behavior.
+    volatile uint64_t spins = 0;
+    while (true) {
+      spins++;
+    }
+
+    ABORT("Child should not reach here");
+  }
+
+  // In parent. Put child into the test cgroup.
+  ASSERT_SOME(cgroups::assign(hierarchy, TEST_CGROUPS_ROOT, pid));
+
+  ASSERT_SOME(counters.get()->start({TEST_CGROUPS_ROOT}));
+
+  os::sleep(Seconds(1));
+
+  Try<hashmap<string, mesos::PerfStatistics>> statistics =
+    counters.get()->stop();
+
+  ASSERT_SOME(statistics);
+
+  ASSERT_TRUE(statistics->contains(TEST_CGROUPS_ROOT));
+  ASSERT_TRUE(statistics->at(TEST_CGROUPS_ROOT).has_cycles());
+  ASSERT_TRUE(statistics->at(TEST_CGROUPS_ROOT).has_task_clock());
+  EXPECT_LT(0.0, statistics->at(TEST_CGROUPS_ROOT).task_clock());
+
+  // A sample must be started before it can be stopped.
+  EXPECT_ERROR(counters.get()->stop());
+
+  counters.get()->remove(TEST_CGROUPS_ROOT);
+
+  // Kill the child process.
+  ASSERT_NE(-1, ::kill(pid, SIGKILL));
+
+  // Wait for the child process.
+  int status;
+  EXPECT_NE(-1, ::waitpid((pid_t) -1, &status, 0));
+  ASSERT_TRUE(WIFSIGNALED(status));
+  EXPECT_EQ(SIGKILL, WTERMSIG(status));
+
+  // Destroy the cgroup.
+  Future<Nothing> destroy = cgroups::destroy(hierarchy, TEST_CGROUPS_ROOT);
+  AWAIT_READY(destroy);
+}
+
+
 class CgroupsAnyHierarchyMemoryPressureTest
   : public CgroupsAnyHierarchyTest
 {
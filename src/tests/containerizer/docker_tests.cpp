@@ -16,16 +16,35 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <process/future.hpp>
 #include <process/gtest.hpp>
+#include <process/network.hpp>
 #include <process/owned.hpp>
 #include <process/subprocess.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/option.hpp>
 #include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
 
 #include "docker/docker.hpp"
 
@@ -34,11 +53,13 @@
 #include "tests/environment.hpp"
 #include "tests/flags.hpp"
 #include "tests/mesos.hpp"
+#include "tests/utils.hpp"
 
 using namespace process;
 
 using std::list;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -457,6 +478,420 @@ TEST_F(DockerTest, ROOT_DOCKER_MountAbsolute)
 }
 
 
+// A stand-in for the Docker daemon that serves canned responses to
+// the Engine API requests it receives on a unix socket, one request
+// per connection.
+class FakeDockerDaemon
+{
+public:
+  explicit FakeDockerDaemon(const string& _path)
+    : path(_path), fd(-1), stopped(false) {}
+
+  ~FakeDockerDaemon()
+  {
+    if (thread.get() != NULL) {
+      // Wake up the blocking accept by connecting to ourselves.
+      stopped = true;
+      Try<int> client = connect();
+      if (client.isError()) {
+        ::shutdown(fd, SHUT_RDWR);
+      }
+
+      thread->join();
+
+      if (client.isSome()) {
+        os::close(client.get());
+      }
+    }
+
+    if (fd != -1) {
+      os::close(fd);
+    }
+  }
+
+  Try<Nothing> start()
+  {
+    Try<int> socket =
+      process::network::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (socket.isError()) {
+      return Error(socket.error());
+    }
+
+    fd = socket.get();
+
+    struct sockaddr_un address = this->address();
+    if (::bind(fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+      return ErrnoError("Failed to bind to '" + path + "'");
+    }
+
+    if (::listen(fd, 16) < 0) {
+      return ErrnoError("Failed to listen on '" + path + "'");
+    }
+
+    thread.reset(new std::thread(&FakeDockerDaemon::serve, this));
+
+    return Nothing();
+  }
+
+  // Responds to requests for the specified method and path (e.g.,
+  // "GET /version") with the given responses in order, repeating
+  // the last one. Requests for anything else get a '404 Not Found'.
+  void respond(
+      const string& target,
+      const string& status,
+      const string& body)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    responses[target].push_back(Response{status, body});
+  }
+
+  // Returns the request lines received so far (e.g.,
+  // "POST /containers/mesos-1/stop?t=10").
+  vector<string> requests()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return received;
+  }
+
+private:
+  struct Response
+  {
+    string status;
+    string body;
+  };
+
+  struct sockaddr_un address() const
+  {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    CHECK_LT(path.size(), sizeof(address.sun_path));
+    memcpy(address.sun_path, path.data(), path.size());
+    return address;
+  }
+
+  Try<int> connect() const
+  {
+    Try<int> socket =
+      process::network::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (socket.isError()) {
+      return socket;
+    }
+
+    struct sockaddr_un address = this->address();
+    if (::connect(
+            socket.get(), (struct sockaddr*) &address, sizeof(address)) < 0) {
+      ErrnoError error;
+      os::close(socket.get());
+      return error;
+    }
+
+    return socket;
+  }
+
+  void serve()
+  {
+    while (true) {
+      int connection = ::accept(fd, NULL, NULL);
+
+      if (connection < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+
+      if (stopped) {
+        os::close(connection);
+        return;
+      }
+
+      handle(connection);
+      os::close(connection);
+    }
+  }
+
+  void handle(int connection)
+  {
+    // None of the requests have a body so we only need to read up to
+    // the end of the headers.
+    string request;
+    while (!strings::contains(request, "\r\n\r\n")) {
+      char buffer[1024];
+      ssize_t length = ::read(connection, buffer, sizeof(buffer));
+      if (length < 0 && errno == EINTR) {
+        continue;
+      } else if (length <= 0) {
+        return;
+      }
+      request.append(buffer, length);
+    }
+
+    // The request line looks like "GET /version HTTP/1.1".
+    vector<string> tokens =
+      strings::tokenize(request.substr(0, request.find("\r\n")), " ");
+
+    if (tokens.size() != 3) {
+      return;
+    }
+
+    const string line = tokens[0] + " " + tokens[1];
+    const string target = tokens[0] + " " + strings::split(tokens[1], "?")[0];
+
+    Response response{"404 Not Found", "{\"message\":\"not found\"}"};
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      received.push_back(line);
+
+      if (responses.contains(target) && !responses[target].empty()) {
+        response = responses[target].front();
+        if (responses[target].size() > 1) {
+          responses[target].pop_front();
+        }
+      }
+    }
+
+    const string data =
+      "HTTP/1.1 " + response.status + "\r\n"
+      "Content-Type: application/json\r\n"
+      "Content-Length: " + stringify(response.body.size()) + "\r\n"
+      "\r\n" +
+      response.body;
+
+    size_t offset = 0;
+    while (offset < data.size()) {
+      ssize_t length =
+        ::write(connection, data.data() + offset, data.size() - offset);
+      if (length < 0 && errno == EINTR) {
+        continue;
+      } else if (length <= 0) {
+        return;
+      }
+      offset += length;
+    }
+  }
+
+  const string path;
+  int fd;
+  std::atomic_bool stopped;
+  process::Owned<std::thread> thread;
+
+  std::mutex mutex;
+  hashmap<string, std::deque<Response>> responses;
+  vector<string> received;
+};
+
+
+// Returns the Engine API representation of a running container.
+static string container(const string& id, const string& name)
+{
+  return
+    "{"
+    "  \"Id\": \"" + id + "\","
+    "  \"Name\": \"/" + name + "\","
+    "  \"State\": {"
+    "    \"Pid\": 1234,"
+    "    \"StartedAt\": \"2015-10-01T00:00:00.000000000Z\""
+    "  },"
+    "  \"NetworkSettings\": {"
+    "    \"IPAddress\": \"172.17.0.2\""
+    "  }"
+    "}";
+}
+
+
+class DockerEngineTest : public TemporaryDirectoryTest
+{
+protected:
+  virtual void SetUp()
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    const string socket = path::join(sandbox.get(), "docker.sock");
+
+    daemon.reset(new FakeDockerDaemon(socket));
+    ASSERT_SOME(daemon->start());
+
+    Try<Docker*> create = Docker::create("docker", socket, false, true);
+
+    ASSERT_SOME(create);
+    docker.reset(create.get());
+  }
+
+  virtual void TearDown()
+  {
+    docker.reset();
+    daemon.reset();
+
+    TemporaryDirectoryTest::TearDown();
+  }
+
+  Owned<FakeDockerDaemon> daemon;
+  Owned<Docker> docker;
+};
+
+
+// Tests that the version is retrieved from the daemon and that any
+// non-conforming components are dropped like for the CLI.
+TEST_F(DockerEngineTest, Version)
+{
+  daemon->respond("GET /version", "200 OK", "{\"Version\":\"1.8.2.fc22\"}");
+
+  AWAIT_EXPECT_EQ(Version(1, 8, 2), docker->version());
+
+  EXPECT_SOME(docker->validateVersion(Version(1, 0, 0)));
+  EXPECT_ERROR(docker->validateVersion(Version(1, 9, 0)));
+}
+
+
+TEST_F(DockerEngineTest, Inspect)
+{
+  daemon->respond(
+      "GET /containers/mesos-1/json",
+      "200 OK",
+      container("1a2b3c", "mesos-1"));
+
+  Future<Docker::Container> container = docker->inspect("mesos-1");
+
+  AWAIT_READY(container);
+  EXPECT_EQ("1a2b3c", container.get().id);
+  EXPECT_EQ("/mesos-1", container.get().name);
+  EXPECT_SOME_EQ(1234, container.get().pid);
+  EXPECT_TRUE(container.get().started);
+  EXPECT_SOME_EQ("172.17.0.2", container.get().ipAddress);
+
+  // Without a retry interval an unknown container fails right away.
+  AWAIT_FAILED(docker->inspect("mesos-2"));
+}
+
+
+// Tests that inspect retries until the container is known.
+TEST_F(DockerEngineTest, InspectRetry)
+{
+  daemon->respond("GET /containers/mesos-1/json", "404 Not Found", "");
+  daemon->respond(
+      "GET /containers/mesos-1/json",
+      "200 OK",
+      container("1a2b3c", "mesos-1"));
+
+  Future<Docker::Container> container =
+    docker->inspect("mesos-1", Milliseconds(10));
+
+  AWAIT_READY(container);
+  EXPECT_EQ("1a2b3c", container.get().id);
+
+  EXPECT_EQ(2u, daemon->requests().size());
+}
+
+
+// Tests that only the containers with the prefix are listed, going
+// by their own names rather than the names they are linked under.
+TEST_F(DockerEngineTest, Ps)
+{
+  daemon->respond(
+      "GET /containers/json",
+      "200 OK",
+      "["
+      "  {\"Id\": \"1a\", \"Names\": [\"/mesos-1\"]},"
+      "  {\"Id\": \"2b\", \"Names\": [\"/other\", \"/mesos-1/other\"]},"
+      "  {\"Id\": \"3c\", \"Names\": [\"/mesos-2\"]}"
+      "]");
+
+  daemon->respond(
+      "GET /containers/mesos-1/json", "200 OK", container("1a", "mesos-1"));
+  daemon->respond(
+      "GET /containers/mesos-2/json", "200 OK", container("3c", "mesos-2"));
+
+  Future<list<Docker::Container>> containers = docker->ps(true, "mesos-");
+
+  AWAIT_READY(containers);
+  ASSERT_EQ(2u, containers.get().size());
+
+  hashset<string> ids;
+  foreach (const Docker::Container& container, containers.get()) {
+    ids.insert(container.id);
+  }
+
+  EXPECT_EQ(hashset<string>({"1a", "3c"}), ids);
+
+  EXPECT_EQ("GET /containers/json?all=1", daemon->requests().front());
+}
+
+
+TEST_F(DockerEngineTest, StopAndRemove)
+{
+  daemon->respond("POST /containers/mesos-1/stop", "204 No Content", "");
+  daemon->respond("DELETE /containers/mesos-1", "204 No Content", "");
+
+  AWAIT_READY(docker->stop("mesos-1", Seconds(10), true));
+
+  vector<string> requests = daemon->requests();
+
+  ASSERT_EQ(2u, requests.size());
+  EXPECT_EQ("POST /containers/mesos-1/stop?t=10", requests[0]);
+  EXPECT_EQ("DELETE /containers/mesos-1", requests[1]);
+
+  // A container that fails to stop gets removed forcibly.
+  daemon->respond(
+      "POST /containers/mesos-2/stop", "500 Internal Server Error", "");
+  daemon->respond("DELETE /containers/mesos-2", "204 No Content", "");
+
+  AWAIT_READY(docker->stop("mesos-2", Seconds(0), true));
+  EXPECT_EQ("DELETE /containers/mesos-2?force=1", daemon->requests().back());
+
+  // Unless it isn't supposed to be removed at all.
+  AWAIT_FAILED(docker->stop("mesos-2", Seconds(0)));
+}
+
+
+// Tests that an image is pulled if it can't be found locally.
+TEST_F(DockerEngineTest, Pull)
+{
+  const string image =
+    "{\"ContainerConfig\": {\"Entrypoint\": [\"/bin/sh\"]}}";
+
+  daemon->respond("GET /images/busybox:latest/json", "404 Not Found", "");
+  daemon->respond("GET /images/busybox:latest/json", "200 OK", image);
+  daemon->respond(
+      "POST /images/create",
+      "200 OK",
+      "{\"status\": \"Pulling repository busybox\"}\r\n"
+      "{\"status\": \"Download complete\"}\r\n");
+
+  Future<Docker::Image> pull = docker->pull(sandbox.get(), "busybox");
+
+  AWAIT_READY(pull);
+  EXPECT_SOME_EQ(vector<string>({"/bin/sh"}), pull.get().entrypoint);
+
+  vector<string> requests = daemon->requests();
+
+  ASSERT_EQ(3u, requests.size());
+  EXPECT_TRUE(strings::startsWith(requests[1], "POST /images/create?"));
+  EXPECT_TRUE(strings::contains(requests[1], "fromImage=busybox"));
+  EXPECT_TRUE(strings::contains(requests[1], "tag=latest"));
+}
+
+
+// Tests that errors reported while pulling an image are surfaced.
+TEST_F(DockerEngineTest, PullFailure)
+{
+  daemon->respond("GET /images/mesos:1.0/json", "404 Not Found", "");
+  daemon->respond(
+      "POST /images/create",
+      "200 OK",
+      "{\"error\": \"Tag 1.0 not found in repository mesos\"}\r\n");
+
+  AWAIT_FAILED(docker->pull(sandbox.get(), "mesos:1.0"));
+
+  // The image is not inspected again after a failed pull.
+  EXPECT_EQ(2u, daemon->requests().size());
+}
+
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
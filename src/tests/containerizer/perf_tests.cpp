@@ -64,6 +64,13 @@ TEST_F(PerfTest, ROOT_Sample)
 }
 
 
+TEST_F(PerfTest, CountersUnknownEvent)
+{
+  // Events without a PerfStatistics field can't be counted natively.
+  EXPECT_ERROR(perf::Counters::create({"cycles", "invalid-event"}, "/"));
+}
+
+
 TEST_F(PerfTest, Parse)
 {
   // Parse multiple cgroups with uint64 and floats.
@@ -16,6 +16,8 @@
  * limitations under the License.
  */
 
+#include <iostream>
+
 #include <process/gtest.hpp>
 
 #include <stout/foreach.hpp>
@@ -23,6 +25,8 @@
 #include <stout/os.hpp>
 #include <stout/os/permissions.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 
 #ifdef __linux__
@@ -31,6 +35,7 @@
 
 #include "slave/containerizer/provisioner/backends/bind.hpp"
 #include "slave/containerizer/provisioner/backends/copy.hpp"
+#include "slave/containerizer/provisioner/backends/overlay.hpp"
 
 #include "tests/flags.hpp"
 #include "tests/utils.hpp"
@@ -39,6 +44,8 @@ using namespace process;
 
 using namespace mesos::internal::slave;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::vector;
 
@@ -47,7 +54,7 @@ namespace internal {
 namespace tests {
 
 #ifdef __linux__
-class BindBackendTest : public TemporaryDirectoryTest
+class MountBackendTest : public TemporaryDirectoryTest
 {
 protected:
   void TearDown()
@@ -69,6 +76,9 @@ protected:
 };
 
 
+class BindBackendTest : public MountBackendTest {};
+
+
 // Provision a rootfs using a BindBackend to another directory and
 // verify if it is read-only within the mount.
 TEST_F(BindBackendTest, ROOT_BindBackend)
@@ -98,6 +108,112 @@ TEST_F(BindBackendTest, ROOT_BindBackend)
 
   EXPECT_FALSE(os::exists(target));
 }
+
+
+class OverlayBackendTest : public MountBackendTest {};
+
+
+// Provision a rootfs using multiple layers with the overlay backend
+// and verify that writes end up in the scratch directory rather than
+// in the layers.
+TEST_F(OverlayBackendTest, ROOT_OVERLAYFS_OverlayBackend)
+{
+  string layer1 = path::join(os::getcwd(), "source1");
+  ASSERT_SOME(os::mkdir(layer1));
+  ASSERT_SOME(os::mkdir(path::join(layer1, "dir1")));
+  ASSERT_SOME(os::write(path::join(layer1, "dir1", "1"), "1"));
+  ASSERT_SOME(os::write(path::join(layer1, "file"), "test1"));
+
+  string layer2 = path::join(os::getcwd(), "source2");
+  ASSERT_SOME(os::mkdir(layer2));
+  ASSERT_SOME(os::mkdir(path::join(layer2, "dir2")));
+  ASSERT_SOME(os::write(path::join(layer2, "dir2", "2"), "2"));
+  ASSERT_SOME(os::write(path::join(layer2, "file"), "test2"));
+
+  // Lay out the rootfs like the provisioner does.
+  string rootfs = path::join(os::getcwd(), "overlay", "rootfses", "rootfs");
+  string scratch = path::join(os::getcwd(), "overlay", "scratch", "rootfs");
+
+  hashmap<string, Owned<Backend>> backends = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends.contains("overlay"));
+
+  AWAIT_READY(backends["overlay"]->provision({layer1, layer2}, rootfs));
+
+  EXPECT_SOME_EQ("1", os::read(path::join(rootfs, "dir1", "1")));
+  EXPECT_SOME_EQ("2", os::read(path::join(rootfs, "dir2", "2")));
+
+  // Last layer should shadow existing file.
+  EXPECT_SOME_EQ("test2", os::read(path::join(rootfs, "file")));
+
+  ASSERT_SOME(os::write(path::join(rootfs, "file"), "test3"));
+  ASSERT_SOME(os::write(path::join(rootfs, "dir1", "3"), "3"));
+
+  EXPECT_SOME_EQ("test3", os::read(path::join(rootfs, "file")));
+  EXPECT_SOME_EQ("test2", os::read(path::join(layer2, "file")));
+  EXPECT_FALSE(os::exists(path::join(layer1, "dir1", "3")));
+  EXPECT_TRUE(os::exists(path::join(scratch, "upperdir", "dir1", "3")));
+
+  AWAIT_EXPECT_EQ(true, backends["overlay"]->destroy(rootfs));
+
+  EXPECT_FALSE(os::exists(rootfs));
+  EXPECT_FALSE(os::exists(scratch));
+
+  // The layers are left untouched.
+  EXPECT_SOME_EQ("1", os::read(path::join(layer1, "dir1", "1")));
+}
+
+
+// Compares the time it takes to provision a rootfs from a multi-layer
+// image with the copy backend against the overlay backend.
+TEST_F(OverlayBackendTest, ROOT_OVERLAYFS_BENCHMARK_ProvisionLatency)
+{
+  const size_t layers = 5;
+  const size_t files = 1000;
+  const size_t rootfses = 5;
+
+  // Create layers of 'files' files of 4KB each.
+  const string data(4096, 'x');
+
+  vector<string> paths;
+  for (size_t i = 0; i < layers; i++) {
+    const string layer = path::join(os::getcwd(), "layers", stringify(i));
+    for (size_t j = 0; j < files; j++) {
+      const string directory = path::join(layer, stringify(j % 10));
+      ASSERT_SOME(os::mkdir(directory));
+      ASSERT_SOME(os::write(path::join(directory, stringify(j)), data));
+    }
+    paths.push_back(layer);
+  }
+
+  hashmap<string, Owned<Backend>> backends = Backend::create(slave::Flags());
+
+  const vector<string> names = {"copy", "overlay"};
+
+  foreach (const string& backend, names) {
+    ASSERT_TRUE(backends.contains(backend));
+
+    vector<string> targets;
+    for (size_t i = 0; i < rootfses; i++) {
+      targets.push_back(
+          path::join(os::getcwd(), backend, "rootfses", stringify(i)));
+    }
+
+    Stopwatch watch;
+    watch.start();
+
+    foreach (const string& target, targets) {
+      AWAIT_READY_FOR(backends[backend]->provision(paths, target), Minutes(5));
+    }
+
+    cout << "Provisioning with the " << backend << " backend took "
+         << watch.elapsed() / rootfses << " per rootfs of " << layers
+         << " layers with " << files << " files each" << endl;
+
+    foreach (const string& target, targets) {
+      AWAIT_READY_FOR(backends[backend]->destroy(target), Minutes(5));
+    }
+  }
+}
 #endif // __linux__
 
 
@@ -22,6 +22,7 @@
 #include <stout/duration.hpp>
 
 #include <stout/gtest.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
@@ -29,9 +30,12 @@
 
 #include <process/address.hpp>
 #include <process/clock.hpp>
+#include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
+#include <process/http.hpp>
 #include <process/owned.hpp>
+#include <process/process.hpp>
 #include <process/socket.hpp>
 #include <process/subprocess.hpp>
 
@@ -696,6 +700,86 @@ TEST_F(RegistryClientTest, BadRequest)
 }
 
 
+
+// Tests that a blob download fails (rather than hangs) when the
+// registry stops sending the body of the blob.
+TEST_F(RegistryClientTest, StalledBlob)
+{
+  Try<Socket> server = setup_server({
+      {"SSL_ENABLED", "true"},
+      {"SSL_KEY_FILE", key_path().value},
+      {"SSL_CERT_FILE", certificate_path().value}});
+
+  ASSERT_SOME(server);
+  ASSERT_SOME(server.get().address());
+  ASSERT_SOME(server.get().address().get().hostname());
+
+  Future<Socket> socket = server.get().accept();
+
+  const process::http::URL url(
+      "https",
+      server.get().address().get().hostname().get(),
+      server.get().address().get().port);
+
+  Try<Owned<RegistryClient>> registryClient =
+    RegistryClient::create(url, url, None());
+
+  ASSERT_SOME(registryClient);
+
+  const Path blobPath(RegistryClientTest::OUTPUT_DIR + "/blob");
+
+  const Duration timeout = Seconds(10);
+
+  Future<size_t> resultFuture =
+    registryClient.get()->getBlob(
+        "/blob",
+        "digest",
+        blobPath,
+        timeout,
+        None());
+
+  AWAIT_ASSERT_READY(socket);
+
+  Future<string> blobHttpRequestFuture = Socket(socket.get()).recv();
+  AWAIT_ASSERT_READY(blobHttpRequestFuture);
+
+  // Only send part of the blob.
+  const string blobHttpResponse =
+    string("HTTP/1.1 200 OK\r\n") +
+    "Content-Length : 1024\r\n" +
+    "\r\n" +
+    "partial";
+
+  AWAIT_ASSERT_READY(Socket(socket.get()).send(blobHttpResponse));
+
+  // Wait for the partial blob to be written, i.e., for the response
+  // headers to have been received, before pausing the clock.
+  Duration elapsed = Duration::zero();
+  while (true) {
+    Try<string> blob = os::read(blobPath.value);
+    if (blob.isSome() && blob.get() == "partial") {
+      break;
+    }
+
+    ASSERT_LT(elapsed, Seconds(15));
+
+    os::sleep(Milliseconds(1));
+    elapsed += Milliseconds(1);
+  }
+
+  Clock::pause();
+  Clock::settle();
+
+  EXPECT_TRUE(resultFuture.isPending());
+
+  Clock::advance(timeout);
+
+  AWAIT_FAILED(resultFuture);
+  EXPECT_TRUE(strings::contains(resultFuture.failure(), "No data received"));
+
+  Clock::resume();
+}
+
 #endif // USE_SSL_SOCKET
 
 
@@ -855,6 +939,254 @@ TEST_F(ProvisionerDockerLocalStoreTest, MetadataManagerInitialization)
   verifyLocalDockerImage(flags, layers.get());
 }
 
+
+/**
+ * A Docker registry stand-in serving the manifests and layers of the
+ * images in its 'library' namespace via the registry's v2 API, which
+ * counts the requests for each of them.
+ */
+class TestRegistryProcess : public Process<TestRegistryProcess>
+{
+public:
+  TestRegistryProcess() : ProcessBase("v2") {}
+
+  // Adds an image with the specified layers, ordered with the top
+  // layer first, as given by their digests.
+  void addImage(const string& repository, const vector<string>& digests)
+  {
+    JSON::Array fsLayers;
+    foreach (const string& digest, digests) {
+      JSON::Object fsLayer;
+      fsLayer.values["blobSum"] = digest;
+      fsLayers.values.push_back(fsLayer);
+    }
+
+    JSON::Object manifest;
+    manifest.values["name"] = "library/" + repository;
+    manifest.values["tag"] = "latest";
+    manifest.values["fsLayers"] = fsLayers;
+
+    manifests[path(repository, "manifests", "latest")] = stringify(manifest);
+  }
+
+  void addLayer(
+      const string& repository,
+      const string& digest,
+      const string& blob)
+  {
+    blobs[path(repository, "blobs", digest)] = blob;
+  }
+
+  size_t requests(const string& path)
+  {
+    return counts.contains(path) ? counts[path] : 0;
+  }
+
+  static string path(
+      const string& repository,
+      const string& type,
+      const string& reference)
+  {
+    return "/v2/library/" + repository + "/" + type + "/" + reference;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    route("/library", None(), &TestRegistryProcess::library);
+  }
+
+private:
+  Future<http::Response> library(const http::Request& request)
+  {
+    const string path = request.url.path;
+
+    counts[path]++;
+
+    if (manifests.contains(path)) {
+      http::OK response(manifests[path]);
+      response.headers["Docker-Content-Digest"] = "sha256:" + path;
+      return response;
+    }
+
+    if (blobs.contains(path)) {
+      return http::OK(blobs[path]);
+    }
+
+    return http::NotFound();
+  }
+
+  hashmap<string, string> manifests;
+  hashmap<string, string> blobs;
+  hashmap<string, size_t> counts;
+};
+
+
+class ProvisionerDockerRegistryPullerTest : public TemporaryDirectoryTest
+{
+protected:
+  virtual void SetUp()
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    registry = Owned<TestRegistryProcess>(new TestRegistryProcess());
+    spawn(registry.get());
+
+    flags.docker_puller = "registry";
+    flags.docker_store_dir = path::join(os::getcwd(), "store");
+    flags.docker_registry = "http://" + stringify(registry->self().address);
+    flags.docker_auth_server = flags.docker_registry;
+  }
+
+  virtual void TearDown()
+  {
+    terminate(registry.get());
+    wait(registry.get());
+
+    TemporaryDirectoryTest::TearDown();
+  }
+
+  // Adds a layer holding a single file named after the layer to the
+  // specified image repository of the registry.
+  void addLayer(const string& repository, const string& name)
+  {
+    const string layer = path::join(os::getcwd(), "layers", name);
+    ASSERT_SOME(os::mkdir(layer));
+    ASSERT_SOME(os::write(path::join(layer, name), name));
+
+    const string blob = layer + ".tar.gz";
+    ASSERT_SOME(os::shell("tar -czf %s -C %s .", blob.c_str(), layer.c_str()));
+
+    Try<string> read = os::read(blob);
+    ASSERT_SOME(read);
+
+    dispatch(registry.get(),
+             &TestRegistryProcess::addLayer,
+             repository,
+             "sha256:" + name,
+             read.get());
+  }
+
+  size_t requests(const string& path)
+  {
+    Future<size_t> requests =
+      dispatch(registry.get(), &TestRegistryProcess::requests, path);
+
+    requests.await();
+
+    return requests.get();
+  }
+
+  slave::Flags flags;
+  Owned<TestRegistryProcess> registry;
+};
+
+
+// This test verifies that concurrently pulled images which share a
+// layer download that layer only once and that the image's layers
+// are put into the store by their digest.
+TEST_F(ProvisionerDockerRegistryPullerTest, ConcurrentPullsShareLayers)
+{
+  const vector<string> abc = {"sha256:abc", "sha256:base"};
+  const vector<string> xyz = {"sha256:xyz", "sha256:base"};
+
+  dispatch(registry.get(), &TestRegistryProcess::addImage, "abc", abc);
+  dispatch(registry.get(), &TestRegistryProcess::addImage, "xyz", xyz);
+
+  addLayer("abc", "abc");
+  addLayer("abc", "base");
+  addLayer("xyz", "xyz");
+  addLayer("xyz", "base");
+
+  Try<Owned<slave::Store>> store = slave::docker::Store::create(flags);
+  ASSERT_SOME(store);
+
+  Image image1;
+  image1.set_type(Image::DOCKER);
+  image1.mutable_docker()->set_name("abc");
+
+  Image image2;
+  image2.set_type(Image::DOCKER);
+  image2.mutable_docker()->set_name("xyz");
+
+  Future<vector<string>> layers1 = store.get()->get(image1);
+  Future<vector<string>> layers2 = store.get()->get(image2);
+
+  AWAIT_READY(layers1);
+  AWAIT_READY(layers2);
+
+  const string base =
+    getImageLayerRootfsPath(flags.docker_store_dir, "sha256-base");
+
+  vector<string> expected1;
+  expected1.push_back(base);
+  expected1.push_back(
+      getImageLayerRootfsPath(flags.docker_store_dir, "sha256-abc"));
+
+  vector<string> expected2;
+  expected2.push_back(base);
+  expected2.push_back(
+      getImageLayerRootfsPath(flags.docker_store_dir, "sha256-xyz"));
+
+  EXPECT_EQ(expected1, layers1.get());
+  EXPECT_EQ(expected2, layers2.get());
+
+  EXPECT_SOME_EQ("base", os::read(path::join(base, "base")));
+  EXPECT_SOME_EQ("abc", os::read(path::join(expected1.back(), "abc")));
+  EXPECT_SOME_EQ("xyz", os::read(path::join(expected2.back(), "xyz")));
+
+  // The shared layer is only downloaded for one of the images.
+  EXPECT_EQ(
+      1u,
+      requests(TestRegistryProcess::path("abc", "blobs", "sha256:base")) +
+      requests(TestRegistryProcess::path("xyz", "blobs", "sha256:base")));
+
+  // Nothing is left in the staging directory.
+  Try<list<string>> staging = os::ls(getStagingDir(flags.docker_store_dir));
+  ASSERT_SOME(staging);
+  EXPECT_TRUE(staging.get().empty());
+}
+
+
+// This test verifies that concurrent gets of the same image pull it
+// only once and that later gets are served from the store.
+TEST_F(ProvisionerDockerRegistryPullerTest, ConcurrentGetsPullOnce)
+{
+  const vector<string> abc = {"sha256:abc", "sha256:base"};
+
+  dispatch(registry.get(), &TestRegistryProcess::addImage, "abc", abc);
+
+  addLayer("abc", "abc");
+  addLayer("abc", "base");
+
+  Try<Owned<slave::Store>> store = slave::docker::Store::create(flags);
+  ASSERT_SOME(store);
+
+  Image image;
+  image.set_type(Image::DOCKER);
+  image.mutable_docker()->set_name("abc");
+
+  Future<vector<string>> layers1 = store.get()->get(image);
+  Future<vector<string>> layers2 = store.get()->get(image);
+
+  AWAIT_READY(layers1);
+  AWAIT_READY(layers2);
+
+  EXPECT_EQ(layers1.get(), layers2.get());
+
+  Future<vector<string>> layers3 = store.get()->get(image);
+  AWAIT_READY(layers3);
+
+  EXPECT_EQ(layers1.get(), layers3.get());
+
+  EXPECT_EQ(1u, requests(
+      TestRegistryProcess::path("abc", "manifests", "latest")));
+  EXPECT_EQ(1u, requests(
+      TestRegistryProcess::path("abc", "blobs", "sha256:abc")));
+  EXPECT_EQ(1u, requests(
+      TestRegistryProcess::path("abc", "blobs", "sha256:base")));
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
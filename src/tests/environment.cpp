@@ -278,6 +278,37 @@ private:
 };
 
 
+class OverlayFSFilter : public TestFilter
+{
+public:
+  OverlayFSFilter()
+  {
+#ifdef __linux__
+    Try<bool> supported = fs::supported("overlay");
+    overlayfsError = !supported.isSome() || !supported.get();
+    if (overlayfsError) {
+      std::cerr
+        << "-------------------------------------------------------------\n"
+        << "The 'overlay' filesystem is not supported by the kernel so no\n"
+        << "overlayfs tests will be run\n"
+        << "-------------------------------------------------------------"
+        << std::endl;
+    }
+#else
+    overlayfsError = true;
+#endif // __linux__
+  }
+
+  bool disable(const ::testing::TestInfo* test) const
+  {
+    return matches(test, "OVERLAYFS_") && overlayfsError;
+  }
+
+private:
+  bool overlayfsError;
+};
+
+
 class BenchmarkFilter : public TestFilter
 {
 public:
@@ -399,6 +430,7 @@ Environment::Environment(const Flags& _flags) : flags(_flags)
   filters.push_back(Owned<TestFilter>(new NetworkIsolatorTestFilter()));
   filters.push_back(Owned<TestFilter>(new PerfFilter()));
   filters.push_back(Owned<TestFilter>(new NetcatFilter()));
+  filters.push_back(Owned<TestFilter>(new OverlayFSFilter()));
 
   // Construct the filter string to handle system or platform specific tests.
   ::testing::UnitTest* unitTest = ::testing::UnitTest::GetInstance();
@@ -1084,8 +1084,8 @@ TEST_F(FetcherCacheHttpTest, HttpMixed)
 }
 
 
-// Tests slave recovery of the fetcher cache. The cache must be
-// wiped clean on recovery, causing renewed downloads.
+// Tests slave recovery of the fetcher cache. The cache must survive
+// recovery, so that no renewed downloads are necessary.
 // TODO(bernd-mesos): Debug flaky behavior reported in MESOS-2871,
 // then reenable this test.
 TEST_F(FetcherCacheHttpTest, DISABLED_HttpCachedRecovery)
@@ -1128,7 +1128,8 @@ TEST_F(FetcherCacheHttpTest, DISABLED_HttpCachedRecovery)
 
   // Don't reuse the old fetcher, which has stale state after
   // stopping the slave.
-  Fetcher fetcher2;
+  FetcherProcess* fetcherProcess2 = new FetcherProcess();
+  Fetcher fetcher2((Owned<FetcherProcess>(fetcherProcess2)));
 
   Try<MesosContainerizer*> c =
     MesosContainerizer::create(flags, true, &fetcher2);
@@ -1147,8 +1148,9 @@ TEST_F(FetcherCacheHttpTest, DISABLED_HttpCachedRecovery)
   // Wait until the containerizer is updated.
   AWAIT_READY(update);
 
-  // Recovery must have cleaned the cache by now.
-  EXPECT_FALSE(os::exists(cacheDirectory));
+  // Recovery must have kept the cache file.
+  ASSERT_SOME(fetcherProcess2->cacheFiles(slaveId, flags));
+  EXPECT_EQ(1u, fetcherProcess2->cacheFiles(slaveId, flags).get().size());
 
   // Repeat of the above to see if it works the same.
   for (size_t i = 0; i < 3; i++) {
@@ -1171,13 +1173,14 @@ TEST_F(FetcherCacheHttpTest, DISABLED_HttpCachedRecovery)
     EXPECT_TRUE(isExecutable(path));
     EXPECT_TRUE(os::exists(path + taskName(i)));
 
-    EXPECT_EQ(1u, fetcherProcess->cacheSize());
-    ASSERT_SOME(fetcherProcess->cacheFiles(slaveId, flags));
-    EXPECT_EQ(1u, fetcherProcess->cacheFiles(slaveId, flags).get().size());
+    // The new fetcher has loaded the cache entry from the index.
+    EXPECT_EQ(1u, fetcherProcess2->cacheSize());
+    ASSERT_SOME(fetcherProcess2->cacheFiles(slaveId, flags));
+    EXPECT_EQ(1u, fetcherProcess2->cacheFiles(slaveId, flags).get().size());
 
-    // content-length requests: 1
-    // downloads: 1
-    EXPECT_EQ(2u, httpServer->countCommandRequests);
+    // content-length requests: 0
+    // downloads: 0
+    EXPECT_EQ(0u, httpServer->countCommandRequests);
   }
 }
 
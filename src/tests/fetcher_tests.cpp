@@ -44,6 +44,7 @@
 
 #include "slave/containerizer/fetcher.hpp"
 #include "slave/flags.hpp"
+#include "slave/paths.hpp"
 
 #include "tests/environment.hpp"
 #include "tests/flags.hpp"
@@ -61,6 +62,7 @@ using mesos::internal::slave::Fetcher;
 using process::Subprocess;
 using process::Future;
 
+using std::list;
 using std::map;
 using std::string;
 
@@ -661,6 +663,243 @@ TEST_F(FetcherTest, HdfsURI)
   EXPECT_TRUE(os::exists(localFile));
 }
 
+
+// Tests that the fetcher cache survives a restart of the fetcher
+// (i.e., of the slave), so that cached URIs are not downloaded again.
+TEST_F(FetcherTest, CachedRecovery)
+{
+  string fromDir = path::join(os::getcwd(), "from");
+  ASSERT_SOME(os::mkdir(fromDir));
+  string testFile = path::join(fromDir, "test");
+  EXPECT_SOME(os::write(testFile, "data"));
+
+  slave::Flags flags;
+  flags.launcher_dir = path::join(tests::flags.build_dir, "src");
+  flags.fetcher_cache_dir = path::join(os::getcwd(), "cache");
+
+  CommandInfo commandInfo;
+  CommandInfo::URI* uri = commandInfo.add_uris();
+  uri->set_value("file://" + testFile);
+  uri->set_cache(true);
+
+  SlaveID slaveId;
+  slaveId.set_value(UUID::random().toString());
+
+  string sandbox1 = path::join(os::getcwd(), "sandbox1");
+  ASSERT_SOME(os::mkdir(sandbox1));
+
+  {
+    ContainerID containerId;
+    containerId.set_value(UUID::random().toString());
+
+    Fetcher fetcher;
+
+    Future<Nothing> fetch = fetcher.fetch(
+        containerId, commandInfo, sandbox1, None(), slaveId, flags);
+    AWAIT_READY(fetch);
+  }
+
+  EXPECT_SOME_EQ("data", os::read(path::join(sandbox1, "test")));
+
+  ASSERT_SOME(Fetcher::recover(slaveId, flags));
+
+  // Only the cache can provide the file from now on.
+  ASSERT_SOME(os::rm(testFile));
+
+  string sandbox2 = path::join(os::getcwd(), "sandbox2");
+  ASSERT_SOME(os::mkdir(sandbox2));
+
+  ContainerID containerId;
+  containerId.set_value(UUID::random().toString());
+
+  Fetcher fetcher;
+
+  Future<Nothing> fetch = fetcher.fetch(
+      containerId, commandInfo, sandbox2, None(), slaveId, flags);
+  AWAIT_READY(fetch);
+
+  EXPECT_SOME_EQ("data", os::read(path::join(sandbox2, "test")));
+
+  JSON::Object stats = Metrics();
+  EXPECT_EQ(1u, stats.values["containerizer/fetcher/cache_hits"]);
+  EXPECT_EQ(0u, stats.values["containerizer/fetcher/cache_misses"]);
+  EXPECT_EQ(1u, stats.values["containerizer/fetcher/cache_hit_rate"]);
+  EXPECT_EQ(4u, stats.values["containerizer/fetcher/cache_bytes_saved"]);
+}
+
+
+// Tests that the fetcher fetches several URIs concurrently, keeps the
+// original order of URIs with the same basename and reports how long
+// the URIs took as metrics.
+TEST_F(FetcherTest, ConcurrentURIs)
+{
+  string fromDir = path::join(os::getcwd(), "from");
+  ASSERT_SOME(os::mkdir(fromDir));
+
+  CommandInfo commandInfo;
+
+  for (int i = 0; i < 8; i++) {
+    string testFile = path::join(fromDir, "test" + stringify(i));
+    EXPECT_SOME(os::write(testFile, stringify(i)));
+
+    commandInfo.add_uris()->set_value(testFile);
+  }
+
+  // Both of these are fetched to "sandbox/test", the latter has to win.
+  string otherDir = path::join(os::getcwd(), "other");
+  ASSERT_SOME(os::mkdir(otherDir));
+  EXPECT_SOME(os::write(path::join(fromDir, "test"), "first"));
+  EXPECT_SOME(os::write(path::join(otherDir, "test"), "second"));
+
+  commandInfo.add_uris()->set_value(path::join(fromDir, "test"));
+  commandInfo.add_uris()->set_value(path::join(otherDir, "test"));
+
+  slave::Flags flags;
+  flags.launcher_dir = path::join(tests::flags.build_dir, "src");
+  flags.fetcher_concurrency = 4;
+
+  ContainerID containerId;
+  containerId.set_value(UUID::random().toString());
+
+  Fetcher fetcher;
+  SlaveID slaveId;
+
+  Future<Nothing> fetch = fetcher.fetch(
+      containerId, commandInfo, os::getcwd(), None(), slaveId, flags);
+  AWAIT_READY(fetch);
+
+  for (int i = 0; i < 8; i++) {
+    EXPECT_SOME_EQ(
+        stringify(i),
+        os::read(path::join(os::getcwd(), "test" + stringify(i))));
+  }
+
+  EXPECT_SOME_EQ("second", os::read(path::join(os::getcwd(), "test")));
+
+  JSON::Object stats = Metrics();
+  EXPECT_EQ(1u, stats.values.count("containerizer/fetcher/download_time_ms"));
+  EXPECT_EQ(1u, stats.values.count("containerizer/fetcher/fetch_time_ms"));
+}
+
+
+// Tests that archives with different basenames but overlapping
+// contents are extracted in the order of their URIs when they are
+// fetched concurrently, i.e., that the last URI wins.
+TEST_F(FetcherTest, ConcurrentOverlappingArchives)
+{
+  string fromDir = path::join(os::getcwd(), "from");
+  ASSERT_SOME(os::mkdir(fromDir));
+
+  string file = path::join(fromDir, "config");
+
+  CommandInfo commandInfo;
+
+  for (int i = 0; i < 8; i++) {
+    ASSERT_SOME(os::write(file, stringify(i)));
+
+    string archive = path::join(fromDir, "archive" + stringify(i) + ".tar.gz");
+    ASSERT_SOME(os::tar(file, archive));
+
+    CommandInfo::URI* uri = commandInfo.add_uris();
+    uri->set_value(archive);
+    uri->set_extract(true);
+  }
+
+  ASSERT_SOME(os::rm(file));
+
+  slave::Flags flags;
+  flags.launcher_dir = path::join(tests::flags.build_dir, "src");
+  flags.fetcher_concurrency = 4;
+
+  ContainerID containerId;
+  containerId.set_value(UUID::random().toString());
+
+  Fetcher fetcher;
+  SlaveID slaveId;
+
+  Future<Nothing> fetch = fetcher.fetch(
+      containerId, commandInfo, os::getcwd(), None(), slaveId, flags);
+  AWAIT_READY(fetch);
+
+  EXPECT_SOME_EQ("7", os::read(path::join(".", file)));
+
+  // Nothing is left behind of the downloads.
+  Try<list<string>> staged =
+    os::glob(path::join(os::getcwd(), ".mesos-fetcher-[0-9]*"));
+  ASSERT_SOME(staged);
+  EXPECT_TRUE(staged.get().empty());
+}
+
+
+// Tests that recovering the fetcher cache discards cache files which
+// changed since they were cached as well as files unknown to it.
+TEST_F(FetcherTest, CachedRecoveryDiscardsChangedFiles)
+{
+  string fromDir = path::join(os::getcwd(), "from");
+  ASSERT_SOME(os::mkdir(fromDir));
+  string testFile = path::join(fromDir, "test");
+  EXPECT_SOME(os::write(testFile, "data"));
+
+  slave::Flags flags;
+  flags.launcher_dir = path::join(tests::flags.build_dir, "src");
+  flags.fetcher_cache_dir = path::join(os::getcwd(), "cache");
+
+  CommandInfo commandInfo;
+  CommandInfo::URI* uri = commandInfo.add_uris();
+  uri->set_value("file://" + testFile);
+  uri->set_cache(true);
+
+  SlaveID slaveId;
+  slaveId.set_value(UUID::random().toString());
+
+  {
+    ContainerID containerId;
+    containerId.set_value(UUID::random().toString());
+
+    Fetcher fetcher;
+
+    Future<Nothing> fetch = fetcher.fetch(
+        containerId, commandInfo, os::getcwd(), None(), slaveId, flags);
+    AWAIT_READY(fetch);
+  }
+
+  const string cacheDirectory =
+    slave::paths::getSlavePath(flags.fetcher_cache_dir, slaveId);
+
+  Try<list<string>> cacheFiles = os::find(cacheDirectory, "test");
+  ASSERT_SOME(cacheFiles);
+  ASSERT_EQ(1u, cacheFiles.get().size());
+
+  const string cacheFile = cacheFiles.get().front();
+  ASSERT_SOME(os::write(cacheFile, "corrupted data"));
+
+  const string unknownFile = path::join(cacheDirectory, "unknown");
+  ASSERT_SOME(os::write(unknownFile, "data"));
+
+  ASSERT_SOME(Fetcher::recover(slaveId, flags));
+
+  EXPECT_FALSE(os::exists(cacheFile));
+  EXPECT_FALSE(os::exists(unknownFile));
+
+  string sandbox = path::join(os::getcwd(), "sandbox");
+  ASSERT_SOME(os::mkdir(sandbox));
+
+  ContainerID containerId;
+  containerId.set_value(UUID::random().toString());
+
+  Fetcher fetcher;
+
+  Future<Nothing> fetch = fetcher.fetch(
+      containerId, commandInfo, sandbox, None(), slaveId, flags);
+  AWAIT_READY(fetch);
+
+  EXPECT_SOME_EQ("data", os::read(path::join(sandbox, "test")));
+
+  JSON::Object stats = Metrics();
+  EXPECT_EQ(0u, stats.values["containerizer/fetcher/cache_hits"]);
+  EXPECT_EQ(1u, stats.values["containerizer/fetcher/cache_misses"]);
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
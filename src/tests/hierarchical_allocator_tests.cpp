@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <queue>
 #include <vector>
@@ -38,6 +39,7 @@
 #include <stout/hashset.hpp>
 #include <stout/os.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/synchronized.hpp>
 #include <stout/utils.hpp>
 
 #include "master/constants.hpp"
@@ -1126,6 +1128,74 @@ TEST_F(HierarchicalAllocatorTest, Whitelist)
 }
 
 
+// Checks that the resources declined by a framework are filtered
+// until the refusal expires, and that resources are only filtered
+// if they are contained in the resources of a single refusal.
+TEST_F(HierarchicalAllocatorTest, DeclinedResourcesFiltered)
+{
+  Clock::pause();
+
+  initialize(vector<string>{});
+
+  hashmap<FrameworkID, Resources> EMPTY;
+
+  SlaveInfo slave = createSlaveInfo("cpus:2;mem:1024");
+  allocator->addSlave(slave.id(), slave, None(), slave.resources(), EMPTY);
+
+  FrameworkInfo framework = createFrameworkInfo("*");
+  allocator->addFramework(
+      framework.id(), framework, hashmap<SlaveID, Resources>());
+
+  Future<Allocation> allocation = allocations.get();
+
+  AWAIT_READY(allocation);
+  EXPECT_EQ(framework.id(), allocation.get().frameworkId);
+  EXPECT_EQ(slave.resources(), Resources::sum(allocation.get().resources));
+
+  // Decline all of the resources for 5 seconds.
+  Filters filters;
+  filters.set_refuse_seconds(5);
+
+  allocator->recoverResources(
+      framework.id(), slave.id(), slave.resources(), filters);
+
+  allocation = allocations.get();
+
+  // Ensure a batch allocation is triggered.
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  // There should be no allocation!
+  ASSERT_TRUE(allocation.isPending());
+
+  // The resources should be offered again once the refusal expires.
+  Clock::advance(Seconds(5) - flags.allocation_interval);
+
+  AWAIT_READY(allocation);
+  EXPECT_EQ(framework.id(), allocation.get().frameworkId);
+  EXPECT_EQ(slave.resources(), Resources::sum(allocation.get().resources));
+
+  // Now decline each half of the resources for 10 seconds. All of
+  // the resources are not contained in either of the refusals, so
+  // they get offered in the next batch allocation.
+  Resources half = Resources::parse("cpus:1;mem:512").get();
+
+  filters.set_refuse_seconds(10);
+
+  allocator->recoverResources(framework.id(), slave.id(), half, filters);
+  allocator->recoverResources(
+      framework.id(), slave.id(), slave.resources() - half, filters);
+
+  allocation = allocations.get();
+
+  Clock::advance(flags.allocation_interval);
+
+  AWAIT_READY(allocation);
+  EXPECT_EQ(framework.id(), allocation.get().frameworkId);
+  EXPECT_EQ(slave.resources(), Resources::sum(allocation.get().resources));
+}
+
+
 class HierarchicalAllocator_BENCHMARK_Test
   : public HierarchicalAllocatorTestBase,
     public WithParamInterface<std::tr1::tuple<size_t, size_t>>
@@ -1236,6 +1306,214 @@ TEST_P(HierarchicalAllocator_BENCHMARK_Test, AddAndUpdateSlave)
   cout << "Updated " << slaveCount << " slaves in " << watch.elapsed() << endl;
 }
 
+
+// Measures a full batch allocation, i.e., the allocation of all the
+// slaves' resources at once, as opposed to the per slave allocations
+// when slaves are added or updated.
+TEST_P(HierarchicalAllocator_BENCHMARK_Test, Allocate)
+{
+  size_t slaveCount = std::tr1::get<0>(GetParam());
+  size_t frameworkCount = std::tr1::get<1>(GetParam());
+
+  vector<SlaveInfo> slaves;
+  vector<FrameworkInfo> frameworks;
+
+  for (unsigned i = 0; i < slaveCount; i++) {
+    slaves.push_back(createSlaveInfo(
+        "cpus:2;mem:1024;disk:4096;ports:[31000-32000]"));
+  }
+
+  for (unsigned i = 0; i < frameworkCount; ++i) {
+    frameworks.push_back(createFrameworkInfo("*"));
+  }
+
+  cout << "Using " << slaveCount << " slaves"
+       << " and " << frameworkCount << " frameworks" << endl;
+
+  Clock::pause();
+
+  // Number of slaves whose resources have been offered. This is used
+  // to determine the termination condition.
+  atomic<size_t> offered(0);
+
+  auto offerCallback = [&offered](
+      const FrameworkID& frameworkId,
+      const hashmap<SlaveID, Resources>& resources) {
+    offered += resources.size();
+  };
+
+  initialize({}, master::Flags(), offerCallback);
+
+  foreach (const FrameworkInfo& framework, frameworks) {
+    allocator->addFramework(framework.id(), framework, {});
+  }
+
+  // Add the slaves with all of their resources in use so that they
+  // don't get allocated as they are added, and then recover all of
+  // the resources (which doesn't trigger an allocation) so that the
+  // next batch allocation has to allocate every slave.
+  for (unsigned i = 0; i < slaves.size(); ++i) {
+    hashmap<FrameworkID, Resources> used;
+    used[frameworks[i % frameworkCount].id()] = slaves[i].resources();
+
+    allocator->addSlave(
+        slaves[i].id(),
+        slaves[i],
+        None(),
+        slaves[i].resources(),
+        used);
+  }
+
+  for (unsigned i = 0; i < slaves.size(); ++i) {
+    allocator->recoverResources(
+        frameworks[i % frameworkCount].id(),
+        slaves[i].id(),
+        slaves[i].resources(),
+        None());
+  }
+
+  // Wait for all the slaves to be added and recovered.
+  Clock::settle();
+
+  ASSERT_EQ(0u, offered.load());
+
+  Stopwatch watch;
+  watch.start();
+
+  // Trigger a batch allocation.
+  Clock::advance(flags.allocation_interval);
+
+  // Wait for all the slaves to be allocated.
+  while (offered.load() != slaveCount) {
+    os::sleep(Milliseconds(1));
+  }
+
+  cout << "Allocated " << slaveCount << " slaves in "
+       << watch.elapsed() << endl;
+}
+
+
+// Measures the batch allocations while the frameworks keep declining
+// their offers with long refusals. Each round a slice of every slave's
+// resources is recovered, so the offered resources are never covered
+// by the earlier refusals and the frameworks keep on refusing them.
+TEST_P(HierarchicalAllocator_BENCHMARK_Test, DeclineOffers)
+{
+  size_t slaveCount = std::tr1::get<0>(GetParam());
+  size_t frameworkCount = std::tr1::get<1>(GetParam());
+
+  // Number of allocation rounds, i.e., how many times each slave
+  // gets offered and declined.
+  const size_t rounds = 50;
+
+  vector<SlaveInfo> slaves;
+  vector<FrameworkInfo> frameworks;
+
+  for (unsigned i = 0; i < slaveCount; i++) {
+    slaves.push_back(createSlaveInfo(
+        "cpus:64;mem:65536;disk:4096;ports:[31000-32000]"));
+  }
+
+  for (unsigned i = 0; i < frameworkCount; ++i) {
+    frameworks.push_back(createFrameworkInfo("*"));
+  }
+
+  cout << "Using " << slaveCount << " slaves"
+       << " and " << frameworkCount << " frameworks" << endl;
+
+  Clock::pause();
+
+  // The offers made in the current round, along with the number of
+  // slaves whose resources have been offered (which is used to
+  // determine the termination condition of each round).
+  std::mutex mutex;
+  vector<Allocation> offers;
+  atomic<size_t> offered(0);
+
+  auto offerCallback = [&mutex, &offers, &offered](
+      const FrameworkID& frameworkId,
+      const hashmap<SlaveID, Resources>& resources) {
+    synchronized (mutex) {
+      offers.push_back(Allocation{frameworkId, resources});
+    }
+    offered += resources.size();
+  };
+
+  initialize({}, master::Flags(), offerCallback);
+
+  foreach (const FrameworkInfo& framework, frameworks) {
+    allocator->addFramework(framework.id(), framework, {});
+  }
+
+  // Add the slaves with all of their resources in use so that they
+  // don't get allocated as they are added.
+  for (unsigned i = 0; i < slaves.size(); ++i) {
+    hashmap<FrameworkID, Resources> used;
+    used[frameworks[i % frameworkCount].id()] = slaves[i].resources();
+
+    allocator->addSlave(
+        slaves[i].id(),
+        slaves[i],
+        None(),
+        slaves[i].resources(),
+        used);
+  }
+
+  Clock::settle();
+
+  ASSERT_EQ(0u, offered.load());
+
+  Resources slice = Resources::parse("cpus:1;mem:1024").get();
+
+  Filters filters;
+  filters.set_refuse_seconds(Days(1).secs());
+
+  size_t declined = 0;
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t round = 0; round < rounds; round++) {
+    for (unsigned i = 0; i < slaves.size(); ++i) {
+      allocator->recoverResources(
+          frameworks[i % frameworkCount].id(),
+          slaves[i].id(),
+          slice,
+          None());
+    }
+
+    // Trigger a batch allocation.
+    Clock::advance(flags.allocation_interval);
+
+    // Wait for all the slaves to be allocated.
+    while (offered.load() != slaveCount * (round + 1)) {
+      os::sleep(Milliseconds(1));
+    }
+
+    vector<Allocation> declines;
+    synchronized (mutex) {
+      std::swap(declines, offers);
+    }
+
+    foreach (const Allocation& allocation, declines) {
+      foreachpair (const SlaveID& slaveId,
+                   const Resources& resources,
+                   allocation.resources) {
+        allocator->recoverResources(
+            allocation.frameworkId, slaveId, resources, filters);
+        declined++;
+      }
+    }
+  }
+
+  // Wait for all the declines to be processed.
+  Clock::settle();
+
+  cout << "Allocated and declined " << declined << " offers"
+       << " in " << rounds << " rounds"
+       << " in " << watch.elapsed() << endl;
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -20,6 +20,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <list>
 #include <set>
 #include <string>
@@ -449,6 +450,214 @@ TEST_F(ReplicaTest, Append)
 }
 
 
+// Tests that the writes that are group committed are all
+// acknowledged, and are durable (i.e., survive a restart).
+TEST_F(ReplicaTest, GroupCommit)
+{
+  const string path = os::getcwd() + "/.log";
+  initializer.flags.path = path;
+  initializer.execute();
+
+  const uint64_t proposal = 1;
+
+  {
+    Replica replica(path, Milliseconds(10));
+
+    PromiseRequest request;
+    request.set_proposal(proposal);
+
+    Future<PromiseResponse> future =
+      protocol::promise(replica.pid(), request);
+
+    AWAIT_READY(future);
+    EXPECT_TRUE(future.get().okay());
+
+    list<Future<WriteResponse> > futures;
+    for (uint64_t position = 1; position <= 10; position++) {
+      WriteRequest request;
+      request.set_proposal(proposal);
+      request.set_position(position);
+      request.set_type(Action::APPEND);
+      request.mutable_append()->set_bytes(stringify(position));
+
+      futures.push_back(protocol::write(replica.pid(), request));
+    }
+
+    uint64_t position = 1;
+    foreach (const Future<WriteResponse>& future, futures) {
+      AWAIT_READY(future);
+      EXPECT_TRUE(future.get().okay());
+      EXPECT_EQ(position++, future.get().position());
+    }
+  }
+
+  Replica replica(path);
+
+  Future<list<Action> > actions = replica.read(1, 10);
+
+  AWAIT_READY(actions);
+  ASSERT_EQ(10u, actions.get().size());
+
+  foreach (const Action& action, actions.get()) {
+    ASSERT_TRUE(action.has_type());
+    ASSERT_EQ(Action::APPEND, action.type());
+    EXPECT_EQ(stringify(action.position()), action.append().bytes());
+  }
+}
+
+
+// Tests that a read of an action that has not yet been group
+// committed waits until the action is durable.
+TEST_F(ReplicaTest, GroupCommitRead)
+{
+  const string path = os::getcwd() + "/.log";
+  initializer.flags.path = path;
+  initializer.execute();
+
+  const uint64_t proposal = 1;
+  const Duration window = Milliseconds(10);
+
+  Replica replica(path, window);
+
+  PromiseRequest promise;
+  promise.set_proposal(proposal);
+
+  Future<PromiseResponse> promised =
+    protocol::promise(replica.pid(), promise);
+
+  AWAIT_READY(promised);
+  EXPECT_TRUE(promised.get().okay());
+
+  Clock::pause();
+
+  WriteRequest request;
+  request.set_proposal(proposal);
+  request.set_position(1);
+  request.set_type(Action::APPEND);
+  request.mutable_append()->set_bytes("hello world");
+
+  Future<WriteResponse> written = protocol::write(replica.pid(), request);
+
+  Clock::settle();
+
+  Future<list<Action> > actions = replica.read(1, 1);
+
+  Clock::settle();
+
+  EXPECT_TRUE(written.isPending());
+  EXPECT_TRUE(actions.isPending());
+
+  Clock::advance(window);
+
+  AWAIT_READY(written);
+  EXPECT_TRUE(written.get().okay());
+
+  AWAIT_READY(actions);
+  ASSERT_EQ(1u, actions.get().size());
+  EXPECT_EQ("hello world", actions.get().front().append().bytes());
+
+  Clock::resume();
+}
+
+
+// A storage that fails to group commit actions while 'fail' is set.
+class FaultyStorage : public LevelDBStorage
+{
+public:
+  FaultyStorage() : fail(false) {}
+
+  using LevelDBStorage::persist;
+
+  virtual Try<Nothing> persist(const list<Action>& actions)
+  {
+    if (fail.load()) {
+      return Error("Injected failure");
+    }
+
+    return LevelDBStorage::persist(actions);
+  }
+
+  std::atomic_bool fail;
+};
+
+
+// Tests that the responses held for a group commit are dropped if
+// the commit fails, and that the metadata is not updated while the
+// pending actions cannot be made durable.
+TEST_F(ReplicaTest, GroupCommitFailure)
+{
+  const string path = os::getcwd() + "/.log";
+  initializer.flags.path = path;
+  initializer.execute();
+
+  const uint64_t proposal = 1;
+  const Duration window = Milliseconds(10);
+
+  // Owned by the replica.
+  FaultyStorage* storage = new FaultyStorage();
+
+  Replica replica(path, window, storage);
+
+  PromiseRequest promise;
+  promise.set_proposal(proposal);
+
+  Future<PromiseResponse> promised =
+    protocol::promise(replica.pid(), promise);
+
+  AWAIT_READY(promised);
+  EXPECT_TRUE(promised.get().okay());
+
+  storage->fail = true;
+
+  Clock::pause();
+
+  WriteRequest request;
+  request.set_proposal(proposal);
+  request.set_position(1);
+  request.set_type(Action::APPEND);
+  request.mutable_append()->set_bytes("hello world");
+
+  Future<WriteResponse> written = protocol::write(replica.pid(), request);
+
+  Clock::settle();
+
+  Future<list<Action> > actions = replica.read(1, 1);
+
+  Clock::settle();
+  Clock::advance(window);
+  Clock::settle();
+
+  // The commit failed, hence the response must not have been sent,
+  // and the action must not have been read.
+  EXPECT_TRUE(written.isPending());
+  AWAIT_FAILED(actions);
+
+  // The status can not be updated before the pending action is
+  // durable.
+  Future<bool> updated = replica.update(Metadata::RECOVERING);
+  AWAIT_READY(updated);
+  EXPECT_FALSE(updated.get());
+
+  AWAIT_EXPECT_EQ(Metadata::VOTING, replica.status());
+
+  // Once the storage recovers the pending action gets committed along
+  // with the update, but the dropped response stays dropped.
+  storage->fail = false;
+
+  updated = replica.update(Metadata::RECOVERING);
+  AWAIT_READY(updated);
+  EXPECT_TRUE(updated.get());
+
+  AWAIT_EXPECT_EQ(Metadata::RECOVERING, replica.status());
+
+  Clock::settle();
+
+  EXPECT_TRUE(written.isPending());
+
+  Clock::resume();
+}
+
+
 TEST_F(ReplicaTest, Restore)
 {
   const string path = os::getcwd() + "/.log";
@@ -1208,6 +1417,226 @@ TEST_F(CoordinatorTest, MultipleAppends)
 }
 
 
+// Tests that pipelined appends complete in order, and that more
+// appends than the window size get queued.
+TEST_F(CoordinatorTest, PipelinedAppends)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  initializer.execute();
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  initializer.execute();
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network, 4);
+
+  {
+    Future<Option<uint64_t> > electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  list<Future<Option<uint64_t> > > appendings;
+  for (uint64_t position = 1; position <= 10; position++) {
+    appendings.push_back(coord.append(stringify(position)));
+  }
+
+  uint64_t position = 1;
+  foreach (const Future<Option<uint64_t> >& appending, appendings) {
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(position++, appending.get());
+  }
+
+  {
+    Future<list<Action> > actions = replica1->read(1, 10);
+    AWAIT_READY(actions);
+    EXPECT_EQ(10u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  // The coordinator can be demoted once all appends are done.
+  AWAIT_EXPECT_EQ(10u, coord.demote());
+}
+
+
+// Tests that pipelined appends are learned in the order of their
+// positions, even if a write completes before a preceding one.
+TEST_F(CoordinatorTest, PipelinedAppendsLearnedInOrder)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  initializer.execute();
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  initializer.execute();
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network(new Network(pids));
+
+  Coordinator coord(2, replica1, network, 2);
+
+  {
+    Future<Option<uint64_t> > electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  Future<LearnedMessage> learned =
+    FUTURE_PROTOBUF(LearnedMessage(), _, Eq(replica1->pid()));
+
+  // Hold the write request for the first position to the second
+  // replica, so that the first write cannot complete before the
+  // second one.
+  Future<Message> writeRequest =
+    DROP_MESSAGE(Eq(WriteRequest().GetTypeName()), _, Eq(replica2->pid()));
+
+  Future<Option<uint64_t> > appending1 = coord.append("hello");
+
+  AWAIT_READY(writeRequest);
+
+  WriteRequest request;
+  ASSERT_TRUE(request.ParseFromString(writeRequest.get().body));
+  EXPECT_EQ(1u, request.position());
+
+  Future<Message> writeResponse =
+    FUTURE_MESSAGE(Eq(WriteResponse().GetTypeName()), Eq(replica2->pid()), _);
+
+  Future<Option<uint64_t> > appending2 = coord.append("world");
+
+  AWAIT_READY(writeResponse);
+
+  EXPECT_TRUE(appending1.isPending());
+  EXPECT_TRUE(appending2.isPending());
+
+  process::post(
+      writeRequest.get().from,
+      writeRequest.get().to,
+      writeRequest.get().name,
+      writeRequest.get().body.data(),
+      writeRequest.get().body.size());
+
+  AWAIT_READY(appending1);
+  EXPECT_SOME_EQ(1u, appending1.get());
+
+  AWAIT_READY(appending2);
+  EXPECT_SOME_EQ(2u, appending2.get());
+
+  // The first position was learned first.
+  AWAIT_READY(learned);
+  EXPECT_EQ(1u, learned.get().action().position());
+
+  {
+    Future<list<Action> > actions = replica1->read(1, 2);
+    AWAIT_READY(actions);
+    ASSERT_EQ(2u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      EXPECT_TRUE(action.has_learned() && action.learned());
+    }
+  }
+}
+
+
+// Tests that if one of several pipelined appends receives a NACK the
+// coordinator gets demoted, all of the appends return none, and the
+// coordinator can be elected again once they are done.
+TEST_F(CoordinatorTest, PipelinedAppendsDemoted)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  initializer.execute();
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  initializer.execute();
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord1(2, replica1, network1, 4);
+
+  {
+    Future<Option<uint64_t> > electing = coord1.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  {
+    Future<Option<uint64_t> > appending = coord1.append("hello world");
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(1u, appending.get());
+  }
+
+  Shared<Network> network2(new Network(pids));
+
+  Coordinator coord2(2, replica2, network2);
+
+  {
+    Future<Option<uint64_t> > electing = coord2.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(1u, electing.get());
+  }
+
+  list<Future<Option<uint64_t> > > appendings;
+  for (int i = 0; i < 3; i++) {
+    appendings.push_back(coord1.append("hello moto"));
+  }
+
+  // The coordinator cannot be demoted while it is writing.
+  AWAIT_FAILED(coord1.demote());
+
+  foreach (const Future<Option<uint64_t> >& appending, appendings) {
+    AWAIT_READY(appending);
+    EXPECT_NONE(appending.get());
+  }
+
+  // The coordinator has been demoted by the NACK.
+  {
+    Future<Option<uint64_t> > appending = coord1.append("hello moto");
+    AWAIT_READY(appending);
+    EXPECT_NONE(appending.get());
+  }
+
+  {
+    Future<Option<uint64_t> > appending = coord2.append("hello hello");
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(2u, appending.get());
+  }
+
+  {
+    Future<Option<uint64_t> > electing = coord1.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(2u, electing.get());
+  }
+}
+
+
 TEST_F(CoordinatorTest, MultipleAppendsNotLearnedFill)
 {
   const string path1 = os::getcwd() + "/.log1";
@@ -20,6 +20,7 @@
 
 #include <gmock/gmock.h>
 
+#include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
@@ -44,12 +45,17 @@
 #include <stout/net.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/recordio.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
 #include <stout/try.hpp>
 
 #include "common/build.hpp"
+#include "common/http.hpp"
 #include "common/protobuf_utils.hpp"
 
+#include "internal/evolve.hpp"
+
 #include "master/flags.hpp"
 #include "master/master.hpp"
 
@@ -65,6 +71,7 @@
 #include "tests/mesos.hpp"
 #include "tests/utils.hpp"
 
+using mesos::internal::master::Broadcast;
 using mesos::internal::master::Master;
 
 using mesos::internal::master::allocator::MesosAllocatorProcess;
@@ -81,6 +88,8 @@ using process::Future;
 using process::PID;
 using process::Promise;
 
+using std::cout;
+using std::endl;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -92,6 +101,7 @@ using testing::Eq;
 using testing::Not;
 using testing::Return;
 using testing::SaveArg;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -2024,6 +2034,165 @@ TEST_F(MasterTest, CancelRecoveredSlaveRemoval)
 }
 
 
+// This test verifies that the pings of the slaves are spread across
+// the ping timeout, and that the first ping of a slave is not
+// evaluated before a full ping timeout has passed.
+TEST_F(MasterTest, SlavePingsSpread)
+{
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.slave_ping_timeout = Seconds(640);
+
+  // The time between two consecutive ping slots being due.
+  const Duration interval =
+    masterFlags.slave_ping_timeout / master::SLAVE_PING_SLOTS;
+
+  Try<PID<Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  // A slave gets pinged as soon as it is added.
+  Future<Message> ping = FUTURE_MESSAGE(
+      Eq(PingSlaveMessage().GetTypeName()), _, _);
+
+  Try<PID<Slave>> slave1 = StartSlave();
+  ASSERT_SOME(slave1);
+
+  AWAIT_READY(ping);
+
+  ping = FUTURE_MESSAGE(Eq(PingSlaveMessage().GetTypeName()), _, _);
+
+  Try<PID<Slave>> slave2 = StartSlave();
+  ASSERT_SOME(slave2);
+
+  AWAIT_READY(ping);
+
+  Clock::pause();
+
+  Future<Message> ping1 = FUTURE_MESSAGE(
+      Eq(PingSlaveMessage().GetTypeName()), _, Eq(slave1.get()));
+
+  Future<Message> ping2 = FUTURE_MESSAGE(
+      Eq(PingSlaveMessage().GetTypeName()), _, Eq(slave2.get()));
+
+  // The first slave is pinged again a ping timeout after it was
+  // added.
+  Clock::advance(masterFlags.slave_ping_timeout);
+
+  AWAIT_READY(ping1);
+
+  // The second slave went into the next slot, which was due shortly
+  // after it was added. It must have been skipped then, and is not
+  // due again yet.
+  Clock::settle();
+  EXPECT_TRUE(ping2.isPending());
+
+  Clock::advance(interval);
+
+  AWAIT_READY(ping2);
+
+  Clock::resume();
+
+  Shutdown();
+}
+
+
+// This test verifies that a slave that misses the pongs for
+// 'max_slave_ping_timeouts' pings gets exactly one shutdown
+// scheduled through the slave removal rate limiter, and that a
+// slave that gets removed while its shutdown is pending is not
+// shut down again.
+TEST_F(MasterTest, RateLimitedShutdownOfUnhealthySlaves)
+{
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.slave_ping_timeout = Seconds(640);
+  masterFlags.max_slave_ping_timeouts = 2;
+
+  // The time between two consecutive ping slots being due.
+  const Duration interval =
+    masterFlags.slave_ping_timeout / master::SLAVE_PING_SLOTS;
+
+  shared_ptr<MockRateLimiter> slaveRemovalLimiter(new MockRateLimiter());
+
+  // Return pending futures from the rate limiter, which is expected to
+  // be asked for exactly one permit per slave.
+  Future<Nothing> acquire1;
+  Future<Nothing> acquire2;
+  Promise<Nothing> promise1;
+  Promise<Nothing> promise2;
+  EXPECT_CALL(*slaveRemovalLimiter, acquire())
+    .WillOnce(DoAll(FutureSatisfy(&acquire1),
+                    Return(promise1.future())))
+    .WillOnce(DoAll(FutureSatisfy(&acquire2),
+                    Return(promise2.future())));
+
+  Try<PID<Master>> master = StartMaster(slaveRemovalLimiter, masterFlags);
+  ASSERT_SOME(master);
+
+  // Drop all the PONGs so that the slaves become unhealthy.
+  DROP_MESSAGES(Eq(PongSlaveMessage().GetTypeName()), _, _);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage1 =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), master.get(), _);
+
+  Try<PID<Slave>> slave1 = StartSlave();
+  ASSERT_SOME(slave1);
+
+  AWAIT_READY(slaveRegisteredMessage1);
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage2 =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), master.get(), _);
+
+  Try<PID<Slave>> slave2 = StartSlave();
+  ASSERT_SOME(slave2);
+
+  AWAIT_READY(slaveRegisteredMessage2);
+
+  Clock::pause();
+
+  // Go through the slots one at a time until both slaves have missed
+  // 'max_slave_ping_timeouts' pongs, and then through another ping
+  // timeout, which must not schedule any more shutdowns.
+  const size_t slots =
+    (masterFlags.max_slave_ping_timeouts + 1) * master::SLAVE_PING_SLOTS + 1;
+
+  for (size_t i = 0; i < slots; i++) {
+    Clock::advance(interval);
+    Clock::settle();
+  }
+
+  AWAIT_READY(acquire1);
+  AWAIT_READY(acquire2);
+
+  JSON::Object stats = Metrics();
+  EXPECT_EQ(2, stats.values["master/slave_shutdowns_scheduled"]);
+  EXPECT_EQ(0, stats.values["master/slave_shutdowns_completed"]);
+
+  // Remove the second slave while its shutdown is pending.
+  Future<UnregisterSlaveMessage> unregisterSlaveMessage =
+    FUTURE_PROTOBUF(UnregisterSlaveMessage(), slave2.get(), master.get());
+
+  Stop(slave2.get(), true);
+
+  AWAIT_READY(unregisterSlaveMessage);
+  Clock::settle();
+
+  // Only the first slave gets shut down once the permits are
+  // satisfied.
+  promise1.set(Nothing());
+  promise2.set(Nothing());
+  Clock::settle();
+
+  stats = Metrics();
+  EXPECT_EQ(1, stats.values["master/slave_shutdowns_completed"]);
+  EXPECT_EQ(0, stats.values["master/slave_shutdowns_canceled"]);
+  EXPECT_EQ(1, stats.values["master/slave_removals/reason_unhealthy"]);
+  EXPECT_EQ(1, stats.values["master/slave_removals/reason_unregistered"]);
+
+  Clock::resume();
+
+  Shutdown();
+}
+
+
 // This test ensures that when a slave is recovered from the registry
 // and re-registers with the master, it is *not* removed after the
 // re-registration timeout elapses.
@@ -3432,6 +3601,68 @@ TEST_F(MasterTest, SlaveActiveEndpoint)
 }
 
 
+// This tests that the master's state endpoint is served from a
+// snapshot that is only refreshed once it is older than the
+// '--state_snapshot_interval'.
+TEST_F(MasterTest, StateSnapshotInterval)
+{
+  master::Flags flags = CreateMasterFlags();
+  flags.state_snapshot_interval = Days(1);
+
+  Try<PID<Master>> master = StartMaster(flags);
+  ASSERT_SOME(master);
+
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "state");
+  AWAIT_READY(response);
+
+  Try<JSON::Object> parse = JSON::parse<JSON::Object>(response.get().body);
+  ASSERT_SOME(parse);
+
+  Result<JSON::Array> slaves = parse.get().find<JSON::Array>("slaves");
+  ASSERT_SOME(slaves);
+  EXPECT_TRUE(slaves.get().values.empty());
+
+  Future<SlaveRegisteredMessage> slaveRegisteredMessage =
+    FUTURE_PROTOBUF(SlaveRegisteredMessage(), _, _);
+
+  Try<PID<Slave>> slave = StartSlave();
+  ASSERT_SOME(slave);
+
+  AWAIT_READY(slaveRegisteredMessage);
+
+  // The slave is not in the snapshot that is still being served.
+  response = process::http::get(master.get(), "state");
+  AWAIT_READY(response);
+
+  parse = JSON::parse<JSON::Object>(response.get().body);
+  ASSERT_SOME(parse);
+
+  slaves = parse.get().find<JSON::Array>("slaves");
+  ASSERT_SOME(slaves);
+  EXPECT_TRUE(slaves.get().values.empty());
+
+  // Once the snapshot is too old a new one is taken, which includes
+  // the slave.
+  Clock::pause();
+  Clock::advance(flags.state_snapshot_interval);
+
+  response = process::http::get(master.get(), "state");
+  AWAIT_READY(response);
+
+  Clock::resume();
+
+  parse = JSON::parse<JSON::Object>(response.get().body);
+  ASSERT_SOME(parse);
+
+  slaves = parse.get().find<JSON::Array>("slaves");
+  ASSERT_SOME(slaves);
+  EXPECT_EQ(1u, slaves.get().values.size());
+
+  Shutdown();
+}
+
+
 // This test verifies that service info for tasks is exposed over the
 // master's state endpoint.
 TEST_F(MasterTest, TaskDiscoveryInfo)
@@ -3830,6 +4061,211 @@ TEST_F(MasterTest, FrameworkInfoLabels)
   Shutdown();
 }
 
+
+// Checks that a broadcast message is encoded the same way as when it
+// gets sent to each framework separately.
+TEST(BroadcastTest, Encoding)
+{
+  LostSlaveMessage message;
+  message.mutable_slave_id()->set_value("slave");
+
+  Broadcast<LostSlaveMessage> broadcast(message);
+
+  EXPECT_EQ(message.GetTypeName(), broadcast.serialized().name());
+  EXPECT_EQ(message.SerializeAsString(), broadcast.serialized().data());
+
+  vector<ContentType> contentTypes =
+    {ContentType::PROTOBUF, ContentType::JSON};
+
+  foreach (ContentType contentType, contentTypes) {
+    ::recordio::Encoder<v1::scheduler::Event> encoder(
+        lambda::bind(serialize, contentType, lambda::_1));
+
+    EXPECT_EQ(encoder.encode(evolve(message)), broadcast.record(contentType));
+  }
+}
+
+
+class Master_BENCHMARK_Test
+  : public ::testing::Test,
+    public WithParamInterface<size_t> {};
+
+
+// The master benchmark tests are parameterized by the number of
+// frameworks.
+INSTANTIATE_TEST_CASE_P(
+    FrameworkCount,
+    Master_BENCHMARK_Test,
+    ::testing::Values(1000U, 2000U, 5000U, 10000U));
+
+
+// Measures the time spent encoding a message that gets sent to all
+// the frameworks (a third of which have a pid, and the rest of which
+// are HTTP frameworks using either content type), when the message
+// is encoded for each framework as opposed to being broadcast.
+TEST_P(Master_BENCHMARK_Test, BroadcastEncoding)
+{
+  size_t frameworkCount = GetParam();
+
+  LostSlaveMessage message;
+  message.mutable_slave_id()->set_value(
+      "20151007-223234-1694607882-5050-20475-S42");
+
+  vector<Option<ContentType>> frameworks;
+  for (size_t i = 0; i < frameworkCount; i++) {
+    switch (i % 3) {
+      case 0: frameworks.push_back(None()); break;
+      case 1: frameworks.push_back(ContentType::PROTOBUF); break;
+      case 2: frameworks.push_back(ContentType::JSON); break;
+    }
+  }
+
+  cout << "Using " << frameworkCount << " frameworks" << endl;
+
+  size_t bytes = 0;
+
+  Stopwatch watch;
+  watch.start();
+
+  foreach (const Option<ContentType>& contentType, frameworks) {
+    if (contentType.isNone()) {
+      bytes += message.SerializeAsString().size();
+    } else {
+      ::recordio::Encoder<v1::scheduler::Event> encoder(
+          lambda::bind(serialize, contentType.get(), lambda::_1));
+
+      bytes += encoder.encode(evolve(message)).size();
+    }
+  }
+
+  Duration separately = watch.elapsed();
+
+  cout << "Encoded the message for each framework in " << separately
+       << endl;
+
+  size_t broadcastBytes = 0;
+
+  watch.start();
+
+  Broadcast<LostSlaveMessage> broadcast(message);
+
+  foreach (const Option<ContentType>& contentType, frameworks) {
+    if (contentType.isNone()) {
+      broadcastBytes += broadcast.serialized().data().size();
+    } else {
+      broadcastBytes += broadcast.record(contentType.get()).size();
+    }
+  }
+
+  Duration once = watch.elapsed();
+
+  EXPECT_EQ(bytes, broadcastBytes);
+
+  cout << "Encoded the broadcast message once in " << once
+       << " (saved " << (separately - once) << ")" << endl;
+}
+
+
+class MasterSnapshot_BENCHMARK_Test
+  : public MesosTest,
+    public WithParamInterface<size_t> {};
+
+
+// The master snapshot benchmark tests are parameterized by the number
+// of tasks.
+INSTANTIATE_TEST_CASE_P(
+    TaskCount,
+    MasterSnapshot_BENCHMARK_Test,
+    ::testing::Values(1000U, 10000U, 50000U));
+
+
+// Measures the time it takes to serve the '/state' endpoint with the
+// default '--state_snapshot_interval', which takes a new snapshot for
+// every request: the first snapshot copies every task, subsequent
+// ones share the copies of the tasks that did not change.
+TEST_P(MasterSnapshot_BENCHMARK_Test, State)
+{
+  const size_t taskCount = GetParam();
+
+  Try<PID<Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  // The tasks never run, the master only needs to know about them.
+  DROP_PROTOBUFS(RunTaskMessage(), _, _);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.resources = "cpus:1;mem:" + stringify(taskCount);
+
+  Try<PID<Slave>> slave = StartSlave(flags);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get(), DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  EXPECT_NE(0u, offers.get().size());
+
+  vector<TaskInfo> tasks;
+  for (size_t i = 0; i < taskCount; i++) {
+    TaskInfo task;
+    task.set_name("");
+    task.mutable_task_id()->set_value(stringify(i));
+    task.mutable_slave_id()->CopyFrom(offers.get()[0].slave_id());
+    task.mutable_resources()->CopyFrom(Resources::parse("mem:1").get());
+    task.mutable_executor()->CopyFrom(DEFAULT_EXECUTOR_INFO);
+    tasks.push_back(task);
+  }
+
+  // The unused CPUs are recovered once all the tasks have been added.
+  Future<Nothing> recoverResources =
+    FUTURE_DISPATCH(_, &MesosAllocatorProcess::recoverResources);
+
+  driver.launchTasks(offers.get()[0].id(), tasks);
+
+  AWAIT_READY(recoverResources);
+
+  cout << "Using " << taskCount << " tasks" << endl;
+
+  Stopwatch watch;
+  watch.start();
+
+  Future<process::http::Response> response =
+    process::http::get(master.get(), "state");
+  AWAIT_READY_FOR(response, Minutes(1));
+  EXPECT_EQ(process::http::OK().status, response.get().status);
+
+  cout << "Served the first '/state' request in " << watch.elapsed()
+       << endl;
+
+  const size_t requestCount = 10;
+
+  watch.start();
+
+  for (size_t i = 0; i < requestCount; i++) {
+    response = process::http::get(master.get(), "state");
+    AWAIT_READY_FOR(response, Minutes(1));
+    EXPECT_EQ(process::http::OK().status, response.get().status);
+  }
+
+  cout << "Served " << requestCount << " subsequent '/state' requests in "
+       << watch.elapsed() << endl;
+
+  driver.stop();
+  driver.join();
+
+  Shutdown();
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -21,6 +21,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <mesos/attributes.hpp>
@@ -34,6 +35,7 @@
 
 #include <stout/bytes.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/strings.hpp>
 #include <stout/uuid.hpp>
 
 #include "common/protobuf_utils.hpp"
@@ -68,6 +70,7 @@ using std::endl;
 using std::map;
 using std::set;
 using std::string;
+using std::tuple;
 using std::vector;
 
 using process::Clock;
@@ -707,6 +710,174 @@ TEST_P(RegistrarTest, Bootstrap)
 }
 
 
+// Tests that the registry is recovered from the stored registry and
+// the deltas that were appended to it.
+TEST_P(RegistrarTest, Deltas)
+{
+  flags.registry_max_deltas = 2;
+
+  vector<SlaveInfo> infos;
+  for (int i = 0; i < 4; i++) {
+    SlaveInfo info = slave;
+    info.mutable_id()->set_value("slave" + stringify(i));
+    infos.push_back(info);
+  }
+
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    // With at most 2 deltas, the registry gets stored in full (and
+    // the deltas compacted) on the third operation.
+    foreach (const SlaveInfo& info, infos) {
+      AWAIT_EQ(true, registrar.apply(Owned<Operation>(new AdmitSlave(info))));
+    }
+
+    AWAIT_EQ(true,
+             registrar.apply(Owned<Operation>(new RemoveSlave(infos[1]))));
+
+    // The last two operations were appended as deltas.
+    Future<set<string>> names = state->names();
+    AWAIT_READY(names);
+
+    EXPECT_EQ(1u, names.get().count("registry_delta_2"));
+    EXPECT_EQ(1u, names.get().count("registry_delta_3"));
+  }
+
+  Registrar registrar(flags, state);
+  Future<Registry> registry = registrar.recover(master);
+  AWAIT_READY(registry);
+
+  // Replaying the removal keeps the order of the remaining slaves.
+  ASSERT_EQ(3, registry.get().slaves().slaves().size());
+  EXPECT_EQ(infos[0], registry.get().slaves().slaves(0).info());
+  EXPECT_EQ(infos[2], registry.get().slaves().slaves(1).info());
+  EXPECT_EQ(infos[3], registry.get().slaves().slaves(2).info());
+
+  // Recovering compacts the deltas, so another recovery (without
+  // any deltas to replay) results in the same registry.
+  Registrar registrar2(flags, state);
+  Future<Registry> registry2 = registrar2.recover(master);
+  AWAIT_READY(registry2);
+
+  ASSERT_EQ(3, registry2.get().slaves().slaves().size());
+  EXPECT_EQ(infos[0], registry2.get().slaves().slaves(0).info());
+}
+
+
+// Checks that removing slaves within a single batch of operations
+// keeps the order of the remaining slaves.
+TEST_P(RegistrarTest, RemoveBatch)
+{
+  vector<SlaveInfo> infos;
+  for (int i = 0; i < 5; i++) {
+    SlaveInfo info = slave;
+    info.mutable_id()->set_value("slave" + stringify(i));
+    infos.push_back(info);
+  }
+
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    foreach (const SlaveInfo& info, infos) {
+      AWAIT_EQ(true, registrar.apply(Owned<Operation>(new AdmitSlave(info))));
+    }
+
+    // Apply the operations without waiting so that they get batched.
+    registrar.apply(Owned<Operation>(new RemoveSlave(infos[1])));
+    registrar.apply(Owned<Operation>(new RemoveSlave(infos[3])));
+    registrar.apply(Owned<Operation>(new AdmitSlave(infos[1])));
+
+    AWAIT_EQ(true,
+             registrar.apply(Owned<Operation>(new RemoveSlave(infos[0]))));
+  }
+
+  Registrar registrar(flags, state);
+  Future<Registry> registry = registrar.recover(master);
+  AWAIT_READY(registry);
+
+  ASSERT_EQ(3, registry.get().slaves().slaves().size());
+  EXPECT_EQ(infos[2], registry.get().slaves().slaves(0).info());
+  EXPECT_EQ(infos[4], registry.get().slaves().slaves(1).info());
+  EXPECT_EQ(infos[1], registry.get().slaves().slaves(2).info());
+}
+
+
+// Checks that replaying the delta of a batch of operations that
+// removes slaves (and admits one of them again) keeps the order of
+// the slaves.
+TEST_P(RegistrarTest, DeltasRemoveBatch)
+{
+  flags.registry_max_deltas = 10;
+
+  vector<SlaveInfo> infos;
+  for (int i = 0; i < 5; i++) {
+    SlaveInfo info = slave;
+    info.mutable_id()->set_value("slave" + stringify(i));
+    infos.push_back(info);
+  }
+
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    foreach (const SlaveInfo& info, infos) {
+      AWAIT_EQ(true, registrar.apply(Owned<Operation>(new AdmitSlave(info))));
+    }
+
+    // Apply the operations without waiting so that they get batched.
+    registrar.apply(Owned<Operation>(new RemoveSlave(infos[1])));
+    registrar.apply(Owned<Operation>(new RemoveSlave(infos[3])));
+
+    AWAIT_EQ(true,
+             registrar.apply(Owned<Operation>(new AdmitSlave(infos[1]))));
+  }
+
+  Registrar registrar(flags, state);
+  Future<Registry> registry = registrar.recover(master);
+  AWAIT_READY(registry);
+
+  ASSERT_EQ(4, registry.get().slaves().slaves().size());
+  EXPECT_EQ(infos[0], registry.get().slaves().slaves(0).info());
+  EXPECT_EQ(infos[2], registry.get().slaves().slaves(1).info());
+  EXPECT_EQ(infos[4], registry.get().slaves().slaves(2).info());
+  EXPECT_EQ(infos[1], registry.get().slaves().slaves(3).info());
+}
+
+
+// Tests that the recovery fails (rather than aborting the master) if
+// one of the deltas of the registry is missing.
+TEST_P(RegistrarTest, MissingDelta)
+{
+  flags.registry_max_deltas = 10;
+
+  {
+    Registrar registrar(flags, state);
+    AWAIT_READY(registrar.recover(master));
+
+    for (int i = 0; i < 3; i++) {
+      SlaveInfo info = slave;
+      info.mutable_id()->set_value("slave" + stringify(i));
+
+      AWAIT_EQ(true, registrar.apply(Owned<Operation>(new AdmitSlave(info))));
+    }
+  }
+
+  Future<state::protobuf::Variable<RegistryDelta>> delta =
+    state->fetch<RegistryDelta>("registry_delta_1");
+
+  AWAIT_READY(delta);
+  AWAIT_EQ(true, state->expunge(delta.get()));
+
+  Registrar registrar(flags, state);
+  Future<Registry> registry = registrar.recover(master);
+
+  AWAIT_FAILED(registry);
+  EXPECT_TRUE(strings::contains(registry.failure(), "Missing delta 1"));
+}
+
+
 class MockStorage : public Storage
 {
 public:
@@ -758,6 +929,9 @@ TEST_P(RegistrarTest, StoreTimeout)
   EXPECT_CALL(storage, get(_))
     .WillOnce(Return(None()));
 
+  EXPECT_CALL(storage, names())
+    .WillRepeatedly(Return(std::set<string>()));
+
   Future<Nothing> set;
   EXPECT_CALL(storage, set(_, _))
     .WillOnce(DoAll(FutureSatisfy(&set),
@@ -788,6 +962,9 @@ TEST_P(RegistrarTest, Abort)
   EXPECT_CALL(storage, get(_))
     .WillOnce(Return(None()));
 
+  EXPECT_CALL(storage, names())
+    .WillRepeatedly(Return(std::set<string>()));
+
   EXPECT_CALL(storage, set(_, _))
     .WillOnce(Return(Future<bool>(true)))              // Recovery.
     .WillOnce(Return(Future<bool>::failed("failure"))) // Failure.
@@ -803,22 +980,53 @@ TEST_P(RegistrarTest, Abort)
 }
 
 
-class Registrar_BENCHMARK_Test : public RegistrarTestBase,
-                                 public WithParamInterface<size_t>
-{};
+class Registrar_BENCHMARK_Test
+  : public RegistrarTestBase,
+    public WithParamInterface<tuple<size_t, size_t>>
+{
+protected:
+  // Returns the number of bytes the registrar has stored so far.
+  static uint64_t storedBytes()
+  {
+    JSON::Object metrics = Metrics();
+
+    return metrics.values["registrar/state_store_bytes"]
+      .as<JSON::Number>().as<uint64_t>();
+  }
+
+  static void report(
+      const string& operation,
+      size_t count,
+      const Duration& elapsed,
+      uint64_t bytes)
+  {
+    cout << operation << " " << count << " slaves in " << elapsed
+         << " (" << (count / elapsed.secs()) << " ops/sec, "
+         << Bytes(bytes / count) << " written per op)" << endl;
+  }
+};
 
 
-// The Registrar benchmark tests are parameterized by the number of slaves.
+// The Registrar benchmark tests are parameterized by the number of
+// slaves and the maximum number of registry deltas.
 INSTANTIATE_TEST_CASE_P(
-    SlaveCount,
+    SlaveCountAndMaxDeltas,
     Registrar_BENCHMARK_Test,
-    ::testing::Values(10000U, 20000U, 30000U, 50000U));
+    ::testing::Combine(
+        ::testing::Values(10000U, 20000U, 30000U, 50000U),
+        ::testing::Values(0U, 100U)));
 
 
 TEST_P(Registrar_BENCHMARK_Test, Performance)
 {
-  Registrar registrar(flags, state);
-  AWAIT_READY(registrar.recover(master));
+  size_t slaveCount = std::get<0>(GetParam());
+  flags.registry_max_deltas = std::get<1>(GetParam());
+
+  cout << "Using at most " << flags.registry_max_deltas
+       << " registry deltas" << endl;
+
+  Owned<Registrar> registrar(new Registrar(flags, state));
+  AWAIT_READY(registrar->recover(master));
 
   vector<SlaveInfo> infos;
 
@@ -826,8 +1034,6 @@ TEST_P(Registrar_BENCHMARK_Test, Performance)
   Resources resources =
     Resources::parse("cpus(*):1.0;mem(*):512;disk(*):2048").get();
 
-  size_t slaveCount = GetParam();
-
   // Create slaves.
   for (size_t i = 0; i < slaveCount; ++i) {
     // Simulate real slave information.
@@ -843,12 +1049,13 @@ TEST_P(Registrar_BENCHMARK_Test, Performance)
   // Admit slaves.
   Stopwatch watch;
   watch.start();
+  uint64_t bytes = storedBytes();
   Future<bool> result;
   foreach (const SlaveInfo& info, infos) {
-    result = registrar.apply(Owned<Operation>(new AdmitSlave(info)));
+    result = registrar->apply(Owned<Operation>(new AdmitSlave(info)));
   }
   AWAIT_READY_FOR(result, Minutes(5));
-  LOG(INFO) << "Admitted " << slaveCount << " slaves in " << watch.elapsed();
+  report("Admitted", slaveCount, watch.elapsed(), storedBytes() - bytes);
 
   // Shuffle the slaves so we are readmitting them in random order (
   // same as in production).
@@ -856,11 +1063,16 @@ TEST_P(Registrar_BENCHMARK_Test, Performance)
 
   // Readmit slaves.
   watch.start();
+  bytes = storedBytes();
   foreach (const SlaveInfo& info, infos) {
-    result = registrar.apply(Owned<Operation>(new ReadmitSlave(info)));
+    result = registrar->apply(Owned<Operation>(new ReadmitSlave(info)));
   }
   AWAIT_READY_FOR(result, Minutes(5));
-  LOG(INFO) << "Readmitted " << slaveCount << " slaves in " << watch.elapsed();
+  report("Readmitted", slaveCount, watch.elapsed(), storedBytes() - bytes);
+
+  // Destroy the registrar so that its metrics get removed, which lets
+  // the second registrar add its own.
+  registrar.reset();
 
   // Recover slaves.
   Registrar registrar2(flags, state);
@@ -880,11 +1092,61 @@ TEST_P(Registrar_BENCHMARK_Test, Performance)
 
   // Remove slaves.
   watch.start();
+  bytes = storedBytes();
   foreach (const SlaveInfo& info, infos) {
     result = registrar2.apply(Owned<Operation>(new RemoveSlave(info)));
   }
   AWAIT_READY_FOR(result, Minutes(5));
-  cout << "Removed " << slaveCount << " slaves in " << watch.elapsed() << endl;
+  report("Removed", slaveCount, watch.elapsed(), storedBytes() - bytes);
+}
+
+
+// Measures removing a large fraction of the slaves at once, e.g.,
+// when a rack or an availability zone fails, in which case all the
+// removals get applied in a few large batches.
+TEST_P(Registrar_BENCHMARK_Test, MassRemoval)
+{
+  size_t slaveCount = std::get<0>(GetParam());
+  flags.registry_max_deltas = std::get<1>(GetParam());
+
+  cout << "Using at most " << flags.registry_max_deltas
+       << " registry deltas" << endl;
+
+  Registrar registrar(flags, state);
+  AWAIT_READY(registrar.recover(master));
+
+  vector<SlaveInfo> infos;
+
+  Resources resources =
+    Resources::parse("cpus(*):1.0;mem(*):512;disk(*):2048").get();
+
+  for (size_t i = 0; i < slaveCount; ++i) {
+    SlaveInfo info;
+    info.set_hostname("localhost");
+    info.mutable_id()->set_value(
+        std::string("201310101658-2280333834-5050-48574-") + stringify(i));
+    info.mutable_resources()->MergeFrom(resources);
+    infos.push_back(info);
+  }
+
+  Future<bool> result;
+  foreach (const SlaveInfo& info, infos) {
+    result = registrar.apply(Owned<Operation>(new AdmitSlave(info)));
+  }
+  AWAIT_READY_FOR(result, Minutes(5));
+
+  // Remove half of the slaves, in random order.
+  std::random_shuffle(infos.begin(), infos.end());
+  infos.resize(slaveCount / 2);
+
+  Stopwatch watch;
+  watch.start();
+  uint64_t bytes = storedBytes();
+  foreach (const SlaveInfo& info, infos) {
+    result = registrar.apply(Owned<Operation>(new RemoveSlave(info)));
+  }
+  AWAIT_READY_FOR(result, Minutes(5));
+  report("Removed", infos.size(), watch.elapsed(), storedBytes() - bytes);
 }
 
 } // namespace tests {
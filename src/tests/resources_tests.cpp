@@ -16,9 +16,11 @@
  * limitations under the License.
  */
 
+#include <iostream>
 #include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -26,6 +28,8 @@
 #include <stout/gtest.hpp>
 #include <stout/json.hpp>
 #include <stout/protobuf.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 
 #include "master/master.hpp"
 
@@ -33,14 +37,19 @@
 
 using namespace mesos::internal::master;
 
+using std::cout;
+using std::endl;
 using std::map;
 using std::ostringstream;
 using std::pair;
 using std::set;
 using std::string;
+using std::vector;
 
 using google::protobuf::RepeatedPtrField;
 
+using testing::WithParamInterface;
+
 namespace mesos {
 namespace internal {
 namespace tests {
@@ -1396,6 +1405,99 @@ TEST(RevocableResourceTest, Filter)
   EXPECT_EQ(r1, (r1 + r2).revocable());
 }
 
+
+class Resources_BENCHMARK_Test
+  : public ::testing::Test,
+    public WithParamInterface<size_t> {};
+
+
+// The resources benchmark tests are parameterized by the number of
+// roles an agent's resources are reserved for.
+INSTANTIATE_TEST_CASE_P(
+    RoleCount,
+    Resources_BENCHMARK_Test,
+    ::testing::Values(1U, 10U, 50U));
+
+
+// Measures the arithmetic the master and the allocator perform on
+// the resources of an agent: accumulating allocations, subtracting
+// them from the total, checking containment and equality, and
+// converting to and from protobufs.
+TEST_P(Resources_BENCHMARK_Test, Arithmetic)
+{
+  const size_t roleCount = GetParam();
+  const size_t iterations = 10000;
+
+  Resources total = Resources::parse("ports:[31000-32000]").get();
+  vector<Resources> allocations;
+
+  for (size_t i = 0; i < roleCount; i++) {
+    const string role = "role" + stringify(i);
+
+    total += Resources::parse("cpus:8;mem:8192;disk:65536", role).get();
+
+    allocations.push_back(
+        Resources::parse("cpus:1;mem:512;disk:1024", role).get());
+  }
+
+  cout << "Using " << roleCount << " roles and " << iterations
+       << " iterations" << endl;
+
+  Stopwatch watch;
+  watch.start();
+
+  for (size_t i = 0; i < iterations; i++) {
+    Resources allocated;
+    foreach (const Resources& allocation, allocations) {
+      allocated += allocation;
+    }
+  }
+
+  cout << "Took " << watch.elapsed() << " to add the allocations" << endl;
+
+  watch.start();
+
+  for (size_t i = 0; i < iterations; i++) {
+    Resources available = total;
+    foreach (const Resources& allocation, allocations) {
+      available -= allocation;
+    }
+  }
+
+  cout << "Took " << watch.elapsed() << " to subtract the allocations"
+       << endl;
+
+  watch.start();
+
+  for (size_t i = 0; i < iterations; i++) {
+    foreach (const Resources& allocation, allocations) {
+      ASSERT_TRUE(total.contains(allocation));
+    }
+  }
+
+  cout << "Took " << watch.elapsed() << " to check containment" << endl;
+
+  const Resources copy = total;
+
+  watch.start();
+
+  for (size_t i = 0; i < iterations; i++) {
+    ASSERT_EQ(total, copy);
+  }
+
+  cout << "Took " << watch.elapsed() << " to check equality" << endl;
+
+  watch.start();
+
+  for (size_t i = 0; i < iterations; i++) {
+    const RepeatedPtrField<Resource>& protobufs = total;
+    Resources converted = protobufs;
+  }
+
+  cout << "Took " << watch.elapsed() << " to convert from protobufs"
+       << endl;
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -21,6 +21,7 @@
 
 #include <gtest/gtest.h>
 
+#include <iostream>
 #include <string>
 
 #include <mesos/executor.hpp>
@@ -39,6 +40,7 @@
 #include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/uuid.hpp>
 
 #include "common/protobuf_utils.hpp"
@@ -70,6 +72,8 @@ using google::protobuf::RepeatedPtrField;
 
 using mesos::internal::master::Master;
 
+using std::cout;
+using std::endl;
 using std::map;
 using std::string;
 using std::vector;
@@ -80,6 +84,7 @@ using testing::DoAll;
 using testing::Eq;
 using testing::Return;
 using testing::SaveArg;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -132,6 +137,213 @@ TEST_F(SlaveStateTest, CheckpointRepeatedProtobufMessages)
 }
 
 
+// Checkpoints the state of a slave with a single framework whose
+// executors each have 'runs' runs, of which the last one is the
+// latest and the others are completed. Each run has 'tasks' tasks
+// with a single status update.
+static void checkpointExecutors(
+    const string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    size_t executors,
+    size_t runs,
+    size_t tasks)
+{
+  paths::createSlaveDirectory(rootDir, slaveId);
+
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_id()->CopyFrom(slaveId);
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getSlaveInfoPath(rootDir, slaveId), slaveInfo));
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.mutable_id()->CopyFrom(frameworkId);
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getFrameworkInfoPath(rootDir, slaveId, frameworkId),
+      frameworkInfo));
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getFrameworkPidPath(rootDir, slaveId, frameworkId),
+      "scheduler@127.0.0.1:5050"));
+
+  for (size_t i = 0; i < executors; i++) {
+    ExecutorInfo executorInfo = DEFAULT_EXECUTOR_INFO;
+    executorInfo.mutable_executor_id()->set_value("executor" + stringify(i));
+
+    const ExecutorID& executorId = executorInfo.executor_id();
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getExecutorInfoPath(rootDir, slaveId, frameworkId, executorId),
+        executorInfo));
+
+    for (size_t j = 0; j < runs; j++) {
+      ContainerID containerId;
+      containerId.set_value("run" + stringify(j));
+
+      paths::createExecutorDirectory(
+          rootDir, slaveId, frameworkId, executorId, containerId);
+
+      if (j + 1 < runs) {
+        ASSERT_SOME(slave::state::checkpoint(
+            paths::getExecutorSentinelPath(
+                rootDir, slaveId, frameworkId, executorId, containerId),
+            ""));
+      }
+
+      ASSERT_SOME(slave::state::checkpoint(
+          paths::getForkedPidPath(
+              rootDir, slaveId, frameworkId, executorId, containerId),
+          "1"));
+
+      ASSERT_SOME(slave::state::checkpoint(
+          paths::getLibprocessPidPath(
+              rootDir, slaveId, frameworkId, executorId, containerId),
+          "executor@127.0.0.1:5051"));
+
+      for (size_t k = 0; k < tasks; k++) {
+        TaskInfo taskInfo;
+        taskInfo.set_name("task");
+        taskInfo.mutable_task_id()->set_value("task" + stringify(k));
+        taskInfo.mutable_slave_id()->CopyFrom(slaveId);
+        taskInfo.mutable_executor()->CopyFrom(executorInfo);
+
+        const TaskID& taskId = taskInfo.task_id();
+
+        ASSERT_SOME(slave::state::checkpoint(
+            paths::getTaskInfoPath(
+                rootDir,
+                slaveId,
+                frameworkId,
+                executorId,
+                containerId,
+                taskId),
+            protobuf::createTask(taskInfo, TASK_RUNNING, frameworkId)));
+
+        StatusUpdateRecord record;
+        record.set_type(StatusUpdateRecord::UPDATE);
+        record.mutable_update()->CopyFrom(protobuf::createStatusUpdate(
+            frameworkId,
+            slaveId,
+            taskId,
+            TASK_RUNNING,
+            TaskStatus::SOURCE_EXECUTOR,
+            UUID::random()));
+
+        ASSERT_SOME(slave::state::checkpoint(
+            paths::getTaskUpdatesPath(
+                rootDir,
+                slaveId,
+                frameworkId,
+                executorId,
+                containerId,
+                taskId),
+            record));
+      }
+    }
+  }
+}
+
+
+// This test verifies that the executors of a framework are recovered
+// entirely from their latest run, while of the other runs only the
+// IDs and whether they are completed are recovered.
+TEST_F(SlaveStateTest, RecoverExecutors)
+{
+  const string rootDir = path::join(os::getcwd(), "meta");
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  checkpointExecutors(rootDir, slaveId, frameworkId, 20, 2, 3);
+
+  Result<slave::state::State> recover = slave::state::recover(rootDir, true);
+  ASSERT_SOME(recover);
+  ASSERT_SOME(recover.get().slave);
+  EXPECT_EQ(0u, recover.get().errors);
+
+  ASSERT_TRUE(recover.get().slave.get().frameworks.contains(frameworkId));
+
+  const slave::state::FrameworkState& framework =
+    recover.get().slave.get().frameworks.get(frameworkId).get();
+
+  ASSERT_EQ(20u, framework.executors.size());
+
+  ContainerID stale;
+  stale.set_value("run0");
+
+  ContainerID latest;
+  latest.set_value("run1");
+
+  foreachvalue (const slave::state::ExecutorState& executor,
+                framework.executors) {
+    ASSERT_SOME(executor.info);
+    ASSERT_SOME_EQ(latest, executor.latest);
+    ASSERT_EQ(2u, executor.runs.size());
+
+    const slave::state::RunState& run = executor.runs.get(latest).get();
+    EXPECT_FALSE(run.completed);
+    EXPECT_SOME(run.forkedPid);
+    EXPECT_SOME(run.libprocessPid);
+    EXPECT_EQ(3u, run.tasks.size());
+
+    const slave::state::RunState& completed = executor.runs.get(stale).get();
+    EXPECT_SOME_EQ(stale, completed.id);
+    EXPECT_TRUE(completed.completed);
+    EXPECT_TRUE(completed.tasks.empty());
+  }
+}
+
+
+class SlaveState_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<size_t> {};
+
+
+// The slave state benchmark tests are parameterized by the number of
+// executors, each with a completed and a latest run of 10 tasks.
+INSTANTIATE_TEST_CASE_P(
+    ExecutorCount,
+    SlaveState_BENCHMARK_Test,
+    ::testing::Values(100U, 1000U, 10000U));
+
+
+TEST_P(SlaveState_BENCHMARK_Test, Recover)
+{
+  const size_t executorCount = GetParam();
+
+  const string rootDir = path::join(os::getcwd(), "meta");
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  checkpointExecutors(rootDir, slaveId, frameworkId, executorCount, 2, 10);
+
+  Stopwatch watch;
+  watch.start();
+
+  Result<slave::state::State> recover = slave::state::recover(rootDir, true);
+
+  cout << "Recovered " << executorCount << " executors in "
+       << watch.elapsed() << endl;
+
+  ASSERT_SOME(recover);
+  ASSERT_SOME(recover.get().slave);
+  EXPECT_EQ(
+      executorCount,
+      recover.get().slave.get().frameworks.get(frameworkId).get()
+        .executors.size());
+}
+
+
 template <typename T>
 class SlaveRecoveryTest : public ContainerizerTest<T>
 {
@@ -21,12 +21,16 @@
 
 #include <gmock/gmock.h>
 
+#include <iostream>
 #include <list>
 #include <string>
+#include <vector>
 
 #include <mesos/resources.hpp>
 
 #include <stout/gtest.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 
 #include "master/allocator/sorter/drf/sorter.hpp"
 
@@ -34,8 +38,13 @@
 
 using mesos::internal::master::allocator::DRFSorter;
 
+using std::cout;
+using std::endl;
 using std::list;
 using std::string;
+using std::vector;
+
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -449,6 +458,141 @@ TEST(SorterTest, RevocableResources)
   EXPECT_EQ("b", sorted.back());
 }
 
+
+// This test verifies that activating a client that is already active
+// does not make it show up in the sort more than once.
+TEST(SorterTest, ActivateActiveClient)
+{
+  DRFSorter sorter;
+
+  SlaveID slaveId;
+  slaveId.set_value("slaveId");
+
+  sorter.add(slaveId, Resources::parse("cpus:10;mem:100").get());
+
+  sorter.add("a");
+  sorter.add("b");
+
+  sorter.allocated("a", slaveId, Resources::parse("cpus:2;mem:1").get());
+  sorter.allocated("b", slaveId, Resources::parse("cpus:1;mem:1").get());
+
+  // Clients are active once added.
+  sorter.activate("a");
+  sorter.activate("a");
+
+  list<string> sorted = sorter.sort();
+  ASSERT_EQ(2u, sorted.size());
+  EXPECT_EQ("b", sorted.front());
+  EXPECT_EQ("a", sorted.back());
+
+  // Deactivating the client once must remove it from the sort.
+  sorter.deactivate("a");
+
+  sorted = sorter.sort();
+  ASSERT_EQ(1u, sorted.size());
+  EXPECT_EQ("b", sorted.front());
+
+  EXPECT_TRUE(sorter.contains("a"));
+  EXPECT_EQ(2, sorter.count());
+}
+
+
+class Sorter_BENCHMARK_Test
+  : public ::testing::Test,
+    public WithParamInterface<size_t> {};
+
+
+// The sorter benchmark tests are parameterized by the number of
+// clients.
+INSTANTIATE_TEST_CASE_P(
+    ClientCount,
+    Sorter_BENCHMARK_Test,
+    ::testing::Values(1000U, 5000U, 10000U));
+
+
+// Measures the sorter operations that the allocator performs:
+// adding clients and slaves, sorting the clients, and allocating and
+// recovering resources.
+TEST_P(Sorter_BENCHMARK_Test, Operations)
+{
+  size_t clientCount = GetParam();
+
+  cout << "Using " << clientCount << " clients" << endl;
+
+  DRFSorter sorter;
+
+  vector<string> clients;
+  vector<SlaveID> slaveIds;
+
+  for (size_t i = 0; i < clientCount; i++) {
+    clients.push_back("client" + stringify(i));
+
+    SlaveID slaveId;
+    slaveId.set_value("slave" + stringify(i));
+    slaveIds.push_back(slaveId);
+  }
+
+  Resources resources = Resources::parse(
+      "cpus:2;mem:1024;disk:4096;ports:[31000-32000]").get();
+
+  Stopwatch watch;
+  watch.start();
+
+  foreach (const string& client, clients) {
+    sorter.add(client);
+  }
+
+  foreach (const SlaveID& slaveId, slaveIds) {
+    sorter.add(slaveId, resources);
+  }
+
+  cout << "Added " << clientCount << " clients and slaves"
+       << " in " << watch.elapsed() << endl;
+
+  watch.start();
+
+  // All shares have to be recalculated since the total has changed.
+  sorter.sort();
+
+  cout << "Sorted " << clientCount << " clients after a change of the"
+       << " total in " << watch.elapsed() << endl;
+
+  watch.start();
+
+  // Allocate a different fraction of a slave to each client so that
+  // the clients end up with different shares.
+  for (size_t i = 0; i < clientCount; i++) {
+    sorter.allocated(
+        clients[i],
+        slaveIds[i],
+        Resources::parse("cpus:" + stringify(i % 20 / 10.0)).get());
+  }
+
+  cout << "Allocated to " << clientCount << " clients"
+       << " in " << watch.elapsed() << endl;
+
+  watch.start();
+
+  list<string> sorted = sorter.sort();
+
+  cout << "Sorted " << clientCount << " clients in "
+       << watch.elapsed() << endl;
+
+  EXPECT_EQ(clientCount, sorted.size());
+
+  watch.start();
+
+  for (size_t i = 0; i < clientCount; i++) {
+    sorter.unallocated(
+        clients[i],
+        slaveIds[i],
+        Resources::parse("cpus:" + stringify(i % 20 / 10.0)).get());
+  }
+
+  cout << "Unallocated from " << clientCount << " clients"
+       << " in " << watch.elapsed() << endl;
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
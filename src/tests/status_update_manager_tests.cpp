@@ -18,14 +18,17 @@
 
 #include <gmock/gmock.h>
 
+#include <iostream>
 #include <list>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <mesos/executor.hpp>
 #include <mesos/scheduler.hpp>
 
 #include <process/clock.hpp>
+#include <process/collect.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/pid.hpp>
@@ -34,14 +37,18 @@
 #include <stout/os.hpp>
 #include <stout/protobuf.hpp>
 #include <stout/result.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/try.hpp>
 
+#include "common/protobuf_utils.hpp"
+
 #include "master/master.hpp"
 
 #include "slave/constants.hpp"
 #include "slave/paths.hpp"
 #include "slave/slave.hpp"
 #include "slave/state.hpp"
+#include "slave/status_update_manager.hpp"
 
 #include "messages/messages.hpp"
 
@@ -50,19 +57,24 @@
 using mesos::internal::master::Master;
 
 using mesos::internal::slave::Slave;
+using mesos::internal::slave::StatusUpdateManager;
 
 using process::Clock;
 using process::Future;
 using process::PID;
 
+using std::cout;
+using std::endl;
 using std::list;
 using std::string;
+using std::tuple;
 using std::vector;
 
 using testing::_;
 using testing::AtMost;
 using testing::Return;
 using testing::SaveArg;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -842,6 +854,194 @@ TEST_F(StatusUpdateManagerTest, LatestTaskState)
   Shutdown();
 }
 
+// This test verifies that with group commit the futures of
+// checkpointed status updates and acknowledgements are only
+// satisfied at the end of the commit window, and that the records
+// are on disk by then.
+TEST_F(StatusUpdateManagerTest, GroupCommit)
+{
+  slave::Flags flags = CreateSlaveFlags();
+  flags.status_update_group_commit_window = Milliseconds(100);
+
+  StatusUpdateManager manager(flags);
+  manager.initialize([](StatusUpdate) {});
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorID executorId;
+  executorId.set_value("executor");
+
+  ContainerID containerId;
+  containerId.set_value("container");
+
+  TaskID taskId1;
+  taskId1.set_value("task1");
+
+  TaskID taskId2;
+  taskId2.set_value("task2");
+
+  StatusUpdate update1 = protobuf::createStatusUpdate(
+      frameworkId,
+      slaveId,
+      taskId1,
+      TASK_FINISHED,
+      TaskStatus::SOURCE_EXECUTOR,
+      UUID::random());
+
+  StatusUpdate update2 = protobuf::createStatusUpdate(
+      frameworkId,
+      slaveId,
+      taskId2,
+      TASK_FINISHED,
+      TaskStatus::SOURCE_EXECUTOR,
+      UUID::random());
+
+  Clock::pause();
+
+  Future<Nothing> updated1 =
+    manager.update(update1, slaveId, executorId, containerId);
+  Future<Nothing> updated2 =
+    manager.update(update2, slaveId, executorId, containerId);
+
+  Clock::settle();
+
+  EXPECT_TRUE(updated1.isPending());
+  EXPECT_TRUE(updated2.isPending());
+
+  Clock::advance(flags.status_update_group_commit_window);
+
+  AWAIT_READY(updated1);
+  AWAIT_READY(updated2);
+
+  const string path = slave::paths::getTaskUpdatesPath(
+      slave::paths::getMetaRootDir(flags.work_dir),
+      slaveId,
+      frameworkId,
+      executorId,
+      containerId,
+      taskId1);
+
+  Result<StatusUpdateRecord> record =
+    ::protobuf::read<StatusUpdateRecord>(path);
+
+  ASSERT_SOME(record);
+  EXPECT_EQ(StatusUpdateRecord::UPDATE, record.get().type());
+  EXPECT_EQ(update1.uuid(), record.get().update().uuid());
+
+  Future<bool> acknowledged = manager.acknowledgement(
+      taskId1, frameworkId, UUID::fromBytes(update1.uuid()));
+
+  Clock::settle();
+
+  EXPECT_TRUE(acknowledged.isPending());
+
+  Clock::advance(flags.status_update_group_commit_window);
+
+  // The stream is terminated by the acknowledgement.
+  AWAIT_EXPECT_FALSE(acknowledged);
+
+  Clock::resume();
+}
+
+
+class StatusUpdateManager_BENCHMARK_Test
+  : public MesosTest,
+    public WithParamInterface<tuple<size_t, Duration>>
+{
+protected:
+  static void report(
+      const string& operation,
+      size_t count,
+      const Duration& elapsed)
+  {
+    cout << operation << " " << count << " status updates in " << elapsed
+         << " (" << (count / elapsed.secs()) << " updates/sec)" << endl;
+  }
+};
+
+
+// The status update manager benchmark tests are parameterized by the
+// number of tasks and the group commit window.
+INSTANTIATE_TEST_CASE_P(
+    TaskCountAndCommitWindow,
+    StatusUpdateManager_BENCHMARK_Test,
+    ::testing::Combine(
+        ::testing::Values(1000U, 10000U),
+        ::testing::Values(Duration::zero(), Milliseconds(5))));
+
+
+// Measures how many checkpointed status updates (and their
+// acknowledgements) per second the status update manager handles
+// when all tasks of a framework change their state at once.
+TEST_P(StatusUpdateManager_BENCHMARK_Test, CheckpointedUpdates)
+{
+  size_t taskCount = std::get<0>(GetParam());
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.status_update_group_commit_window = std::get<1>(GetParam());
+
+  cout << "Using a group commit window of "
+       << flags.status_update_group_commit_window << endl;
+
+  StatusUpdateManager manager(flags);
+  manager.initialize([](StatusUpdate) {});
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorID executorId;
+  executorId.set_value("executor");
+
+  ContainerID containerId;
+  containerId.set_value("container");
+
+  vector<StatusUpdate> updates;
+  for (size_t i = 0; i < taskCount; i++) {
+    TaskID taskId;
+    taskId.set_value("task" + stringify(i));
+
+    updates.push_back(protobuf::createStatusUpdate(
+        frameworkId,
+        slaveId,
+        taskId,
+        TASK_FINISHED,
+        TaskStatus::SOURCE_EXECUTOR,
+        UUID::random()));
+  }
+
+  Stopwatch watch;
+  watch.start();
+
+  list<Future<Nothing>> updated;
+  foreach (const StatusUpdate& update, updates) {
+    updated.push_back(
+        manager.update(update, slaveId, executorId, containerId));
+  }
+
+  AWAIT_READY_FOR(collect(updated), Minutes(5));
+  report("Checkpointed", taskCount, watch.elapsed());
+
+  watch.start();
+
+  list<Future<bool>> acknowledged;
+  foreach (const StatusUpdate& update, updates) {
+    acknowledged.push_back(manager.acknowledgement(
+        update.status().task_id(),
+        frameworkId,
+        UUID::fromBytes(update.uuid())));
+  }
+
+  AWAIT_READY_FOR(collect(acknowledged), Minutes(5));
+  report("Acknowledged", taskCount, watch.elapsed());
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {